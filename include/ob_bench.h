@@ -0,0 +1,85 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @file
+ * @brief Time to online benchmark on the simulated wifi driver.
+ *
+ * The benchmark takes the station offline through the simulated driver and
+ * measures how long each onboarding flow takes to bring the network back
+ * to L4 connected, using the credentials of the first simulated AP:
+ * - stored: the AP drops the station, which reconnects with its profile
+ * - portal: the profiles are removed, and the credentials are posted to
+ *   the captive portal once the bring-up asks for them
+ * - gatt: the same with the credentials written over GATT
+ * - reprovision: the passphrase of the AP changes, and the new one is
+ *   posted to the captive portal CONFIG_ONBOARDING_BENCH_REPROVISION_DELAY
+ *   milliseconds after the station dropped
+ *
+ * The stored and reprovision flows are timed from the drop, the portal and
+ * gatt flows from the submission of the credentials. Each flow prints one
+ * JSON object with the distribution of the time to L4 connected and the
+ * mean duration of each phase of the timelines, followed by the heap high
+ * water mark and the stack usage of each thread. The profiles of the device
+ * are replaced by the credentials of the benchmark.
+ */
+
+/**
+ * @brief the flows of the benchmark
+ */
+enum ob_bench_flow {
+  /** @brief reconnect with the stored profile */
+  OB_BENCH_STORED,
+  /** @brief provision from the captive portal */
+  OB_BENCH_PORTAL,
+  /** @brief provision over GATT */
+  OB_BENCH_GATT,
+  /** @brief provision a new passphrase while the stored one fails */
+  OB_BENCH_REPROVISION,
+  /** @brief the number of flows */
+  OB_BENCH_FLOWS,
+  /** @brief every flow */
+  OB_BENCH_ALL = -1
+};
+
+/**
+ * @brief print one line of the report
+ *
+ * @param line the line, a JSON object without a line feed
+ * @param user_data the user data given to ob_bench_start()
+ */
+typedef void (*ob_bench_print_t)(const char * line, void * user_data);
+
+/**
+ * @brief start the benchmark in the background
+ *
+ * @param flow the flow, OB_BENCH_ALL for every flow
+ * @param runs the number of runs of each flow, at most CONFIG_ONBOARDING_BENCH_MAX_RUNS
+ * @param print called with each line of the report, from the benchmark thread
+ * @param user_data passed to print
+ * @return 0 on success
+ * @return -EINVAL if the flow or the number of runs is invalid
+ * @return -EBUSY if the benchmark is running
+ */
+int ob_bench_start(enum ob_bench_flow flow, int runs, ob_bench_print_t print, void * user_data);
+
+/**
+ * @brief check if the benchmark is running
+ *
+ * @return true if it is running
+ */
+bool ob_bench_running(void);
+
+/**
+ * @brief get the name of a flow
+ *
+ * @param flow the flow
+ * @return the name
+ */
+const char * ob_bench_flow_str(enum ob_bench_flow flow);
@@ -26,6 +26,10 @@ extern k_timeout_t SCAN_TIMEOUT;
 #define BT_UUID_CUSTOM_SET_AP_VAL \
   BT_UUID_128_ENCODE(0x9c3a708e, 0x2f6c, 0x4336, 0x8a68, 0x4612a886dc81)
 
+/** @brief The UUID for the protocol version and AP list format charactaristic is 2b7e6a55-0c1f-4d8e-9a31-5e8c7d2f1b04 */
+#define BT_UUID_CUSTOM_VERSION_VAL \
+  BT_UUID_128_ENCODE(0x2b7e6a55, 0x0c1f, 0x4d8e, 0x9a31, 0x5e8c7d2f1b04)
+
 
 #define BLUETOOTH_LOG_MODULE_NAME bluetooth
 #define BLUETOOTH_LOG_MODULE_LEVEL LOG_LEVEL_DBG
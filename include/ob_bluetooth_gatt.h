@@ -4,6 +4,41 @@
  */
 
 #pragma once
+#include <zephyr/sys/util.h>
 #include "ob_bluetooth.h"
 
 extern struct obb_mode obb_mode_gatt;
+
+/** @brief the version of the GATT protocol read from the version characteristic */
+#define OB_GATT_PROTOCOL_VERSION 1
+
+/** @brief the AP list is a JSON array of {"ssid","secure","strength"} objects */
+#define OB_GATT_AP_LIST_JSON 0
+/**
+ * @brief the AP list is a list of binary TLV records
+ * @details the list starts with OB_GATT_PROTOCOL_VERSION and the number of
+ * records, each record is a type byte, a length byte and the value
+ */
+#define OB_GATT_AP_LIST_TLV  1
+
+/**
+ * @brief the type of a TLV record holding an AP
+ * @details the value is the SSID length, the SSID, the OB_GATT_AP_FLAG_*
+ * flags and the RSSI in dBm as a signed byte
+ */
+#define OB_GATT_TLV_AP 0x01
+
+/** @brief the AP is secured */
+#define OB_GATT_AP_FLAG_SECURE BIT(0)
+/** @brief the AP is in the 5 GHz band */
+#define OB_GATT_AP_FLAG_5GHZ   BIT(1)
+
+/**
+ * @brief connect the station as if the credentials were written to the current AP characteristic
+ * @details the credentials are saved once the station has an address, no
+ * notification is sent
+ *
+ * @param ssid the SSID, NUL terminated
+ * @param psk the PSK, NUL terminated
+ */
+void ob_bluetooth_gatt_join(const char *ssid, const char *psk);
@@ -11,3 +11,16 @@
  * return -1 on error
  **/
 int ob_cp_init();
+
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+/**
+ * @brief connect the station as if the credentials were posted to the setup page
+ * @details the credentials are saved once the station has an address
+ *
+ * @param ssid the SSID, NUL terminated
+ * @param psk the PSK, NUL terminated
+ * @return 0 if the connection was started
+ * @return a negative errno on failure
+ **/
+int ob_cp_join(const char * ssid, const char * psk);
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ob_web_server.h"
+
+/**
+ * @file
+ * @brief Incremental parsers for HTTP requests and text/plain POST bodies.
+ *
+ * The parsers are fed bytes as they arrive from the client and never touch a
+ * socket, so they can be built and exercised on the host. They only use the C
+ * library and keep all of their state in the parser structure.
+ */
+
+/** @brief the maximum number of bytes accepted in the request line and headers */
+#define OB_HTTP_MAX_HEADER_LEN 2048
+
+/** @brief the largest Content-Length accepted from a client */
+#define OB_HTTP_MAX_CONTENT_LENGTH 4096
+
+/** @brief the size of the buffer used to match header names */
+#define OB_HTTP_HEADER_NAME_LEN 16
+
+/**
+ * @brief HTTP methods understood by the web server
+ */
+typedef enum ob_http_method {
+  /** @brief unsupported operation requested */
+  OB_HTTP_METHOD_UNKNOWN,
+  /** @brief GET opertation requested */
+  OB_HTTP_METHOD_GET,
+  /** @brief POST operation requested */
+  OB_HTTP_METHOD_POST
+} ob_http_method_t;
+
+/**
+ * @brief results returned by the feed functions
+ */
+typedef enum ob_http_parse_result {
+  /** @brief the parser needs more data */
+  OB_HTTP_PARSE_MORE = 0,
+  /** @brief the request headers are complete */
+  OB_HTTP_PARSE_DONE = 1,
+  /** @brief the request is malformed or exceeds a limit */
+  OB_HTTP_PARSE_ERROR = -1
+} ob_http_parse_result_t;
+
+/**
+ * @struct ob_http_request_parser
+ * @brief state of the request line and header parser
+ */
+struct ob_http_request_parser {
+  /** @brief the method of the request */
+  ob_http_method_t method;
+  /** @brief the path of the request, NUL terminated */
+  char path[MAX_WEB_PATH_NAME_LEN];
+  /** @brief the value of the Content-Length header, 0 if absent */
+  int content_length;
+  /** @brief the number of bytes consumed so far */
+  int consumed;
+  /** @brief internal parser state */
+  int state;
+  /** @brief number of bytes in the current token */
+  int token_len;
+  /** @brief buffer for the method and header names */
+  char token[OB_HTTP_HEADER_NAME_LEN];
+};
+
+/**
+ * @brief initialize a request parser
+ *
+ * @param p the parser to initialize
+ */
+void ob_http_request_parser_init(struct ob_http_request_parser *p);
+
+/**
+ * @brief feed bytes of a request to the parser
+ *
+ * Parsing stops at the blank line that terminates the headers. Bytes after
+ * that point are not consumed.
+ *
+ * @param p the parser
+ * @param buf the data received from the client
+ * @param len the number of bytes in buf
+ * @param[out] used the number of bytes consumed, may be NULL
+ *
+ * @return OB_HTTP_PARSE_MORE if more data is needed
+ * @return OB_HTTP_PARSE_DONE when the headers are complete
+ * @return OB_HTTP_PARSE_ERROR if the request is malformed or too large
+ */
+ob_http_parse_result_t ob_http_request_parser_feed(struct ob_http_request_parser *p,
+                                                   const char *buf, size_t len,
+                                                   size_t *used);
+
+/**
+ * @struct ob_post_parser
+ * @brief state of the text/plain POST body parser
+ *
+ * The body is a sequence of name=value lines. Each value is copied into the
+ * valuebuffer of the post_attributes_t entry with the same name.
+ */
+struct ob_post_parser {
+  /** @brief the attributes to fill in */
+  post_attributes_t *ap;
+  /** @brief the number of attributes */
+  int num_ap;
+  /** @brief the attribute currently receiving a value, NULL while parsing a name */
+  post_attributes_t *cp;
+  /** @brief the name being parsed */
+  char name[NAME_BUFFER_SIZE];
+  /** @brief the number of bytes in name or in the current value */
+  int len;
+  /** @brief set once an error has been detected */
+  int error;
+};
+
+/**
+ * @brief initialize a POST body parser
+ *
+ * The valuebuffer of every attribute is cleared.
+ *
+ * @param p the parser to initialize
+ * @param ap A pointer to an array of post_attribute_t structures
+ * @param num_ap The number of elements in the ap array.
+ */
+void ob_post_parser_init(struct ob_post_parser *p, post_attributes_t *ap, int num_ap);
+
+/**
+ * @brief feed bytes of a POST body to the parser
+ *
+ * @param p the parser
+ * @param buf the body data
+ * @param len the number of bytes in buf
+ *
+ * @return 0 on success
+ * @return -EINVAL if an attribute is unknown or a name or value is too long
+ */
+int ob_post_parser_feed(struct ob_post_parser *p, const char *buf, size_t len);
+
+/**
+ * @brief terminate the value of the last attribute
+ *
+ * Browsers may omit the line ending after the last attribute.
+ *
+ * @param p the parser
+ *
+ * @return 0 on success
+ * @return -EINVAL if an error was detected while parsing
+ */
+int ob_post_parser_finish(struct ob_post_parser *p);
@@ -70,6 +70,13 @@ int ob_nvs_data_read(const char *name, void * buffer, int len);
  * @return -1 on error
  **/
 int ob_nvs_data_write(const char *name, void * buffer, int len);
+/**
+ * @brief delete a record from the nvs store
+ * @param name - the name of the data record
+ * @return 0 on success
+ * @return a negative errno on error
+ **/
+int ob_nvs_data_delete(const char *name);
 /**
  * @brief deletes the data in the nvs partition
  * This function deletes all records in the nvs partition
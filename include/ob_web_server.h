@@ -201,6 +201,9 @@ ssize_t sendall(int sock, const void *buf, size_t len);
  * @param num_ap The number of elements in the ap array.
  * @param wp a pointer to the web_page_t instance for this web page
  *
+ * @return 0 on success
+ * @return -EINVAL if an attribute is unknown or its value does not fit in the valuebuffer
+ * @return a negative errno on a socket error
  */
 int ob_ws_process_post(int client,  post_attributes_t* ap, int num_ap, web_page_t * wp);
 /**
@@ -7,13 +7,16 @@
 #pragma once
 
 #include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/net/wifi.h>
 
 /**
  * @struct ssid_item
  * @brief a structre representing the discoverd SSIDs
  *
- * This structure is used in a linke list to hold all the SSIDs discovered
- * by a wifi scan
+ * The items of a scan live in a fixed size table inside the scan snapshot.
+ * They are linked from the strongest to the weakest signal.
  */
 struct ssid_item {
   /**
@@ -22,10 +25,10 @@ struct ssid_item {
   */
   struct ssid_item * next;
   /**
-   * @var char * ssid
+   * @var char ssid[WIFI_SSID_MAX_LEN + 1]
    * @brief the name of the ssid
    */
-  char * ssid;
+  char ssid[WIFI_SSID_MAX_LEN + 1];
   /**
    * @var int len
    * @brief length of the ssid
@@ -36,11 +39,36 @@ struct ssid_item {
    * @brief the signal strenth of the wifi network (0-100 scale)
    */
   int signal_strength;
+  /**
+   * @var int rssi
+   * @brief the strongest RSSI seen for the ssid in dBm
+   */
+  int rssi;
+  /**
+   * @var uint8_t channel
+   * @brief the channel of the strongest BSS for the ssid
+   */
+  uint8_t channel;
+  /**
+   * @var uint8_t band
+   * @brief the band (enum wifi_frequency_bands) of the strongest BSS for the ssid
+   */
+  uint8_t band;
+  /**
+   * @var uint8_t bssid[WIFI_MAC_ADDR_LEN]
+   * @brief the BSSID of the strongest BSS for the ssid
+   */
+  uint8_t bssid[WIFI_MAC_ADDR_LEN];
   /**
    * @var bool security
    * @brief boolean indicating whether the network is secure or open
    */
   bool security;
+  /**
+   * @var uint8_t security_type
+   * @brief the security (enum wifi_security_type) of the strongest BSS for the ssid
+   */
+  uint8_t security_type;
 };
 /**
  * @brief alias for a struct ssid_item
@@ -55,17 +83,124 @@ extern char  wifi_ap_address[];
 
 /** @brief the data record identifier for the SSID to connect with */
 #define NVS_SETTINGS_ID_WIFI_SSID     "ob/wifi/ssid"
+/** @brief the data record identifier for the BSSID, channel, band and security of the last association */
+#define NVS_SETTINGS_ID_WIFI_BSS      "ob/wifi/bss"
 /** @brief the data record identifier for the PSK of the SSID to connect with */
 #define NVS_SETTINGS_ID_WIFI_PSK      "ob/wifi/psk"
+/** @brief the data record identifier for the precomputed WPA2 PMK of the SSID to connect with */
+#define NVS_SETTINGS_ID_WIFI_PMK      "ob/wifi/pmk"
 /** @brief the data record identifier for the host name of the device */
 #define NVS_SETTINGS_ID_HOSTNAME "ob/hostname"
 
+/**
+ * @struct ob_wifi_bss
+ * @brief an AP of a network
+ */
+struct ob_wifi_bss {
+  /** @brief the BSSID of the AP */
+  uint8_t bssid[WIFI_MAC_ADDR_LEN];
+  /** @brief the channel of the AP */
+  uint8_t channel;
+  /** @brief the band (enum wifi_frequency_bands) of the AP */
+  uint8_t band;
+  /** @brief the security (enum wifi_security_type) of the AP */
+  uint8_t security;
+};
+
+/** @brief the number of 2.4 GHz channels */
+#define OB_WIFI_CHANNELS_2_4_GHZ 14
+
+/**
+ * @struct ob_wifi_scan_snapshot
+ * @brief the results of one completed wifi scan
+ *
+ * Snapshots are allocated from a pool of CONFIG_ONBOARDING_WIFI_SCAN_SNAPSHOTS
+ * fixed size tables, their size does not depend on the number of visible
+ * APs. A snapshot is immutable once published. It is reference counted, a
+ * consumer that keeps a snapshot after its callback returns must take a
+ * reference with ob_wifi_scan_ref() and drop it with ob_wifi_scan_unref().
+ */
+struct ob_wifi_scan_snapshot {
+  /**
+   * @var atomic_t refcount
+   * @brief the number of references held on the snapshot
+   */
+  atomic_t refcount;
+  /**
+   * @var int64_t timestamp
+   * @brief the uptime in milliseconds when the scan completed
+   */
+  int64_t timestamp;
+  /**
+   * @var int32_t duration_ms
+   * @brief the time the scan took in milliseconds
+   */
+  int32_t duration_ms;
+  /**
+   * @var int count
+   * @brief the number of SSIDs in the list
+   */
+  int count;
+  /**
+   * @var ssid_item_t * head
+   * @brief the linked list of SSIDs found by the scan, strongest first
+   */
+  ssid_item_t * head;
+  /**
+   * @var int dropped
+   * @brief the number of results discarded because the table or the scan ring was full
+   */
+  int dropped;
+#ifdef CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+  /**
+   * @var uint8_t bss_count[OB_WIFI_CHANNELS_2_4_GHZ]
+   * @brief the number of BSSes heard on each 2.4 GHz channel, channel 1 first
+   * @details counted from every result of the scan, before they are
+   * deduplicated by SSID
+   */
+  uint8_t bss_count[OB_WIFI_CHANNELS_2_4_GHZ];
+  /**
+   * @var uint16_t rssi_sum[OB_WIFI_CHANNELS_2_4_GHZ]
+   * @brief the sum of the RSSI above -100 dBm of the BSSes of each 2.4 GHz channel
+   */
+  uint16_t rssi_sum[OB_WIFI_CHANNELS_2_4_GHZ];
+#endif // CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+  /**
+   * @var ssid_item_t items[CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS]
+   * @brief storage for the SSIDs
+   */
+  ssid_item_t items[CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS];
+};
+/**
+ * @brief alias for a struct ob_wifi_scan_snapshot
+ */
+typedef struct ob_wifi_scan_snapshot ob_wifi_scan_snapshot_t;
+
 /**
  * @brief signature for the callback when a wifi scan is completed
  *
- * @param it pointer to the linked list of ssid_item_t items found
- */ 
-typedef void(*scan_done_callback_t)(ssid_item_t * it);
+ * @param snap the scan results, NULL if the scan failed. The snapshot is only
+ *        guaranteed to be valid for the duration of the callback.
+ * @param user_data the pointer passed when subscribing
+ */
+typedef void(*ob_wifi_scan_cb_t)(ob_wifi_scan_snapshot_t * snap, void * user_data);
+
+/**
+ * @struct ob_wifi_scan_subscriber
+ * @brief a request for scan results
+ *
+ * The structure is owned by the caller and must stay valid until the
+ * callback has been called.
+ */
+struct ob_wifi_scan_subscriber {
+  /** @brief list node, used internally */
+  sys_snode_t node;
+  /** @brief the function to call with the results */
+  ob_wifi_scan_cb_t callback;
+  /** @brief application data passed to the callback */
+  void * user_data;
+};
+
 /**
  * @brief signature for the callback when an IPV4 address is acquired
  */
@@ -78,31 +213,308 @@ typedef void(*address_add_callback_t)(void);
  */
 void set_address_add_callback(address_add_callback_t callback);
 /**
- * @brief set the callback address to be called when a wifi scan completes.
+ * @brief the reasons reported at the end of a connection
+ */
+typedef enum ob_wifi_connect_reason {
+  /** @brief connected and an address was bound */
+  OB_WIFI_CONNECT_OK = 0,
+  /** @brief the driver kept rejecting the connect request */
+  OB_WIFI_CONNECT_ERR_REQUEST,
+  /** @brief the association was refused, e.g. a wrong PSK or an unknown SSID */
+  OB_WIFI_CONNECT_ERR_ASSOC,
+  /** @brief no connect result was received in time */
+  OB_WIFI_CONNECT_ERR_ASSOC_TIMEOUT,
+  /** @brief associated but DHCP did not bind an address in time */
+  OB_WIFI_CONNECT_ERR_DHCP_TIMEOUT,
+  /** @brief the AP disconnected the station before an address was bound */
+  OB_WIFI_CONNECT_ERR_DISCONNECTED,
+  /** @brief the connection was cancelled with ob_wifi_connect_cancel() */
+  OB_WIFI_CONNECT_ERR_CANCELLED
+} ob_wifi_connect_reason_t;
+
+/**
+ * @struct ob_wifi_connect_result
+ * @brief the outcome of a connection reported to the completion callback
+ */
+struct ob_wifi_connect_result {
+  /** @brief the reason the connection ended, of the last attempt on failure */
+  ob_wifi_connect_reason_t reason;
+  /** @brief the status reported by the driver for the last attempt, 0 if none */
+  int status;
+  /** @brief the number of connect requests issued */
+  int attempts;
+  /** @brief milliseconds from ob_wifi_connect_async() to the completion */
+  int32_t elapsed_ms;
+};
+
+/**
+ * @brief the completion callback of ob_wifi_connect_async()
  *
- * @param callback the address of the callback function
+ * Called on the wifi connect work queue, or in the context of
+ * ob_wifi_connect_cancel(). It must not block.
+ *
+ * @param result the outcome of the connection
+ * @param user_data the user data passed to ob_wifi_connect_async()
  */
-void set_scan_done_callback(scan_done_callback_t callback);
+typedef void(*ob_wifi_connect_cb_t)(const struct ob_wifi_connect_result * result, void * user_data);
+
+/** @brief max_attempts value that retries until the connection is cancelled */
+#define OB_WIFI_CONNECT_ATTEMPTS_FOREVER (-1)
+
+/**
+ * @struct ob_wifi_connect_params
+ * @brief parameters of ob_wifi_connect_async()
+ */
+struct ob_wifi_connect_params {
+  /** @brief the SSID, NUL terminated. NULL to use the configured credentials */
+  const char * ssid;
+  /** @brief the PSK, NUL terminated. NULL or empty for an open network */
+  const char * psk;
+  /**
+   * @brief the number of full connection attempts before giving up
+   * @details 0 uses CONFIG_ONBOARDING_WIFI_CONNECT_ATTEMPTS,
+   * OB_WIFI_CONNECT_ATTEMPTS_FOREVER retries until cancelled
+   */
+  int max_attempts;
+  /**
+   * @brief the AP the first attempt targets
+   * @details NULL to target the BSS of the last association with
+   * CONFIG_ONBOARDING_WIFI_FAST_CONNECT
+   */
+  const struct ob_wifi_bss * bss;
+};
+
 /**
- * @brief provide a linked list when a wifi scan completes.
+ * @brief start connecting wifi to an access point
  *
- * @param pointer to the linked list of scan items
+ * The connection is driven by a state machine on a dedicated work queue and
+ * the call returns immediately. If params->bss is set, or
+ * CONFIG_ONBOARDING_WIFI_FAST_CONNECT is set and the BSS of the last
+ * association with the SSID is known, a connection to that BSSID and channel
+ * is tried first. Full scan connections are then
+ * retried with an exponential backoff with jitter, each bounded by
+ * CONFIG_ONBOARDING_WIFI_CONNECT_TIMEOUT.
+ *
+ * @param params the network to connect to, NULL to use the configured credentials
+ * @param callback called once when the connection succeeds, fails or is cancelled, may be NULL
+ * @param user_data passed to the callback
+ * @return 0 if the connection was started
+ * @return -EBUSY if a connection is already in progress
+ * @return -EINVAL if the credentials are invalid
+ * @return -EAGAIN if ob_wifi_init() has not been called
+ * @return -ENODEV if there is no station interface
  */
-void scan_complete(ssid_item_t *item);
+int ob_wifi_connect_async(const struct ob_wifi_connect_params * params,
+                          ob_wifi_connect_cb_t callback, void * user_data);
+
 /**
- * @brief conntect wifi to an access point
+ * @brief cancel the connection in progress
+ *
+ * The completion callback is called with OB_WIFI_CONNECT_ERR_CANCELLED
+ * before this function returns.
+ *
+ * @return 0 if a connection was cancelled
+ * @return -EALREADY if no connection is in progress
+ */
+int ob_wifi_connect_cancel(void);
+
+/**
+ * @brief conntect wifi to an access point and wait for the outcome
+ *
+ * A blocking wrapper of ob_wifi_connect_async() with the configured
+ * credentials. It is bounded by CONFIG_ONBOARDING_WIFI_CONNECT_ATTEMPTS and
+ * must not be called from a completion callback.
  *
  * @note the SSID and PSK for the target station are stored in ob_nvs_data
+ * @return 0 on success
+ * @return -1 on failure
  */
 int ob_wifi_connect(void);
+
+/**
+ * @brief get a printable name of a connection result reason
+ *
+ * @param reason the reason
+ * @return the name of the reason
+ */
+const char * ob_wifi_connect_reason_str(ob_wifi_connect_reason_t reason);
+
+/**
+ * @brief save the credentials of the network to connect with
+ *
+ * The credentials are added to the profile table with
+ * OB_WIFI_PROFILE_PRIORITY_DEFAULT, or replace those of the profile with the
+ * same SSID. With CONFIG_ONBOARDING_WIFI_PMK the WPA2 PMK of a WPA2-PSK
+ * network is derived from the passphrase and saved in its place, so the
+ * PBKDF2 derivation is only run once. See ob_wifi_profile_add().
+ *
+ * @param ssid the SSID, NUL terminated
+ * @param psk the passphrase, NUL terminated
+ * @return 0 on success
+ * @return a negative errno on error
+ */
+int ob_wifi_save_credentials(const char * ssid, const char * psk);
+/**
+ * @brief tell the bring-up that profiles were added or removed
+ * @details a device waiting for credentials starts connecting
+ */
+void ob_wifi_profiles_changed(void);
+
+/** @brief the number of connection attempts kept by ob_wifi_get_connect_attempts() */
+#define OB_WIFI_CONNECT_ATTEMPT_HISTORY 4
+
+/**
+ * @struct ob_wifi_connect_attempt
+ * @brief the timing of a connection attempt
+ */
+struct ob_wifi_connect_attempt {
+  /** @brief true if the attempt targeted the cached BSS */
+  bool targeted;
+  /** @brief true if the attempt succeeded */
+  bool success;
+  /** @brief milliseconds from the request to the connect result, -1 if none */
+  int32_t assoc_ms;
+  /** @brief milliseconds from the request to the end of the attempt */
+  int32_t total_ms;
+};
+
+/**
+ * @brief get the timing of the most recent connection attempts
+ *
+ * @param attempts the array to fill in, most recent first
+ * @param max the number of elements in attempts
+ * @return the number of attempts returned
+ */
+int ob_wifi_get_connect_attempts(struct ob_wifi_connect_attempt * attempts, int max);
 /**
  *@brief scan for reachable APs
- * It scans for reachable APS and creates a linked list of the SSIDs found.
- * When the scan completes if the scan_done_callback is set that function is called
+ * It starts a scan for reachable APs, ignoring the cached results. If a scan
+ * is already in progress no new scan is started. When the scan completes
+ * the results replace the cached snapshot and all subscribers are called.
  * @return 0 on success
  * @return -1 on error
  */
 int ob_wifi_scan(void);
+/**
+ * @brief request scan results
+ *
+ * If the cached results are younger than CONFIG_ONBOARDING_WIFI_SCAN_CACHE_TTL
+ * the callback is called immediately from the calling thread. Otherwise the
+ * subscriber is queued and called when the scan completes. Only one scan is
+ * run at a time, all subscribers queued while it is in flight share it.
+ *
+ * @param sub the subscriber, must remain valid until its callback is called
+ * @return 0 on success
+ * @return -1 on error
+ */
+int ob_wifi_scan_subscribe(struct ob_wifi_scan_subscriber * sub);
+/**
+ * @brief get scan results, waiting for a scan if the cache is stale
+ *
+ * @param[out] snap set to the snapshot with a reference held, the caller must
+ *             release it with ob_wifi_scan_unref()
+ * @param timeout the maximum time to wait for a scan to complete
+ * @return 0 on success
+ * @return -EAGAIN if the scan did not complete in time
+ * @return -EIO if the scan failed
+ */
+int ob_wifi_scan_get(ob_wifi_scan_snapshot_t ** snap, k_timeout_t timeout);
+/**
+ * @brief get the security of an SSID from the cached scan results
+ * @details no scan is started, the age of the cached results is not checked
+ *
+ * @param ssid the SSID, NUL terminated
+ * @return the security of the strongest BSS of the SSID
+ * @return WIFI_SECURITY_TYPE_UNKNOWN if the SSID is not in the cached results
+ */
+enum wifi_security_type ob_wifi_scan_security(const char * ssid);
+/**
+ * @brief named sets of scan parameters
+ */
+typedef enum ob_wifi_scan_preset {
+  /** @brief every channel with the driver defaults */
+  OB_WIFI_SCAN_PRESET_FULL = 0,
+  /** @brief every channel, active, short dwell, for listing networks */
+  OB_WIFI_SCAN_PRESET_PORTAL_QUICK,
+  /** @brief every channel, passive, no probe requests are sent */
+  OB_WIFI_SCAN_PRESET_PASSIVE,
+  /** @brief one SSID, on the channel of its known AP if given */
+  OB_WIFI_SCAN_PRESET_RECONNECT_TARGETED,
+  /** @brief one SSID on the roaming channels, or on the band of the given AP */
+  OB_WIFI_SCAN_PRESET_ROAM_BACKGROUND,
+  /** @brief the number of presets */
+  OB_WIFI_SCAN_PRESET_COUNT
+} ob_wifi_scan_preset_t;
+
+/**
+ * @brief fill in the scan parameters of a preset
+ *
+ * @param preset the preset
+ * @param ssid the SSID to look for, NUL terminated, required by the SSID
+ *        presets and ignored by the others. It must remain valid until the
+ *        scan is started.
+ * @param bss a known AP of the SSID, may be NULL
+ * @param[out] params the scan parameters
+ * @return 0 on success
+ * @return -EINVAL if the preset is unknown or needs an SSID
+ */
+int ob_wifi_scan_preset_params(ob_wifi_scan_preset_t preset, const char * ssid,
+                               const struct ob_wifi_bss * bss,
+                               struct wifi_scan_params * params);
+/**
+ * @brief get the name of a scan preset
+ *
+ * @param preset the preset
+ * @return the name, "unknown" if the preset is unknown
+ */
+const char * ob_wifi_scan_preset_name(ob_wifi_scan_preset_t preset);
+/**
+ * @brief find a scan preset by name
+ *
+ * @param name the name
+ * @return the preset
+ * @return -ENOENT if no preset has the name
+ */
+int ob_wifi_scan_preset_find(const char * name);
+/**
+ * @brief run a scan with parameters
+ *
+ * The results of a scan limited to some SSIDs, bands or channels only cover
+ * part of the networks, so they are not stored in the cache. Requests for
+ * complete results made while such a scan is in flight wait for a full scan
+ * started once it completes. Scans of every channel replace the cache.
+ *
+ * @param sub the subscriber, must remain valid until its callback is called
+ * @param params the parameters of the scan, e.g. from ob_wifi_scan_preset_params()
+ * @return 0 on success
+ * @return -EBUSY if a scan is in flight
+ * @return -EINVAL if sub or params is NULL
+ * @return -1 if the scan could not be started, the callback is called with NULL
+ */
+int ob_wifi_scan_ex(struct ob_wifi_scan_subscriber * sub,
+                    const struct wifi_scan_params * params);
+/**
+ * @brief get the number of scan results dropped because the scan ring was full
+ * @details the results are also counted in the dropped count of the snapshot
+ * of the scan they belonged to
+ *
+ * @return the number of results dropped since boot
+ */
+uint32_t ob_wifi_scan_overflows(void);
+/**
+ * @brief take a reference on a scan snapshot
+ *
+ * @param snap the snapshot
+ * @return snap
+ */
+ob_wifi_scan_snapshot_t * ob_wifi_scan_ref(ob_wifi_scan_snapshot_t * snap);
+/**
+ * @brief release a reference on a scan snapshot
+ * @details the snapshot is freed when the last reference is released
+ *
+ * @param snap the snapshot, may be NULL
+ */
+void ob_wifi_scan_unref(ob_wifi_scan_snapshot_t * snap);
 /**
  *@brief enable a wifi AP
  *
@@ -113,10 +525,62 @@ void ob_wifi_ap_enable(void);
  * @brief disable the wifi AP
  */
 void ob_wifi_ap_disable(void);
+/** @brief the maximum number of candidate channels of the AP */
+#define OB_WIFI_AP_CHANNELS_MAX 14
+/**
+ * @struct ob_wifi_ap_channel_score
+ * @brief the congestion of a candidate channel of the AP
+ */
+struct ob_wifi_ap_channel_score {
+  /** @brief the 2.4 GHz channel */
+  uint8_t channel;
+  /** @brief the number of BSSes on overlapping channels */
+  uint8_t bss_count;
+  /** @brief the score, lower is better */
+  int32_t score;
+};
+/**
+ * @brief get the scores of the last AP channel selection
+ *
+ * @param[out] scores the scores of the candidate channels
+ * @param max the number of elements in scores
+ * @param[out] channel the selected channel, may be NULL
+ * @param[out] age_ms the age of the selection in milliseconds, may be NULL
+ * @return the number of scores
+ * @return -ENOENT if no channel was selected yet
+ */
+int ob_wifi_ap_channel_scores(struct ob_wifi_ap_channel_score * scores, int max,
+                              int * channel, int64_t * age_ms);
+/** @brief readiness event: the device AP is up */
+#define OB_WIFI_EVENT_AP_READY         BIT(0)
+/** @brief readiness event: the station is connected and has an address */
+#define OB_WIFI_EVENT_STA_CONNECTED    BIT(1)
+/** @brief readiness event: no credentials are configured, onboarding is needed */
+#define OB_WIFI_EVENT_NEED_CREDENTIALS BIT(2)
+/** @brief readiness event: the hostname and the credentials have been loaded */
+#define OB_WIFI_EVENT_CONFIG_LOADED    BIT(3)
+
 /**
  * @brief initializ the wifi
+ *
+ * Registers the network management callbacks and returns. Loading the
+ * hostname and the credentials, the AP bring-up and the station connection
+ * run on the wifi connect work queue. Use ob_wifi_wait_events() to wait for
+ * the wifi to become ready.
+ *
+ * @return 0 on success
+ * @return -1 if the nvs store can not be initialized
  */
 int ob_wifi_init(void);
+
+/**
+ * @brief wait for wifi readiness events
+ *
+ * @param events the OB_WIFI_EVENT_* events to wait for
+ * @param timeout the time to wait
+ * @return the events of the set that have occurred, 0 on timeout
+ */
+uint32_t ob_wifi_wait_events(uint32_t events, k_timeout_t timeout);
 /**
  *@brief deinitialize the wifi
  * this will bring down a connection and/or an AP
@@ -150,8 +614,3 @@ char * Mac2String(uint8_t * macp);
  */
 bool get_mac_address(uint8_t * buffer, int len);
 
-/** Globals representing the SSID, PSK and respective length of those strings */
-extern char gSSID[];
-extern int gSSID_len;
-extern char gPSK[];
-extern int gPSK_len;
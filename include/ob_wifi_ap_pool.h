@@ -0,0 +1,119 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/wifi.h>
+
+/**
+ * @file
+ * @brief DHCP address pool of the device AP.
+ *
+ * The pool holds CONFIG_NET_DHCPV4_SERVER_ADDR_COUNT addresses, which
+ * defaults to CONFIG_ONBOARDING_WIFI_AP_POOL_SIZE, starting at the AP
+ * address plus an offset. The network mask and the offset are saved at
+ * NVS_SETTINGS_ID_WIFI_AP_POOL and applied when the AP starts.
+ *
+ * The stations associated with the AP are tracked. The lease of a station
+ * that stays disconnected for CONFIG_ONBOARDING_WIFI_AP_EVICT_DELAY
+ * milliseconds is released so its address can be given to another one.
+ * The leases are saved at NVS_SETTINGS_ID_WIFI_AP_LEASES when the AP stops
+ * and given back to the same stations when it starts again.
+ */
+
+/** @brief the data record identifier of the pool configuration */
+#define NVS_SETTINGS_ID_WIFI_AP_POOL "ob/wifi/ap_pool"
+/** @brief the data record identifier of the saved leases */
+#define NVS_SETTINGS_ID_WIFI_AP_LEASES "ob/wifi/ap_leases"
+
+/**
+ * @struct ob_wifi_ap_pool_config
+ * @brief the runtime configuration of the pool
+ */
+struct ob_wifi_ap_pool_config {
+  /** @brief the network mask of the AP */
+  struct in_addr netmask;
+  /** @brief the first address of the pool is the AP address plus this offset */
+  uint8_t offset;
+};
+
+/**
+ * @struct ob_wifi_ap_station
+ * @brief a station of the AP
+ */
+struct ob_wifi_ap_station {
+  /** @brief the MAC address of the station */
+  uint8_t mac[WIFI_MAC_ADDR_LEN];
+  /** @brief the leased address, INADDR_ANY if none */
+  struct in_addr addr;
+  /** @brief the remaining time of the lease in seconds */
+  uint32_t lease_s;
+  /** @brief indicates that the station is associated */
+  bool associated;
+};
+
+/**
+ * @brief get the configuration of the pool
+ * @details a saved configuration that does not fit with the AP address is
+ * deleted and the Kconfig defaults are returned, so the netmask can be set
+ * on the AP address before the pool starts
+ *
+ * @param[out] config the configuration
+ * @param ap_addr the address of the AP the pool must fit with
+ */
+void ob_wifi_ap_pool_get(struct ob_wifi_ap_pool_config * config,
+                         const struct in_addr * ap_addr);
+
+/**
+ * @brief save the configuration of the pool
+ * @details the configuration is applied the next time the AP starts
+ *
+ * @param config the configuration, NULL for the Kconfig defaults
+ * @param ap_addr the address of the AP the pool must fit with
+ * @return 0 on success
+ * @return -EINVAL if the netmask is not contiguous or the pool does not fit in the subnet
+ * @return -EIO if the configuration could not be saved
+ */
+int ob_wifi_ap_pool_set(const struct ob_wifi_ap_pool_config * config,
+                        const struct in_addr * ap_addr);
+
+/**
+ * @brief start the DHCP server of the AP
+ * @details the saved leases are given back to their stations
+ *
+ * @param iface the AP interface, configured with the AP address and the netmask
+ * @param ap_addr the address of the AP
+ * @return 0 on success
+ * @return a negative errno if the server did not start
+ */
+int ob_wifi_ap_pool_start(struct net_if * iface, const struct in_addr * ap_addr);
+
+/**
+ * @brief save the leases and stop the DHCP server of the AP
+ *
+ * @param iface the AP interface
+ * @return 0 on success
+ * @return a negative errno if the server did not stop
+ */
+int ob_wifi_ap_pool_stop(struct net_if * iface);
+
+/**
+ * @brief track a station associating with or leaving the AP
+ *
+ * @param mac the MAC address of the station
+ * @param associated true when the station associated, false when it left
+ */
+void ob_wifi_ap_pool_station(const uint8_t * mac, bool associated);
+
+/**
+ * @brief list the stations of the AP
+ * @details the associated stations and the stations holding a lease
+ *
+ * @param[out] stations the stations
+ * @param max the size of stations
+ * @return the number of stations
+ */
+int ob_wifi_ap_pool_stations(struct ob_wifi_ap_station * stations, int max);
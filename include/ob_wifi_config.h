@@ -0,0 +1,66 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/net/wifi.h>
+
+/**
+ * @file
+ * @brief The published credentials of the station.
+ *
+ * The network the station connects with is published as an immutable
+ * snapshot. A publish copies the new credentials into a spare snapshot,
+ * gives it the next version and swaps the current snapshot pointer, so
+ * readers never take a lock: they load the pointer and copy the snapshot,
+ * and retry in the rare case a publish reused it meanwhile. The version
+ * lets a reader tell that the credentials changed without copying them.
+ */
+
+/**
+ * @struct ob_wifi_config
+ * @brief a snapshot of the credentials of the station
+ */
+struct ob_wifi_config {
+  /** @brief the version of the snapshot, 0 until credentials are published */
+  uint32_t version;
+  /** @brief the SSID to connect with, NUL terminated */
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  /** @brief the length of the SSID, 0 if none */
+  uint8_t ssid_len;
+  /** @brief the PSK for the SSID, a passphrase or the PMK in hex, NUL terminated */
+  char psk[WIFI_PSK_MAX_LEN + 1];
+  /** @brief the length of the PSK */
+  uint8_t psk_len;
+};
+
+/**
+ * @brief get a consistent copy of the current credentials
+ * @details lock free, may be called from any thread
+ *
+ * @param[out] config the credentials
+ * @return the version of the credentials
+ */
+uint32_t ob_wifi_config_get(struct ob_wifi_config * config);
+
+/**
+ * @brief get the version of the current credentials
+ * @details a single atomic load, for readers checking for changes
+ *
+ * @return the version, 0 until credentials are published
+ */
+uint32_t ob_wifi_config_version(void);
+
+/**
+ * @brief publish new credentials
+ * @details writers are serialized, readers are never blocked
+ *
+ * @param ssid the SSID, NUL terminated
+ * @param psk the PSK, NUL terminated, NULL or empty for an open network
+ * @return the version of the published credentials
+ * @return -EINVAL if the SSID or the PSK is too long or the SSID is empty
+ */
+int ob_wifi_config_publish(const char * ssid, const char * psk);
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <zephyr/net/net_if.h>
+
+/**
+ * @file
+ * @brief Static IPv4 configuration of the station.
+ *
+ * When a static configuration is saved at NVS_SETTINGS_ID_WIFI_IPV4 it is
+ * applied as soon as the station associates and the DHCP client is not
+ * started. Without one the station uses DHCP.
+ */
+
+/** @brief the data record identifier of the static configuration */
+#define NVS_SETTINGS_ID_WIFI_IPV4 "ob/wifi/ipv4"
+
+/**
+ * @struct ob_wifi_ipv4_config
+ * @brief a static IPv4 configuration
+ */
+struct ob_wifi_ipv4_config {
+  /** @brief the address of the station */
+  struct in_addr address;
+  /** @brief the network mask */
+  struct in_addr netmask;
+  /** @brief the default gateway, INADDR_ANY if none */
+  struct in_addr gateway;
+  /** @brief the DNS server, INADDR_ANY if none */
+  struct in_addr dns;
+};
+
+/**
+ * @brief load the static configuration from the nvs store
+ * @details called by ob_wifi_init()
+ */
+void ob_wifi_ipv4_load(void);
+
+/**
+ * @brief get the static configuration
+ *
+ * @param[out] config the configuration
+ * @return 0 on success
+ * @return -ENOENT if the station uses DHCP
+ */
+int ob_wifi_ipv4_get(struct ob_wifi_ipv4_config * config);
+
+/**
+ * @brief save a static configuration, or go back to DHCP
+ * @details the configuration is applied at the next association
+ *
+ * @param config the configuration, NULL to use DHCP
+ * @return 0 on success
+ * @return -EINVAL if the configuration is invalid
+ * @return -EIO if it could not be saved
+ */
+int ob_wifi_ipv4_set(const struct ob_wifi_ipv4_config * config);
+
+/**
+ * @brief build a configuration from strings
+ *
+ * @param address the address in dotted decimal
+ * @param netmask the network mask in dotted decimal
+ * @param gateway the gateway in dotted decimal, NULL or empty if none
+ * @param dns the DNS server in dotted decimal, NULL or empty if none
+ * @param[out] config the configuration
+ * @return 0 on success
+ * @return -EINVAL if a string is not a valid address or the netmask is not contiguous
+ */
+int ob_wifi_ipv4_parse(const char * address, const char * netmask, const char * gateway,
+                       const char * dns, struct ob_wifi_ipv4_config * config);
+
+/**
+ * @brief configure the static address on the station interface
+ *
+ * @param iface the station interface
+ * @return 0 if the static configuration was applied
+ * @return -ENOENT if the station uses DHCP
+ * @return -ENOMEM if the address could not be added
+ */
+int ob_wifi_ipv4_apply(struct net_if * iface);
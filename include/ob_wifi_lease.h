@@ -0,0 +1,73 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <zephyr/net/net_if.h>
+
+/**
+ * @file
+ * @brief Reuse of the DHCP lease across reboots.
+ *
+ * The lease bound by the DHCP client is saved at NVS_SETTINGS_ID_WIFI_LEASE.
+ * The first time the station associates after a boot the saved address is
+ * requested directly (the RFC 2131 INIT-REBOOT state), skipping the
+ * DISCOVER/OFFER exchange. When the server acknowledges it the lease is
+ * held by this module, which renews it with the server from half the lease
+ * time, and the DHCP client is not started. The DHCP client only runs when
+ * the saved address was not acknowledged or the lease is lost.
+ *
+ * The requests are sent and the replies polled from a delayable work item
+ * on the system work queue, so no caller blocks on the exchange.
+ */
+
+/** @brief the data record identifier of the saved lease */
+#define NVS_SETTINGS_ID_WIFI_LEASE "ob/wifi/lease"
+
+/**
+ * @brief the end of a request for the saved address, or the loss of the lease
+ * @details called from the system work queue
+ *
+ * @param iface the station interface
+ * @param result 0 if the server acknowledged the saved address, which is
+ * now configured on iface, -ECONNREFUSED if the server refused the address,
+ * -ETIMEDOUT if the server did not answer, another negative errno on other
+ * errors
+ */
+typedef void (*ob_wifi_lease_cb_t)(struct net_if * iface, int result);
+
+/**
+ * @brief request the saved address of a network
+ * @details returns once the request is sent. Only the first call after a
+ * boot sends a request. cb is called with the result of the request and,
+ * once the address was acknowledged, with a negative errno if the lease is
+ * refused or expires while renewing it. The address is removed from iface
+ * before the call, so the DHCP client can be started from cb.
+ *
+ * @param iface the station interface, associated and without an address
+ * @param ssid the SSID of the network, NUL terminated
+ * @param cb called with the result
+ * @return 0 if the request was sent
+ * @return -ENOENT if no lease is saved for the network
+ * @return -EALREADY if a request was already made since boot
+ * @return a negative errno on other errors
+ */
+int ob_wifi_lease_reboot(struct net_if * iface, const char * ssid, ob_wifi_lease_cb_t cb);
+
+/**
+ * @brief stop holding the lease
+ * @details called when the station disconnects. A request in progress is
+ * abandoned and the address of a held lease is removed, cb is not called.
+ */
+void ob_wifi_lease_stop(void);
+
+/**
+ * @brief save the lease bound by the DHCP client
+ * @details the record is only written when the lease changed
+ *
+ * @param iface the station interface
+ * @param ssid the SSID of the network, NUL terminated
+ */
+void ob_wifi_lease_bound(struct net_if * iface, const char * ssid);
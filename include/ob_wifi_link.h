@@ -0,0 +1,99 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/net/net_if.h>
+
+/**
+ * @file
+ * @brief Supervision of the station link.
+ *
+ * A disconnect that no roam or onboarding method asked for opens an
+ * incident and the bring-up connects the station again. The reconnection
+ * starts right away, unless the station keeps dropping within
+ * CONFIG_ONBOARDING_WIFI_LINK_STABLE milliseconds of coming online, in
+ * which case it waits for an exponential backoff. The incident closes
+ * when the station has an address again and its downtime is logged and
+ * added to the counters.
+ *
+ * With CONFIG_ONBOARDING_WIFI_LINK_ETHERNET the default interface moves to
+ * the Ethernet interface when its carrier comes up and back to the station
+ * when it goes down.
+ */
+
+/**
+ * @struct ob_wifi_link_stats
+ * @brief counters of the link supervisor
+ */
+struct ob_wifi_link_stats {
+  /** @brief the number of incidents closed */
+  int incidents;
+  /** @brief the downtime of the open incident in milliseconds, 0 if none is open */
+  int32_t down_ms;
+  /** @brief the downtime of the last incident in milliseconds */
+  int32_t last_ms;
+  /** @brief the longest downtime in milliseconds */
+  int32_t max_ms;
+  /** @brief the sum of the downtimes in milliseconds */
+  int64_t total_ms;
+  /** @brief the number of disconnects in a row shortly after coming online */
+  int flaps;
+  /** @brief the number of times the default interface moved to Ethernet */
+  int failovers;
+  /** @brief the Ethernet carrier is up */
+  bool ethernet;
+};
+
+/**
+ * @brief record that the station lost its connection
+ * @details called from the wifi management event handler
+ */
+void ob_wifi_link_lost(void);
+
+/**
+ * @brief open an incident for the last loss of the connection
+ * @details called by the bring-up when no roam or onboarding method is
+ * connecting the station
+ *
+ * @return the number of disconnects in a row shortly after coming online
+ */
+int ob_wifi_link_incident(void);
+
+/**
+ * @brief record that the station has an address again
+ * @details closes the open incident, if any
+ */
+void ob_wifi_link_restored(void);
+
+/**
+ * @brief forget when the station came online
+ * @details the next loss of the connection is not counted as a flap, used
+ * by the benchmark to drop the link repeatedly without a backoff
+ */
+void ob_wifi_link_forget(void);
+
+/**
+ * @brief record a change of the Ethernet carrier
+ *
+ * @param iface the Ethernet interface
+ * @param on true if the carrier came up
+ */
+void ob_wifi_link_carrier(struct net_if * iface, bool on);
+
+/**
+ * @brief make the preferred connected interface the default one
+ * @details the Ethernet interface while its carrier is up, the station otherwise
+ */
+void ob_wifi_link_set_default(void);
+
+/**
+ * @brief get the counters of the link supervisor
+ *
+ * @param[out] stats the counters
+ */
+void ob_wifi_link_get_stats(struct ob_wifi_link_stats * stats);
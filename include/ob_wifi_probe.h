@@ -0,0 +1,116 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/net/net_ip.h>
+
+/**
+ * @file
+ * @brief Probe of the quality of the station link.
+ *
+ * While the station is connected an ICMP echo request is sent every
+ * CONFIG_ONBOARDING_WIFI_PROBE_INTERVAL to the gateway and to the probe
+ * target, and a reply that does not come back within
+ * CONFIG_ONBOARDING_WIFI_PROBE_TIMEOUT counts as lost. The round trip
+ * times and the losses are smoothed with an EWMA, the jitter is the
+ * smoothed difference between consecutive round trip times as in RFC 3550.
+ * The RSSI and the TX rate of the station are read at the same time, and
+ * with CONFIG_NET_STATISTICS_WIFI its packet and error counters.
+ */
+
+/**
+ * @brief the destinations of the probe
+ */
+enum ob_wifi_probe_path_id {
+  /** @brief the gateway of the station */
+  OB_WIFI_PROBE_GATEWAY,
+  /** @brief the probe target */
+  OB_WIFI_PROBE_TARGET,
+  /** @brief the number of destinations */
+  OB_WIFI_PROBE_PATHS
+};
+
+/**
+ * @struct ob_wifi_probe_path
+ * @brief the statistics of a destination
+ */
+struct ob_wifi_probe_path {
+  /** @brief the address probed, INADDR_ANY if none */
+  struct in_addr addr;
+  /** @brief the number of requests sent */
+  uint32_t sent;
+  /** @brief the number of replies received in time */
+  uint32_t received;
+  /** @brief the last round trip time in microseconds */
+  uint32_t rtt_us;
+  /** @brief the smoothed round trip time in microseconds */
+  uint32_t srtt_us;
+  /** @brief the shortest round trip time in microseconds */
+  uint32_t min_us;
+  /** @brief the longest round trip time in microseconds */
+  uint32_t max_us;
+  /** @brief the smoothed jitter in microseconds */
+  uint32_t jitter_us;
+  /** @brief the smoothed loss in per mille */
+  uint16_t loss_permille;
+};
+
+/**
+ * @struct ob_wifi_probe_stats
+ * @brief the statistics of the probe
+ */
+struct ob_wifi_probe_stats {
+  /** @brief the destinations, indexed by enum ob_wifi_probe_path_id */
+  struct ob_wifi_probe_path paths[OB_WIFI_PROBE_PATHS];
+  /** @brief the last RSSI in dBm, 0 if not connected */
+  int rssi;
+  /** @brief the smoothed RSSI in dBm */
+  int rssi_avg;
+  /** @brief the PHY TX rate in kbps as reported by the driver */
+  int tx_rate;
+  /** @brief the packets sent by the station */
+  uint32_t tx_packets;
+  /** @brief the packets the station failed to send */
+  uint32_t tx_errors;
+  /** @brief the packets the station failed to receive */
+  uint32_t rx_errors;
+  /** @brief the number of probe rounds */
+  uint32_t rounds;
+  /** @brief the uptime of the last round in milliseconds, 0 if none */
+  int64_t timestamp;
+};
+
+/**
+ * @brief start the probe
+ * @details called by ob_wifi_init()
+ */
+void ob_wifi_probe_init(void);
+
+/**
+ * @brief stop the probe
+ * @details called by ob_wifi_deinit()
+ */
+void ob_wifi_probe_stop(void);
+
+/**
+ * @brief set the probe target
+ *
+ * @param addr the address, NULL or INADDR_ANY to only probe the gateway
+ */
+void ob_wifi_probe_set_target(const struct in_addr * addr);
+
+/**
+ * @brief clear the statistics
+ */
+void ob_wifi_probe_reset(void);
+
+/**
+ * @brief get the statistics of the probe
+ *
+ * @param[out] stats the statistics
+ */
+void ob_wifi_probe_get_stats(struct ob_wifi_probe_stats * stats);
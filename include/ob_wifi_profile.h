@@ -0,0 +1,151 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/net/wifi.h>
+
+#include "ob_wifi.h"
+
+/**
+ * @file
+ * @brief The table of networks the device can connect to.
+ *
+ * Each profile holds the credentials of a network with its priority, the
+ * RSSI it was last seen with and when it last connected. Profiles are saved
+ * at NVS_SETTINGS_ID_WIFI_PROFILE/<n>. When the device comes up the profiles
+ * are ranked against a scan and tried in order, so a device that moves
+ * between sites reconnects without being onboarded again.
+ */
+
+/** @brief the prefix of the data record identifiers of the profiles */
+#define NVS_SETTINGS_ID_WIFI_PROFILE "ob/wifi/prof"
+
+/** @brief the priority of profiles added by the onboarding methods */
+#define OB_WIFI_PROFILE_PRIORITY_DEFAULT 100
+
+/**
+ * @struct ob_wifi_profile
+ * @brief a network the device can connect to
+ */
+struct ob_wifi_profile {
+  /** @brief the SSID, NUL terminated, empty for an unused entry */
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  /** @brief the passphrase, or the PMK as 64 hex digits, NUL terminated */
+  char psk[WIFI_PSK_MAX_LEN + 1];
+  /** @brief higher priorities are tried first */
+  uint8_t priority;
+  /** @brief the RSSI the network was last seen with, 0 if never seen */
+  int8_t last_rssi;
+  /** @brief the security (enum wifi_security_type) the network was last seen with */
+  uint8_t security;
+  /** @brief sequence number of the last successful connection, larger is more recent, 0 if never */
+  uint32_t last_success;
+};
+
+/**
+ * @brief load the profiles from the nvs store
+ *
+ * Credentials saved at the legacy NVS_SETTINGS_ID_WIFI_SSID,
+ * NVS_SETTINGS_ID_WIFI_PSK and NVS_SETTINGS_ID_WIFI_PMK records are moved
+ * into the table.
+ *
+ * @return the number of profiles
+ */
+int ob_wifi_profile_load(void);
+
+/**
+ * @brief add a profile, or update the profile with the same SSID
+ *
+ * With CONFIG_ONBOARDING_WIFI_PMK and a WPA2-PSK network, known from the
+ * profile or the cached scan results, the passphrase is only kept in RAM
+ * while the PMK is derived on a work queue of its own. The profile is then
+ * saved once, with the PMK. The passphrase of any other network is saved as
+ * it is. When the table is full the profile with the lowest priority and the
+ * oldest connection is replaced.
+ *
+ * @param ssid the SSID, NUL terminated
+ * @param psk the passphrase, NUL terminated, empty for an open network
+ * @param priority the priority, 0 to 255
+ * @return the index of the profile
+ * @return -EINVAL if the credentials are invalid
+ * @return a negative errno if the profile could not be saved
+ */
+int ob_wifi_profile_add(const char * ssid, const char * psk, int priority);
+
+/**
+ * @brief remove the profile of an SSID
+ *
+ * @param ssid the SSID, NUL terminated
+ * @return 0 on success
+ * @return -ENOENT if there is no profile for the SSID
+ */
+int ob_wifi_profile_remove(const char * ssid);
+
+/**
+ * @brief get a copy of a profile
+ *
+ * @param index the index of the profile, 0 to CONFIG_ONBOARDING_WIFI_PROFILES - 1
+ * @param[out] profile the copy
+ * @return 0 on success
+ * @return -ENOENT if the entry is unused
+ * @return -EINVAL if the index is out of range
+ */
+int ob_wifi_profile_get(int index, struct ob_wifi_profile * profile);
+
+/**
+ * @brief get the number of profiles
+ *
+ * @return the number of profiles
+ */
+int ob_wifi_profile_count(void);
+
+/**
+ * @brief get the profile that connected most recently
+ *
+ * @return the index of the profile
+ * @return -ENOENT if no profile has connected
+ */
+int ob_wifi_profile_most_recent(void);
+
+/**
+ * @brief rank the profiles against scan results
+ *
+ * Profiles seen by the scan come first, ordered by priority, RSSI and the
+ * time of their last connection. Profiles not seen, e.g. hidden networks,
+ * follow ordered by priority and the time of their last connection.
+ *
+ * @param snap the scan results, NULL if no scan is available
+ * @param[out] order the indexes of the profiles, best first
+ * @param max the number of elements in order
+ * @return the number of indexes in order
+ */
+int ob_wifi_profile_rank(ob_wifi_scan_snapshot_t * snap, int * order, int max);
+
+/**
+ * @brief record a successful connection to the profile of an SSID
+ * @details the profile is only saved when another profile connected last
+ *
+ * @param ssid the SSID, NUL terminated
+ */
+void ob_wifi_profile_connected(const char * ssid);
+
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+/**
+ * @brief check if a profile holds a PMK rather than a passphrase
+ *
+ * @param profile the profile
+ * @return true if the PSK is 64 hex digits
+ */
+bool ob_wifi_profile_has_pmk(const struct ob_wifi_profile * profile);
+
+/**
+ * @brief wait for the PMK derivations in progress
+ * @details the profiles waiting for their PMK are only saved once it is
+ * derived, call before rebooting
+ */
+void ob_wifi_profile_flush(void);
+#endif // CONFIG_ONBOARDING_WIFI_PMK
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/net/wifi_mgmt.h>
+
+/**
+ * @file
+ * @brief Power save profiles of the station.
+ *
+ * Each profile maps to a set of NET_REQUEST_WIFI_PS parameters and, for the
+ * deep save profile with CONFIG_ONBOARDING_WIFI_PS_TWT, to a TWT agreement
+ * with the AP. The profile follows the operating phase of the device:
+ * - latency while a hold is set, i.e. while the device AP serves the
+ *   captive portal, while an OTA update runs or while the application
+ *   asks for it
+ * - balanced otherwise
+ * - deep save once nothing reported activity for
+ *   CONFIG_ONBOARDING_WIFI_PS_IDLE_DELAY milliseconds, if not 0
+ *
+ * The profile can also be forced, e.g. from the shell. The time spent in
+ * each profile, the round trip times measured by the link probe and the
+ * wake ups of the station are counted per profile.
+ */
+
+/**
+ * @brief the power save profiles
+ */
+enum ob_wifi_ps_profile {
+  /** @brief power save off, for onboarding and updates */
+  OB_WIFI_PS_LATENCY,
+  /** @brief power save waking up at every DTIM */
+  OB_WIFI_PS_BALANCED,
+  /** @brief power save waking up at the listen interval or at the TWT service periods */
+  OB_WIFI_PS_DEEP,
+  /** @brief the number of profiles */
+  OB_WIFI_PS_PROFILES,
+  /** @brief the profile follows the operating phase */
+  OB_WIFI_PS_AUTO = -1
+};
+
+/** @brief the device AP is up for the captive portal */
+#define OB_WIFI_PS_HOLD_PORTAL BIT(0)
+/** @brief an OTA update is running */
+#define OB_WIFI_PS_HOLD_OTA    BIT(1)
+/** @brief the application needs a low latency */
+#define OB_WIFI_PS_HOLD_APP    BIT(2)
+
+/**
+ * @struct ob_wifi_ps_stats
+ * @brief the counters of a profile
+ */
+struct ob_wifi_ps_stats {
+  /** @brief the number of times the profile was applied */
+  uint32_t activations;
+  /** @brief the time spent in the profile in milliseconds */
+  int64_t time_ms;
+  /** @brief the number of round trip times measured */
+  uint32_t rtt_samples;
+  /** @brief the sum of the round trip times in microseconds */
+  uint64_t rtt_total_us;
+  /** @brief the longest round trip time in microseconds */
+  uint32_t rtt_max_us;
+  /** @brief the number of TWT service periods the station woke up for */
+  uint32_t wakes;
+  /** @brief the number of beacons received, with CONFIG_NET_STATISTICS_WIFI */
+  uint32_t beacons;
+};
+
+/**
+ * @brief start following the operating phase
+ * @details called by ob_wifi_init()
+ */
+void ob_wifi_ps_init(void);
+
+/**
+ * @brief set or clear a reason to stay in the latency profile
+ *
+ * @param hold a OB_WIFI_PS_HOLD_* bit
+ * @param held true to set it, false to clear it
+ */
+void ob_wifi_ps_hold(uint32_t hold, bool held);
+
+/**
+ * @brief report activity, which delays the deep save profile
+ */
+void ob_wifi_ps_activity(void);
+
+/**
+ * @brief force a profile
+ *
+ * @param profile the profile, OB_WIFI_PS_AUTO to follow the operating phase again
+ * @return 0 on success
+ * @return -EINVAL if the profile is unknown
+ */
+int ob_wifi_ps_force(enum ob_wifi_ps_profile profile);
+
+/**
+ * @brief apply the profile again once the station is connected
+ * @details called when the station has an address
+ */
+void ob_wifi_ps_connected(void);
+
+/**
+ * @brief handle the result of a TWT request
+ * @details called from the wifi management event handler
+ *
+ * @param params the TWT parameters of the event
+ */
+void ob_wifi_ps_twt_event(const struct wifi_twt_params * params);
+
+/**
+ * @brief handle a TWT sleep state change
+ * @details called from the wifi management event handler
+ *
+ * @param state the WIFI_TWT_STATE_* sleep state
+ */
+void ob_wifi_ps_twt_sleep(int state);
+
+/**
+ * @brief add a round trip time to the current profile
+ * @details called by the link probe, may be called from any thread
+ *
+ * @param rtt_us the round trip time in microseconds
+ */
+void ob_wifi_ps_rtt(uint32_t rtt_us);
+
+/**
+ * @brief get the profile and the counters of the profiles
+ *
+ * @param[out] forced the forced profile, OB_WIFI_PS_AUTO if none, may be NULL
+ * @param[out] stats the counters indexed by profile, OB_WIFI_PS_PROFILES entries, may be NULL
+ * @return the current profile
+ */
+enum ob_wifi_ps_profile ob_wifi_ps_get(enum ob_wifi_ps_profile * forced,
+                                       struct ob_wifi_ps_stats * stats);
+
+/**
+ * @brief get the name of a profile
+ *
+ * @param profile the profile
+ * @return the name
+ */
+const char * ob_wifi_ps_profile_str(enum ob_wifi_ps_profile profile);
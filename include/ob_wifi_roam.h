@@ -0,0 +1,61 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @file
+ * @brief Background roaming between the APs of the connected network.
+ *
+ * While the station is connected its RSSI is read every
+ * CONFIG_ONBOARDING_WIFI_ROAM_INTERVAL and smoothed with an EWMA. When the
+ * smoothed RSSI drops below CONFIG_ONBOARDING_WIFI_ROAM_THRESHOLD a scan
+ * limited to the SSID and to the roaming channels is run, at most every
+ * CONFIG_ONBOARDING_WIFI_ROAM_SCAN_INTERVAL. The station moves to the
+ * strongest other AP of the SSID if it is at least
+ * CONFIG_ONBOARDING_WIFI_ROAM_HYSTERESIS dB stronger.
+ */
+
+/**
+ * @struct ob_wifi_roam_stats
+ * @brief counters of the roaming monitor
+ */
+struct ob_wifi_roam_stats {
+  /** @brief the smoothed RSSI of the current AP in dBm, 0 if not connected */
+  int rssi;
+  /** @brief the number of background scans run */
+  int scans;
+  /** @brief the number of roams that reconnected */
+  int roams;
+  /** @brief the number of roams that did not reconnect to the new AP */
+  int failures;
+  /** @brief milliseconds from the disconnect to the new address of the last roam */
+  int32_t last_ms;
+  /** @brief the longest roam in milliseconds */
+  int32_t max_ms;
+  /** @brief the sum of the roam latencies in milliseconds */
+  int64_t total_ms;
+};
+
+/**
+ * @brief start the roaming monitor
+ * @details called by ob_wifi_init()
+ */
+void ob_wifi_roam_init(void);
+
+/**
+ * @brief stop the roaming monitor
+ * @details called by ob_wifi_deinit()
+ */
+void ob_wifi_roam_stop(void);
+
+/**
+ * @brief get the counters of the roaming monitor
+ *
+ * @param[out] stats the counters
+ */
+void ob_wifi_roam_get_stats(struct ob_wifi_roam_stats * stats);
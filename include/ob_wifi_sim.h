@@ -0,0 +1,148 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/net/wifi.h>
+
+/**
+ * @file
+ * @brief Simulated wifi driver for native_sim.
+ *
+ * The driver registers a wifi interface implementing the scan, connect,
+ * disconnect, AP enable, AP disable and interface status operations of
+ * wifi_mgmt_ops against a scripted list of APs. The APs of
+ * CONFIG_ONBOARDING_WIFI_SIM_APS are loaded at boot and can be changed at
+ * runtime. Every operation completes after a fixed delay and raises the
+ * same NET_EVENT_WIFI_* events as a real driver, so a given script always
+ * produces the same sequence of events. Failures can be injected for the
+ * next operations and a disconnect by the AP can be triggered.
+ *
+ * With CONFIG_ONBOARDING_WIFI_SIM_BRIDGE the frames of the interface are
+ * exchanged with a TAP interface of the host while the station is
+ * connected or the AP is up, so a DHCP server of the host can serve the
+ * station. Otherwise the frames are dropped and the station needs a static
+ * IPv4 configuration.
+ */
+
+/**
+ * @brief the operations failures can be injected into
+ */
+enum ob_wifi_sim_op {
+  /** @brief scans */
+  OB_WIFI_SIM_OP_SCAN,
+  /** @brief connections of the station */
+  OB_WIFI_SIM_OP_CONNECT,
+  /** @brief AP enables */
+  OB_WIFI_SIM_OP_AP,
+  /** @brief the number of operations */
+  OB_WIFI_SIM_OPS
+};
+
+/**
+ * @struct ob_wifi_sim_ap
+ * @brief a simulated AP
+ */
+struct ob_wifi_sim_ap {
+  /** @brief the SSID, NUL terminated */
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  /** @brief the passphrase, empty for an open network */
+  char psk[WIFI_PSK_MAX_LEN + 1];
+  /** @brief the RSSI in dBm */
+  int rssi;
+  /** @brief the channel, the band is 5 GHz above 14 */
+  uint8_t channel;
+  /** @brief the BSSID, derived from the index of the AP */
+  uint8_t bssid[WIFI_MAC_ADDR_LEN];
+};
+
+/**
+ * @brief add an AP
+ *
+ * @param ssid the SSID
+ * @param psk the passphrase, NULL or empty for an open network
+ * @param rssi the RSSI in dBm
+ * @param channel the channel
+ * @return the index of the AP
+ * @return -EINVAL if a parameter is invalid
+ * @return -ENOMEM if CONFIG_ONBOARDING_WIFI_SIM_MAX_APS APs are set
+ */
+int ob_wifi_sim_ap_add(const char * ssid, const char * psk, int rssi, int channel);
+
+/**
+ * @brief change the RSSI of the APs of an SSID
+ *
+ * @param ssid the SSID
+ * @param rssi the RSSI in dBm
+ * @return 0 on success
+ * @return -ENOENT if no AP has the SSID
+ */
+int ob_wifi_sim_ap_rssi(const char * ssid, int rssi);
+
+/**
+ * @brief change the passphrase of the APs of an SSID
+ * @details the station stays connected until ob_wifi_sim_drop() is called
+ *
+ * @param ssid the SSID
+ * @param psk the passphrase, NULL or empty for an open network
+ * @return 0 on success
+ * @return -EINVAL if the passphrase is too long
+ * @return -ENOENT if no AP has the SSID
+ */
+int ob_wifi_sim_ap_psk(const char * ssid, const char * psk);
+
+/**
+ * @brief remove every AP
+ * @details the station stays connected until ob_wifi_sim_drop() is called
+ */
+void ob_wifi_sim_ap_clear(void);
+
+/**
+ * @brief list the APs
+ *
+ * @param[out] aps the APs
+ * @param max the size of aps
+ * @return the number of APs
+ */
+int ob_wifi_sim_aps(struct ob_wifi_sim_ap * aps, int max);
+
+/**
+ * @brief set the delays of the operations
+ *
+ * @param scan_ms the time a scan takes in milliseconds
+ * @param connect_ms the time a connection takes in milliseconds
+ */
+void ob_wifi_sim_set_delays(uint32_t scan_ms, uint32_t connect_ms);
+
+/**
+ * @brief make the next operations fail
+ *
+ * @param op the operation
+ * @param count the number of operations to fail, 0 to stop failing
+ * @param status the WIFI_STATUS_* of the failures, e.g. WIFI_STATUS_CONN_TIMEOUT
+ * @return 0 on success
+ * @return -EINVAL if the operation is unknown
+ */
+int ob_wifi_sim_fail(enum ob_wifi_sim_op op, int count, int status);
+
+/**
+ * @brief disconnect the station as if the AP went away
+ *
+ * @return 0 on success
+ * @return -ENOTCONN if the station is not connected
+ */
+int ob_wifi_sim_drop(void);
+
+/**
+ * @brief make a station join or leave the AP
+ *
+ * @param mac the MAC address of the station
+ * @param joined true when the station joins, false when it leaves
+ * @return 0 on success
+ * @return -ENETDOWN if the AP is not up
+ */
+int ob_wifi_sim_station(const uint8_t * mac, bool joined);
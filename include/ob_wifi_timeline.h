@@ -0,0 +1,171 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+
+/**
+ * @file
+ * @brief Timing of each phase of bringing the station online.
+ *
+ * A timeline starts at a scan or a connection request made while the
+ * station is offline and records when each step is reached, in
+ * microseconds from the start, until the network is L4 connected. The last
+ * CONFIG_ONBOARDING_WIFI_TIMELINE_DEPTH completed timelines are kept in RAM.
+ */
+
+/** @brief the offset of a step that was not reached */
+#define OB_WIFI_TIMELINE_NONE UINT32_MAX
+
+/**
+ * @brief the steps of bringing the station online
+ */
+enum ob_wifi_timeline_mark {
+  /** @brief a scan was started */
+  OB_WIFI_TIMELINE_SCAN_START = 0,
+  /** @brief the scan completed */
+  OB_WIFI_TIMELINE_SCAN_DONE,
+  /** @brief a connection was requested from the driver */
+  OB_WIFI_TIMELINE_CONNECT_REQUEST,
+  /** @brief the driver reported the result of the connection */
+  OB_WIFI_TIMELINE_CONNECT_RESULT,
+  /** @brief the DHCP client was started */
+  OB_WIFI_TIMELINE_DHCP_START,
+  /** @brief the DHCP client got a lease */
+  OB_WIFI_TIMELINE_DHCP_BOUND,
+  /** @brief an IPv4 address was added to the interface */
+  OB_WIFI_TIMELINE_ADDR_ADD,
+  /** @brief the connection manager reported the network L4 connected */
+  OB_WIFI_TIMELINE_L4_CONNECTED,
+  /** @brief the number of steps */
+  OB_WIFI_TIMELINE_MARK_COUNT
+};
+
+/**
+ * @brief the phases measured between two steps
+ */
+enum ob_wifi_timeline_phase {
+  /** @brief from SCAN_START to SCAN_DONE */
+  OB_WIFI_TIMELINE_PHASE_SCAN = 0,
+  /** @brief from CONNECT_REQUEST to CONNECT_RESULT */
+  OB_WIFI_TIMELINE_PHASE_ASSOCIATE,
+  /** @brief from DHCP_START to DHCP_BOUND */
+  OB_WIFI_TIMELINE_PHASE_DHCP,
+  /** @brief from CONNECT_RESULT to ADDR_ADD */
+  OB_WIFI_TIMELINE_PHASE_ADDRESS,
+  /** @brief from ADDR_ADD to L4_CONNECTED */
+  OB_WIFI_TIMELINE_PHASE_L4,
+  /** @brief from the start of the timeline to L4_CONNECTED */
+  OB_WIFI_TIMELINE_PHASE_TOTAL,
+  /** @brief the number of phases */
+  OB_WIFI_TIMELINE_PHASE_COUNT
+};
+
+/**
+ * @struct ob_wifi_timeline
+ * @brief the steps of one bring up
+ */
+struct ob_wifi_timeline {
+  /** @brief the uptime in microseconds when the timeline started, see ob_wifi_timeline_now_us() */
+  uint64_t start_us;
+  /** @brief microseconds from the start to the last time each step was reached, or OB_WIFI_TIMELINE_NONE */
+  uint32_t at_us[OB_WIFI_TIMELINE_MARK_COUNT];
+};
+
+/**
+ * @struct ob_wifi_timeline_stat
+ * @brief the duration of a phase over the kept timelines
+ */
+struct ob_wifi_timeline_stat {
+  /** @brief the number of timelines that went through the phase */
+  int count;
+  /** @brief the shortest duration in microseconds */
+  uint32_t min_us;
+  /** @brief the mean duration in microseconds */
+  uint32_t avg_us;
+  /** @brief the longest duration in microseconds */
+  uint32_t max_us;
+};
+
+#ifdef CONFIG_ONBOARDING_WIFI_TIMELINE
+/**
+ * @brief start recording timelines
+ * @details called by ob_wifi_init()
+ */
+void ob_wifi_timeline_init(void);
+
+/**
+ * @brief record that a step was reached
+ * @details may be called from any context
+ *
+ * @param mark the step
+ */
+void ob_wifi_timeline_mark(enum ob_wifi_timeline_mark mark);
+#else
+static inline void ob_wifi_timeline_init(void) { }
+static inline void ob_wifi_timeline_mark(enum ob_wifi_timeline_mark mark) { ARG_UNUSED(mark); }
+#endif // CONFIG_ONBOARDING_WIFI_TIMELINE
+
+/**
+ * @brief read the clock of the timelines
+ * @details the cycle counter gives sub tick resolution when it is 64 bit
+ *
+ * @return the uptime in microseconds
+ */
+uint64_t ob_wifi_timeline_now_us(void);
+
+/**
+ * @brief get a completed timeline
+ *
+ * @param index 0 for the most recent timeline
+ * @param[out] timeline the timeline
+ * @return 0 on success
+ * @return -ENOENT if there is no such timeline
+ */
+int ob_wifi_timeline_get(int index, struct ob_wifi_timeline * timeline);
+
+/**
+ * @brief get the duration of a phase over the completed timelines
+ *
+ * @param phase the phase
+ * @param[out] stat the durations, count is 0 if no timeline went through the phase
+ * @return 0 on success
+ * @return -EINVAL if the phase is unknown
+ */
+int ob_wifi_timeline_stats(enum ob_wifi_timeline_phase phase, struct ob_wifi_timeline_stat * stat);
+
+/**
+ * @brief get the duration of a phase in a timeline
+ *
+ * @param timeline the timeline
+ * @param phase the phase
+ * @return the duration in microseconds
+ * @return OB_WIFI_TIMELINE_NONE if the timeline did not go through the phase
+ */
+uint32_t ob_wifi_timeline_phase_us(const struct ob_wifi_timeline * timeline,
+                                   enum ob_wifi_timeline_phase phase);
+
+/**
+ * @brief discard the completed timelines
+ */
+void ob_wifi_timeline_clear(void);
+
+/**
+ * @brief get the name of a step
+ *
+ * @param mark the step
+ * @return the name
+ */
+const char * ob_wifi_timeline_mark_name(enum ob_wifi_timeline_mark mark);
+
+/**
+ * @brief get the name of a phase
+ *
+ * @param phase the phase
+ * @return the name
+ */
+const char * ob_wifi_timeline_phase_name(enum ob_wifi_timeline_phase phase);
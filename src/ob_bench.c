@@ -0,0 +1,589 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/sys_heap.h>
+#ifdef CONFIG_ARCH_POSIX
+#include <posix_board_if.h>
+#endif // CONFIG_ARCH_POSIX
+
+#include "ob_bench.h"
+#include "ob_wifi.h"
+#include "ob_wifi_link.h"
+#include "ob_wifi_profile.h"
+#include "ob_wifi_sim.h"
+#include "ob_wifi_timeline.h"
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+#include "ob_captive_portal.h"
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+#ifdef CONFIG_ONBOARDING_BLUETOOTH_GATT
+#include "ob_bluetooth_gatt.h"
+#endif // CONFIG_ONBOARDING_BLUETOOTH_GATT
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief the time between two checks of the station in milliseconds */
+#define BENCH_POLL_MS 10
+/** @brief the length of a line of the report */
+#define BENCH_LINE_LEN 512
+/** @brief appended to the passphrase of the AP by the reprovision flow */
+#define BENCH_NEW_PSK_SUFFIX "-new"
+
+/**
+ * @brief the benchmark, only used by the benchmark thread while bench_busy is set
+ */
+static struct {
+  /** @brief the flow to run, OB_BENCH_ALL for every flow */
+  enum ob_bench_flow flow;
+  /** @brief the number of runs of each flow */
+  int runs;
+  /** @brief prints the report */
+  ob_bench_print_t print;
+  /** @brief passed to print */
+  void * user_data;
+  /** @brief exit native_sim with the result once done */
+  bool exit_when_done;
+  /** @brief the SSID of the benchmark */
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  /** @brief the passphrase of the benchmark */
+  char psk[WIFI_PSK_MAX_LEN + 1];
+  /** @brief the time to L4 connected of the successful runs in microseconds */
+  uint32_t samples[CONFIG_ONBOARDING_BENCH_MAX_RUNS];
+  /** @brief the sum of the durations of each phase in microseconds */
+  uint64_t phase_total_us[OB_WIFI_TIMELINE_PHASE_COUNT];
+  /** @brief the number of runs that went through each phase */
+  int phase_count[OB_WIFI_TIMELINE_PHASE_COUNT];
+  /** @brief the line being printed */
+  char line[BENCH_LINE_LEN];
+} bench;
+
+/** @brief set while the benchmark runs */
+static atomic_t bench_busy = ATOMIC_INIT(0);
+
+K_THREAD_STACK_DEFINE(bench_stack, CONFIG_ONBOARDING_BENCH_STACK_SIZE);
+/** @brief the thread running the benchmark */
+static struct k_thread bench_thread;
+
+#if defined(CONFIG_SYS_HEAP_RUNTIME_STATS) && defined(CONFIG_COMMON_LIBC_MALLOC)
+/* Provided by the common libc malloc */
+int malloc_runtime_stats_get(struct sys_memory_stats * stats);
+#endif // CONFIG_SYS_HEAP_RUNTIME_STATS && CONFIG_COMMON_LIBC_MALLOC
+
+/**
+ * @brief append to the line being printed
+ *
+ * @param pos the length of the line
+ * @param fmt the format
+ * @return the new length of the line
+ */
+static int
+bench_append(int pos, const char * fmt, ...)
+{
+  va_list args;
+  int len;
+
+  if(pos >= (int)sizeof(bench.line)) {
+    return pos;
+  }
+  va_start(args, fmt);
+  len = vsnprintk(&bench.line[pos], sizeof(bench.line) - pos, fmt, args);
+  va_end(args);
+  return MIN(pos + MAX(len, 0), (int)sizeof(bench.line));
+}
+
+/**
+ * @brief print the line
+ */
+static void
+bench_flush(void)
+{
+  bench.print(bench.line, bench.user_data);
+}
+
+/**
+ * @brief get the uptime in microseconds the timeline reached L4 connected
+ * @details in the clock of ob_wifi_timeline_now_us(), the runs are timed with it
+ *
+ * @param timeline the timeline
+ * @return the uptime in microseconds
+ */
+static int64_t
+bench_end_us(const struct ob_wifi_timeline * timeline)
+{
+  return (int64_t)timeline->start_us + timeline->at_us[OB_WIFI_TIMELINE_L4_CONNECTED];
+}
+
+/**
+ * @brief wait for the station to be online and let it settle
+ *
+ * @return 0 on success
+ * @return -ETIMEDOUT if the station did not connect
+ */
+static int
+bench_online(void)
+{
+  if(0 == ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_MSEC(CONFIG_ONBOARDING_BENCH_TIMEOUT))) {
+    return -ETIMEDOUT;
+  }
+  /* Lets the L4 connection of the previous run complete its timeline */
+  k_sleep(K_MSEC(CONFIG_ONBOARDING_BENCH_SETTLE));
+  return 0;
+}
+
+/**
+ * @brief make the simulated AP drop the station and wait for the disconnect
+ *
+ * @return 0 on success
+ * @return -ENOTCONN if the station is not connected
+ * @return -ETIMEDOUT if the disconnect was not handled
+ */
+static int
+bench_offline(void)
+{
+  int64_t deadline = k_uptime_get() + CONFIG_ONBOARDING_BENCH_TIMEOUT;
+  int rc;
+
+  /* Each run is a first disconnect, not a flap backing off */
+  ob_wifi_link_forget();
+  if((rc = ob_wifi_sim_drop()) < 0) {
+    return rc;
+  }
+  while(0 != ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_NO_WAIT)) {
+    if(k_uptime_get() > deadline) {
+      return -ETIMEDOUT;
+    }
+    k_sleep(K_MSEC(BENCH_POLL_MS));
+  }
+  return 0;
+}
+
+/**
+ * @brief wait for a timeline to reach L4 connected after a time
+ *
+ * @param after_us the uptime in microseconds
+ * @param[out] timeline the timeline
+ * @return 0 on success
+ * @return -ETIMEDOUT if no timeline reached L4 connected
+ */
+static int
+bench_wait_l4(int64_t after_us, struct ob_wifi_timeline * timeline)
+{
+  int64_t deadline = k_uptime_get() + CONFIG_ONBOARDING_BENCH_TIMEOUT;
+
+  while((0 != ob_wifi_timeline_get(0, timeline)) || (bench_end_us(timeline) <= after_us)) {
+    if(k_uptime_get() > deadline) {
+      return -ETIMEDOUT;
+    }
+    k_sleep(K_MSEC(BENCH_POLL_MS));
+  }
+  return 0;
+}
+
+/**
+ * @brief remove every profile so the bring-up asks for credentials
+ */
+static void
+bench_remove_profiles(void)
+{
+  struct ob_wifi_profile profile;
+  int i;
+
+  for(i = 0; i < CONFIG_ONBOARDING_WIFI_PROFILES; i++) {
+    if(0 == ob_wifi_profile_get(i, &profile)) {
+      ob_wifi_profile_remove(profile.ssid);
+    }
+  }
+  memset(&profile, 0, sizeof(profile));
+}
+
+/**
+ * @brief submit credentials the way an onboarding flow does
+ *
+ * @param flow the flow
+ * @param psk the passphrase
+ * @return 0 if the connection was started
+ * @return -ENOTSUP if the onboarding method of the flow is not built
+ */
+static int
+bench_submit(enum ob_bench_flow flow, const char * psk)
+{
+  switch(flow) {
+  case OB_BENCH_PORTAL:
+  case OB_BENCH_REPROVISION:
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+    return ob_cp_join(bench.ssid, psk);
+#else
+    return -ENOTSUP;
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+
+  case OB_BENCH_GATT:
+#ifdef CONFIG_ONBOARDING_BLUETOOTH_GATT
+    ob_bluetooth_gatt_join(bench.ssid, psk);
+    return 0;
+#else
+    return -ENOTSUP;
+#endif // CONFIG_ONBOARDING_BLUETOOTH_GATT
+
+  default:
+    return -EINVAL;
+  }
+}
+
+/**
+ * @brief check if the onboarding method of a flow is built
+ *
+ * @param flow the flow
+ * @return true if the flow can run
+ */
+static bool
+bench_supported(enum ob_bench_flow flow)
+{
+  switch(flow) {
+  case OB_BENCH_PORTAL:
+  case OB_BENCH_REPROVISION:
+    return IS_ENABLED(CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE);
+  case OB_BENCH_GATT:
+    return IS_ENABLED(CONFIG_ONBOARDING_BLUETOOTH_GATT);
+  default:
+    return true;
+  }
+}
+
+/**
+ * @brief run a flow once
+ * @details every run starts online with the credentials of the benchmark
+ *
+ * @param flow the flow
+ * @param[out] l4_us the time to L4 connected in microseconds
+ * @param[out] timeline the timeline of the run
+ * @return 0 on success
+ * @return a negative errno on failure
+ */
+static int
+bench_run(enum ob_bench_flow flow, uint32_t * l4_us, struct ob_wifi_timeline * timeline)
+{
+  char new_psk[WIFI_PSK_MAX_LEN + 1];
+  int64_t start_us = 0;
+  int rc;
+
+  ob_wifi_sim_ap_psk(bench.ssid, bench.psk);
+  if(((rc = ob_wifi_save_credentials(bench.ssid, bench.psk)) < 0) ||
+     ((rc = bench_online()) < 0)) {
+    return rc;
+  }
+  switch(flow) {
+  case OB_BENCH_STORED:
+    start_us = ob_wifi_timeline_now_us();
+    rc = bench_offline();
+    break;
+
+  case OB_BENCH_PORTAL:
+  case OB_BENCH_GATT:
+    bench_remove_profiles();
+    if((rc = bench_offline()) < 0) {
+      break;
+    }
+    if(0 == ob_wifi_wait_events(OB_WIFI_EVENT_NEED_CREDENTIALS,
+                                K_MSEC(CONFIG_ONBOARDING_BENCH_TIMEOUT))) {
+      rc = -ETIMEDOUT;
+      break;
+    }
+    start_us = ob_wifi_timeline_now_us();
+    rc = bench_submit(flow, bench.psk);
+    break;
+
+  case OB_BENCH_REPROVISION:
+    strncpy(new_psk, bench.psk, WIFI_PSK_MAX_LEN - strlen(BENCH_NEW_PSK_SUFFIX));
+    new_psk[WIFI_PSK_MAX_LEN - strlen(BENCH_NEW_PSK_SUFFIX)] = '\0';
+    strcat(new_psk, BENCH_NEW_PSK_SUFFIX);
+    ob_wifi_sim_ap_psk(bench.ssid, new_psk);
+    if((rc = bench_offline()) < 0) {
+      break;
+    }
+    /* The stored passphrase fails until the user sends the new one, the
+     * time the user takes is not part of the sample */
+    k_sleep(K_MSEC(CONFIG_ONBOARDING_BENCH_REPROVISION_DELAY));
+    start_us = ob_wifi_timeline_now_us();
+    rc = bench_submit(flow, new_psk);
+    memset(new_psk, 0, sizeof(new_psk));
+    break;
+
+  default:
+    rc = -EINVAL;
+    break;
+  }
+  if((rc < 0) || ((rc = bench_wait_l4(start_us, timeline)) < 0)) {
+    return rc;
+  }
+  *l4_us = (uint32_t)MIN(bench_end_us(timeline) - start_us, (int64_t)UINT32_MAX);
+  return 0;
+}
+
+/**
+ * @brief compare two samples for qsort
+ */
+static int
+bench_compare(const void * a, const void * b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief run a flow and print its line of the report
+ *
+ * @param flow the flow
+ * @return the number of failed runs
+ */
+static int
+bench_flow(enum ob_bench_flow flow)
+{
+  struct ob_wifi_timeline timeline;
+  uint64_t total = 0;
+  uint32_t phase_us;
+  int failures = 0;
+  int count = 0;
+  int pos;
+  int rc;
+  int i;
+  int p;
+
+  memset(bench.phase_total_us, 0, sizeof(bench.phase_total_us));
+  memset(bench.phase_count, 0, sizeof(bench.phase_count));
+  for(i = 0; i < bench.runs; i++) {
+    if((rc = bench_run(flow, &bench.samples[count], &timeline)) < 0) {
+      LOG_ERR("Bench %s run %d failed %d", ob_bench_flow_str(flow), i, rc);
+      failures++;
+      continue;
+    }
+    total += bench.samples[count++];
+    for(p = 0; p < OB_WIFI_TIMELINE_PHASE_COUNT; p++) {
+      if(OB_WIFI_TIMELINE_NONE != (phase_us = ob_wifi_timeline_phase_us(&timeline, p))) {
+        bench.phase_total_us[p] += phase_us;
+        bench.phase_count[p]++;
+      }
+    }
+  }
+  pos = bench_append(0, "{\"flow\":\"%s\",\"runs\":%d,\"failures\":%d,\"l4_us\":",
+                     ob_bench_flow_str(flow), bench.runs, failures);
+  if(0 == count) {
+    pos = bench_append(pos, "null");
+  } else {
+    qsort(bench.samples, count, sizeof(bench.samples[0]), bench_compare);
+    pos = bench_append(pos, "{\"min\":%u,\"p50\":%u,\"p90\":%u,\"max\":%u,\"avg\":%u}",
+                       bench.samples[0], bench.samples[(count - 1) / 2],
+                       bench.samples[((count - 1) * 9) / 10], bench.samples[count - 1],
+                       (uint32_t)(total / count));
+  }
+  pos = bench_append(pos, ",\"phases_us\":{");
+  for(p = 0; p < OB_WIFI_TIMELINE_PHASE_COUNT; p++) {
+    pos = bench_append(pos, "%s\"%s\":", (p > 0) ? "," : "", ob_wifi_timeline_phase_name(p));
+    if(0 == bench.phase_count[p]) {
+      pos = bench_append(pos, "null");
+    } else {
+      pos = bench_append(pos, "%u", (uint32_t)(bench.phase_total_us[p] / bench.phase_count[p]));
+    }
+  }
+  bench_append(pos, "}}");
+  bench_flush();
+  return failures;
+}
+
+#if defined(CONFIG_THREAD_MONITOR) && defined(CONFIG_THREAD_STACK_INFO) && defined(CONFIG_INIT_STACKS)
+/**
+ * @brief print the stack usage of a thread
+ *
+ * @param thread the thread
+ * @param user_data unused
+ */
+static void
+bench_thread_report(const struct k_thread * thread, void * user_data)
+{
+  const char * name = k_thread_name_get((k_tid_t)thread);
+  size_t unused;
+
+  ARG_UNUSED(user_data);
+  if(0 != k_thread_stack_space_get(thread, &unused)) {
+    return;
+  }
+  snprintk(bench.line, sizeof(bench.line), "{\"thread\":\"%s\",\"stack_size\":%zu,\"stack_used\":%zu}",
+           (NULL != name) ? name : "", thread->stack_info.size, thread->stack_info.size - unused);
+  bench_flush();
+}
+#endif // CONFIG_THREAD_MONITOR && CONFIG_THREAD_STACK_INFO && CONFIG_INIT_STACKS
+
+/**
+ * @brief print the memory usage
+ */
+static void
+bench_memory_report(void)
+{
+#if defined(CONFIG_SYS_HEAP_RUNTIME_STATS) && defined(CONFIG_COMMON_LIBC_MALLOC)
+  struct sys_memory_stats stats;
+
+  if(0 == malloc_runtime_stats_get(&stats)) {
+    snprintk(bench.line, sizeof(bench.line),
+             "{\"heap\":{\"allocated\":%zu,\"free\":%zu,\"max_allocated\":%zu}}",
+             stats.allocated_bytes, stats.free_bytes, stats.max_allocated_bytes);
+    bench_flush();
+  }
+#endif // CONFIG_SYS_HEAP_RUNTIME_STATS && CONFIG_COMMON_LIBC_MALLOC
+#if defined(CONFIG_THREAD_MONITOR) && defined(CONFIG_THREAD_STACK_INFO) && defined(CONFIG_INIT_STACKS)
+  /* The report may block, so the thread list is not locked */
+  k_thread_foreach_unlocked(bench_thread_report, NULL);
+#endif // CONFIG_THREAD_MONITOR && CONFIG_THREAD_STACK_INFO && CONFIG_INIT_STACKS
+}
+
+/**
+ * @brief run the benchmark
+ */
+static void
+bench_main(void * p1, void * p2, void * p3)
+{
+  struct ob_wifi_sim_ap ap;
+  int failures = 0;
+  int flow;
+
+  ARG_UNUSED(p1);
+  ARG_UNUSED(p2);
+  ARG_UNUSED(p3);
+  ob_wifi_wait_events(OB_WIFI_EVENT_CONFIG_LOADED, K_FOREVER);
+  if(ob_wifi_sim_aps(&ap, 1) < 1) {
+    snprintk(bench.line, sizeof(bench.line), "{\"error\":\"no simulated AP\"}");
+    bench_flush();
+    failures = 1;
+  } else {
+    strcpy(bench.ssid, ap.ssid);
+    strcpy(bench.psk, ap.psk);
+    for(flow = 0; flow < OB_BENCH_FLOWS; flow++) {
+      if((OB_BENCH_ALL != bench.flow) && (flow != bench.flow)) {
+        continue;
+      }
+      if(!bench_supported(flow)) {
+        snprintk(bench.line, sizeof(bench.line), "{\"flow\":\"%s\",\"skipped\":\"not built\"}",
+                 ob_bench_flow_str(flow));
+        bench_flush();
+        continue;
+      }
+      if((OB_BENCH_REPROVISION == flow) && ('\0' == bench.psk[0])) {
+        snprintk(bench.line, sizeof(bench.line), "{\"flow\":\"%s\",\"skipped\":\"open network\"}",
+                 ob_bench_flow_str(flow));
+        bench_flush();
+        continue;
+      }
+      failures += bench_flow(flow);
+    }
+    /* Leave the station with the credentials of the benchmark */
+    ob_wifi_sim_ap_psk(bench.ssid, bench.psk);
+    ob_wifi_save_credentials(bench.ssid, bench.psk);
+    bench_memory_report();
+  }
+  snprintk(bench.line, sizeof(bench.line), "{\"bench\":\"done\",\"failures\":%d}", failures);
+  bench_flush();
+  memset(bench.psk, 0, sizeof(bench.psk));
+#ifdef CONFIG_ARCH_POSIX
+  if(bench.exit_when_done) {
+    posix_exit((failures > 0) ? 1 : 0);
+  }
+#endif // CONFIG_ARCH_POSIX
+  atomic_clear(&bench_busy);
+}
+
+/**
+ * @brief start the benchmark thread
+ *
+ * @param flow the flow, OB_BENCH_ALL for every flow
+ * @param runs the number of runs of each flow
+ * @param print prints the report
+ * @param user_data passed to print
+ * @param exit_when_done exit native_sim once done
+ * @return 0 on success
+ * @return -EINVAL if the flow or the number of runs is invalid
+ * @return -EBUSY if the benchmark is running
+ */
+static int
+bench_start(enum ob_bench_flow flow, int runs, ob_bench_print_t print, void * user_data, bool exit_when_done)
+{
+  if((((int)flow < 0) && (OB_BENCH_ALL != flow)) || (flow >= OB_BENCH_FLOWS) ||
+     (runs <= 0) || (runs > CONFIG_ONBOARDING_BENCH_MAX_RUNS) || (NULL == print)) {
+    return -EINVAL;
+  }
+  if(!atomic_cas(&bench_busy, 0, 1)) {
+    return -EBUSY;
+  }
+  bench.flow = flow;
+  bench.runs = runs;
+  bench.print = print;
+  bench.user_data = user_data;
+  bench.exit_when_done = exit_when_done;
+  k_thread_create(&bench_thread, bench_stack, K_THREAD_STACK_SIZEOF(bench_stack), bench_main,
+                  NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, K_NO_WAIT);
+  k_thread_name_set(&bench_thread, "ob_bench");
+  return 0;
+}
+
+int
+ob_bench_start(enum ob_bench_flow flow, int runs, ob_bench_print_t print, void * user_data)
+{
+  return bench_start(flow, runs, print, user_data, false);
+}
+
+bool
+ob_bench_running(void)
+{
+  return 0 != atomic_get(&bench_busy);
+}
+
+const char *
+ob_bench_flow_str(enum ob_bench_flow flow)
+{
+  switch(flow) {
+  case OB_BENCH_STORED:
+    return "stored";
+  case OB_BENCH_PORTAL:
+    return "portal";
+  case OB_BENCH_GATT:
+    return "gatt";
+  case OB_BENCH_REPROVISION:
+    return "reprovision";
+  case OB_BENCH_ALL:
+    return "all";
+  default:
+    return "unknown";
+  }
+}
+
+#ifdef CONFIG_ONBOARDING_BENCH_AUTORUN
+/**
+ * @brief print a line of the report on the console
+ */
+static void
+bench_autorun_print(const char * line, void * user_data)
+{
+  ARG_UNUSED(user_data);
+  printk("%s\n", line);
+}
+
+/**
+ * @brief run every flow once the application initialized the wifi
+ */
+static int
+bench_autorun(void)
+{
+  return bench_start(OB_BENCH_ALL, CONFIG_ONBOARDING_BENCH_RUNS, bench_autorun_print, NULL, true);
+}
+
+SYS_INIT(bench_autorun, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif // CONFIG_ONBOARDING_BENCH_AUTORUN
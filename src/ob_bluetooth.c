@@ -336,10 +336,6 @@ int bluetooth_init()
   int rc = 0;
   LOG_DBG("Calling bluetooth_init()");
 #ifdef CONFIG_ONBOARDING_BLUETOOTH
-#ifdef CONFIG_ONBOARDING_WIFI
-  set_scan_done_callback(&scan_complete);
-#endif // CONFIG_ONBOARDING_WIFI
-  
   rc = bt_enable(bt_enable_callback);
   if(0 != rc) {
     LOG_ERR("bt_enabled failed %d",rc);
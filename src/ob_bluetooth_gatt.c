@@ -9,11 +9,15 @@
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/conn.h>
 #include <zephyr/data/json.h>
 
 #include <ob_bluetooth.h>
 #include <ob_bluetooth_gatt.h>
 #include <ob_wifi.h>
+#include <ob_wifi_config.h>
+#include <ob_wifi_profile.h>
+#include <ob_wifi_ipv4.h>
 #include <ob_nvs_data.h>
 
 #include <zephyr/logging/log.h>
@@ -24,8 +28,7 @@ K_WORK_DEFINE(ap_list_notify_work, send_ap_list_work_handler);
 struct bt_conn *work_handler_conn_pointer;
 
 LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
-                   
-K_SEM_DEFINE(scan_semaphore, 0, 1);
+
 
 static const struct bt_uuid_128 primary_service_uuid = BT_UUID_INIT_128( BT_UUID_CUSTOM_ONBOARDING_VAL);
 
@@ -33,6 +36,8 @@ static const struct bt_uuid_128 read_aps_characteristic_uuid  = BT_UUID_INIT_128
 
 static const struct bt_uuid_128 write_current_ap_characteristic_uuid = BT_UUID_INIT_128(BT_UUID_CUSTOM_SET_AP_VAL);
 
+static const struct bt_uuid_128 version_characteristic_uuid = BT_UUID_INIT_128(BT_UUID_CUSTOM_VERSION_VAL);
+
 static ssize_t read_aps(struct bt_conn *conn, const struct bt_gatt_attr *attr,
                         void *buf, uint16_t len, uint16_t offset);
 static ssize_t read_current_ap(struct bt_conn *conn, const struct bt_gatt_attr *attr,
@@ -41,6 +46,11 @@ static ssize_t write_current_ap(struct bt_conn *conn,
 					     const struct bt_gatt_attr *attr,
 					     const void *buf, uint16_t len,
 					     uint16_t offset, uint8_t flags);
+static ssize_t read_version(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                            void *buf, uint16_t len, uint16_t offset);
+static ssize_t write_version(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             const void *buf, uint16_t len,
+                             uint16_t offset, uint8_t flags);
 
 static void aps_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
 {
@@ -49,14 +59,18 @@ static void aps_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
 }
 
 static void ob_join_network(struct bt_conn *conn, const struct bt_gatt_attr *attr,
-			    char *ssid, char *passcode);
+			    const char *ssid, const char *passcode);
+static void ob_forget_network(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			      char *ssid);
 static void scan_and_update_list();
-static void ob_update_ap_list(void);
+static void ob_update_ap_list(ob_wifi_scan_snapshot_t * snap);
 
 struct ob_ap_list_entry {
   char *ssid;
   bool secure;
   uint32_t strength;
+  int rssi;
+  uint8_t band;
 };
 
 static const struct json_obj_descr secure_ap_list_entry_json_descr[] = {
@@ -85,14 +99,61 @@ struct ob_set_ap {
   char *ssid;
   char *passcode;
   char *error;
+  bool forget;
+  char *address;
+  char *netmask;
+  char *gateway;
+  char *dns;
+  bool dhcp;
 };
 
 static const struct json_obj_descr set_ap_json_descr[] = {
   JSON_OBJ_DESCR_PRIM(struct ob_set_ap, ssid, JSON_TOK_STRING),
   JSON_OBJ_DESCR_PRIM(struct ob_set_ap, passcode, JSON_TOK_STRING),
   JSON_OBJ_DESCR_PRIM(struct ob_set_ap, error, JSON_TOK_STRING),
+  JSON_OBJ_DESCR_PRIM(struct ob_set_ap, forget, JSON_TOK_TRUE),
+  JSON_OBJ_DESCR_PRIM(struct ob_set_ap, address, JSON_TOK_STRING),
+  JSON_OBJ_DESCR_PRIM(struct ob_set_ap, netmask, JSON_TOK_STRING),
+  JSON_OBJ_DESCR_PRIM(struct ob_set_ap, gateway, JSON_TOK_STRING),
+  JSON_OBJ_DESCR_PRIM(struct ob_set_ap, dns, JSON_TOK_STRING),
+  JSON_OBJ_DESCR_PRIM(struct ob_set_ap, dhcp, JSON_TOK_TRUE),
 };
 
+/** @brief the bit set in the result of json_obj_parse() when ssid was present */
+#define SET_AP_SSID_PARSED BIT(0)
+/** @brief the bit set in the result of json_obj_parse() when forget was present */
+#define SET_AP_FORGET_PARSED BIT(3)
+/** @brief the bit set in the result of json_obj_parse() when address was present */
+#define SET_AP_ADDRESS_PARSED BIT(4)
+/** @brief the bit set in the result of json_obj_parse() when dhcp was present */
+#define SET_AP_DHCP_PARSED BIT(8)
+
+/**
+ * @brief save the IPv4 settings of a write to the current AP
+ * @details "dhcp":true selects DHCP, otherwise address and netmask, with
+ * optional gateway and dns, set a static configuration applied at the
+ * next association
+ *
+ * @param ap the parsed write
+ * @param parsed the result of json_obj_parse()
+ * @return 0 on success
+ * @return -EINVAL if the settings are invalid
+ */
+static int ob_set_ipv4(const struct ob_set_ap *ap, int64_t parsed)
+{
+  struct ob_wifi_ipv4_config config;
+  int rc;
+
+  if ((parsed & SET_AP_DHCP_PARSED) && ap->dhcp) {
+    return ob_wifi_ipv4_set(NULL);
+  }
+  if ((rc = ob_wifi_ipv4_parse(ap->address, ap->netmask, ap->gateway, ap->dns, &config)) < 0) {
+    LOG_ERR("Invalid IPv4 settings");
+    return rc;
+  }
+  return ob_wifi_ipv4_set(&config);
+}
+
 #define MAX_AP_LIST_LENGTH 64
 
 static struct ob_ap_list_entry ap_list[MAX_AP_LIST_LENGTH]; 
@@ -103,9 +164,192 @@ static char ap_list_data[2048] = {
   ']'
 };
 
+/** @brief the size of a TLV record holding an AP with the longest SSID */
+#define AP_LIST_TLV_RECORD_MAX (2 + 1 + WIFI_SSID_MAX_LEN + 2)
+
+/** @brief the AP list in the OB_GATT_AP_LIST_TLV format */
+static uint8_t ap_list_tlv[2 + (MAX_AP_LIST_LENGTH * AP_LIST_TLV_RECORD_MAX)] = {
+  OB_GATT_PROTOCOL_VERSION,
+  0
+};
+/** @brief the length of ap_list_tlv */
+static size_t ap_list_tlv_len = 2;
+
+/** @brief the OB_GATT_AP_LIST_* format selected by the central, JSON until it writes the version characteristic */
+static uint8_t ap_list_format = OB_GATT_AP_LIST_JSON;
+
 static struct ob_current_ap current_ap;
 static char current_ap_data[256] = "{\"ssid\":\"\", \"error\":\"\"}";
 
+#ifdef CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+/** @brief protects the tuning state */
+static K_MUTEX_DEFINE(tune_mutex);
+/** @brief the connection being tuned, referenced until it disconnects */
+static struct bt_conn *tune_conn;
+/** @brief the fast connection parameters were requested */
+static bool tune_fast;
+
+static void tune_idle_handler(struct k_work *work);
+/** @brief relaxes the connection once the central is idle */
+static K_WORK_DELAYABLE_DEFINE(tune_idle_work, tune_idle_handler);
+
+/**
+ * @brief log the parameters negotiated for a connection
+ *
+ * @param conn the connection
+ * @param what what changed
+ */
+static void tune_log(struct bt_conn *conn, const char *what)
+{
+  struct bt_conn_info info;
+
+  if (bt_conn_get_info(conn, &info) < 0) {
+    return;
+  }
+  LOG_INF("%s: interval %u.%02u ms latency %u timeout %u ms mtu %u", what,
+          (info.le.interval * 125) / 100, (info.le.interval * 125) % 100,
+          info.le.latency, info.le.timeout * 10, bt_gatt_get_mtu(conn));
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+  LOG_INF("%s: phy tx %u rx %u", what, info.le.phy->tx_phy, info.le.phy->rx_phy);
+#endif // CONFIG_BT_USER_PHY_UPDATE
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+  LOG_INF("%s: data length tx %u rx %u", what, info.le.data_len->tx_max_len,
+          info.le.data_len->rx_max_len);
+#endif // CONFIG_BT_USER_DATA_LEN_UPDATE
+}
+
+/**
+ * @brief request the fast or the relaxed connection interval, called with tune_mutex held
+ *
+ * @param conn the connection
+ * @param fast true for the provisioning interval
+ */
+static void tune_interval_locked(struct bt_conn *conn, bool fast)
+{
+  struct bt_le_conn_param param = BT_LE_CONN_PARAM_INIT(
+    CONFIG_ONBOARDING_BLUETOOTH_GATT_FAST_INTERVAL_MIN,
+    CONFIG_ONBOARDING_BLUETOOTH_GATT_FAST_INTERVAL_MAX,
+    0, CONFIG_ONBOARDING_BLUETOOTH_GATT_TIMEOUT);
+  int err;
+
+  if (!fast) {
+    param.interval_min = CONFIG_ONBOARDING_BLUETOOTH_GATT_SLOW_INTERVAL_MIN;
+    param.interval_max = CONFIG_ONBOARDING_BLUETOOTH_GATT_SLOW_INTERVAL_MAX;
+    param.latency = CONFIG_ONBOARDING_BLUETOOTH_GATT_SLOW_LATENCY;
+  }
+  tune_fast = fast;
+  if ((err = bt_conn_le_param_update(conn, &param)) < 0) {
+    LOG_WRN("Unable to request the %s interval %d", fast ? "fast" : "relaxed", err);
+  }
+}
+
+/**
+ * @brief keep the connection fast while the central uses the service
+ *
+ * @param conn the connection
+ */
+static void tune_activity(struct bt_conn *conn)
+{
+  k_mutex_lock(&tune_mutex, K_FOREVER);
+  if ((NULL != tune_conn) && (conn == tune_conn)) {
+    if (!tune_fast) {
+      tune_interval_locked(conn, true);
+    }
+    k_work_reschedule(&tune_idle_work, K_MSEC(CONFIG_ONBOARDING_BLUETOOTH_GATT_IDLE));
+  }
+  k_mutex_unlock(&tune_mutex);
+}
+
+/**
+ * @brief relax the connection interval
+ * @param work The work structure
+ */
+static void tune_idle_handler(struct k_work *work)
+{
+  k_mutex_lock(&tune_mutex, K_FOREVER);
+  if ((NULL != tune_conn) && tune_fast) {
+    LOG_DBG("GATT idle, relaxing the connection");
+    tune_interval_locked(tune_conn, false);
+  }
+  k_mutex_unlock(&tune_mutex);
+}
+
+#ifdef CONFIG_BT_GATT_CLIENT
+/** @brief the parameters of the MTU exchange */
+static struct bt_gatt_exchange_params tune_mtu_params;
+
+/**
+ * @brief log the result of the MTU exchange
+ */
+static void tune_mtu_done(struct bt_conn *conn, uint8_t err,
+                          struct bt_gatt_exchange_params *params)
+{
+  if (err) {
+    LOG_WRN("MTU exchange failed 0x%02x", err);
+  } else {
+    LOG_INF("ATT MTU %u", bt_gatt_get_mtu(conn));
+  }
+}
+#endif // CONFIG_BT_GATT_CLIENT
+
+/**
+ * @brief ask for a large MTU, long link layer packets, the 2M PHY and the fast interval
+ *
+ * @param conn the connection
+ */
+static void tune_start(struct bt_conn *conn)
+{
+  int err;
+
+  k_mutex_lock(&tune_mutex, K_FOREVER);
+  if (NULL != tune_conn) {
+    // Only the first central is tuned
+    k_mutex_unlock(&tune_mutex);
+    return;
+  }
+  tune_conn = bt_conn_ref(conn);
+  tune_interval_locked(conn, true);
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+  if ((err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX)) < 0) {
+    LOG_WRN("Unable to request the data length extension %d", err);
+  }
+#endif // CONFIG_BT_USER_DATA_LEN_UPDATE
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+  if ((err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M)) < 0) {
+    LOG_WRN("Unable to request the 2M PHY %d", err);
+  }
+#endif // CONFIG_BT_USER_PHY_UPDATE
+#ifdef CONFIG_BT_GATT_CLIENT
+  tune_mtu_params.func = tune_mtu_done;
+  if ((err = bt_gatt_exchange_mtu(conn, &tune_mtu_params)) < 0) {
+    LOG_WRN("Unable to exchange the MTU %d", err);
+  }
+#endif // CONFIG_BT_GATT_CLIENT
+  ARG_UNUSED(err);
+  k_work_reschedule(&tune_idle_work, K_MSEC(CONFIG_ONBOARDING_BLUETOOTH_GATT_IDLE));
+  k_mutex_unlock(&tune_mutex);
+}
+
+/**
+ * @brief forget the tuned connection
+ *
+ * @param conn the connection
+ */
+static void tune_stop(struct bt_conn *conn)
+{
+  k_mutex_lock(&tune_mutex, K_FOREVER);
+  if (conn == tune_conn) {
+    k_work_cancel_delayable(&tune_idle_work);
+    bt_conn_unref(tune_conn);
+    tune_conn = NULL;
+    tune_fast = false;
+  }
+  k_mutex_unlock(&tune_mutex);
+}
+#else
+static inline void tune_activity(struct bt_conn *conn) { ARG_UNUSED(conn); }
+#endif // CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+
 /* Primary Service Declaration */
 BT_GATT_SERVICE_DEFINE(primary_service,
 	BT_GATT_PRIMARY_SERVICE(&primary_service_uuid),
@@ -123,6 +367,11 @@ BT_GATT_SERVICE_DEFINE(primary_service,
 			        read_current_ap, write_current_ap, current_ap_data),
 	BT_GATT_CCC(aps_ccc_cfg_changed,
 		    BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+
+	BT_GATT_CHARACTERISTIC(&version_characteristic_uuid.uuid,
+			        BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			        BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT,
+			        read_version, write_version, NULL),
 );
 
 static const struct bt_data advertisement[] = {
@@ -134,16 +383,6 @@ static const struct bt_data sd[] = {
 	BT_DATA(BT_DATA_NAME_COMPLETE, CONFIG_BT_DEVICE_NAME, sizeof(CONFIG_BT_DEVICE_NAME) - 1),
 };
 
-static ssid_item_t * ssid_list;
-
-void scan_complete(ssid_item_t * item)
-{
-  LOG_DBG("calling scan_complete");
-  ssid_list = item;
-  k_sem_give(&scan_semaphore);
-
-}
-
 
 static ssize_t read_current_ap(struct bt_conn *conn,
                                const struct bt_gatt_attr *attr,
@@ -169,6 +408,8 @@ static ssize_t write_current_ap(struct bt_conn *conn,
   LOG_DBG("WRITE CURRENT AP (%d BYTES)", len);
   static char tmp_write_buffer[256];
 
+  tune_activity(conn);
+
   if (offset + len > sizeof(tmp_write_buffer)) {
     return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
   }
@@ -181,7 +422,7 @@ static ssize_t write_current_ap(struct bt_conn *conn,
     LOG_DBG("        JSON:  %s", tmp_write_buffer);
 
     // Parse the JSON
-    struct ob_set_ap ap;
+    struct ob_set_ap ap = { 0 };
     int64_t result = json_obj_parse(tmp_write_buffer, strlen(tmp_write_buffer),
 				    set_ap_json_descr, ARRAY_SIZE(set_ap_json_descr),
                                     &ap);
@@ -191,8 +432,19 @@ static ssize_t write_current_ap(struct bt_conn *conn,
   	  return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
     }
     
-    LOG_DBG("Calling ob_join_network(ssid=%s, passcode=%s)\n", ap.ssid, ap.passcode);
-    ob_join_network(conn, attr, ap.ssid, ap.passcode);
+    if ((result & (SET_AP_ADDRESS_PARSED | SET_AP_DHCP_PARSED)) && (ob_set_ipv4(&ap, result) < 0)) {
+  	  return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    if (!(result & SET_AP_SSID_PARSED)) {
+      LOG_DBG("IPv4 settings only");
+    } else if ((result & SET_AP_FORGET_PARSED) && ap.forget) {
+      LOG_DBG("Calling ob_forget_network(ssid=%s)", ap.ssid);
+      ob_forget_network(conn, attr, ap.ssid);
+    } else {
+      LOG_DBG("Calling ob_join_network(ssid=%s, passcode=%s)\n", ap.ssid, ap.passcode);
+      ob_join_network(conn, attr, ap.ssid, ap.passcode);
+    }
 
     LOG_DBG("WRITE CURRENT AP -- current_ap_data=%s", current_ap_data);
   }
@@ -200,6 +452,119 @@ static ssize_t write_current_ap(struct bt_conn *conn,
   return len;
 }
 
+/**
+ * @brief read the protocol version, the AP list formats supported and the one selected
+ */
+static ssize_t read_version(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                            void *buf, uint16_t len, uint16_t offset)
+{
+  uint8_t value[] = {
+    OB_GATT_PROTOCOL_VERSION,
+    BIT(OB_GATT_AP_LIST_JSON) | BIT(OB_GATT_AP_LIST_TLV),
+    ap_list_format
+  };
+
+  return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+/**
+ * @brief select the format of the AP list for the connection
+ * @details the value is one OB_GATT_AP_LIST_* byte, the format goes back to
+ * JSON when the central disconnects
+ */
+static ssize_t write_version(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             const void *buf, uint16_t len,
+                             uint16_t offset, uint8_t flags)
+{
+  uint8_t format;
+
+  if (offset != 0) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+  }
+  if (len != 1) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+  }
+  tune_activity(conn);
+  format = *(const uint8_t *)buf;
+  if ((format != OB_GATT_AP_LIST_JSON) && (format != OB_GATT_AP_LIST_TLV)) {
+    return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+  }
+  LOG_DBG("AP list format %u", format);
+  ap_list_format = format;
+  return len;
+}
+
+static void gatt_conn_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+  ap_list_format = OB_GATT_AP_LIST_JSON;
+#ifdef CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+  tune_stop(conn);
+#endif // CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+}
+
+#ifdef CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+static void gatt_conn_connected(struct bt_conn *conn, uint8_t err)
+{
+  if (!err) {
+    tune_start(conn);
+  }
+}
+
+/**
+ * @brief keep the fast interval while provisioning
+ * @details a central asking for a slower interval is refused until the
+ * connection is idle
+ */
+static bool gatt_le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param)
+{
+  bool accept = true;
+
+  k_mutex_lock(&tune_mutex, K_FOREVER);
+  if ((conn == tune_conn) && tune_fast &&
+      (param->interval_min > CONFIG_ONBOARDING_BLUETOOTH_GATT_FAST_INTERVAL_MAX)) {
+    LOG_DBG("Refusing interval %u-%u while provisioning", param->interval_min, param->interval_max);
+    accept = false;
+  }
+  k_mutex_unlock(&tune_mutex);
+  return accept;
+}
+
+static void gatt_le_param_updated(struct bt_conn *conn, uint16_t interval,
+                                  uint16_t latency, uint16_t timeout)
+{
+  tune_log(conn, "Connection updated");
+}
+
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+static void gatt_le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+  tune_log(conn, "PHY updated");
+}
+#endif // CONFIG_BT_USER_PHY_UPDATE
+
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+static void gatt_le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+  tune_log(conn, "Data length updated");
+}
+#endif // CONFIG_BT_USER_DATA_LEN_UPDATE
+#endif // CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+
+BT_CONN_CB_DEFINE(gatt_conn_callbacks) = {
+  .disconnected = gatt_conn_disconnected,
+#ifdef CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+  .connected = gatt_conn_connected,
+  .le_param_req = gatt_le_param_req,
+  .le_param_updated = gatt_le_param_updated,
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+  .le_phy_updated = gatt_le_phy_updated,
+#endif // CONFIG_BT_USER_PHY_UPDATE
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+  .le_data_len_updated = gatt_le_data_len_updated,
+#endif // CONFIG_BT_USER_DATA_LEN_UPDATE
+#endif // CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+};
+
 char uuid_str[BT_UUID_STR_LEN];
 
 void send_ap_list_work_handler(struct k_work *work)
@@ -212,8 +577,16 @@ void send_ap_list_work_handler(struct k_work *work)
 
 	  struct bt_conn *conn = work_handler_conn_pointer;
 	  size_t offset = 0;
+
+	  tune_activity(conn);
+	  const uint8_t *data = (const uint8_t *)ap_list_data;
 	  size_t total_len = strlen(ap_list_data);
 
+	  if (OB_GATT_AP_LIST_TLV == ap_list_format) {
+		  data = ap_list_tlv;
+		  total_len = ap_list_tlv_len;
+	  }
+
           // Standard MTU overhead is usually 3 bytes (Opcode + Handle)
 	  // If you haven't negotiated a large MTU, this might be ~20 bytes payload.
 	  // If MTU is 247, chunk_size can be 244.
@@ -228,7 +601,7 @@ void send_ap_list_work_handler(struct k_work *work)
 	  
 		  struct bt_gatt_notify_params params = {0};
 		  params.attr = &primary_service.attrs[1]; // Index of your Characteristic Attribute
-		  params.data = &ap_list_data[offset];
+		  params.data = &data[offset];
 		  params.len = len_to_send;
 		  params.func = NULL; // Optional completion callback
 
@@ -260,6 +633,7 @@ static ssize_t read_aps(struct bt_conn *conn, const struct bt_gatt_attr *attr,
   
   LOG_DBG("READ AP LIST (really just trigger a set of notifications).");
 
+  tune_activity(conn);
   if (offset == 0) {
 	  work_handler_conn_pointer = conn;
 	  k_work_submit(&ap_list_notify_work);
@@ -302,9 +676,28 @@ int  gatt_adv_start()
   return err;
 }
 
+#ifdef CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+static void gatt_att_mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx)
+{
+  LOG_INF("ATT MTU updated tx %u rx %u", tx, rx);
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+  .att_mtu_updated = gatt_att_mtu_updated,
+};
+#endif // CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+
 int gatt_init()
 {
   LOG_DBG("GATT init");
+#ifdef CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
+  static bool registered;
+
+  if (!registered) {
+    bt_gatt_cb_register(&gatt_callbacks);
+    registered = true;
+  }
+#endif // CONFIG_ONBOARDING_BLUETOOTH_GATT_TUNING
   return 0;
 }
 
@@ -317,83 +710,197 @@ struct obb_mode obb_mode_gatt = {
 };
 
 
-static void ob_join_network(struct bt_conn *conn, const struct bt_gatt_attr *attr,
-			    char *ssid, char *passcode)
+/** @brief serializes joins with their completion */
+static K_MUTEX_DEFINE(join_mutex);
+/** @brief the connection that requested the join, referenced until the join completes */
+static struct bt_conn *join_conn;
+/** @brief the attribute notified when the join completes */
+static const struct bt_gatt_attr *join_attr;
+/** @brief the SSID being joined */
+static char join_ssid[WIFI_SSID_MAX_LEN + 1];
+/** @brief the PSK of the SSID being joined */
+static char join_psk[WIFI_PSK_MAX_LEN + 1];
+
+/**
+ * @brief encode current_ap into current_ap_data
+ */
+static void encode_current_ap(void)
 {
-  // For now, simply update the current_ap_data
-  current_ap.ssid = ssid;
-  current_ap.error = "";
-  
   int json_encode_result = json_obj_encode_buf(current_ap_set_json_descr, ARRAY_SIZE(current_ap_set_json_descr),
 					       &current_ap, current_ap_data, ARRAY_SIZE(current_ap_data));
   if (0 > json_encode_result) {
-    LOG_DBG("    PROBLEM ENCODING NEW AP TO JSON (err: %d)", json_encode_result);
+    LOG_ERR("    PROBLEM ENCODING CURRENT AP TO JSON (err: %d)", json_encode_result);
   }
-  LOG_DBG("    CURRENT AP:  %s", current_ap_data);
+}
 
-  strcpy(gSSID, ssid);
-  gSSID_len = strlen(gSSID);
-  strcpy(gPSK, passcode);
-  gPSK_len = strlen(gPSK);
+/**
+ * @brief completion callback of the wifi connection started by ob_join_network
+ *
+ * @param result the outcome of the connection
+ * @param user_data unused
+ */
+static void ob_join_network_done(const struct ob_wifi_connect_result *result, void *user_data)
+{
+  ARG_UNUSED(user_data);
 
-  int connect_rc = ob_wifi_connect(); 
-  if (connect_rc == 0) {
-    LOG_DBG("Successfully connected to SSID \"%s\"", gSSID);
+  k_mutex_lock(&join_mutex, K_FOREVER);
+  if (OB_WIFI_CONNECT_OK == result->reason) {
+    LOG_DBG("Successfully connected to SSID \"%s\"", join_ssid);
 
     int nvs_rc;
-    if((nvs_rc = ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_SSID, ssid, strlen(ssid))) < 0) {
-      LOG_ERR("Unable to save SSID %d", nvs_rc);
+    if((nvs_rc = ob_wifi_save_credentials(join_ssid, join_psk)) < 0) {
+      LOG_ERR("Unable to save credentials %d", nvs_rc);
+    } else {
+      ob_wifi_profile_connected(join_ssid);
     }
-    if((nvs_rc = ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_PSK, passcode, strlen(passcode))) < 0) {
-      LOG_ERR("Unable to save PSK %d", nvs_rc);
-    }    
+    ob_wifi_config_publish(join_ssid, join_psk);
   }
   else {
-    LOG_ERR("Failed to connect to SSID \"%s\"", gSSID);
-    current_ap.error="Failed to connect.";
-
-    LOG_DBG("Calling json_obj_encode_buf to encode the error message");
-    json_encode_result = json_obj_encode_buf(current_ap_set_json_descr, ARRAY_SIZE(current_ap_set_json_descr),
-					     &current_ap, current_ap_data, ARRAY_SIZE(current_ap_data));
-    LOG_DBG("Reuturning from json_obj_encode_buf with return value %d", json_encode_result);
-    if (0 > json_encode_result) {
-      LOG_ERR("    PROBLEM ENCODING FAILED AP TO JSON (err: %d)", json_encode_result);
-    }
+    LOG_ERR("Failed to connect to SSID \"%s\": %s", join_ssid,
+            ob_wifi_connect_reason_str(result->reason));
+    current_ap.error = (OB_WIFI_CONNECT_ERR_CANCELLED == result->reason) ?
+      "Cancelled." : "Failed to connect.";
+    encode_current_ap();
   }
-  LOG_DBG("Notifying current_ap_data=%s", current_ap_data);
-  bt_gatt_notify(conn, attr, current_ap_data, strlen(current_ap_data));
+  memset(join_psk, 0, sizeof(join_psk));
+  if (NULL != join_conn) {
+    LOG_DBG("Notifying current_ap_data=%s", current_ap_data);
+    bt_gatt_notify(join_conn, join_attr, current_ap_data, strlen(current_ap_data));
+    bt_conn_unref(join_conn);
+    join_conn = NULL;
+  }
+  k_mutex_unlock(&join_mutex);
 }
 
-#define MIN_SCAN_INTERVAL_MS 5000
+static void ob_join_network(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			    const char *ssid, const char *passcode)
+{
+  struct ob_wifi_connect_params params = { 0 };
+  int connect_rc;
 
-static void scan_and_update_list()
+  if ((NULL == ssid) || (NULL == passcode) ||
+      (strlen(ssid) > WIFI_SSID_MAX_LEN) || (strlen(passcode) > WIFI_PSK_MAX_LEN)) {
+    LOG_ERR("Invalid credentials");
+    return;
+  }
+
+  // A new join replaces the connection in progress
+  ob_wifi_connect_cancel();
+
+  k_mutex_lock(&join_mutex, K_FOREVER);
+  strcpy(join_ssid, ssid);
+  strcpy(join_psk, passcode);
+  join_conn = (NULL != conn) ? bt_conn_ref(conn) : NULL;
+  join_attr = attr;
+
+  current_ap.ssid = join_ssid;
+  current_ap.error = "";
+  encode_current_ap();
+  LOG_DBG("    CURRENT AP:  %s", current_ap_data);
+
+  params.ssid = join_ssid;
+  params.psk = join_psk;
+  k_mutex_unlock(&join_mutex);
+
+  // The outcome is notified by ob_join_network_done
+  connect_rc = ob_wifi_connect_async(&params, ob_join_network_done, NULL);
+  if (-EBUSY == connect_rc) {
+    // The bring-up started trying a profile in the meantime
+    ob_wifi_connect_cancel();
+    connect_rc = ob_wifi_connect_async(&params, ob_join_network_done, NULL);
+  }
+  if (connect_rc < 0) {
+    struct ob_wifi_connect_result result = {
+      .reason = OB_WIFI_CONNECT_ERR_REQUEST,
+      .status = connect_rc
+    };
+    ob_join_network_done(&result, NULL);
+  }
+}
+
+void ob_bluetooth_gatt_join(const char *ssid, const char *psk)
 {
-  int rc = 0;
+  ob_join_network(NULL, NULL, ssid, psk);
+}
 
-  static uint32_t most_recent_scan_time = 0;
+static void ob_forget_network(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			      char *ssid)
+{
+  // Kept apart from join_ssid so a join in progress is not disturbed
+  static char forget_ssid[WIFI_SSID_MAX_LEN + 1];
 
-  uint32_t new_scan_time = k_uptime_get_32();
+  if (NULL == ssid) {
+    LOG_ERR("Invalid SSID");
+    return;
+  }
 
-  // Don't do another scan if we've already done one recently 
-  if (((new_scan_time - most_recent_scan_time) > MIN_SCAN_INTERVAL_MS)
-      && ap_list_count > 0) {
-	  return;
+  k_mutex_lock(&join_mutex, K_FOREVER);
+  strncpy(forget_ssid, ssid, WIFI_SSID_MAX_LEN);
+  forget_ssid[WIFI_SSID_MAX_LEN] = '\0';
+  current_ap.ssid = forget_ssid;
+  if (ob_wifi_profile_remove(forget_ssid) < 0) {
+    LOG_WRN("No profile for SSID \"%s\"", forget_ssid);
+    current_ap.error = "Unknown network.";
+  } else {
+    LOG_INF("Forgot SSID \"%s\"", forget_ssid);
+    current_ap.error = "Forgotten.";
   }
+  encode_current_ap();
+  bt_gatt_notify(conn, attr, current_ap_data, strlen(current_ap_data));
+  k_mutex_unlock(&join_mutex);
+}
 
-  ob_wifi_scan();
-  most_recent_scan_time = new_scan_time;
-  
-  if((rc = k_sem_take(&scan_semaphore, SCAN_TIMEOUT)) < 0) {
-    LOG_ERR("Scan timed out %d",rc);
+static void scan_and_update_list()
+{
+  int rc = 0;
+  ob_wifi_scan_snapshot_t * snap = NULL;
+
+  // Recent results are served from the wifi scan cache
+  if((rc = ob_wifi_scan_get(&snap, SCAN_TIMEOUT)) < 0) {
+    LOG_ERR("Scan failed %d",rc);
+    return;
   }
 
-  ob_update_ap_list();
+  ob_update_ap_list(snap);
+  ob_wifi_scan_unref(snap);
 
   LOG_DBG("ap_list_data=\"%s\"", ap_list_data);  
 
 }	
 
-static void ob_update_ap_list(void)
+/**
+ * @brief encode ap_list into ap_list_tlv
+ */
+static void ob_update_ap_list_tlv(void)
+{
+  size_t offset = 2;
+  size_t ssid_len;
+  uint8_t flags;
+  int ndx;
+
+  ap_list_tlv[0] = OB_GATT_PROTOCOL_VERSION;
+  ap_list_tlv[1] = ap_list_count;
+  for (ndx = 0; ndx < ap_list_count; ++ndx) {
+    ssid_len = strlen(ap_list[ndx].ssid);
+    flags = 0;
+    if (ap_list[ndx].secure) {
+      flags |= OB_GATT_AP_FLAG_SECURE;
+    }
+    if (WIFI_FREQ_BAND_5_GHZ == ap_list[ndx].band) {
+      flags |= OB_GATT_AP_FLAG_5GHZ;
+    }
+    ap_list_tlv[offset++] = OB_GATT_TLV_AP;
+    ap_list_tlv[offset++] = 1 + ssid_len + 2;
+    ap_list_tlv[offset++] = ssid_len;
+    memcpy(&ap_list_tlv[offset], ap_list[ndx].ssid, ssid_len);
+    offset += ssid_len;
+    ap_list_tlv[offset++] = flags;
+    ap_list_tlv[offset++] = (uint8_t)(int8_t)CLAMP(ap_list[ndx].rssi, INT8_MIN, 0);
+  }
+  ap_list_tlv_len = offset;
+}
+
+static void ob_update_ap_list(ob_wifi_scan_snapshot_t * snap)
 {
   LOG_DBG("UPDATE AP LIST CHRC");
 
@@ -402,20 +909,23 @@ static void ob_update_ap_list(void)
   
   
   int ndx = 0;
-  ssid_item_t *current_node = ssid_list;
-  do
+  ssid_item_t *current_node;
+  for(current_node = snap->head; NULL != current_node; current_node = current_node->next)
   {
-    ap_list[ndx].ssid = current_node->ssid;
-    ap_list[ndx].secure = current_node->security;
-    ap_list[ndx].strength = current_node->signal_strength;
-
-    if (++ndx == MAX_AP_LIST_LENGTH) {
+    if (ndx == MAX_AP_LIST_LENGTH) {
 	    LOG_ERR("ssid_list length exceeds MAX_AP_LIST_LENGTH");
 	    break;
     }
-    current_node = current_node->next;
-  } while (current_node != NULL);
+    ap_list[ndx].ssid = current_node->ssid;
+    ap_list[ndx].secure = current_node->security;
+    ap_list[ndx].strength = current_node->signal_strength;
+    ap_list[ndx].rssi = current_node->rssi;
+    ap_list[ndx].band = current_node->band;
+    ndx++;
+  }
   ap_list_count=ndx;
+
+  ob_update_ap_list_tlv();
   
   memset(ap_list_data, 0, max_size);
   ap_list_data[0] = '[';
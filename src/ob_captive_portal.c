@@ -10,6 +10,12 @@
 #include <stdlib.h>
 #include "ob_web_server.h"
 #include "ob_wifi.h"
+#include "ob_wifi_config.h"
+#include "ob_wifi_profile.h"
+#include "ob_wifi_ipv4.h"
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+#include "ob_wifi_probe.h"
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
 #include "ob_nvs_data.h"
 #include "ob_reboot.h"
 
@@ -25,6 +31,42 @@ LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
  * @brief The title of the web page.
  */
 #define WIFI_SETUP_TITLE "Wifi setup"
+/**
+ * @brief The path of the saved networks web page.
+ */
+#define WIFI_PROFILES_PAGE_PATH "/wifiprofiles.html"
+/**
+ * @brief The title of the saved networks web page.
+ */
+#define WIFI_PROFILES_TITLE "Saved networks"
+/**
+ * @brief The path of the IPv4 settings web page.
+ */
+#define WIFI_IPV4_PAGE_PATH "/ipv4.html"
+/**
+ * @brief The title of the IPv4 settings web page.
+ */
+#define WIFI_IPV4_TITLE "IPv4 settings"
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+/**
+ * @brief The path of the connection status web page.
+ */
+#define WIFI_STATUS_PAGE_PATH "/wifistatus.html"
+/**
+ * @brief The title of the connection status web page.
+ */
+#define WIFI_STATUS_TITLE "Wifi status"
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+/**
+ * @brief The path of the link quality web page.
+ */
+#define WIFI_LINK_PAGE_PATH "/wifilink.html"
+/**
+ * @brief The title of the link quality web page.
+ */
+#define WIFI_LINK_TITLE "Link quality"
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
 
 
 /**
@@ -33,13 +75,6 @@ LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
 static char content_wifi_body_start[] = {
   "<form method=\"post\" enctype=\"text/plain\" action=\"" WIFI_SETUP_PAGE_PATH "\"><div><label for=\"ssid\">Select a SSID:</label><select name=\"ssid\" id=\"ssid\"> "};
 
-/**
- * @brief this is the buffer that contains the SSIDs and the PSK for discovered APs.
- *  It is filled in by the client_scan_done callback
- * @see client_scan_done
- */
-static char *content_wifi_body_ssid = NULL;
-
 /**
  * @brief This tail of the body of the WIFI_SETUP_PAGE_PATH
  */
@@ -101,50 +136,49 @@ post_attributes_t wifi_setup_attrib[NUM_WIFI_SETUP_ATTRIBUTES] = {
 #endif //CONFIG_ONBOARDING_OTA_GOLIOTH
 };
 /**
- * @brief a semaphore to pend opertation until the wifi scan is complete
- *
+ * @brief the maximum time to wait for a wifi scan
  */
-static K_SEM_DEFINE(scan_done_sem, 0, 1);
+#define WIFI_SETUP_SCAN_TIMEOUT K_MSEC(CONFIG_ONBOARDING_WIFI_SCAN_TIMEOUT)
 
 /**
- * @brief This function is called when a wifi scan completes. @n
- * This function iterates through the passed list of ssids
+ * @brief This function builds the SSID options from a scan. @n
+ * This function iterates through the list of ssids
  * to find the size of the buffer needed to hold all the ssids. @n
  * It then allocates and constructs the buffer for selecting an SSID.
  *
- * @param ssid Pointer to the linked list of ssids detected
+ * @param snap the scan results
+ *
+ * @return the buffer, to be freed by the caller
+ * @return NULL on failure
  */
-static void client_scan_done(ssid_item_t * ssid)
+static char * create_ssid_options(ob_wifi_scan_snapshot_t * snap)
 {
   ssid_item_t * it;
   char ssidbuf[(WIFI_SSID_MAX_LEN * 2) + sizeof(option_fmt)];
-  int len = 0;
-  LOG_DBG("Wifi scan done");
-  for(it = ssid; NULL != it; it=it->next) {
-    //    len += it->len * 2 ;
+  char * options;
+  int len = 1;
+  int offset = 0;
+
+  for(it = snap->head; NULL != it; it=it->next) {
     len += strlen(it->ssid) * 2 ;
     len += (sizeof(option_fmt) -4);
   }
 
-  content_wifi_body_ssid = malloc(len);
-  //content_wifi_body_ssid = ssid_data;
-  if(NULL == content_wifi_body_ssid) {
+  options = malloc(len);
+  if(NULL == options) {
     LOG_ERR("scan done no memory for %d", len);
-    return;
+    return NULL;
   }
   LOG_DBG("Allocated %d bytes", len);
-  memset(content_wifi_body_ssid, 0, len);
+  options[0] = '\0';
 
-  int altlen = 0;
-  for(it = ssid; NULL != it; it=it->next) {
-    sprintf(ssidbuf, option_fmt, it->ssid, it->ssid);
-    LOG_DBG("ssid buf %s %d", ssidbuf, (int)strlen(ssidbuf));
-    altlen += strlen(ssidbuf);
-    strcat(content_wifi_body_ssid, ssidbuf);
+  for(it = snap->head; NULL != it; it=it->next) {
+    snprintf(ssidbuf, sizeof(ssidbuf), option_fmt, it->ssid, it->ssid);
+    strcpy(options + offset, ssidbuf);
+    offset += strlen(ssidbuf);
   }
-  LOG_DBG("buf %s altlen %d", content_wifi_body_ssid, altlen);
-  k_sem_give(&scan_done_sem);
-
+  LOG_DBG("buf %s len %d", options, offset);
+  return options;
 }
 
 /**
@@ -160,13 +194,17 @@ static int display_wifi_setup_page(int client, web_page_t * wp)
 {
   int contentlen;
   char * header = NULL;
+  char * content_wifi_body_ssid = NULL;
+  ob_wifi_scan_snapshot_t * snap = NULL;
   int rc = 0;
 
   LOG_DBG("Wifi Setup");
-  set_scan_done_callback(client_scan_done);
-  ob_wifi_scan();
-  k_sem_take(&scan_done_sem, K_FOREVER);
-  // TODO add a queue to pass ssid string
+  if((rc = ob_wifi_scan_get(&snap, WIFI_SETUP_SCAN_TIMEOUT)) < 0) {
+    LOG_ERR("Wifi scan failed %d", rc);
+    return -1;
+  }
+  content_wifi_body_ssid = create_ssid_options(snap);
+  ob_wifi_scan_unref(snap);
   do {
     if(NULL == content_wifi_body_ssid) {
       rc = -1;
@@ -204,11 +242,299 @@ static int display_wifi_setup_page(int client, web_page_t * wp)
   return rc;
 }
 
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+/**
+ * @brief the progress of the connection started from the portal
+ */
+typedef enum {
+  /** @brief no connection was started */
+  PORTAL_JOIN_IDLE,
+  /** @brief the station is connecting */
+  PORTAL_JOIN_CONNECTING,
+  /** @brief the station is online and the credentials are saved */
+  PORTAL_JOIN_CONNECTED,
+  /** @brief the connection failed */
+  PORTAL_JOIN_FAILED,
+} portal_join_state_t;
+
+/** @brief protects the portal_join variables */
+static K_MUTEX_DEFINE(portal_join_mutex);
+/** @brief the progress of the connection */
+static portal_join_state_t portal_join_state = PORTAL_JOIN_IDLE;
+/** @brief the reason the connection failed */
+static ob_wifi_connect_reason_t portal_join_reason;
+/** @brief the SSID being joined */
+static char portal_join_ssid[WIFI_SSID_MAX_LEN + 1];
+/** @brief the PSK of the SSID being joined, cleared once the connection ends */
+static char portal_join_psk[WIFI_PSK_MAX_LEN + 1];
+
+/**
+ * @brief The body of the WIFI_STATUS_PAGE_PATH while connecting, reloaded every 2 seconds.
+ */
+static const char content_status_connecting_fmt[] =
+  "<meta http-equiv=\"refresh\" content=\"2\" />"
+  "<div>Connecting to %s...</div></body></html>\r\n\r\n";
+
+/**
+ * @brief The body of the WIFI_STATUS_PAGE_PATH once connected.
+ */
+static const char content_status_connected_fmt[] =
+  "<div>Connected to %s with the address %s. The setup network closes in %d seconds.</div>"
+  "</body></html>\r\n\r\n";
+
+/**
+ * @brief The body of the WIFI_STATUS_PAGE_PATH when the connection failed.
+ */
+static const char content_status_failed_fmt[] =
+  "<div>Unable to connect to %s: %s.</div>"
+  "<div><a href=\"" WIFI_SETUP_PAGE_PATH "\">Check the password and try again</a></div>"
+  "</body></html>\r\n\r\n";
+
+/**
+ * @brief The body of the WIFI_STATUS_PAGE_PATH before a network is configured.
+ */
+static const char content_status_idle[] =
+  "<div><a href=\"" WIFI_SETUP_PAGE_PATH "\">Select a network</a></div></body></html>\r\n\r\n";
+
+/**
+ * @brief completion callback of the connection started by post_wifi_setup_page. @n
+ * The credentials are only saved once an address is bound.
+ *
+ * @param result the outcome of the connection
+ * @param user_data unused
+ */
+static void portal_join_done(const struct ob_wifi_connect_result * result, void * user_data)
+{
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  char psk[WIFI_PSK_MAX_LEN + 1];
+  int rc;
+
+  ARG_UNUSED(user_data);
+  k_mutex_lock(&portal_join_mutex, K_FOREVER);
+  strcpy(ssid, portal_join_ssid);
+  strcpy(psk, portal_join_psk);
+  memset(portal_join_psk, 0, sizeof(portal_join_psk));
+  if(OB_WIFI_CONNECT_OK == result->reason) {
+    portal_join_state = PORTAL_JOIN_CONNECTED;
+  } else {
+    portal_join_reason = result->reason;
+    portal_join_state = PORTAL_JOIN_FAILED;
+  }
+  k_mutex_unlock(&portal_join_mutex);
+
+  // Saved without the mutex, so the status page is not held up by the flash
+  if(OB_WIFI_CONNECT_OK == result->reason) {
+    LOG_INF("Connected to %s", ssid);
+    if((rc = ob_wifi_save_credentials(ssid, psk)) < 0) {
+      LOG_ERR("Unable to save credentials %d", rc);
+    } else {
+      ob_wifi_profile_connected(ssid);
+    }
+    ob_wifi_config_publish(ssid, psk);
+  } else {
+    LOG_ERR("Failed to connect to %s: %s", ssid, ob_wifi_connect_reason_str(result->reason));
+  }
+  memset(psk, 0, sizeof(psk));
+}
+
+/**
+ * @brief start connecting the station with the posted credentials
+ *
+ * @param ssid the SSID, NUL terminated
+ * @param psk the PSK, NUL terminated
+ * @return 0 if the connection was started
+ * @return a negative errno on failure
+ */
+static int portal_join_start(const char * ssid, const char * psk)
+{
+  struct ob_wifi_connect_params params = { 0 };
+  int rc;
+
+  if((strlen(ssid) == 0) || (strlen(ssid) > WIFI_SSID_MAX_LEN) || (strlen(psk) > WIFI_PSK_MAX_LEN)) {
+    return -EINVAL;
+  }
+  // A new join replaces the connection in progress
+  ob_wifi_connect_cancel();
+
+  k_mutex_lock(&portal_join_mutex, K_FOREVER);
+  strcpy(portal_join_ssid, ssid);
+  strcpy(portal_join_psk, psk);
+  portal_join_state = PORTAL_JOIN_CONNECTING;
+  params.ssid = portal_join_ssid;
+  params.psk = portal_join_psk;
+  params.max_attempts = CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE_ATTEMPTS;
+  k_mutex_unlock(&portal_join_mutex);
+
+  // The outcome is recorded by portal_join_done
+  rc = ob_wifi_connect_async(&params, portal_join_done, NULL);
+  if(-EBUSY == rc) {
+    // The bring-up started trying a profile in the meantime
+    ob_wifi_connect_cancel();
+    rc = ob_wifi_connect_async(&params, portal_join_done, NULL);
+  }
+  if(rc < 0) {
+    struct ob_wifi_connect_result result = {
+      .reason = OB_WIFI_CONNECT_ERR_REQUEST,
+      .status = rc
+    };
+    portal_join_done(&result, NULL);
+  }
+  return rc;
+}
+
+/**
+ * @brief This function sends the progress of the connection started from the portal. @n
+ * The page reloads itself while the station is connecting.
+ *
+ * @param client The socket to send the page over.
+ * @param wp The web_page_t structure for this page
+ *
+ * @return 0 on success
+ * @return -1 on failure
+ */
+static int display_wifi_status_page(int client, web_page_t * wp)
+{
+  char address[NET_IPV4_ADDR_LEN] = "";
+  struct net_if * iface = net_if_get_wifi_sta();
+  struct in_addr * in;
+  char * body;
+  char * header;
+  int len;
+  int rc;
+
+  len = sizeof(content_status_failed_fmt) + sizeof(content_status_connected_fmt) +
+    (WIFI_SSID_MAX_LEN * 2) + NET_IPV4_ADDR_LEN + 32;
+  if(NULL == (body = malloc(len))) {
+    LOG_ERR("No memory for %d", len);
+    return -1;
+  }
+  k_mutex_lock(&portal_join_mutex, K_FOREVER);
+  switch(portal_join_state) {
+  case PORTAL_JOIN_CONNECTING:
+    len = snprintf(body, len, content_status_connecting_fmt, portal_join_ssid);
+    break;
+
+  case PORTAL_JOIN_CONNECTED:
+    if((NULL != iface) && (NULL != (in = net_if_ipv4_get_global_addr(iface, NET_ADDR_PREFERRED)))) {
+      net_addr_ntop(AF_INET, in, address, sizeof(address));
+    }
+    len = snprintf(body, len, content_status_connected_fmt, portal_join_ssid, address,
+                   CONFIG_ONBOARDING_WIFI_AP_GRACE / MSEC_PER_SEC);
+    break;
+
+  case PORTAL_JOIN_FAILED:
+    len = snprintf(body, len, content_status_failed_fmt, portal_join_ssid,
+                   ob_wifi_connect_reason_str(portal_join_reason));
+    break;
+
+  default:
+    len = snprintf(body, len, "%s", content_status_idle);
+    break;
+  }
+  k_mutex_unlock(&portal_join_mutex);
+  header = CreateHeader200(len, WIFI_STATUS_TITLE);
+  if(NULL == header) {
+    LOG_ERR("HTTP header creation failed");
+    free(body);
+    return -1;
+  }
+  if((rc = sendall(client, header, strlen(header))) < 0) {
+    LOG_ERR("HTTP Header send failed %d",errno);
+  }
+  if((rc = sendall(client, body, len)) < 0) {
+    LOG_ERR("HTTP status body send failed %d",errno);
+  }
+  free(body);
+  return rc;
+}
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+/**
+ * @brief The radio part of the WIFI_LINK_PAGE_PATH.
+ */
+static const char content_link_radio_fmt[] =
+  "<div>RSSI %d dBm, average %d dBm, TX rate %d kbps, TX errors %u, RX errors %u</div>"
+  "<table><tr><th>Destination</th><th>Sent</th><th>Received</th><th>Loss</th>"
+  "<th>RTT (us)</th><th>Average (us)</th><th>Jitter (us)</th></tr>";
+
+/**
+ * @brief A destination row of the WIFI_LINK_PAGE_PATH.
+ */
+static const char content_link_path_fmt[] =
+  "<tr><td>%s</td><td>%u</td><td>%u</td><td>%u.%u%%</td><td>%u</td><td>%u</td><td>%u</td></tr>";
+
+/**
+ * @brief The end of the WIFI_LINK_PAGE_PATH.
+ */
+static const char content_link_tail[] = "</table></body></html>\r\n\r\n";
+
+/**
+ * @brief This function sends the statistics of the link probe.
+ *
+ * @param client The socket to send the page over.
+ * @param wp The web_page_t structure for this page
+ *
+ * @return 0 on success
+ * @return -1 on failure
+ */
+static int display_wifi_link_page(int client, web_page_t * wp)
+{
+  struct ob_wifi_probe_stats stats;
+  struct ob_wifi_probe_path * path;
+  char address[NET_IPV4_ADDR_LEN];
+  char * body;
+  char * header;
+  int size;
+  int len;
+  int rc;
+  int i;
+
+  ob_wifi_probe_get_stats(&stats);
+  size = sizeof(content_link_radio_fmt) + sizeof(content_link_tail) + 64 +
+    (OB_WIFI_PROBE_PATHS * (sizeof(content_link_path_fmt) + NET_IPV4_ADDR_LEN + 64));
+  if(NULL == (body = malloc(size))) {
+    LOG_ERR("No memory for %d", size);
+    return -1;
+  }
+  len = snprintf(body, size, content_link_radio_fmt, stats.rssi, stats.rssi_avg, stats.tx_rate,
+                 stats.tx_errors, stats.rx_errors);
+  for(i = 0; i < OB_WIFI_PROBE_PATHS; i++) {
+    path = &stats.paths[i];
+    if(INADDR_ANY == path->addr.s_addr) {
+      continue;
+    }
+    net_addr_ntop(AF_INET, &path->addr, address, sizeof(address));
+    len += snprintf(body + len, size - len, content_link_path_fmt, address, path->sent,
+                    path->received, path->loss_permille / 10, path->loss_permille % 10,
+                    path->rtt_us, path->srtt_us, path->jitter_us);
+  }
+  len += snprintf(body + len, size - len, "%s", content_link_tail);
+  header = CreateHeader200(len, WIFI_LINK_TITLE);
+  if(NULL == header) {
+    LOG_ERR("HTTP header creation failed");
+    free(body);
+    return -1;
+  }
+  if((rc = sendall(client, header, strlen(header))) < 0) {
+    LOG_ERR("HTTP Header send failed %d",errno);
+  }
+  if((rc = sendall(client, body, len)) < 0) {
+    LOG_ERR("HTTP link body send failed %d",errno);
+  }
+  free(body);
+  return rc;
+}
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
+
 /**
  * @brief This function processes a post to the WIFI_SETUP_PAGE_PATH web page. @n
- * The function processes the POST from a client. @n It extracts the SSID and the PSK
- * and saves them into nvs storage. @n
- * It sends the web server home page back to the client and reboots the device
+ * The function processes the POST from a client. @n It extracts the SSID and the PSK.
+ * With CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE the station connects with them while
+ * the AP stays up and the status page is sent back, the credentials are saved once
+ * an address is bound. @n
+ * Otherwise they are saved into nvs storage, the web server home page is sent back
+ * to the client and the device reboots.
  *
  * @return 0 on success
  * @return -1 on error
@@ -217,16 +543,19 @@ static int post_wifi_setup_page(int client, web_page_t * wp)
 {
   int rc;
   if((rc =  ob_ws_process_post(client, wifi_setup_attrib, NUM_WIFI_SETUP_ATTRIBUTES,wp)) >= 0) {
-    if((rc = ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_SSID,
-                            wifi_setup_attrib[WIFI_SETUP_ATTRIB_SSID].valuebuffer,
-                            strlen(wifi_setup_attrib[WIFI_SETUP_ATTRIB_SSID].valuebuffer))) < 0) {
-      LOG_ERR("Unable to save SSID %d", rc);
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+    if((rc = portal_join_start(wifi_setup_attrib[WIFI_SETUP_ATTRIB_SSID].valuebuffer,
+                               wifi_setup_attrib[WIFI_SETUP_ATTRIB_PASSWORD].valuebuffer)) < 0) {
+      LOG_ERR("Unable to connect %d", rc);
     }
-    if((rc = ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_PSK,
-                            wifi_setup_attrib[WIFI_SETUP_ATTRIB_PASSWORD].valuebuffer,
-                            strlen(wifi_setup_attrib[WIFI_SETUP_ATTRIB_PASSWORD].valuebuffer))) < 0) {
-      LOG_ERR("Unable to save PSK %d", rc);
+#else
+    if((rc = ob_wifi_save_credentials(wifi_setup_attrib[WIFI_SETUP_ATTRIB_SSID].valuebuffer,
+                                      wifi_setup_attrib[WIFI_SETUP_ATTRIB_PASSWORD].valuebuffer)) < 0) {
+      LOG_ERR("Unable to save credentials %d", rc);
     }
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+    memset(wifi_setup_attrib[WIFI_SETUP_ATTRIB_PASSWORD].valuebuffer, 0,
+           sizeof(wifi_setup_attrib[WIFI_SETUP_ATTRIB_PASSWORD].valuebuffer));
 #ifdef CONFIG_ONBOARDING_OTA_GOLIOTH
     if((rc = ob_nvs_data_write(NVS_SETTINGS_ID_OTA_PSK,
                             wifi_setup_attrib[WIFI_SETUP_ATTRIB_OTA_PSK].valuebuffer,
@@ -243,14 +572,257 @@ static int post_wifi_setup_page(int client, web_page_t * wp)
   } else {
     LOG_ERR("Post proccess failed %d", rc);
   }
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+  display_wifi_status_page(client, wp);
+#else
   ob_web_server_display_home(client);
 
   if(rc >= 0) {
     ob_reboot();
   }
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+  return rc;
+}
+
+/**
+ * @brief This is the start of the body of the WIFI_PROFILES_PAGE_PATH.
+ */
+static char content_profiles_body_start[] = {
+  "<form method=\"post\" enctype=\"text/plain\" action=\"" WIFI_PROFILES_PAGE_PATH "\"><div><label for=\"ssid\">Forget a saved network:</label><select name=\"ssid\" id=\"ssid\"> "};
+
+/**
+ * @brief This tail of the body of the WIFI_PROFILES_PAGE_PATH
+ */
+static char content_profiles_body_tail[] = {
+  "</select></div><input type=\"submit\" value=\"Forget\" /></form></body></html>\r\n\r\n"};
+
+/**
+ * @brief The format for displaying a saved network
+ */
+static char profile_option_fmt[] = "<option value=\"%s\">%s (priority %d)</option>";
+
+/**
+ * @var wifi_profiles_attrib
+ * @brief This variable holds the attributes that are returned from a
+ * POST to the WIFI_PROFILES_PAGE_PATH web page
+ */
+post_attributes_t wifi_profiles_attrib[1] = {
+  /**
+   * @brief the SSID of the network to forget
+   */
+  { "ssid", 4, },
+};
+
+/**
+ * @brief This function sends the list of saved networks.
+ *
+ * @param client The socket to send the page over.
+ * @param wp The web_page_t structure for this page
+ *
+ * @return 0 on success
+ * @return -1 on failure
+ */
+static int display_wifi_profiles_page(int client, web_page_t * wp)
+{
+  struct ob_wifi_profile profile;
+  char optionbuf[(WIFI_SSID_MAX_LEN * 2) + sizeof(profile_option_fmt) + 4];
+  char * options;
+  char * header = NULL;
+  int len = 1;
+  int offset = 0;
+  int contentlen;
+  int rc = 0;
+  int i;
+
+  len += CONFIG_ONBOARDING_WIFI_PROFILES * sizeof(optionbuf);
+  options = malloc(len);
+  if(NULL == options) {
+    LOG_ERR("No memory for %d", len);
+    return -1;
+  }
+  options[0] = '\0';
+  for(i = 0; i < CONFIG_ONBOARDING_WIFI_PROFILES; i++) {
+    if(ob_wifi_profile_get(i, &profile) < 0) {
+      continue;
+    }
+    offset += snprintf(options + offset, len - offset, profile_option_fmt,
+                       profile.ssid, profile.ssid, profile.priority);
+  }
+  memset(&profile, 0, sizeof(profile));
+  do {
+    contentlen = strlen(content_profiles_body_start) + offset + strlen(content_profiles_body_tail);
+    header = CreateHeader200(contentlen, WIFI_PROFILES_TITLE);
+    if(NULL == header) {
+      LOG_ERR("HTTP header creation failed");
+      rc = -1;
+      break;
+    }
+    if((rc = sendall(client, header, strlen(header))) < 0) {
+      LOG_ERR("HTTP Header send failed %d",errno);
+    }
+    if((rc = sendall(client, content_profiles_body_start, strlen(content_profiles_body_start))) < 0) {
+      LOG_ERR("HTTP profiles_body_start send failed %d",errno);
+    }
+    if((rc = sendall(client, options, offset)) < 0) {
+      LOG_ERR("HTTP profiles send failed %d",errno);
+    }
+    if((rc = sendall(client, content_profiles_body_tail, strlen(content_profiles_body_tail))) < 0) {
+      LOG_ERR("HTTP profiles_body_tail send failed %d",errno);
+    }
+  } while(0);
+  free(options);
   return rc;
 }
 
+/**
+ * @brief This function processes a post to the WIFI_PROFILES_PAGE_PATH web page. @n
+ * It removes the profile of the selected SSID and sends the home page back.
+ *
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int post_wifi_profiles_page(int client, web_page_t * wp)
+{
+  int rc;
+
+  if((rc = ob_ws_process_post(client, wifi_profiles_attrib, ARRAY_SIZE(wifi_profiles_attrib), wp)) >= 0) {
+    if((rc = ob_wifi_profile_remove(wifi_profiles_attrib[0].valuebuffer)) < 0) {
+      LOG_ERR("No profile for %s", wifi_profiles_attrib[0].valuebuffer);
+    }
+  } else {
+    LOG_ERR("Post proccess failed %d", rc);
+  }
+  ob_web_server_display_home(client);
+  return rc;
+}
+
+/**
+ * @brief The body of the WIFI_IPV4_PAGE_PATH, filled in with the current configuration.
+ */
+static const char content_ipv4_body_fmt[] =
+  "<form method=\"post\" enctype=\"text/plain\" action=\"" WIFI_IPV4_PAGE_PATH "\">"
+  "<div>Leave the address empty to use DHCP.</div>"
+  "<div><label for=\"address\">Address:</label><input type=\"text\" id=\"address\" name=\"address\" value=\"%s\" /></div>"
+  "<div><label for=\"netmask\">Netmask:</label><input type=\"text\" id=\"netmask\" name=\"netmask\" value=\"%s\" /></div>"
+  "<div><label for=\"gateway\">Gateway:</label><input type=\"text\" id=\"gateway\" name=\"gateway\" value=\"%s\" /></div>"
+  "<div><label for=\"dns\">DNS server:</label><input type=\"text\" id=\"dns\" name=\"dns\" value=\"%s\" /></div>"
+  "<input type=\"submit\" value=\"Save\" /></form></body></html>\r\n\r\n";
+
+/** @brief the index of the address post attribute */
+#define WIFI_IPV4_ATTRIB_ADDRESS 0
+/** @brief the index of the netmask post attribute */
+#define WIFI_IPV4_ATTRIB_NETMASK 1
+/** @brief the index of the gateway post attribute */
+#define WIFI_IPV4_ATTRIB_GATEWAY 2
+/** @brief the index of the DNS server post attribute */
+#define WIFI_IPV4_ATTRIB_DNS     3
+
+/**
+ * @var wifi_ipv4_attrib
+ * @brief This variable holds the attributes that are returned from a
+ * POST to the WIFI_IPV4_PAGE_PATH web page
+ */
+post_attributes_t wifi_ipv4_attrib[4] = {
+  { "address", 7, },
+  { "netmask", 7, },
+  { "gateway", 7, },
+  { "dns", 3, },
+};
+
+/**
+ * @brief This function sends the IPv4 settings of the station.
+ *
+ * @param client The socket to send the page over.
+ * @param wp The web_page_t structure for this page
+ *
+ * @return 0 on success
+ * @return -1 on failure
+ */
+static int display_wifi_ipv4_page(int client, web_page_t * wp)
+{
+  struct ob_wifi_ipv4_config config;
+  char address[NET_IPV4_ADDR_LEN] = "";
+  char netmask[NET_IPV4_ADDR_LEN] = "";
+  char gateway[NET_IPV4_ADDR_LEN] = "";
+  char dns[NET_IPV4_ADDR_LEN] = "";
+  char * body;
+  char * header;
+  int len;
+  int rc;
+
+  if(ob_wifi_ipv4_get(&config) == 0) {
+    net_addr_ntop(AF_INET, &config.address, address, sizeof(address));
+    net_addr_ntop(AF_INET, &config.netmask, netmask, sizeof(netmask));
+    if(INADDR_ANY != config.gateway.s_addr) {
+      net_addr_ntop(AF_INET, &config.gateway, gateway, sizeof(gateway));
+    }
+    if(INADDR_ANY != config.dns.s_addr) {
+      net_addr_ntop(AF_INET, &config.dns, dns, sizeof(dns));
+    }
+  }
+  len = sizeof(content_ipv4_body_fmt) + (4 * NET_IPV4_ADDR_LEN);
+  if(NULL == (body = malloc(len))) {
+    LOG_ERR("No memory for %d", len);
+    return -1;
+  }
+  len = snprintf(body, len, content_ipv4_body_fmt, address, netmask, gateway, dns);
+  header = CreateHeader200(len, WIFI_IPV4_TITLE);
+  if(NULL == header) {
+    LOG_ERR("HTTP header creation failed");
+    free(body);
+    return -1;
+  }
+  if((rc = sendall(client, header, strlen(header))) < 0) {
+    LOG_ERR("HTTP Header send failed %d",errno);
+  }
+  if((rc = sendall(client, body, len)) < 0) {
+    LOG_ERR("HTTP ipv4 body send failed %d",errno);
+  }
+  free(body);
+  return rc;
+}
+
+/**
+ * @brief This function processes a post to the WIFI_IPV4_PAGE_PATH web page. @n
+ * It saves the static configuration, or selects DHCP when the address is
+ * empty, and sends the home page back. The configuration is applied at the
+ * next association.
+ *
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int post_wifi_ipv4_page(int client, web_page_t * wp)
+{
+  struct ob_wifi_ipv4_config config;
+  int rc;
+
+  if((rc = ob_ws_process_post(client, wifi_ipv4_attrib, ARRAY_SIZE(wifi_ipv4_attrib), wp)) >= 0) {
+    if('\0' == wifi_ipv4_attrib[WIFI_IPV4_ATTRIB_ADDRESS].valuebuffer[0]) {
+      rc = ob_wifi_ipv4_set(NULL);
+    } else if((rc = ob_wifi_ipv4_parse(wifi_ipv4_attrib[WIFI_IPV4_ATTRIB_ADDRESS].valuebuffer,
+                                       wifi_ipv4_attrib[WIFI_IPV4_ATTRIB_NETMASK].valuebuffer,
+                                       wifi_ipv4_attrib[WIFI_IPV4_ATTRIB_GATEWAY].valuebuffer,
+                                       wifi_ipv4_attrib[WIFI_IPV4_ATTRIB_DNS].valuebuffer,
+                                       &config)) < 0) {
+      LOG_ERR("Invalid IPv4 configuration");
+    } else {
+      rc = ob_wifi_ipv4_set(&config);
+    }
+  } else {
+    LOG_ERR("Post proccess failed %d", rc);
+  }
+  ob_web_server_display_home(client);
+  return rc;
+}
+
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+int
+ob_cp_join(const char * ssid, const char * psk)
+{
+  return portal_join_start(ssid, psk);
+}
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+
 /**
  * @brief This function registers the captive portal web page with the ob_web_server
  * @see ob_web_server
@@ -264,6 +836,38 @@ ob_cp_init()
                                display_wifi_setup_page,
                                post_wifi_setup_page,
                                PAGE_IS_CAPTIVE_PORTAL | PAGE_IS_HOME_PAGE);
+  if(rc >= 0) {
+    rc = ob_ws_register_web_page(WIFI_PROFILES_PAGE_PATH,
+                                 WIFI_PROFILES_TITLE,
+                                 display_wifi_profiles_page,
+                                 post_wifi_profiles_page,
+                                 0);
+  }
+  if(rc >= 0) {
+    rc = ob_ws_register_web_page(WIFI_IPV4_PAGE_PATH,
+                                 WIFI_IPV4_TITLE,
+                                 display_wifi_ipv4_page,
+                                 post_wifi_ipv4_page,
+                                 0);
+  }
+#ifdef CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+  if(rc >= 0) {
+    rc = ob_ws_register_web_page(WIFI_STATUS_PAGE_PATH,
+                                 WIFI_STATUS_TITLE,
+                                 display_wifi_status_page,
+                                 NULL,
+                                 0);
+  }
+#endif // CONFIG_ONBOARDING_CAPTIVE_PORTAL_LIVE
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+  if(rc >= 0) {
+    rc = ob_ws_register_web_page(WIFI_LINK_PAGE_PATH,
+                                 WIFI_LINK_TITLE,
+                                 display_wifi_link_page,
+                                 NULL,
+                                 0);
+  }
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
   return rc;
 
 }
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "ob_http_parser.h"
+
+/**
+ * @brief states of the request parser
+ */
+enum {
+  /** @brief reading the method */
+  REQ_METHOD,
+  /** @brief reading the path */
+  REQ_PATH,
+  /** @brief skipping the query string and the protocol version */
+  REQ_LINE,
+  /** @brief reading a header name */
+  REQ_HDR_NAME,
+  /** @brief skipping the value of an uninteresting header */
+  REQ_HDR_SKIP,
+  /** @brief reading the value of the Content-Length header */
+  REQ_HDR_LENGTH,
+  /** @brief a carriage return was seen at the start of a line */
+  REQ_HDR_END,
+  /** @brief the headers are complete */
+  REQ_DONE
+};
+
+/** @brief the header name of the content length, lower case */
+static const char content_length_name[] = "content-length";
+
+void ob_http_request_parser_init(struct ob_http_request_parser *p)
+{
+  memset(p, 0, sizeof(*p));
+  p->method = OB_HTTP_METHOD_UNKNOWN;
+  p->state = REQ_METHOD;
+}
+
+/**
+ * @brief convert an upper case ASCII letter to lower case
+ */
+static inline char to_lower(char c)
+{
+  return ((c >= 'A') && (c <= 'Z')) ? (char)(c + ('a' - 'A')) : c;
+}
+
+ob_http_parse_result_t ob_http_request_parser_feed(struct ob_http_request_parser *p,
+                                                   const char *buf, size_t len,
+                                                   size_t *used)
+{
+  ob_http_parse_result_t rc = OB_HTTP_PARSE_MORE;
+  size_t n;
+
+  for(n = 0; (n < len) && (OB_HTTP_PARSE_MORE == rc); n++) {
+    char c = buf[n];
+
+    if(++p->consumed > OB_HTTP_MAX_HEADER_LEN) {
+      rc = OB_HTTP_PARSE_ERROR;
+      break;
+    }
+
+    switch(p->state) {
+    case REQ_METHOD:
+      if(' ' == c) {
+        if((3 == p->token_len) && (0 == memcmp(p->token, "GET", 3))) {
+          p->method = OB_HTTP_METHOD_GET;
+        } else if((4 == p->token_len) && (0 == memcmp(p->token, "POST", 4))) {
+          p->method = OB_HTTP_METHOD_POST;
+        }
+        p->token_len = 0;
+        p->state = REQ_PATH;
+      } else if(p->token_len < OB_HTTP_HEADER_NAME_LEN) {
+        p->token[p->token_len++] = c;
+      } else {
+        rc = OB_HTTP_PARSE_ERROR;
+      }
+      break;
+
+    case REQ_PATH:
+      if((' ' == c) || ('?' == c)) {
+        p->path[p->token_len] = '\0';
+        p->token_len = 0;
+        p->state = REQ_LINE;
+      } else if(('\r' == c) || ('\n' == c)) {
+        rc = OB_HTTP_PARSE_ERROR;
+      } else if(p->token_len < (MAX_WEB_PATH_NAME_LEN - 1)) {
+        p->path[p->token_len++] = c;
+      } else {
+        rc = OB_HTTP_PARSE_ERROR;
+      }
+      break;
+
+    case REQ_LINE:
+    case REQ_HDR_SKIP:
+    case REQ_HDR_LENGTH:
+      if('\n' == c) {
+        p->token_len = 0;
+        p->state = REQ_HDR_NAME;
+      } else if(REQ_HDR_LENGTH == p->state) {
+        if((c >= '0') && (c <= '9')) {
+          p->content_length = (p->content_length * 10) + (c - '0');
+          if(p->content_length > OB_HTTP_MAX_CONTENT_LENGTH) {
+            rc = OB_HTTP_PARSE_ERROR;
+          }
+        } else if((' ' != c) && ('\t' != c) && ('\r' != c)) {
+          rc = OB_HTTP_PARSE_ERROR;
+        }
+      }
+      break;
+
+    case REQ_HDR_NAME:
+      if((0 == p->token_len) && ('\r' == c)) {
+        p->state = REQ_HDR_END;
+      } else if((0 == p->token_len) && ('\n' == c)) {
+        p->state = REQ_DONE;
+        rc = OB_HTTP_PARSE_DONE;
+      } else if(':' == c) {
+        if((p->token_len == sizeof(content_length_name) - 1) &&
+           (0 == memcmp(p->token, content_length_name, p->token_len))) {
+          p->content_length = 0;
+          p->state = REQ_HDR_LENGTH;
+        } else {
+          p->state = REQ_HDR_SKIP;
+        }
+      } else if('\n' == c) {
+        p->token_len = 0;
+      } else if(p->token_len < OB_HTTP_HEADER_NAME_LEN) {
+        p->token[p->token_len++] = to_lower(c);
+      } else {
+        /* Longer than any header we are interested in */
+        p->state = REQ_HDR_SKIP;
+      }
+      break;
+
+    case REQ_HDR_END:
+      if('\n' == c) {
+        p->state = REQ_DONE;
+        rc = OB_HTTP_PARSE_DONE;
+      } else {
+        rc = OB_HTTP_PARSE_ERROR;
+      }
+      break;
+
+    case REQ_DONE:
+    default:
+      rc = OB_HTTP_PARSE_DONE;
+      break;
+    }
+  }
+
+  if(NULL != used) {
+    *used = n;
+  }
+  return rc;
+}
+
+void ob_post_parser_init(struct ob_post_parser *p, post_attributes_t *ap, int num_ap)
+{
+  int i;
+
+  memset(p, 0, sizeof(*p));
+  p->ap = ap;
+  p->num_ap = num_ap;
+  for(i = 0; i < num_ap; i++) {
+    ap[i].valuebuffer[0] = '\0';
+  }
+}
+
+/**
+ * @brief find the attribute matching the parsed name
+ *
+ * @return a pointer to the attribute, NULL if not found
+ */
+static post_attributes_t *find_attribute(struct ob_post_parser *p)
+{
+  int i;
+
+  for(i = 0; i < p->num_ap; i++) {
+    if(((size_t)p->len == strlen(p->ap[i].name)) &&
+       (0 == memcmp(p->name, p->ap[i].name, p->len))) {
+      return &p->ap[i];
+    }
+  }
+  return NULL;
+}
+
+int ob_post_parser_feed(struct ob_post_parser *p, const char *buf, size_t len)
+{
+  size_t n;
+
+  for(n = 0; (n < len) && (0 == p->error); n++) {
+    char c = buf[n];
+
+    if(NULL == p->cp) {
+      if('=' == c) {
+        p->cp = find_attribute(p);
+        if(NULL == p->cp) {
+          p->error = -EINVAL;
+        }
+        p->len = 0;
+      } else if(('\r' != c) && ('\n' != c)) {
+        if(p->len < (NAME_BUFFER_SIZE - 1)) {
+          p->name[p->len++] = c;
+        } else {
+          p->error = -EINVAL;
+        }
+      }
+    } else {
+      if(('\r' == c) || ('\n' == c)) {
+        p->cp->valuebuffer[p->len] = '\0';
+        p->cp = NULL;
+        p->len = 0;
+      } else if(p->len < (VALUE_BUFFER_SIZE - 1)) {
+        p->cp->valuebuffer[p->len++] = c;
+      } else {
+        p->cp->valuebuffer[p->len] = '\0';
+        p->error = -EINVAL;
+      }
+    }
+  }
+  return p->error;
+}
+
+int ob_post_parser_finish(struct ob_post_parser *p)
+{
+  if((0 == p->error) && (NULL != p->cp)) {
+    p->cp->valuebuffer[p->len] = '\0';
+    p->cp = NULL;
+    p->len = 0;
+  }
+  return p->error;
+}
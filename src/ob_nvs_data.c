@@ -81,7 +81,7 @@ int ob_nvs_data_read(const char * name, void * buffer, int len)
 int ob_nvs_data_write(const char * name, void * buffer, int len)
 {
   int rc=0;
-  LOG_DBG("writing len=%d buffer=%s to name=%s", len, (char *)buffer, name);
+  LOG_DBG("writing len=%d to name=%s", len, name);
 
   rc = settings_save_one(name, buffer, len);
     
@@ -95,6 +95,22 @@ int ob_nvs_data_write(const char * name, void * buffer, int len)
   return rc;
 }
 
+/**
+ *@brief Delete a data element
+ */
+int ob_nvs_data_delete(const char * name)
+{
+  int rc;
+
+  rc = settings_delete(name);
+  if (rc < 0) {
+      LOG_ERR("Delete for %s failed (rc=%d)", name, rc);
+  } else {
+      LOG_DBG("Value deleted for: %s", name);
+  }
+  return rc;
+}
+
 typedef struct ob_nvs_cb {
   const char * subtree;
 } ob_nvs_cb_t;
@@ -13,6 +13,9 @@
 
 #include "ob_ota.h"
 #include "ob_nvs_data.h"
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+#include "ob_wifi_ps.h"
+#endif // CONFIG_ONBOARDING_WIFI_PS
 
 #include <zephyr/logging/log.h>
 #include <zephyr/logging/log_ctrl.h>
@@ -54,7 +57,14 @@ bool ota_do_update()
   ob_ota_result_t status;
 
   if(ota_vtable->ob_ota_update()) {
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+    // The download runs with power save off
+    ob_wifi_ps_hold(OB_WIFI_PS_HOLD_OTA, true);
+#endif // CONFIG_ONBOARDING_WIFI_PS
     status = ota_vtable->ob_ota_update();
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+    ob_wifi_ps_hold(OB_WIFI_PS_HOLD_OTA, false);
+#endif // CONFIG_ONBOARDING_WIFI_PS
     switch(status) {
     case OB_OTA_RES_OK:
       LOG_PANIC();
@@ -4,10 +4,15 @@
 #include "ob_ota.h"
 #include "ob_web_server.h"
 #include "ob_wifi.h"
+#include "ob_wifi_profile.h"
 
 
 void ob_reboot(void)
 {
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+  // The profiles waiting for their PMK are not saved yet
+  ob_wifi_profile_flush();
+#endif // CONFIG_ONBOARDING_WIFI_PMK
 
 #ifdef CONFIG_ONBOARDING_OTA
   ota_reboot();
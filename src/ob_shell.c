@@ -19,6 +19,33 @@
 #include "ob_nvs_data.h"
 
 #include "ob_wifi.h"
+#include "ob_wifi_config.h"
+#include "ob_wifi_profile.h"
+#include "ob_wifi_ipv4.h"
+#ifdef CONFIG_ONBOARDING_WIFI_ROAM
+#include "ob_wifi_roam.h"
+#endif // CONFIG_ONBOARDING_WIFI_ROAM
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+#include "ob_wifi_link.h"
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+#include "ob_wifi_probe.h"
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+#include "ob_wifi_ps.h"
+#endif // CONFIG_ONBOARDING_WIFI_PS
+#ifdef CONFIG_ONBOARDING_WIFI_TIMELINE
+#include "ob_wifi_timeline.h"
+#endif // CONFIG_ONBOARDING_WIFI_TIMELINE
+#ifdef CONFIG_ONBOARDING_WIFI_SIM
+#include "ob_wifi_sim.h"
+#endif // CONFIG_ONBOARDING_WIFI_SIM
+#ifdef CONFIG_ONBOARDING_BENCH
+#include "ob_bench.h"
+#endif // CONFIG_ONBOARDING_BENCH
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+#include "ob_wifi_ap_pool.h"
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
 #include "ob_web_server.h"
 #ifdef CONFIG_ONBOARDING_OTA
 #include "ob_ota.h"
@@ -33,9 +60,24 @@ LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
 #define OB_HELP_WIFI_SSID "wifi ssid [SSID]"
 #define OB_HELP_WIFI_PSK "wifi psk [PSK]"
 #define OB_HELP_WIFI_ADDRESS "wifi address <ipv4>"
+#define OB_HELP_WIFI_IPV4 "wifi ipv4 [dhcp | <address> <netmask> [gateway] [dns]] show or save the station IPv4 configuration"
+#define OB_HELP_WIFI_SCAN "wifi scan [refresh | full | quick | passive | targeted <ssid> | roam <ssid>] show visible networks"
+#define OB_HELP_WIFI_ATTEMPTS "wifi attempts show the timing of recent connection attempts"
+#define OB_HELP_WIFI_PROFILE "wifi profile commands"
+#define OB_HELP_WIFI_ROAM "wifi roam show the roaming counters"
+#define OB_HELP_WIFI_LINK "wifi link show the downtime of the station link"
+#define OB_HELP_WIFI_PS "wifi ps [auto | latency | balanced | deep] show or force the power save profile"
+#define OB_HELP_WIFI_PROBE "wifi probe [reset | target <ipv4 | none>] show the latency, loss and jitter of the station link"
+#define OB_HELP_WIFI_TIMELINE "wifi timeline [json | clear] show the time spent in each phase of going online"
+#define OB_HELP_WIFI_PROFILE_LIST "wifi profile list show the saved networks"
+#define OB_HELP_WIFI_PROFILE_ADD "wifi profile add <SSID> <PSK> [priority]"
+#define OB_HELP_WIFI_PROFILE_DEL "wifi profile del <SSID>"
 #define OB_HELP_WIFI_AP_ENABLE "ap enable Enable WiFi AP"
 #define OB_HELP_WIFI_AP_DISABLE "ap disable Disable WiFi AP"
 #define OB_HELP_WIFI_AP_ADDRESS "ap address [IPv4]"
+#define OB_HELP_WIFI_AP_CHANNEL "ap channel show the scores of the AP channels"
+#define OB_HELP_WIFI_AP_POOL "ap pool [default | <netmask> [offset]] show or save the DHCP pool of the AP"
+#define OB_HELP_WIFI_AP_STATIONS "ap stations show the stations of the AP and their leases"
 #define OB_HELP_WEB_START "Start web server"
 #define OB_HELP_WEB_STOP  "Stop web server"
 #define OB_HELP_WIFI_DHCP_START "Start DHCPv4 client"
@@ -47,6 +89,12 @@ LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
 #define OB_HELP_OTA_UH_UPDATE "updatehub update"
 #define OB_HELP_OTA_GOLIOTH_PSK "golioth psk [<psk>]"
 #define OB_HELP_OTA_GOLIOTH_PSK_ID "golioth psk_id [<psk_id>]"
+#define OB_HELP_SIM_AP "sim ap [clear | add <SSID> <PSK | \"\"> <rssi> <channel> | rssi <SSID> <rssi>] show or change the simulated APs"
+#define OB_HELP_SIM_DELAY "sim delay <scan ms> <connect ms>"
+#define OB_HELP_SIM_FAIL "sim fail <scan | connect | ap> <count> [status] fail the next operations"
+#define OB_HELP_SIM_DROP "sim drop disconnect the station as if the AP went away"
+#define OB_HELP_SIM_STA "sim sta <join | leave> <MAC> make a station join or leave the AP"
+#define OB_HELP_BENCH "bench [all | stored | portal | gatt | reprovision] [runs] measure the time to online as JSON"
 
 #ifdef CONFIG_ONBOARDING_WEB_SERVER
 /**
@@ -144,6 +192,114 @@ static int ap_address_handler(const struct shell *sh, size_t argc, char ** argv)
   LOG_INF("AP Ip address: %s", wifi_ap_address);
   return 0;
 }
+
+/**
+ * @brief Shows the scores of the last AP channel selection
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0
+ */
+static int ap_channel_handler(const struct shell *sh, size_t argc, char ** argv)
+{
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  struct ob_wifi_ap_channel_score scores[OB_WIFI_AP_CHANNELS_MAX];
+  int64_t age;
+  int channel;
+  int count;
+
+  if((count = ob_wifi_ap_channel_scores(scores, ARRAY_SIZE(scores), &channel, &age)) < 0) {
+    shell_print(sh, "No channel selected");
+    return 0;
+  }
+  shell_print(sh, "channel %d selected %lld ms ago", channel, (long long)age);
+  for(int i = 0; i < count; i++) {
+    shell_print(sh, "%c%3d BSSes %3d score %6d", (scores[i].channel == channel) ? '*' : ' ',
+                scores[i].channel, scores[i].bss_count, scores[i].score);
+  }
+  return 0;
+}
+
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+/**
+ * @brief Shows or saves the DHCP pool of the devices AP
+ * @details the pool is applied the next time the AP starts
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int ap_pool_handler(const struct shell *sh, size_t argc, char ** argv)
+{
+  struct ob_wifi_ap_pool_config config;
+  struct in_addr ap_addr;
+  char buffer[NET_IPV4_ADDR_LEN];
+  int rc = 0;
+
+  if(net_addr_pton(AF_INET, wifi_ap_address, &ap_addr)) {
+    shell_error(sh, "Invalid AP address %s", wifi_ap_address);
+    return -EINVAL;
+  }
+  if((argc > 1) && !strcmp(argv[1], "default")) {
+    rc = ob_wifi_ap_pool_set(NULL, &ap_addr);
+  } else if(argc > 1) {
+    ob_wifi_ap_pool_get(&config, &ap_addr);
+    if(net_addr_pton(AF_INET, argv[1], &config.netmask)) {
+      shell_error(sh, "Invalid netmask %s", argv[1]);
+      return -EINVAL;
+    }
+    if(argc > 2) {
+      config.offset = (uint8_t)strtoul(argv[2], NULL, 10);
+    }
+    if((rc = ob_wifi_ap_pool_set(&config, &ap_addr)) == -EINVAL) {
+      shell_error(sh, "The pool does not fit in the subnet of %s", wifi_ap_address);
+      return rc;
+    }
+  }
+  if(rc < 0) {
+    shell_error(sh, "Unable to save the pool (%d)", rc);
+    return rc;
+  }
+  ob_wifi_ap_pool_get(&config, &ap_addr);
+  ap_addr.s_addr = htonl(ntohl(ap_addr.s_addr) + config.offset);
+  shell_print(sh, "netmask %s", net_addr_ntop(AF_INET, &config.netmask, buffer, sizeof(buffer)));
+  shell_print(sh, "pool %d addresses from %s", CONFIG_NET_DHCPV4_SERVER_ADDR_COUNT,
+              net_addr_ntop(AF_INET, &ap_addr, buffer, sizeof(buffer)));
+  shell_print(sh, "lease time %d s", CONFIG_NET_DHCPV4_SERVER_ADDR_LEASE_TIME);
+  return 0;
+}
+
+/**
+ * @brief Shows the stations of the devices AP
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0
+ */
+static int ap_stations_handler(const struct shell *sh, size_t argc, char ** argv)
+{
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  struct ob_wifi_ap_station stations[CONFIG_NET_DHCPV4_SERVER_ADDR_COUNT];
+  char buffer[NET_IPV4_ADDR_LEN];
+  int count = ob_wifi_ap_pool_stations(stations, ARRAY_SIZE(stations));
+
+  shell_print(sh, "%-17s %-15s %10s %s", "mac", "address", "lease s", "associated");
+  for(int i = 0; i < count; i++) {
+    shell_print(sh, "%02x:%02x:%02x:%02x:%02x:%02x %-15s %10u %s",
+                stations[i].mac[0], stations[i].mac[1], stations[i].mac[2],
+                stations[i].mac[3], stations[i].mac[4], stations[i].mac[5],
+                (INADDR_ANY == stations[i].addr.s_addr) ? "-" :
+                net_addr_ntop(AF_INET, &stations[i].addr, buffer, sizeof(buffer)),
+                stations[i].lease_s, stations[i].associated ? "yes" : "no");
+  }
+  return 0;
+}
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
 #endif // CONFIG_ONBOARDING_WIFI_AP
 
 /**
@@ -177,6 +333,670 @@ static int setup_iface( const struct shell *sh, size_t argc, char **argv)
   }
   return 0;
 }
+#ifdef CONFIG_ONBOARDING_WIFI
+/**
+ * @brief Shows or saves the IPv4 configuration of the station
+ *
+ * @details the configuration is applied at the next association
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int ipv4_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  struct ob_wifi_ipv4_config config;
+  char address[NET_IPV4_ADDR_LEN];
+  char netmask[NET_IPV4_ADDR_LEN];
+  char gateway[NET_IPV4_ADDR_LEN];
+  char dns[NET_IPV4_ADDR_LEN];
+  int rc;
+
+  if(1 == argc) {
+    if(ob_wifi_ipv4_get(&config) < 0) {
+      shell_print(sh, "dhcp");
+    } else {
+      shell_print(sh, "static %s netmask %s gateway %s dns %s",
+                  net_addr_ntop(AF_INET, &config.address, address, sizeof(address)),
+                  net_addr_ntop(AF_INET, &config.netmask, netmask, sizeof(netmask)),
+                  net_addr_ntop(AF_INET, &config.gateway, gateway, sizeof(gateway)),
+                  net_addr_ntop(AF_INET, &config.dns, dns, sizeof(dns)));
+    }
+    return 0;
+  }
+  if(0 == strcmp(argv[1], "dhcp")) {
+    return ob_wifi_ipv4_set(NULL);
+  }
+  if(argc < 3) {
+    shell_error(sh, "%s", OB_HELP_WIFI_IPV4);
+    return -EINVAL;
+  }
+  if((rc = ob_wifi_ipv4_parse(argv[1], argv[2], (argc > 3) ? argv[3] : NULL,
+                              (argc > 4) ? argv[4] : NULL, &config)) < 0) {
+    shell_error(sh, "Invalid IPv4 configuration");
+    return rc;
+  }
+  return ob_wifi_ipv4_set(&config);
+}
+
+/** @brief signalled when a preset scan started from the shell completes */
+static K_SEM_DEFINE(scan_preset_sem, 0, 1);
+/** @brief the results of the preset scan, with a reference held */
+static ob_wifi_scan_snapshot_t *scan_preset_snap = NULL;
+
+/**
+ * @brief Scan callback of a preset scan started from the shell
+ *
+ * @param snap the scan results, NULL if the scan failed
+ * @param user_data unused
+ */
+static void scan_preset_done(ob_wifi_scan_snapshot_t * snap, void * user_data)
+{
+  ARG_UNUSED(user_data);
+  scan_preset_snap = ob_wifi_scan_ref(snap);
+  k_sem_give(&scan_preset_sem);
+}
+
+/**
+ * @brief Runs a scan with the parameters of a preset
+ *
+ * @param sh Pointer to the shell structure.
+ * @param preset the preset
+ * @param ssid the SSID to look for, may be NULL
+ * @param[out] snap the scan results, with a reference held
+ * @return 0 on success
+ */
+static int scan_preset(const struct shell *sh, int preset, const char *ssid,
+                       ob_wifi_scan_snapshot_t **snap)
+{
+  static struct ob_wifi_scan_subscriber sub = { .callback = scan_preset_done };
+  static struct wifi_scan_params params;
+  static char ssid_buf[WIFI_SSID_MAX_LEN + 1];
+  int rc;
+
+  if(NULL != ssid) {
+    strncpy(ssid_buf, ssid, sizeof(ssid_buf) - 1);
+    ssid = ssid_buf;
+  }
+  if((rc = ob_wifi_scan_preset_params(preset, ssid, NULL, &params)) < 0) {
+    shell_error(sh, "The %s scan needs an SSID", ob_wifi_scan_preset_name(preset));
+    return rc;
+  }
+  k_sem_reset(&scan_preset_sem);
+  scan_preset_snap = NULL;
+  if((rc = ob_wifi_scan_ex(&sub, &params)) == -EBUSY) {
+    shell_error(sh, "A scan is in progress");
+    return rc;
+  }
+  /* The callback is also called when the scan fails */
+  if((k_sem_take(&scan_preset_sem, K_MSEC(2 * CONFIG_ONBOARDING_WIFI_SCAN_TIMEOUT)) < 0) ||
+     (NULL == scan_preset_snap)) {
+    return -EIO;
+  }
+  *snap = scan_preset_snap;
+  return 0;
+}
+
+/**
+ * @brief Lists the networks found by a wifi scan
+ *
+ * @details the cached scan results are shown unless refresh or a preset is given
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int scan_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  int rc;
+  int preset;
+  ob_wifi_scan_snapshot_t *snap = NULL;
+  ssid_item_t *it;
+
+  if((argc > 1) && (0 == strcmp(argv[1], "refresh"))) {
+    ob_wifi_scan();
+    rc = ob_wifi_scan_get(&snap, K_MSEC(CONFIG_ONBOARDING_WIFI_SCAN_TIMEOUT));
+  } else if(argc > 1) {
+    if((preset = ob_wifi_scan_preset_find(argv[1])) < 0) {
+      shell_error(sh, "Unknown scan %s", argv[1]);
+      return -EINVAL;
+    }
+    rc = scan_preset(sh, preset, (argc > 2) ? argv[2] : NULL, &snap);
+  } else {
+    rc = ob_wifi_scan_get(&snap, K_MSEC(CONFIG_ONBOARDING_WIFI_SCAN_TIMEOUT));
+  }
+  if(rc < 0) {
+    shell_error(sh, "Scan failed %d", rc);
+    return rc;
+  }
+  shell_print(sh, "%d networks, %d dropped, scan took %d ms, %lld ms old", snap->count,
+              snap->dropped, snap->duration_ms, (long long)(k_uptime_get() - snap->timestamp));
+  if(ob_wifi_scan_overflows() > 0) {
+    shell_print(sh, "%u results dropped on a full scan ring since boot", ob_wifi_scan_overflows());
+  }
+  for(it = snap->head; NULL != it; it = it->next) {
+    shell_print(sh, "%3d %s %s", it->signal_strength, it->security ? "secure" : "open  ", it->ssid);
+  }
+  ob_wifi_scan_unref(snap);
+  return 0;
+}
+
+/**
+ * @brief Shows the timing of the most recent connection attempts
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0
+ */
+static int attempts_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  struct ob_wifi_connect_attempt attempts[OB_WIFI_CONNECT_ATTEMPT_HISTORY];
+  int count;
+  int i;
+
+  count = ob_wifi_get_connect_attempts(attempts, ARRAY_SIZE(attempts));
+  for(i = 0; i < count; i++) {
+    shell_print(sh, "%-9s %-7s assoc %5d ms total %5d ms",
+                attempts[i].targeted ? "targeted" : "full scan",
+                attempts[i].success ? "ok" : "failed",
+                attempts[i].assoc_ms, attempts[i].total_ms);
+  }
+  return 0;
+}
+
+/**
+ * @brief Lists the wifi profiles
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0
+ */
+static int profile_list_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  struct ob_wifi_profile profile;
+  int i;
+
+  for(i = 0; i < CONFIG_ONBOARDING_WIFI_PROFILES; i++) {
+    if(ob_wifi_profile_get(i, &profile) < 0) {
+      continue;
+    }
+    shell_print(sh, "%2d priority %3d rssi %4d last %5u %s", i, profile.priority,
+                profile.last_rssi, profile.last_success, profile.ssid);
+  }
+  memset(&profile, 0, sizeof(profile));
+  return 0;
+}
+
+/**
+ * @brief Adds a wifi profile, or updates the profile with the same SSID
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int profile_add_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  int priority = OB_WIFI_PROFILE_PRIORITY_DEFAULT;
+  int rc;
+
+  if(argc > 3) {
+    priority = atoi(argv[3]);
+  }
+  if((rc = ob_wifi_profile_add(argv[1], argv[2], priority)) < 0) {
+    shell_error(sh, "Unable to add the profile of %s %d", argv[1], rc);
+    return rc;
+  }
+  ob_wifi_profiles_changed();
+  shell_print(sh, "Profile %d: %s", rc, argv[1]);
+  return 0;
+}
+
+/**
+ * @brief Removes a wifi profile
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int profile_del_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  int rc;
+
+  if((rc = ob_wifi_profile_remove(argv[1])) < 0) {
+    shell_error(sh, "No profile for %s", argv[1]);
+  }
+  return rc;
+}
+
+#ifdef CONFIG_ONBOARDING_WIFI_ROAM
+/**
+ * @brief Shows the counters of the roaming monitor
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0
+ */
+static int roam_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  struct ob_wifi_roam_stats stats;
+
+  ob_wifi_roam_get_stats(&stats);
+  shell_print(sh, "RSSI %d dBm scans %d roams %d failed %d", stats.rssi, stats.scans,
+              stats.roams, stats.failures);
+  if(stats.roams > 0) {
+    shell_print(sh, "latency last %d ms max %d ms avg %lld ms", stats.last_ms, stats.max_ms,
+                (long long)(stats.total_ms / stats.roams));
+  }
+  return 0;
+}
+#endif // CONFIG_ONBOARDING_WIFI_ROAM
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+/**
+ * @brief Shows the counters of the link supervisor
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0
+ */
+static int link_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  struct ob_wifi_link_stats stats;
+
+  ob_wifi_link_get_stats(&stats);
+  shell_print(sh, "incidents %d flaps %d ethernet %s failovers %d", stats.incidents, stats.flaps,
+              stats.ethernet ? "up" : "down", stats.failovers);
+  if(stats.down_ms > 0) {
+    shell_print(sh, "down for %d ms", stats.down_ms);
+  }
+  if(stats.incidents > 0) {
+    shell_print(sh, "downtime last %d ms max %d ms avg %lld ms total %lld ms", stats.last_ms,
+                stats.max_ms, (long long)(stats.total_ms / stats.incidents),
+                (long long)stats.total_ms);
+  }
+  return 0;
+}
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+/**
+ * @brief Shows the statistics of the link probe, clears them or sets the probe target
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int probe_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  static const char * const names[OB_WIFI_PROBE_PATHS] = {
+    [OB_WIFI_PROBE_GATEWAY] = "gateway",
+    [OB_WIFI_PROBE_TARGET] = "target"
+  };
+  struct ob_wifi_probe_stats stats;
+  struct ob_wifi_probe_path * path;
+  struct in_addr addr;
+  char buffer[NET_IPV4_ADDR_LEN];
+  int i;
+
+  if((argc > 1) && (0 == strcmp(argv[1], "reset"))) {
+    ob_wifi_probe_reset();
+    return 0;
+  }
+  if((argc > 1) && (0 == strcmp(argv[1], "target"))) {
+    if((argc < 3) || (0 == strcmp(argv[2], "none"))) {
+      ob_wifi_probe_set_target(NULL);
+    } else if(net_addr_pton(AF_INET, argv[2], &addr)) {
+      shell_error(sh, "Invalid address %s", argv[2]);
+      return -EINVAL;
+    } else {
+      ob_wifi_probe_set_target(&addr);
+    }
+    return 0;
+  }
+  if(argc > 1) {
+    shell_error(sh, "%s", OB_HELP_WIFI_PROBE);
+    return -EINVAL;
+  }
+  ob_wifi_probe_get_stats(&stats);
+  shell_print(sh, "RSSI %d dBm avg %d dBm TX rate %d kbps rounds %u", stats.rssi, stats.rssi_avg,
+              stats.tx_rate, stats.rounds);
+#ifdef CONFIG_NET_STATISTICS_WIFI
+  shell_print(sh, "TX packets %u errors %u RX errors %u", stats.tx_packets, stats.tx_errors,
+              stats.rx_errors);
+#endif // CONFIG_NET_STATISTICS_WIFI
+  for(i = 0; i < OB_WIFI_PROBE_PATHS; i++) {
+    path = &stats.paths[i];
+    if(INADDR_ANY == path->addr.s_addr) {
+      continue;
+    }
+    shell_print(sh, "%s %s sent %u received %u loss %u.%u%%", names[i],
+                net_addr_ntop(AF_INET, &path->addr, buffer, sizeof(buffer)),
+                path->sent, path->received, path->loss_permille / 10, path->loss_permille % 10);
+    if(path->received > 0) {
+      shell_print(sh, "  rtt last %u us avg %u us min %u us max %u us jitter %u us", path->rtt_us,
+                  path->srtt_us, path->min_us, path->max_us, path->jitter_us);
+    }
+  }
+  return 0;
+}
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+/**
+ * @brief Shows the power save profiles and their counters, or forces a profile
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int ps_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  struct ob_wifi_ps_stats stats[OB_WIFI_PS_PROFILES];
+  enum ob_wifi_ps_profile current;
+  enum ob_wifi_ps_profile forced;
+  int i;
+
+  if(argc > 1) {
+    for(i = OB_WIFI_PS_AUTO; i < OB_WIFI_PS_PROFILES; i++) {
+      if(0 == strcmp(argv[1], ob_wifi_ps_profile_str(i))) {
+        return ob_wifi_ps_force(i);
+      }
+    }
+    shell_error(sh, "%s", OB_HELP_WIFI_PS);
+    return -EINVAL;
+  }
+  current = ob_wifi_ps_get(&forced, stats);
+  shell_print(sh, "profile %s (%s)", ob_wifi_ps_profile_str(current),
+              (OB_WIFI_PS_AUTO == forced) ? "auto" : "forced");
+  for(i = 0; i < OB_WIFI_PS_PROFILES; i++) {
+    shell_print(sh, "%-8s applied %u time %lld ms wakes %u beacons %u", ob_wifi_ps_profile_str(i),
+                stats[i].activations, (long long)stats[i].time_ms, stats[i].wakes, stats[i].beacons);
+    if(stats[i].rtt_samples > 0) {
+      shell_print(sh, "         rtt avg %llu us max %u us (%u samples)",
+                  (unsigned long long)(stats[i].rtt_total_us / stats[i].rtt_samples),
+                  stats[i].rtt_max_us, stats[i].rtt_samples);
+    }
+  }
+  return 0;
+}
+#endif // CONFIG_ONBOARDING_WIFI_PS
+#ifdef CONFIG_ONBOARDING_WIFI_SIM
+/**
+ * @brief Shows the simulated APs, or adds, changes or removes them
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int sim_ap_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  static struct ob_wifi_sim_ap aps[CONFIG_ONBOARDING_WIFI_SIM_MAX_APS];
+  int count;
+  int rc;
+  int i;
+
+  if(argc == 1) {
+    count = ob_wifi_sim_aps(aps, ARRAY_SIZE(aps));
+    for(i = 0; i < count; i++) {
+      shell_print(sh, "%-32s %02x:%02x:%02x:%02x:%02x:%02x ch %3u %4d dBm %s", aps[i].ssid,
+                  aps[i].bssid[0], aps[i].bssid[1], aps[i].bssid[2],
+                  aps[i].bssid[3], aps[i].bssid[4], aps[i].bssid[5],
+                  aps[i].channel, aps[i].rssi, ('\0' == aps[i].psk[0]) ? "open" : "psk");
+    }
+    return 0;
+  }
+  if((argc == 2) && (0 == strcmp(argv[1], "clear"))) {
+    ob_wifi_sim_ap_clear();
+    return 0;
+  }
+  if((argc == 6) && (0 == strcmp(argv[1], "add"))) {
+    if((rc = ob_wifi_sim_ap_add(argv[2], argv[3], atoi(argv[4]), atoi(argv[5]))) < 0) {
+      shell_error(sh, "Unable to add the AP %d", rc);
+      return rc;
+    }
+    return 0;
+  }
+  if((argc == 4) && (0 == strcmp(argv[1], "rssi"))) {
+    if((rc = ob_wifi_sim_ap_rssi(argv[2], atoi(argv[3]))) < 0) {
+      shell_error(sh, "No AP %s", argv[2]);
+    }
+    return rc;
+  }
+  shell_error(sh, "%s", OB_HELP_SIM_AP);
+  return -EINVAL;
+}
+
+/**
+ * @brief Sets the time the simulated operations take
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0
+ */
+static int sim_delay_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  ARG_UNUSED(sh);
+  ARG_UNUSED(argc);
+  ob_wifi_sim_set_delays(strtoul(argv[1], NULL, 10), strtoul(argv[2], NULL, 10));
+  return 0;
+}
+
+/**
+ * @brief Makes the next simulated operations fail
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int sim_fail_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  static const char * const ops[OB_WIFI_SIM_OPS] = { "scan", "connect", "ap" };
+  int status = WIFI_STATUS_CONN_FAIL;
+  int i;
+
+  if(argc > 3) {
+    status = atoi(argv[3]);
+  }
+  for(i = 0; i < OB_WIFI_SIM_OPS; i++) {
+    if(0 == strcmp(argv[1], ops[i])) {
+      return ob_wifi_sim_fail(i, atoi(argv[2]), status);
+    }
+  }
+  shell_error(sh, "%s", OB_HELP_SIM_FAIL);
+  return -EINVAL;
+}
+
+/**
+ * @brief Disconnects the station as if the AP went away
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int sim_drop_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  int rc;
+
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  if((rc = ob_wifi_sim_drop()) < 0) {
+    shell_error(sh, "The station is not connected");
+  }
+  return rc;
+}
+
+/**
+ * @brief Makes a station join or leave the simulated AP
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int sim_sta_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  uint8_t mac[WIFI_MAC_ADDR_LEN];
+  int rc;
+
+  ARG_UNUSED(argc);
+  if(((0 != strcmp(argv[1], "join")) && (0 != strcmp(argv[1], "leave"))) ||
+     (0 != net_bytes_from_str(mac, sizeof(mac), argv[2]))) {
+    shell_error(sh, "%s", OB_HELP_SIM_STA);
+    return -EINVAL;
+  }
+  if((rc = ob_wifi_sim_station(mac, 0 == strcmp(argv[1], "join"))) < 0) {
+    shell_error(sh, "The AP is not up");
+  }
+  return rc;
+}
+#endif // CONFIG_ONBOARDING_WIFI_SIM
+#ifdef CONFIG_ONBOARDING_BENCH
+/**
+ * @brief Prints a line of the benchmark report
+ *
+ * @param line the line
+ * @param user_data the shell that started the benchmark
+ */
+static void bench_print(const char *line, void *user_data)
+{
+  shell_print((const struct shell *)user_data, "%s", line);
+}
+
+/**
+ * @brief Starts the time to online benchmark
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int bench_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  int flow = OB_BENCH_ALL;
+  int runs = CONFIG_ONBOARDING_BENCH_RUNS;
+  int rc = 0;
+
+  if(argc > 1) {
+    for(flow = OB_BENCH_ALL; flow < OB_BENCH_FLOWS; flow++) {
+      if(0 == strcmp(argv[1], ob_bench_flow_str(flow))) {
+        break;
+      }
+    }
+  }
+  if(argc > 2) {
+    runs = atoi(argv[2]);
+  }
+  if((flow >= OB_BENCH_FLOWS) ||
+     ((rc = ob_bench_start(flow, runs, bench_print, (void *)sh)) == -EINVAL)) {
+    shell_error(sh, "%s", OB_HELP_BENCH);
+    return -EINVAL;
+  }
+  if(rc < 0) {
+    shell_error(sh, "The benchmark is running");
+    return rc;
+  }
+  shell_print(sh, "Benchmark started, the report follows");
+  return 0;
+}
+#endif // CONFIG_ONBOARDING_BENCH
+#ifdef CONFIG_ONBOARDING_WIFI_TIMELINE
+/**
+ * @brief Prints the recorded timelines as one JSON object per line
+ *
+ * @param sh Pointer to the shell structure.
+ */
+static void timeline_print_json(const struct shell *sh)
+{
+  struct ob_wifi_timeline timeline;
+  struct ob_wifi_timeline_stat stat;
+  char line[384];
+  int len;
+
+  for(int i = 0; 0 == ob_wifi_timeline_get(i, &timeline); i++) {
+    len = snprintf(line, sizeof(line), "{\"timeline\":%d,\"start_ms\":%lld", i,
+                   (long long)(timeline.start_us / USEC_PER_MSEC));
+    for(int m = 0; m < OB_WIFI_TIMELINE_MARK_COUNT; m++) {
+      if(OB_WIFI_TIMELINE_NONE != timeline.at_us[m]) {
+        len += snprintf(&line[len], sizeof(line) - len, ",\"%s_us\":%u",
+                        ob_wifi_timeline_mark_name(m), timeline.at_us[m]);
+      }
+    }
+    shell_print(sh, "%s}", line);
+  }
+  for(int p = 0; p < OB_WIFI_TIMELINE_PHASE_COUNT; p++) {
+    ob_wifi_timeline_stats(p, &stat);
+    shell_print(sh, "{\"phase\":\"%s\",\"count\":%d,\"min_us\":%u,\"avg_us\":%u,\"max_us\":%u}",
+                ob_wifi_timeline_phase_name(p), stat.count, stat.min_us, stat.avg_us, stat.max_us);
+  }
+}
+
+/**
+ * @brief Shows the time spent in each phase of going online
+ *
+ * @param sh Pointer to the shell structure.
+ * @param argc The number of arguments.
+ * @param argv The arguments to the function.
+ * @return 0 on success
+ */
+static int timeline_handler(const struct shell *sh, size_t argc, char **argv)
+{
+  struct ob_wifi_timeline timeline;
+  struct ob_wifi_timeline_stat stat;
+  uint32_t us;
+
+  if((argc > 1) && (0 == strcmp(argv[1], "json"))) {
+    timeline_print_json(sh);
+    return 0;
+  }
+  if((argc > 1) && (0 == strcmp(argv[1], "clear"))) {
+    ob_wifi_timeline_clear();
+    return 0;
+  }
+  if(argc > 1) {
+    shell_error(sh, "Unknown option %s", argv[1]);
+    return -EINVAL;
+  }
+  for(int i = 0; 0 == ob_wifi_timeline_get(i, &timeline); i++) {
+    shell_fprintf(sh, SHELL_NORMAL, "%2d at %8lld ms:", i, (long long)(timeline.start_us / USEC_PER_MSEC));
+    for(int p = 0; p < OB_WIFI_TIMELINE_PHASE_COUNT; p++) {
+      if(OB_WIFI_TIMELINE_NONE == (us = ob_wifi_timeline_phase_us(&timeline, p))) {
+        shell_fprintf(sh, SHELL_NORMAL, " %s -", ob_wifi_timeline_phase_name(p));
+      } else {
+        shell_fprintf(sh, SHELL_NORMAL, " %s %u.%03u", ob_wifi_timeline_phase_name(p),
+                      us / 1000, us % 1000);
+      }
+    }
+    shell_fprintf(sh, SHELL_NORMAL, "\n");
+  }
+  shell_print(sh, "%-10s %5s %12s %12s %12s", "phase", "count", "min ms", "avg ms", "max ms");
+  for(int p = 0; p < OB_WIFI_TIMELINE_PHASE_COUNT; p++) {
+    ob_wifi_timeline_stats(p, &stat);
+    shell_print(sh, "%-10s %5d %8u.%03u %8u.%03u %8u.%03u", ob_wifi_timeline_phase_name(p),
+                stat.count, stat.min_us / 1000, stat.min_us % 1000, stat.avg_us / 1000,
+                stat.avg_us % 1000, stat.max_us / 1000, stat.max_us % 1000);
+  }
+  return 0;
+}
+#endif // CONFIG_ONBOARDING_WIFI_TIMELINE
+#endif // CONFIG_ONBOARDING_WIFI
+
 #ifdef CONFIG_ONBOARDING_WIFI_AP
 #ifdef CONFIG_NET_DHCPV4_SERVER
 /**
@@ -247,7 +1067,8 @@ static int wifi_name_handler(const struct shell *sh, size_t argc, char**argv)
 /**
  * @brief Reads and writes the SSID to the non volatile store
  *
- * @details if the value of the SSID is absent the current SSID will be printed
+ * @details if the value of the SSID is absent the current SSID will be printed.
+ * With wifi the SSID is held until the PSK is set, which adds the profile.
  * @param sh Pointer to the shell structure.
  * @param argc The number of arguments.
  * @param argv The arguments to the function.
@@ -260,6 +1081,13 @@ static int ssid_handler(const struct shell *sh, size_t argc, char **argv)
   ob_nvs_data_init();
   if(argc < 2) {
     if((rc = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_SSID, SSID, WIFI_SSID_MAX_LEN)) <= 0) {
+#ifdef CONFIG_ONBOARDING_WIFI
+      struct ob_wifi_config config;
+      if(ob_wifi_config_get(&config) > 0) {
+        shell_print(sh, "SSID: %s\n", config.ssid);
+        return 0;
+      }
+#endif // CONFIG_ONBOARDING_WIFI
       LOG_ERR("Unable to read SSID");
       return -1;
     }
@@ -270,6 +1098,9 @@ static int ssid_handler(const struct shell *sh, size_t argc, char **argv)
       LOG_ERR("Unable to save SSID %d", rc);
     } else {
       LOG_DBG("Saved SSID %s", argv[1]);
+#ifdef CONFIG_ONBOARDING_WIFI
+      shell_print(sh, "Set the PSK to add the profile for this SSID\n");
+#endif // CONFIG_ONBOARDING_WIFI
     }
   }
   return rc;
@@ -278,7 +1109,9 @@ static int ssid_handler(const struct shell *sh, size_t argc, char **argv)
 /**
  * @brief Reads and writes the PSK to the non volatile store
  *
- * @details if the value of the PSK is absent the current PSK will be printed
+ * @details if the value of the PSK is absent the current PSK will be printed.
+ * With wifi setting the PSK adds the profile of the SSID set last, or of the
+ * current SSID.
  * @param sh Pointer to the shell structure.
  * @param argc The number of arguments.
  * @param argv The arguments to the function.
@@ -291,17 +1124,44 @@ static int psk_handler(const struct shell *sh, size_t argc, char **argv)
   ob_nvs_data_init();
   if(argc < 2) {
     if((rc = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_PSK, PSK, WIFI_PSK_MAX_LEN)) <= 0) {
+#ifdef CONFIG_ONBOARDING_WIFI
+      struct ob_wifi_config config;
+      if(ob_wifi_config_get(&config) > 0) {
+        shell_print(sh, "PSK: stored in the profile of %s\n", config.ssid);
+        return 0;
+      }
+#endif // CONFIG_ONBOARDING_WIFI
       LOG_ERR("Unable to read PSK");
       return -1;
     }
     PSK[rc] = '\0';
     shell_print(sh, "PSK: %s\n", PSK);
   }  else {
+#ifdef CONFIG_ONBOARDING_WIFI
+    char SSID[WIFI_SSID_MAX_LEN+1];
+    struct ob_wifi_config config;
+    if((rc = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_SSID, SSID, WIFI_SSID_MAX_LEN)) > 0) {
+      SSID[rc] = '\0';
+    } else if(ob_wifi_config_get(&config) > 0) {
+      strcpy(SSID, config.ssid);
+    } else {
+      shell_error(sh, "Set the SSID before the PSK\n");
+      return -1;
+    }
+    if((rc = ob_wifi_save_credentials(SSID, argv[1])) < 0) {
+      LOG_ERR("Unable to save PSK %d", rc);
+    } else {
+      ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_SSID);
+      ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_PSK);
+      shell_print(sh, "Saved the profile of %s\n", SSID);
+    }
+#else
     if((rc = ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_PSK, argv[1], strlen(argv[1]))) < 0) {
       LOG_ERR("Unable to save PSK %d", rc);
     } else {
-      LOG_DBG("Saved PSK %s", argv[1]);
+      LOG_DBG("Saved PSK");
     }
+#endif // CONFIG_ONBOARDING_WIFI
   }
   return rc;
 }
@@ -440,6 +1300,11 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob_ap_cmds,
      SHELL_CMD_ARG(enable, NULL, OB_HELP_WIFI_AP_ENABLE, ob_ap_enable, 0, 1),
      SHELL_CMD_ARG(disable, NULL, OB_HELP_WIFI_AP_DISABLE, ob_ap_disable, 0, 0),
      SHELL_CMD_ARG(address, NULL, OB_HELP_WIFI_AP_ADDRESS, ap_address_handler, 1, 1),
+     SHELL_CMD_ARG(channel, NULL, OB_HELP_WIFI_AP_CHANNEL, ap_channel_handler, 1, 0),
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+     SHELL_CMD_ARG(pool, NULL, OB_HELP_WIFI_AP_POOL, ap_pool_handler, 1, 2),
+     SHELL_CMD_ARG(stations, NULL, OB_HELP_WIFI_AP_STATIONS, ap_stations_handler, 1, 0),
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
      SHELL_SUBCMD_SET_END
      );
 #ifdef CONFIG_NET_DHCPV4_SERVER
@@ -452,6 +1317,16 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob_dhcp_cmds,
 #endif // CONFIG_NET_DHCPV4_SERVER
 #endif // CONFIG_ONBOARDING_WIFI_AP
 
+#ifdef CONFIG_ONBOARDING_WIFI
+/** @brief commands to handle the wifi profiles. */
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob_wifi_profile_cmds,
+     SHELL_CMD_ARG(list, NULL, OB_HELP_WIFI_PROFILE_LIST, profile_list_handler, 1, 0),
+     SHELL_CMD_ARG(add, NULL, OB_HELP_WIFI_PROFILE_ADD, profile_add_handler, 3, 1),
+     SHELL_CMD_ARG(del, NULL, OB_HELP_WIFI_PROFILE_DEL, profile_del_handler, 2, 0),
+     SHELL_SUBCMD_SET_END
+     );
+#endif // CONFIG_ONBOARDING_WIFI
+
 /** @brief commands to handle the device WIFI. */
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob_wifi_cmds,
 #ifdef CONFIG_ONBOARDING_NVS
@@ -461,6 +1336,25 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob_wifi_cmds,
                                
 #ifdef CONFIG_ONBOARDING_WIFI
      SHELL_CMD_ARG(address, NULL, OB_HELP_WIFI_ADDRESS, setup_iface, 2, 0),
+     SHELL_CMD_ARG(ipv4, NULL, OB_HELP_WIFI_IPV4, ipv4_handler, 1, 4),
+     SHELL_CMD_ARG(scan, NULL, OB_HELP_WIFI_SCAN, scan_handler, 1, 2),
+     SHELL_CMD_ARG(attempts, NULL, OB_HELP_WIFI_ATTEMPTS, attempts_handler, 1, 0),
+     SHELL_CMD(profile, &sub_ob_wifi_profile_cmds, OB_HELP_WIFI_PROFILE, NULL),
+#ifdef CONFIG_ONBOARDING_WIFI_ROAM
+     SHELL_CMD_ARG(roam, NULL, OB_HELP_WIFI_ROAM, roam_handler, 1, 0),
+#endif // CONFIG_ONBOARDING_WIFI_ROAM
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+     SHELL_CMD_ARG(link, NULL, OB_HELP_WIFI_LINK, link_handler, 1, 0),
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+     SHELL_CMD_ARG(probe, NULL, OB_HELP_WIFI_PROBE, probe_handler, 1, 2),
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+     SHELL_CMD_ARG(ps, NULL, OB_HELP_WIFI_PS, ps_handler, 1, 1),
+#endif // CONFIG_ONBOARDING_WIFI_PS
+#ifdef CONFIG_ONBOARDING_WIFI_TIMELINE
+     SHELL_CMD_ARG(timeline, NULL, OB_HELP_WIFI_TIMELINE, timeline_handler, 1, 1),
+#endif // CONFIG_ONBOARDING_WIFI_TIMELINE
 #endif //CONFIG_ONBOARDING_WIFI
                                
 #ifdef CONFIG_NET_HOSTNAME_DYNAMIC
@@ -470,6 +1364,18 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob_wifi_cmds,
      SHELL_SUBCMD_SET_END
      );
 
+#ifdef CONFIG_ONBOARDING_WIFI_SIM
+/** @brief commands to script the simulated wifi driver */
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob_sim_cmds,
+     SHELL_CMD_ARG(ap, NULL, OB_HELP_SIM_AP, sim_ap_handler, 1, 5),
+     SHELL_CMD_ARG(delay, NULL, OB_HELP_SIM_DELAY, sim_delay_handler, 3, 0),
+     SHELL_CMD_ARG(fail, NULL, OB_HELP_SIM_FAIL, sim_fail_handler, 3, 1),
+     SHELL_CMD_ARG(drop, NULL, OB_HELP_SIM_DROP, sim_drop_handler, 1, 0),
+     SHELL_CMD_ARG(sta, NULL, OB_HELP_SIM_STA, sim_sta_handler, 3, 0),
+     SHELL_SUBCMD_SET_END
+     );
+#endif // CONFIG_ONBOARDING_WIFI_SIM
+
 #ifdef CONFIG_ONBOARDING_OTA_UPDATEHUB
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob_ota_updatehub,
      SHELL_CMD_ARG(confirm, NULL, OB_HELP_OTA_UH_CONFIRM, updatehub_confirm_handler, 0, 0),
@@ -510,6 +1416,12 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_ob,
 #ifdef CONFIG_ONBOARDING_OTA_GOLIOTH
      SHELL_CMD(golioth, &sub_ob_ota_golioth, "Golioth commands", NULL),
 #endif // CONFIG_ONBOARDING_OTA_GOLIOTH
+#ifdef CONFIG_ONBOARDING_WIFI_SIM
+     SHELL_CMD(sim, &sub_ob_sim_cmds, "simulated wifi commands", NULL),
+#endif // CONFIG_ONBOARDING_WIFI_SIM
+#ifdef CONFIG_ONBOARDING_BENCH
+     SHELL_CMD_ARG(bench, NULL, OB_HELP_BENCH, bench_handler, 1, 2),
+#endif // CONFIG_ONBOARDING_BENCH
 #ifdef CONFIG_ONBOARDING_REBOOT
      SHELL_CMD_ARG(reboot, NULL, OB_HELP_REBOOT, cmd_reboot, 0, 0),
 #endif // CONFIG_ONBOARDING_REBOOT
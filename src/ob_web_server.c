@@ -18,6 +18,7 @@
 #include <zephyr/net/wifi.h>
 
 #include "ob_web_server.h"
+#include "ob_http_parser.h"
 #include "ob_wifi.h"
 #include "ob_nvs_data.h"
 #include "ob_certs.h"
@@ -52,8 +53,6 @@ static sec_tag_t sec_tag_list[] = {
 
 /** @brief the maximum size of the content item in the http header */
 #define MAX_HEADER_CONTENT_LEN 40
-/** @brief the size of "Content Length:" in the http header */
-#define CONTENT_LENGTH_END 15
 
 /** @brief the priority for the tcp processing  threads */
 #if defined(CONFIG_NET_TC_THREAD_COOPERATIVE)
@@ -255,18 +254,6 @@ static int setup(int *sock, struct sockaddr *bind_addr,
 }
 
 
-/**
- * @brief types of web page operations
- */
-typedef enum page_type {
-  /** @brief GET opertation requested */
-  GET,
-  /** @brief POST operation requested */
-  POST,
-  /** @brief unsupported operation requested */
-  UNKNOWN
-} page_type_t;
-
 /**
  * @brief send a 404 web page to the client
  *
@@ -298,6 +285,9 @@ static void display_500(int client)
   }
 }
 
+/** @brief the size of the buffer used to receive a POST body */
+#define POST_RECV_BUFFER_SIZE 64
+
 /**
  * @brief This function handles an incomming connection
  *
@@ -313,29 +303,18 @@ static void client_conn_handler(void *ptr1, void *ptr2, void *ptr3)
   int client;
   int received;
   int ret;
-  int i = 0;
   int rc = 0;
-  int start_page;
-  page_type_t page_type = UNKNOWN;
-  char filename[MAX_WEB_PATH_NAME_LEN];
-  char getbuf[6];
-  int req_state = 0;
+  ob_http_parse_result_t parse_rc = OB_HTTP_PARSE_MORE;
+  struct ob_http_request_parser parser;
   client = *sock;
   web_page_t * wp;
   bool found = false;
-  bool doGetLength = false;
-  int length = 0;
-  int ct_index = 0;
 
-  /* Discard HTTP request (or otherwise client will get
-   * connection reset error).
+  /* Read the request one byte at a time so that the POST body is left in
+   * the socket for ob_ws_process_post().
    */
-
-  (void)memset(getbuf, 0, sizeof(getbuf));
-  (void)memset(filename, 0, sizeof(filename));
-  start_page = 0;
-  i = 0;
-  do {
+  ob_http_request_parser_init(&parser);
+  while (OB_HTTP_PARSE_MORE == parse_rc) {
     char c;
     received = zsock_recv(client, &c, 1, 0);
     if (received == 0) {
@@ -353,78 +332,17 @@ static void client_conn_handler(void *ptr1, void *ptr2, void *ptr3)
       LOG_ERR("[%d] Connection error %d", client, ret);
       break;
     }
-#ifdef CONFIG_ONBOARDING_LOG_LEVEL_DBG
-      //      putchar(c);
-#endif // CONFIG_ONBOARDING_LOG_LEVEL_DBG
-    if(i < 5) {
-      getbuf[i] = c;
-    }
-    if(start_page > 0) {
-      if(' ' == c) {
-        filename[i-start_page] = '\0';
-        start_page = 0;
-        LOG_DBG("File name '%s'", filename);
-      } else {
-        filename[i-start_page] = c;
-      }
-    }
-    if(i == 4) {
-      if(0 == strncmp("GET ",getbuf, 4)) {
-        page_type = GET;
-        LOG_DBG("Found start %d", i);
-        start_page = 4;
-        filename[0] = c;
-      }
-    }
-    if((!start_page) && (i == 5)) {
-      if(0 == strncmp("POST", getbuf, 4)) {
-        page_type = POST;
-        start_page = 5;
-        filename[0] = c;
-      }
-    }
-
-    /* Search for Content-Length: */
-    if(doGetLength) {
-      if(c == '\r') {
-        LOG_DBG("ContentLength %d", length);
-        doGetLength =false;
-      } else {
-        if((c >= '0')  && ( c <= '9')) {
-
-          length *=10;
-          length += (c - '0');
-        }
-      }
-    }
-    if( content_length[ct_index] == c){
-      if(CONTENT_LENGTH_END == ct_index) {
-        doGetLength = true;
-        ct_index = 0;
-        //        LOG_DBG("Found content-length");
-      } else {
-        ct_index++;
-      }
-    }
-    if (req_state == 0 && c == '\r') {
-      req_state++;
-    } else if (req_state == 1 && c == '\n') {
-      req_state++;
-    } else if (req_state == 2 && c == '\r') {
-      req_state++;
-    } else if (req_state == 3 && c == '\n') {
-      break;
-    } else {
-      req_state = 0;
-    }
-    i++;
-
-  } while (true);
-  LOG_DBG("ready to process '%s'", filename);
+    parse_rc = ob_http_request_parser_feed(&parser, &c, 1, NULL);
+  }
+  if (OB_HTTP_PARSE_DONE != parse_rc) {
+    LOG_ERR("[%d] Malformed request %d", client, parse_rc);
+    parser.method = OB_HTTP_METHOD_UNKNOWN;
+  }
+  LOG_DBG("ready to process '%s'", parser.path);
   found = false;
-  switch(page_type) {
-  case GET:
-    if(strlen(filename) == 1) {
+  switch(parser.method) {
+  case OB_HTTP_METHOD_GET:
+    if(strlen(parser.path) == 1) {
       LOG_DBG("Searching for home");
       for(wp = web_pages; wp != NULL; wp = wp->next) {
         if(ob_wifi_HasAP() ) {
@@ -446,7 +364,7 @@ static void client_conn_handler(void *ptr1, void *ptr2, void *ptr3)
     } else {
       for(wp = web_pages; wp != NULL; wp = wp->next) {
         LOG_DBG("Checking %s", wp->pathname);
-        if((0 == strncmp(wp->pathname, filename, strlen(wp->pathname))) &&
+        if((0 == strncmp(wp->pathname, parser.path, strlen(wp->pathname))) &&
            (NULL != wp->get_callback)) {
           rc = (*wp->get_callback)(client, wp);
           found = true;
@@ -463,12 +381,12 @@ static void client_conn_handler(void *ptr1, void *ptr2, void *ptr3)
     }
 
     break;
-  case POST:
+  case OB_HTTP_METHOD_POST:
     for(wp = web_pages; wp != NULL; wp = wp->next) {
-      if(0 == strncmp(wp->pathname, filename, strlen(wp->pathname))) {
-        if(NULL != wp->get_callback) {
+      if(0 == strncmp(wp->pathname, parser.path, strlen(wp->pathname))) {
+        if(NULL != wp->post_callback) {
           LOG_DBG("Posting %s", wp->pathname);
-          wp->content_length = length;
+          wp->content_length = parser.content_length;
           rc = (*wp->post_callback)(client, wp);
           found = true;
           break;
@@ -483,7 +401,7 @@ static void client_conn_handler(void *ptr1, void *ptr2, void *ptr3)
       }
     }
     break;
-  case UNKNOWN:
+  case OB_HTTP_METHOD_UNKNOWN:
   default:
   }
   (void)zsock_close(client);
@@ -499,25 +417,16 @@ static void client_conn_handler(void *ptr1, void *ptr2, void *ptr3)
 int ob_ws_process_post(int client,  post_attributes_t* ap, int num_ap, web_page_t *wp)
 {
   int rc = 0;
-  int i;
-  int cl;
-  int index;
-  bool doName;
+  int remaining;
   int received;
-  int value_start;
-  int req_state = 0;
-  char name[NAME_BUFFER_SIZE];
-  char * valuebuffer;
-  post_attributes_t * cp;
-  cp = ap;
-  //  for(i = 0; i < num_ap ; i++) {
-  index = 0;
-  doName = true;
-  valuebuffer = cp->valuebuffer;
+  char buffer[POST_RECV_BUFFER_SIZE];
+  struct ob_post_parser parser;
+
+  ob_post_parser_init(&parser, ap, num_ap);
   LOG_DBG("Length %d", wp->content_length);
-  for(cl = 0; cl < wp->content_length; cl++) {
-    char c;
-    received = zsock_recv(client, &c, 1, 0);
+  remaining = wp->content_length;
+  while(remaining > 0) {
+    received = zsock_recv(client, buffer, MIN(remaining, (int)sizeof(buffer)), 0);
     if (received == 0) {
       /* Connection closed */
       LOG_ERR("[%d] Connection closed by peer", client);
@@ -532,68 +441,20 @@ int ob_ws_process_post(int client,  post_attributes_t* ap, int num_ap, web_page_
       LOG_ERR("[%d] Connection error %d", client, rc);
       break;
     }
-#ifdef CONFIG_ONBOARDING_LOG_LEVEL
-    if (CONFIG_ONBOARDING_LOG_LEVEL >= LOG_LEVEL_DBG) {
-      putchar(c);
+    remaining -= received;
+    if((rc = ob_post_parser_feed(&parser, buffer, received)) < 0) {
+      LOG_ERR("Invalid POST attribute");
+      return rc;
     }
-#endif // CONFIG_ONBOARDING_LOG_LEVEL
-
-    if(doName) {
-      if ( '=' == c) {
-        value_start = index + 1;
-        name[index++] = '\0';
-        cp = ap;
-        for(i = 0; i < num_ap ; i++) {
-          LOG_DBG("Checking '%s' with '%s'", name, cp->name);
-          if(!strncmp(name, cp->name, NAME_BUFFER_SIZE)) {
-            LOG_DBG("Found name %s", cp->name);
-            valuebuffer = cp->valuebuffer;
-
-            break;
-          }
-          cp++;
-        }
-        if(i == num_ap) {
-          LOG_ERR("Name not found");
-          return -EINVAL;
-        }
-
-        doName = false;
-      } else {
-        if((c != '\r') && (c != '\n')) {
-          if(index < NAME_BUFFER_SIZE) {
-            name[index++] = c;
-          } else {
-            LOG_ERR("name too long %d", index);
-          }
-        }
-      }
-    } else {
-      if( ('\r' == c) || ('\n' == c)) {
-        valuebuffer[index - value_start] = '\0';
-        LOG_DBG("VALUE = '%s'", valuebuffer);
-        doName = true;
-        index = 0;
-      } else {
-        valuebuffer[index++ - value_start] = c;
-      }
-    }
-    if (req_state == 0 && c == '\r') {
-      req_state++;
-    } else if (req_state == 1 && c == '\n') {
-      LOG_INF("attrib: '%s': '%s'", cp->name, cp->valuebuffer);
-      //        break;
-    } else {
-      req_state = 0;
-    }
-  } ;
-  putchar('\n');
-  //  }
+  }
+  if(rc == 0) {
+    rc = ob_post_parser_finish(&parser);
+  }
   return rc;
 }
 
 /** @brief the maximum lenght of the menu buffer */
-#define WEB_MENU_LEN 256
+#define WEB_MENU_LEN 512
 
 /** @brief the start of a menu element */
 static const char MENU_ELEM_START[] =  "<a href=\"";
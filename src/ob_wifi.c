@@ -17,9 +17,34 @@
 
 
 #include <zephyr/net/wifi_mgmt.h>
+#include <zephyr/net/wifi_utils.h>
 #include <zephyr/net/ethernet_mgmt.h>
+#include <zephyr/random/random.h>
+#include <zephyr/smf.h>
 
 #include "ob_wifi.h"
+#include "ob_wifi_config.h"
+#include "ob_wifi_profile.h"
+#include "ob_wifi_ipv4.h"
+#include "ob_wifi_timeline.h"
+#ifdef CONFIG_ONBOARDING_WIFI_LEASE
+#include "ob_wifi_lease.h"
+#endif // CONFIG_ONBOARDING_WIFI_LEASE
+#ifdef CONFIG_ONBOARDING_WIFI_ROAM
+#include "ob_wifi_roam.h"
+#endif // CONFIG_ONBOARDING_WIFI_ROAM
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+#include "ob_wifi_ap_pool.h"
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+#include "ob_wifi_link.h"
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+#include "ob_wifi_probe.h"
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+#include "ob_wifi_ps.h"
+#endif // CONFIG_ONBOARDING_WIFI_PS
 #include "ob_nvs_data.h"
 #ifdef CONFIG_USE_READY_LED
 #include <ready_led.h>
@@ -35,40 +60,320 @@ static struct net_mgmt_event_callback ipv4_mgmt_cb;
 static struct net_mgmt_event_callback ethernet_mgmt_cb;
 /** @brief indicates that the wifi module hs been initialized */
 static bool wifi_inited = false;
-/** @brief indicates whether connection request succeded (including dhcp response) or failed */
-static bool wifi_connect_status_succeded = false;
-
-/** @brief a semaphore released after a wifi connection completes */
-static K_SEM_DEFINE(wifi_connect_sem, 0, 1);
-/** @brief a sempaphore released when the AP is disabled
-    This usually means that the SSID and PSK of the target wifi have been configured
-*/
-static K_SEM_DEFINE(wifi_ap_sem, 0, 1);
+/** @brief the OB_WIFI_EVENT_* readiness events */
+static K_EVENT_DEFINE(wifi_events);
 /** @brief a semaphore released when the wifi has been disonnected during wifi shutdown */
 static K_SEM_DEFINE(wifi_deinit_sem, 0, 1);
 
-/** @brief the head of the SSID list */
-ssid_item_t *ssid_head = NULL;
-/** @brief the tail of the SSID list */
-ssid_item_t *ssid_tail = NULL;
+/** @brief the pool of scan snapshots */
+K_MEM_SLAB_DEFINE_STATIC(scan_slab, sizeof(ob_wifi_scan_snapshot_t),
+                         CONFIG_ONBOARDING_WIFI_SCAN_SNAPSHOTS, 4);
+
+/**
+ * @brief the table of the scan in progress
+ *
+ * The SSIDs are deduplicated on a hash of the SSID and the security. A
+ * min-heap ordered on the RSSI keeps the strongest
+ * CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS networks.
+ */
+static struct {
+  /** @brief the snapshot being filled, NULL if none */
+  ob_wifi_scan_snapshot_t *snap;
+  /** @brief the hash of each item */
+  uint32_t hash[CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS];
+  /** @brief the min-heap of item indexes */
+  uint8_t heap[CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS];
+  /** @brief the position of each item in the heap */
+  uint8_t heap_pos[CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS];
+} scan_table;
+
+/** @brief protects the scan list, the scan cache and the subscriber list */
+static K_MUTEX_DEFINE(scan_mutex);
+/** @brief the results of the last completed scan, holds a reference */
+static ob_wifi_scan_snapshot_t *scan_cache = NULL;
+/** @brief subscribers waiting for the scan in flight */
+static sys_slist_t scan_subscribers = SYS_SLIST_STATIC_INIT(&scan_subscribers);
+/** @brief indicates that a scan has been requested and has not completed */
+static bool scan_in_flight = false;
+/** @brief the scan in flight is limited by parameters and is not cached */
+static bool scan_partial = false;
+/** @brief subscribers waiting for a full scan while a partial scan is in flight */
+static sys_slist_t scan_pending = SYS_SLIST_STATIC_INIT(&scan_pending);
+/** @brief the uptime when the scan in flight was started */
+static int64_t scan_start_time = 0;
+/** @brief the parameters of full scans, from CONFIG_ONBOARDING_WIFI_SCAN_DEFAULT */
+static struct wifi_scan_params scan_default_params;
+
+/** @brief the names of the scan presets, indexed by ob_wifi_scan_preset_t */
+static const char * const scan_preset_names[OB_WIFI_SCAN_PRESET_COUNT] = {
+  [OB_WIFI_SCAN_PRESET_FULL] = "full",
+  [OB_WIFI_SCAN_PRESET_PORTAL_QUICK] = "quick",
+  [OB_WIFI_SCAN_PRESET_PASSIVE] = "passive",
+  [OB_WIFI_SCAN_PRESET_RECONNECT_TARGETED] = "targeted",
+  [OB_WIFI_SCAN_PRESET_ROAM_BACKGROUND] = "roam",
+};
+
+static void scan_timeout_handler(struct k_work *work);
+/** @brief fails a scan that does not complete within CONFIG_ONBOARDING_WIFI_SCAN_TIMEOUT */
+static K_WORK_DELAYABLE_DEFINE(scan_timeout_work, scan_timeout_handler);
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_ONBOARDING_WIFI_SCAN_RING),
+             "CONFIG_ONBOARDING_WIFI_SCAN_RING must be a power of two");
+
+/**
+ * @brief a scan result copied out of the net_mgmt callback
+ */
+struct scan_ring_entry {
+  /** @brief the SSID, not NUL terminated */
+  char ssid[WIFI_SSID_MAX_LEN];
+  /** @brief the BSSID */
+  uint8_t bssid[WIFI_MAC_ADDR_LEN];
+  /** @brief the length of the SSID */
+  uint8_t ssid_length;
+  /** @brief the security (enum wifi_security_type) */
+  uint8_t security;
+  /** @brief the RSSI in dBm */
+  int8_t rssi;
+  /** @brief the channel */
+  uint8_t channel;
+  /** @brief the band (enum wifi_frequency_bands) */
+  uint8_t band;
+};
+
+/**
+ * @brief the scan results waiting to be added to the scan table
+ *
+ * A single producer, single consumer ring: the net_mgmt callback only
+ * writes the entry at head and then advances head, the scan drain work
+ * only reads the entry at tail and then advances tail.
+ */
+static struct {
+  /** @brief the entries */
+  struct scan_ring_entry entries[CONFIG_ONBOARDING_WIFI_SCAN_RING];
+  /** @brief the number of entries written, only advanced by the producer */
+  atomic_t head;
+  /** @brief the number of entries read, only advanced by the consumer */
+  atomic_t tail;
+  /** @brief the number of results dropped because the ring was full */
+  atomic_t overflows;
+  /** @brief the status of the scan done event plus one, 0 if none is pending */
+  atomic_t done;
+} scan_ring;
+
+static void scan_drain_handler(struct k_work *work);
+/** @brief adds the results of the scan ring to the scan table on the connect work queue */
+static K_WORK_DEFINE(scan_drain_work, scan_drain_handler);
+
+/** @brief the uptime when the last CONNECT_RESULT was received */
+static int64_t connect_result_time = 0;
+/** @brief timing of the most recent connection attempts */
+static struct ob_wifi_connect_attempt connect_attempts[OB_WIFI_CONNECT_ATTEMPT_HISTORY];
+/** @brief the number of connection attempts made */
+static int connect_attempt_count = 0;
+
+#ifdef CONFIG_ONBOARDING_WIFI_FAST_CONNECT
+/**
+ * @brief the BSS of the last successful association
+ * @details persisted at NVS_SETTINGS_ID_WIFI_BSS
+ */
+struct ob_wifi_bss_record {
+  /** @brief the SSID the BSS belongs to */
+  char ssid[WIFI_SSID_MAX_LEN];
+  /** @brief the length of the SSID */
+  uint8_t ssid_len;
+  /** @brief the BSSID of the AP */
+  uint8_t bssid[WIFI_MAC_ADDR_LEN];
+  /** @brief the channel of the AP */
+  uint8_t channel;
+  /** @brief the band (enum wifi_frequency_bands) of the AP */
+  uint8_t band;
+  /** @brief the security (enum wifi_security_type) of the AP */
+  uint8_t security;
+};
+
+static void save_bss_work_handler(struct k_work * work);
+/** @brief saves the BSS after a successful association */
+static K_WORK_DEFINE(save_bss_work, save_bss_work_handler);
+#endif // CONFIG_ONBOARDING_WIFI_FAST_CONNECT
+
+#ifdef CONFIG_ONBOARDING_WIFI_LEASE
+static void lease_start_work_handler(struct k_work * work);
+/** @brief requests the saved lease or starts the DHCP client, runs on connect_wq */
+static K_WORK_DEFINE(lease_start_work, lease_start_work_handler);
+static void lease_result_work_handler(struct k_work * work);
+/** @brief reports the saved lease acknowledged or starts the DHCP client, runs on connect_wq */
+static K_WORK_DEFINE(lease_result_work, lease_result_work_handler);
+/** @brief the last result of the saved lease */
+static atomic_t lease_result;
+static void lease_save_work_handler(struct k_work * work);
+/** @brief saves the lease bound by the DHCP client */
+static K_WORK_DEFINE(lease_save_work, lease_save_work_handler);
+#endif // CONFIG_ONBOARDING_WIFI_LEASE
+
+/** @brief the number of times a rejected connect request is retried while the interface comes up */
+#define CONNECT_REQUEST_RETRIES 20
+/** @brief milliseconds between connect requests while the interface comes up */
+#define CONNECT_REQUEST_RETRY_MS 1000
+
+/** @brief connect event: the station associated */
+#define CONNECT_EV_ASSOCIATED BIT(0)
+/** @brief connect event: the association failed */
+#define CONNECT_EV_FAILED BIT(1)
+/** @brief connect event: DHCP bound an address */
+#define CONNECT_EV_BOUND BIT(2)
+/** @brief connect event: the station was disconnected */
+#define CONNECT_EV_DISCONNECTED BIT(3)
+
+/**
+ * @brief states of the connection state machine
+ */
+enum connect_state {
+  /** @brief no connection in progress */
+  CONNECT_IDLE,
+  /** @brief the next connect request is due */
+  CONNECT_REQUEST,
+  /** @brief waiting for the association and DHCP */
+  CONNECT_WAIT,
+  /** @brief waiting out the backoff before the next attempt */
+  CONNECT_BACKOFF
+};
+
+/**
+ * @brief the connection in progress
+ * @details protected by connect_mutex
+ */
+static struct {
+  /** @brief the state of the connection */
+  enum connect_state state;
+  /** @brief the current attempt targets a known BSS */
+  bool targeted;
+  /** @brief the current attempt has associated */
+  bool associated;
+  /** @brief the reason the last attempt ended */
+  ob_wifi_connect_reason_t reason;
+  /** @brief the number of connect requests issued */
+  int requests;
+  /** @brief the number of failed full scan attempts */
+  int failures;
+  /** @brief the number of full scan attempts before giving up, negative for no limit */
+  int max_attempts;
+  /** @brief the number of rejected requests of the current attempt */
+  int request_tries;
+  /** @brief the uptime when the connection was started */
+  int64_t start;
+  /** @brief the uptime when the current attempt was started */
+  int64_t attempt_start;
+  /** @brief the uptime when the state machine must run next */
+  int64_t deadline;
+  /** @brief the completion callback */
+  ob_wifi_connect_cb_t callback;
+  /** @brief the user data of the completion callback */
+  void * user_data;
+  /** @brief the parameters of the connect requests */
+  struct wifi_connect_req_params params;
+  /** @brief the SSID to connect to */
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  /** @brief the PSK of the SSID */
+  char psk[WIFI_PSK_MAX_LEN + 1];
+  /** @brief the BSS targeted by the first attempt */
+  struct ob_wifi_bss target;
+} cnx;
+
+/** @brief protects cnx */
+static K_MUTEX_DEFINE(connect_mutex);
+/** @brief CONNECT_EV_* events received from net_mgmt and not yet handled */
+static atomic_t connect_events = ATOMIC_INIT(0);
+/** @brief the last status reported by the driver */
+static atomic_t connect_status = ATOMIC_INIT(0);
+
+/** @brief the stack of the connect work queue */
+static K_THREAD_STACK_DEFINE(connect_wq_stack, CONFIG_ONBOARDING_WIFI_CONNECT_STACK_SIZE);
+/** @brief the work queue running the connection state machine */
+static struct k_work_q connect_wq;
+/** @brief indicates that the connect work queue has been started */
+static bool connect_wq_started = false;
+
+static void connect_work_handler(struct k_work * work);
+/** @brief runs the connection state machine */
+static K_WORK_DELAYABLE_DEFINE(connect_work, connect_work_handler);
+static void connect_event(atomic_val_t event, int status);
+static uint32_t backoff_delay(int failures);
+
+/**
+ * @brief states of the wifi bring-up
+ */
+enum bringup_state {
+  /** @brief loading the configuration and starting the AP */
+  BRINGUP_LOAD,
+  /** @brief connecting the station */
+  BRINGUP_CONNECT,
+  /** @brief waiting for credentials from an onboarding method */
+  BRINGUP_PROVISION,
+  /** @brief the station is connected */
+  BRINGUP_ONLINE
+};
+
+/**
+ * @brief the wifi bring-up state machine
+ */
+static struct {
+  /** @brief the state machine context, must be first */
+  struct smf_ctx ctx;
+  /** @brief the initial state has been entered */
+  bool started;
+  /** @brief the uptime when ob_wifi_init() was called */
+  int64_t start;
+  /** @brief the request for the scan the profiles are ranked against */
+  struct ob_wifi_scan_subscriber scan_sub;
+  /** @brief set by the scan callback once order and num are filled in */
+  atomic_t ranked;
+  /** @brief the reason of the last connection plus one, 0 while it runs */
+  atomic_t result;
+  /** @brief the driver status of the last connection */
+  atomic_t status;
+  /** @brief the indexes of the profiles to try, best first */
+  int order[CONFIG_ONBOARDING_WIFI_PROFILE_CANDIDATES];
+  /** @brief the number of indexes in order */
+  int num;
+  /** @brief the index in order of the profile to try next */
+  int next;
+  /** @brief the number of ranked rounds that failed */
+  int rounds;
+  /** @brief the uptime before which nothing is tried */
+  int64_t retry_at;
+  /** @brief waiting for the scan */
+  bool scanning;
+  /** @brief the candidates come from a scan rather than the last connection */
+  bool scanned;
+  /** @brief waiting for the connection */
+  bool connecting;
+  /** @brief the profile being tried */
+  struct ob_wifi_profile profile;
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+  /** @brief the uptime when the online station reconnects, 0 while connected */
+  int64_t reconnect_at;
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+} bringup;
+
+static const struct smf_state bringup_states[];
+static void bringup_work_handler(struct k_work * work);
+/** @brief runs the bring-up state machine */
+static K_WORK_DELAYABLE_DEFINE(bringup_work, bringup_work_handler);
+
+/**
+ * @brief Run the bring-up state machine again
+ */
+static void
+bringup_kick(void)
+{
+  k_work_reschedule_for_queue(&connect_wq, &bringup_work, K_NO_WAIT);
+}
 
 /** @brief indicates if the device AP isactive */
 bool mHasAp = false;
 
-/** @brief the SSID to connect with */
-char gSSID[WIFI_SSID_MAX_LEN];
-/** @brief the length of the connect SSID */
-int gSSID_len;
-/** @brief the PSK for the connect SSID */
-char gPSK[WIFI_PSK_MAX_LEN];
-/** @brief ths length of the PSK for the connect SSID */
-int gPSK_len;
 
 #ifdef CONFIG_ONBOARDING_WIFI_AP
-#ifdef CONFIG_NET_DHCPV4_SERVER
-/** @brief the network mask for the devices DHCP server */
-static struct in_addr netmask = { { { 255, 255, 255, 0 } } };
-#endif
 /** @brief the ssid of the device AP */
 char wifi_ap_ssid[WIFI_SSID_MAX_LEN];
 /** @brief the PSK of the device AP */
@@ -78,25 +383,78 @@ char wifi_ap_address[WIFI_AP_ADDRESS_SIZE];
 
 /** @brief The delayed work structure for the devices AP */
 struct k_work_delayable start_ap_work;
+/** @brief disables the device AP CONFIG_ONBOARDING_WIFI_AP_GRACE after the station is online */
+static struct k_work_delayable stop_ap_work;
+
+static void _ob_wifi_ap_enable(int channel);
 
-static void _ob_wifi_ap_enable(void);
+#ifdef CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+/**
+ * @brief the last selection of the AP channel
+ * @details only written by the AP start work, protected by ap_channel_lock
+ */
+static struct {
+  /** @brief the scores of the candidate channels */
+  struct ob_wifi_ap_channel_score scores[OB_WIFI_AP_CHANNELS_MAX];
+  /** @brief the number of scores */
+  int count;
+  /** @brief the selected channel, 0 if none */
+  int channel;
+  /** @brief the uptime of the selection */
+  int64_t timestamp;
+} ap_channel;
+
+/** @brief protects ap_channel */
+static struct k_spinlock ap_channel_lock;
+/** @brief the request for the scan the AP channel is selected from */
+static struct ob_wifi_scan_subscriber ap_channel_sub;
+/** @brief set while ap_channel_sub waits for its scan */
+static atomic_t ap_channel_scanning;
+/** @brief the channel selected by the scan callback for the AP start, 0 if none */
+static atomic_t ap_channel_selected;
+
+static int ap_channel_select(void);
+#endif // CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
 
 /**
  * @brief This function is called from the delayed work structure to enable the device AP
+ * @details with CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL and no recent
+ * channel selection the work only requests a scan, its callback selects
+ * the channel and runs the work again. The system work queue is not held
+ * while the scan runs.
  * @param work The delayed work structure
  */
 static void bws_start_ap_work(struct k_work * work)
 {
-   _ob_wifi_ap_enable();
+#ifdef CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+  int channel = (int)atomic_clear(&ap_channel_selected);
+
+  if((0 == channel) && (0 == (channel = ap_channel_select()))) {
+    return;
+  }
+  _ob_wifi_ap_enable(channel);
+#else
+  _ob_wifi_ap_enable(WIFI_CHANNEL_ANY);
+#endif // CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+}
+
+/**
+ * @brief This function is called from the delayed work structure to disable the device AP
+ * @details the AP is kept if the station went offline during the grace period
+ * @param work The delayed work structure
+ */
+static void stop_ap_work_handler(struct k_work * work)
+{
+  ARG_UNUSED(work);
+  if(ob_wifi_HasAP() && k_event_test(&wifi_events, OB_WIFI_EVENT_STA_CONNECTED)) {
+    ob_wifi_ap_disable();
+  }
 }
 #endif // CONFIG_ONBOARDING_WIFI_AP
 
-/** @brief callback called when a wifi scan is completed */
-scan_done_callback_t done_callback = NULL;
 /** @brief callback called when an IPV4 address is added  */
 address_add_callback_t address_add_callback = NULL;
 
-#ifdef CONFIG_ONBOARDING_WIFI_AP
 /**
  * @brief Converts a binary mac address to a string
  * @param macp A 6 byte array representing the 6 octets of the MAC address
@@ -109,7 +467,6 @@ char *Mac2String(uint8_t * macp)
            macp[0], macp[1], macp[2], macp[3], macp[4], macp[5]);
   return macbuf;
 }
-#endif //CONFIG_ONBOARDING_WIFI_AP
 
 /**
  * @brief Obtains the MAC address of the WiFi interface
@@ -144,92 +501,713 @@ bool ob_wifi_HasAP(void)
   return mHasAp;
 }
 
-void set_scan_done_callback(scan_done_callback_t func)
+void set_address_add_callback(address_add_callback_t callback)
 {
-  done_callback = func;
+  address_add_callback = callback;
 }
 
-void set_address_add_callback(address_add_callback_t callback)
+BUILD_ASSERT(CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS <= UINT8_MAX,
+             "scan heap indexes are 8 bits");
+
+/**
+ * @brief hash an SSID and its security
+ *
+ * @param ssid Pointer to the SSID name
+ * @param ssid_length length of the SSID name
+ * @param security true if the network is secure
+ * @return the FNV-1a hash
+ */
+static uint32_t
+ssid_hash(const char * ssid, int ssid_length, bool security)
 {
-  address_add_callback = callback;
+  uint32_t hash = 2166136261U;
+  int i;
+
+  for(i = 0; i < ssid_length; i++) {
+    hash = (hash ^ (uint8_t)ssid[i]) * 16777619U;
+  }
+  return (hash ^ (security ? 1U : 0U)) * 16777619U;
 }
 
 /**
- * @brief free an item from the list of SSIDs
- * @details this recursively frees all subsequent items in the SSID list
- * @param it  Pointer to ssid item to free
+ * @brief swap two entries of the scan heap
+ */
+static inline void
+scan_heap_swap(int a, int b)
+{
+  uint8_t tmp = scan_table.heap[a];
+
+  scan_table.heap[a] = scan_table.heap[b];
+  scan_table.heap[b] = tmp;
+  scan_table.heap_pos[scan_table.heap[a]] = a;
+  scan_table.heap_pos[scan_table.heap[b]] = b;
+}
+
+/**
+ * @brief return the RSSI of the item at a heap position
+ */
+static inline int
+scan_heap_rssi(int pos)
+{
+  return scan_table.snap->items[scan_table.heap[pos]].rssi;
+}
+
+/**
+ * @brief move a heap entry towards the root while it is weaker than its parent
  */
 static void
-ssid_free_item(ssid_item_t * it)
+scan_heap_sift_up(int pos)
 {
-  if(NULL == it) {
-    return;
+  while((pos > 0) && (scan_heap_rssi(pos) < scan_heap_rssi((pos - 1) / 2))) {
+    scan_heap_swap(pos, (pos - 1) / 2);
+    pos = (pos - 1) / 2;
   }
-  ssid_free_item(it->next);
-  free(it->ssid);
-  free(it);
 }
 
 /**
- * @brief Add an SSID item to the ssid list
+ * @brief move a heap entry towards the leaves while it is stronger than a child
+ */
+static void
+scan_heap_sift_down(int pos, int count)
+{
+  int child;
+
+  while((child = (2 * pos) + 1) < count) {
+    if(((child + 1) < count) && (scan_heap_rssi(child + 1) < scan_heap_rssi(child))) {
+      child++;
+    }
+    if(scan_heap_rssi(pos) <= scan_heap_rssi(child)) {
+      break;
+    }
+    scan_heap_swap(pos, child);
+    pos = child;
+  }
+}
+
+/**
+ * @brief fill in an SSID item
+ */
+static void
+ssid_set_item(int index, uint32_t hash, const char * ssid, int ssid_length,
+              uint8_t security, int rssi, int signal_strength, uint8_t channel, uint8_t band,
+              const uint8_t * bssid)
+{
+  ssid_item_t * it = &scan_table.snap->items[index];
+
+  scan_table.hash[index] = hash;
+  memcpy(it->ssid, ssid, ssid_length);
+  it->ssid[ssid_length] = '\0';
+  it->len = ssid_length;
+  it->security = (WIFI_SECURITY_TYPE_NONE != security);
+  it->security_type = security;
+  it->rssi = rssi;
+  it->signal_strength = signal_strength;
+  it->channel = channel;
+  it->band = band;
+  memcpy(it->bssid, bssid, WIFI_MAC_ADDR_LEN);
+}
+
+/**
+ * @brief Add an SSID item to the scan table
+ * @details if the SSID is already in the table the strongest signal is kept.
+ * When the table is full the new SSID replaces the weakest one if it is stronger.
  *
  * @param ssid Pointer to the SSID name
  * @param ssid_length lenght of the SSID name
+ * @param security the security (enum wifi_security_type) of the BSS
  */
 static void
-ssid_add_item(const char * ssid, int ssid_length, bool security, int signal_strength)
+ssid_add_item(const char * ssid, int ssid_length, uint8_t security, int rssi,
+              int signal_strength, uint8_t channel, uint8_t band, const uint8_t * bssid)
 {
-  ssid_item_t * it = NULL;
-  if(NULL != ssid_head) {
-    for(it = ssid_head; NULL != it; it = it->next) {
-      if(0 == strncmp(ssid, it->ssid, ssid_length)) {
-        break;
+  ob_wifi_scan_snapshot_t * snap = scan_table.snap;
+  bool secure = (WIFI_SECURITY_TYPE_NONE != security);
+  uint32_t hash;
+  int i;
+
+  if((NULL == snap) || (ssid_length <= 0) || (ssid_length > WIFI_SSID_MAX_LEN)) {
+    return;
+  }
+  hash = ssid_hash(ssid, ssid_length, secure);
+  for(i = 0; i < snap->count; i++) {
+    ssid_item_t * it = &snap->items[i];
+    if((scan_table.hash[i] == hash) && (it->len == ssid_length) &&
+       (it->security == secure) && (0 == memcmp(it->ssid, ssid, ssid_length))) {
+      if(rssi > it->rssi) {
+        it->security_type = security;
+        it->rssi = rssi;
+        it->signal_strength = signal_strength;
+        it->channel = channel;
+        it->band = band;
+        memcpy(it->bssid, bssid, WIFI_MAC_ADDR_LEN);
+        scan_heap_sift_down(scan_table.heap_pos[i], snap->count);
       }
+      return;
     }
   }
-  if(NULL == it) {
-    it = malloc(sizeof(ssid_item_t));
-    //    LOG_DBG("Malloc %d", (int) sizeof(ssid_item_t));
-    if(NULL == it) {
-      LOG_ERR("Mem alloc failed");
-      return;
+  if(snap->count < CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS) {
+    i = snap->count++;
+    ssid_set_item(i, hash, ssid, ssid_length, security, rssi, signal_strength, channel, band, bssid);
+    scan_table.heap[i] = i;
+    scan_table.heap_pos[i] = i;
+    scan_heap_sift_up(i);
+  } else if(rssi > scan_heap_rssi(0)) {
+    ssid_set_item(scan_table.heap[0], hash, ssid, ssid_length, security, rssi,
+                  signal_strength, channel, band, bssid);
+    scan_heap_sift_down(0, snap->count);
+    snap->dropped++;
+  } else {
+    snap->dropped++;
+  }
+}
+
+/**
+ * @brief link the items of the scan table from the strongest to the weakest
+ * @details the heap is consumed
+ */
+static void
+ssid_link_items(void)
+{
+  ob_wifi_scan_snapshot_t * snap = scan_table.snap;
+  ssid_item_t * it;
+  int count;
+
+  snap->head = NULL;
+  for(count = snap->count; count > 0; count--) {
+    it = &snap->items[scan_table.heap[0]];
+    it->next = snap->head;
+    snap->head = it;
+    scan_heap_swap(0, count - 1);
+    scan_heap_sift_down(0, count - 1);
+  }
+}
+
+/**
+ * @brief initialize the scan table
+ * @details a new snapshot is taken from the pool, the previous one is released
+ *
+ * @return 0 on success
+ * @return -ENOMEM if all the snapshots are in use
+ */
+static int
+ssid_init_list(void)
+{
+  if(NULL == scan_table.snap) {
+    if(k_mem_slab_alloc(&scan_slab, (void **)&scan_table.snap, K_NO_WAIT) < 0) {
+      LOG_ERR("No free scan snapshot");
+      scan_table.snap = NULL;
+      return -ENOMEM;
     }
-    it->next = NULL;
-    it->ssid = malloc(ssid_length +1);
-    LOG_DBG("ssid malloc %d %s", ssid_length +1 , ssid);
-    if(NULL == it->ssid) {
-      LOG_ERR("SSID alloc failed %d", ssid_length);
-      free(it);
-      return;
+  }
+  scan_table.snap->count = 0;
+  scan_table.snap->dropped = 0;
+  scan_table.snap->head = NULL;
+#ifdef CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+  memset(scan_table.snap->bss_count, 0, sizeof(scan_table.snap->bss_count));
+  memset(scan_table.snap->rssi_sum, 0, sizeof(scan_table.snap->rssi_sum));
+#endif // CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+  return 0;
+}
+
+/**
+ * @brief release the snapshot of the scan table
+ */
+static void
+ssid_free_list(void)
+{
+  if(NULL != scan_table.snap) {
+    k_mem_slab_free(&scan_slab, scan_table.snap);
+    scan_table.snap = NULL;
+  }
+}
+
+ob_wifi_scan_snapshot_t *
+ob_wifi_scan_ref(ob_wifi_scan_snapshot_t * snap)
+{
+  if(NULL != snap) {
+    atomic_inc(&snap->refcount);
+  }
+  return snap;
+}
+
+void
+ob_wifi_scan_unref(ob_wifi_scan_snapshot_t * snap)
+{
+  if((NULL != snap) && (1 == atomic_dec(&snap->refcount))) {
+    k_mem_slab_free(&scan_slab, snap);
+  }
+}
+
+/**
+ * @brief check if a scan only covers part of the networks
+ *
+ * @param params the parameters of the scan
+ * @return true if the scan is limited to some SSIDs, bands or channels
+ */
+static bool
+scan_params_partial(const struct wifi_scan_params * params)
+{
+  return ((NULL != params->ssids[0]) && ('\0' != params->ssids[0][0])) ||
+    (0 != params->bands) || (0 != params->band_chan[0].channel);
+}
+
+/**
+ * @brief start a scan
+ * @details must be called with scan_mutex held and no scan in flight.
+ * If the scan cannot be started the subscribers are failed from the
+ * scan timeout work.
+ *
+ * @param params the parameters of the scan, NULL for a full scan with
+ *        the CONFIG_ONBOARDING_WIFI_SCAN_DEFAULT preset
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int
+scan_start_locked(const struct wifi_scan_params * params)
+{
+  struct net_if *iface = net_if_get_wifi_sta();
+  int rc = 0;
+
+  if(NULL == params) {
+    params = &scan_default_params;
+  }
+  scan_in_flight = true;
+  scan_partial = scan_params_partial(params);
+  scan_start_time = k_uptime_get();
+  ob_wifi_timeline_mark(OB_WIFI_TIMELINE_SCAN_START);
+  LOG_DBG("scan iface %s", iface?iface->config.name:"NULL");
+  // TODO why?
+  if(ssid_init_list() < 0) {
+    rc = -1;
+  } else if(!wifi_inited) {
+    LOG_ERR("Wifi not initied");
+    rc = -1;
+  } else if (net_mgmt(NET_REQUEST_WIFI_SCAN, iface, (void *)params, sizeof(*params))) {
+    LOG_ERR("Wifi scan faild");
+    rc = -1;
+  }
+  if(rc < 0) {
+    k_work_reschedule(&scan_timeout_work, K_NO_WAIT);
+  } else {
+    LOG_DBG("Scan started");
+    k_work_reschedule(&scan_timeout_work, K_MSEC(CONFIG_ONBOARDING_WIFI_SCAN_TIMEOUT));
+  }
+  return rc;
+}
+
+/**
+ * @brief complete the scan in flight
+ * @details on success the list of SSIDs becomes the cached snapshot. All the
+ * waiting subscribers are called with the new snapshot, or NULL on failure.
+ *
+ * @param success true if the scan completed successfully
+ */
+static void
+scan_finish(bool success)
+{
+  sys_slist_t done;
+  struct ob_wifi_scan_subscriber *sub;
+  struct ob_wifi_scan_subscriber *tmp;
+  ob_wifi_scan_snapshot_t *snap = NULL;
+
+  k_mutex_lock(&scan_mutex, K_FOREVER);
+  if(!scan_in_flight) {
+    k_mutex_unlock(&scan_mutex);
+    return;
+  }
+  scan_in_flight = false;
+  k_work_cancel_delayable(&scan_timeout_work);
+  ob_wifi_timeline_mark(OB_WIFI_TIMELINE_SCAN_DONE);
+  if(success && (NULL != scan_table.snap)) {
+    ssid_link_items();
+    snap = scan_table.snap;
+    scan_table.snap = NULL;
+    snap->timestamp = k_uptime_get();
+    snap->duration_ms = (int32_t)(snap->timestamp - scan_start_time);
+    if(snap->dropped > 0) {
+      LOG_DBG("Scan kept %d SSIDs, dropped %d", snap->count, snap->dropped);
     }
-    strncpy(it->ssid, ssid, ssid_length);
+    if(scan_partial) {
+      /* Only part of the networks were scanned, do not cache the results */
+      atomic_set(&snap->refcount, 1);
+    } else {
+      /* One reference for the cache and one for the subscribers */
+      atomic_set(&snap->refcount, 2);
+      ob_wifi_scan_unref(scan_cache);
+      scan_cache = snap;
+    }
+  }
+  ssid_free_list();
+  done = scan_subscribers;
+  sys_slist_init(&scan_subscribers);
+  k_mutex_unlock(&scan_mutex);
 
-    it->ssid[ssid_length] = '\0';
-    it->len = ssid_length;
-    it->security = security;
-    it->signal_strength = signal_strength;
+  SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&done, sub, tmp, node) {
+    (*sub->callback)(snap, sub->user_data);
+  }
+  ob_wifi_scan_unref(snap);
 
-    if(NULL == ssid_head) {
-      ssid_head = it;
-      ssid_tail = it;
+  k_mutex_lock(&scan_mutex, K_FOREVER);
+  if(!scan_in_flight && !sys_slist_is_empty(&scan_pending)) {
+    LOG_DBG("Starting the full scan waited for");
+    sys_slist_merge_slist(&scan_subscribers, &scan_pending);
+    scan_start_locked(NULL);
+  }
+  k_mutex_unlock(&scan_mutex);
+}
+
+/**
+ * @brief fails a scan that could not be started or did not complete
+ * @param work The delayed work structure
+ */
+static void scan_timeout_handler(struct k_work *work)
+{
+  ARG_UNUSED(work);
+  LOG_WRN("Wifi scan failed or timed out");
+  scan_finish(false);
+}
+
+int
+ob_wifi_scan_subscribe(struct ob_wifi_scan_subscriber * sub)
+{
+  ob_wifi_scan_snapshot_t *snap = NULL;
+  int rc = 0;
+
+  if((NULL == sub) || (NULL == sub->callback)) {
+    return -1;
+  }
+  k_mutex_lock(&scan_mutex, K_FOREVER);
+  if((NULL != scan_cache) &&
+     ((k_uptime_get() - scan_cache->timestamp) < CONFIG_ONBOARDING_WIFI_SCAN_CACHE_TTL)) {
+    snap = ob_wifi_scan_ref(scan_cache);
+  } else {
+    if(scan_in_flight && scan_partial) {
+      LOG_DBG("Waiting for the partial scan in flight");
+      sys_slist_append(&scan_pending, &sub->node);
     } else {
-      ssid_tail->next = it;
-      ssid_tail = it;
+      sys_slist_append(&scan_subscribers, &sub->node);
+      if(!scan_in_flight) {
+        rc = scan_start_locked(NULL);
+      } else {
+        LOG_DBG("Joining scan in flight");
+      }
     }
   }
+  k_mutex_unlock(&scan_mutex);
+
+  if(NULL != snap) {
+    LOG_DBG("Scan served from cache");
+    (*sub->callback)(snap, sub->user_data);
+    ob_wifi_scan_unref(snap);
+  }
+  return rc;
+}
+
+int
+ob_wifi_scan_ex(struct ob_wifi_scan_subscriber * sub,
+                const struct wifi_scan_params * params)
+{
+  int rc;
+
+  if((NULL == sub) || (NULL == sub->callback) || (NULL == params)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&scan_mutex, K_FOREVER);
+  if(scan_in_flight) {
+    rc = -EBUSY;
+  } else {
+    sys_slist_append(&scan_subscribers, &sub->node);
+    rc = scan_start_locked(params);
+  }
+  k_mutex_unlock(&scan_mutex);
+  return rc;
 }
+
+int
+ob_wifi_scan_preset_params(ob_wifi_scan_preset_t preset, const char * ssid,
+                           const struct ob_wifi_bss * bss,
+                           struct wifi_scan_params * params)
+{
+  memset(params, 0, sizeof(*params));
+  switch(preset) {
+  case OB_WIFI_SCAN_PRESET_FULL:
+    break;
+
+  case OB_WIFI_SCAN_PRESET_PORTAL_QUICK:
+    params->scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    params->dwell_time_active = CONFIG_ONBOARDING_WIFI_SCAN_QUICK_DWELL;
+    params->max_bss_cnt = CONFIG_ONBOARDING_WIFI_SCAN_MAX_RESULTS;
+    break;
+
+  case OB_WIFI_SCAN_PRESET_PASSIVE:
+    params->scan_type = WIFI_SCAN_TYPE_PASSIVE;
+    params->dwell_time_passive = CONFIG_ONBOARDING_WIFI_SCAN_PASSIVE_DWELL;
+    break;
+
+  case OB_WIFI_SCAN_PRESET_RECONNECT_TARGETED:
+    if((NULL == ssid) || ('\0' == ssid[0])) {
+      return -EINVAL;
+    }
+    params->scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    params->ssids[0] = ssid;
+    params->dwell_time_active = CONFIG_ONBOARDING_WIFI_SCAN_TARGETED_DWELL;
+    if((NULL != bss) && (0 != bss->channel)) {
+      params->band_chan[0].band = bss->band;
+      params->band_chan[0].channel = bss->channel;
+    }
+    break;
+
+  case OB_WIFI_SCAN_PRESET_ROAM_BACKGROUND:
+    if((NULL == ssid) || ('\0' == ssid[0])) {
+      return -EINVAL;
+    }
+    params->scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    params->ssids[0] = ssid;
+    params->dwell_time_active = CONFIG_ONBOARDING_WIFI_SCAN_TARGETED_DWELL;
+#ifdef CONFIG_ONBOARDING_WIFI_ROAM
+    if(sizeof(CONFIG_ONBOARDING_WIFI_ROAM_CHANNELS) > 1) {
+      char channels[] = CONFIG_ONBOARDING_WIFI_ROAM_CHANNELS;
+
+      if(wifi_utils_parse_scan_chan(channels, params->band_chan,
+                                    ARRAY_SIZE(params->band_chan)) < 0) {
+        LOG_ERR("Invalid roaming channels %s", CONFIG_ONBOARDING_WIFI_ROAM_CHANNELS);
+        memset(params->band_chan, 0, sizeof(params->band_chan));
+      }
+    }
+#endif // CONFIG_ONBOARDING_WIFI_ROAM
+    if((0 == params->band_chan[0].channel) && (NULL != bss)) {
+      params->bands = BIT(bss->band);
+    }
+    break;
+
+  default:
+    return -EINVAL;
+  }
+  return 0;
+}
+
+const char *
+ob_wifi_scan_preset_name(ob_wifi_scan_preset_t preset)
+{
+  if(((int)preset < 0) || (preset >= OB_WIFI_SCAN_PRESET_COUNT)) {
+    return "unknown";
+  }
+  return scan_preset_names[preset];
+}
+
+int
+ob_wifi_scan_preset_find(const char * name)
+{
+  for(int i = 0; i < OB_WIFI_SCAN_PRESET_COUNT; i++) {
+    if(0 == strcmp(name, scan_preset_names[i])) {
+      return i;
+    }
+  }
+  return -ENOENT;
+}
+
+/**
+ * @brief the state of a thread waiting in ob_wifi_scan_get()
+ */
+struct scan_waiter {
+  /** @brief the subscription */
+  struct ob_wifi_scan_subscriber sub;
+  /** @brief released when the callback has been called */
+  struct k_sem sem;
+  /** @brief the snapshot delivered, with a reference held */
+  ob_wifi_scan_snapshot_t *snap;
+};
+
 /**
- * @brief initialize the list of SSIDs
- * @details the previous list is erased
+ * @brief the subscriber callback of ob_wifi_scan_get()
  */
+static void scan_waiter_callback(ob_wifi_scan_snapshot_t * snap, void * user_data)
+{
+  struct scan_waiter *waiter = user_data;
+
+  waiter->snap = ob_wifi_scan_ref(snap);
+  k_sem_give(&waiter->sem);
+}
+
+int
+ob_wifi_scan_get(ob_wifi_scan_snapshot_t ** snap, k_timeout_t timeout)
+{
+  struct scan_waiter waiter;
+  bool removed;
+
+  k_sem_init(&waiter.sem, 0, 1);
+  waiter.snap = NULL;
+  waiter.sub.callback = scan_waiter_callback;
+  waiter.sub.user_data = &waiter;
+  ob_wifi_scan_subscribe(&waiter.sub);
+
+  if(k_sem_take(&waiter.sem, timeout) < 0) {
+    k_mutex_lock(&scan_mutex, K_FOREVER);
+    removed = sys_slist_find_and_remove(&scan_subscribers, &waiter.sub.node) ||
+      sys_slist_find_and_remove(&scan_pending, &waiter.sub.node);
+    k_mutex_unlock(&scan_mutex);
+    if(!removed) {
+      /* The scan completed while timing out, the callback is being called */
+      k_sem_take(&waiter.sem, K_FOREVER);
+      ob_wifi_scan_unref(waiter.snap);
+    }
+    return -EAGAIN;
+  }
+  if(NULL == waiter.snap) {
+    return -EIO;
+  }
+  *snap = waiter.snap;
+  return 0;
+}
+
+enum wifi_security_type
+ob_wifi_scan_security(const char * ssid)
+{
+  enum wifi_security_type security = WIFI_SECURITY_TYPE_UNKNOWN;
+  ssid_item_t * it;
+
+  k_mutex_lock(&scan_mutex, K_FOREVER);
+  // The items are linked strongest first, an SSID listed both open and
+  // secure takes the security of its strongest BSS
+  for(it = (NULL != scan_cache) ? scan_cache->head : NULL; NULL != it; it = it->next) {
+    if(0 == strcmp(it->ssid, ssid)) {
+      security = it->security_type;
+      break;
+    }
+  }
+  k_mutex_unlock(&scan_mutex);
+  return security;
+}
+
+int
+ob_wifi_save_credentials(const char * ssid, const char * psk)
+{
+  int rc;
+
+  if((rc = ob_wifi_profile_add(ssid, psk, OB_WIFI_PROFILE_PRIORITY_DEFAULT)) < 0) {
+    LOG_ERR("Unable to save the profile of %s %d", ssid, rc);
+    return rc;
+  }
+  ob_wifi_profiles_changed();
+  return 0;
+}
+
 void
-ssid_init_list(void)
+ob_wifi_profiles_changed(void)
 {
-  ssid_free_item(ssid_head);
-  ssid_head = NULL;
-  ssid_tail = NULL;
+  if(connect_wq_started) {
+    bringup_kick();
+  }
 }
 
+/**
+ * @brief Mark the station online once it has an address
+ */
+static void
+ipv4_bound(void)
+{
+  ob_wifi_timeline_mark(OB_WIFI_TIMELINE_DHCP_BOUND);
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+  ob_wifi_link_restored();
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+  k_event_post(&wifi_events, OB_WIFI_EVENT_STA_CONNECTED);
+  connect_event(CONNECT_EV_BOUND, 0);
+  bringup_kick();
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+  ob_wifi_ps_connected();
+#endif // CONFIG_ONBOARDING_WIFI_PS
+#ifdef CONFIG_ONBOARDING_WIFI_AP
+  // The client of the AP is told the station is online before the AP goes away
+  if(ob_wifi_HasAP()) {
+    k_work_reschedule_for_queue(&connect_wq, &stop_ap_work, K_MSEC(CONFIG_ONBOARDING_WIFI_AP_GRACE));
+  }
+#endif // CONFIG_ONBOARDING_WIFI_AP
+}
+
+#ifdef CONFIG_ONBOARDING_WIFI_LEASE
+/**
+ * @brief Read the SSID of the current association
+ *
+ * @param iface the station interface
+ * @param[out] ssid the SSID, NUL terminated
+ * @return true if the station is associated
+ */
+static bool
+lease_current_ssid(struct net_if * iface, char ssid[WIFI_SSID_MAX_LEN + 1])
+{
+  struct wifi_iface_status status = { 0 };
+
+  if(net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface, &status, sizeof(status)) ||
+     (status.ssid_len <= 0) || (status.ssid_len > WIFI_SSID_MAX_LEN)) {
+    return false;
+  }
+  memcpy(ssid, status.ssid, status.ssid_len);
+  ssid[status.ssid_len] = '\0';
+  return true;
+}
+
+/**
+ * @brief Report the result of the saved lease from connect_wq
+ *
+ * @param iface the station interface
+ * @param result 0 if the saved address was acknowledged, a negative errno otherwise
+ */
+static void lease_result_cb(struct net_if * iface, int result)
+{
+  ARG_UNUSED(iface);
+  atomic_set(&lease_result, result);
+  k_work_submit_to_queue(&connect_wq, &lease_result_work);
+}
+
+/**
+ * @brief Report the saved lease acknowledged, or start the DHCP client
+ * @details the client discovers a new lease when the saved one was refused,
+ * not answered or lost while renewing it
+ * @param work The work structure
+ */
+static void lease_result_work_handler(struct k_work * work)
+{
+  ARG_UNUSED(work);
+  if(0 == atomic_get(&lease_result)) {
+    ipv4_bound();
+  } else {
+    net_dhcpv4_start(net_if_get_wifi_sta());
+  }
+}
+
+/**
+ * @brief Request the saved lease, or start the DHCP client
+ * @details the request does not block, lease_result_cb() is called with its result
+ * @param work The work structure
+ */
+static void lease_start_work_handler(struct k_work * work)
+{
+  struct net_if *iface = net_if_get_wifi_sta();
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+
+  ARG_UNUSED(work);
+  if(!lease_current_ssid(iface, ssid) || (ob_wifi_lease_reboot(iface, ssid, lease_result_cb) < 0)) {
+    net_dhcpv4_start(iface);
+  }
+}
+
+/**
+ * @brief Save the lease bound by the DHCP client
+ * @details runs on the system work queue to keep flash writes off the net_mgmt thread
+ * @param work The work structure
+ */
+static void lease_save_work_handler(struct k_work * work)
+{
+  struct net_if *iface = net_if_get_wifi_sta();
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+
+  ARG_UNUSED(work);
+  if(lease_current_ssid(iface, ssid)) {
+    ob_wifi_lease_bound(iface, ssid);
+  }
+}
+#endif // CONFIG_ONBOARDING_WIFI_LEASE
+
 /**
  * @brief call back for IPV4 management events
  *
@@ -247,13 +1225,16 @@ static void ipv4_mgmt_event_handler(struct net_mgmt_event_callback *cb,
       LOG_ERR("DHCP  request failed (%d)(%d:%d:%d)", status->status, status->conn_status, status->disconn_reason, status->ap_status);
     } else {
       LOG_INF("DHCP bound");
-      wifi_connect_status_succeded = true;
-      k_sem_give(&wifi_connect_sem);
+#ifdef CONFIG_ONBOARDING_WIFI_LEASE
+      k_work_submit(&lease_save_work);
+#endif // CONFIG_ONBOARDING_WIFI_LEASE
+      ipv4_bound();
     }
     break;
 
   case NET_EVENT_IPV4_DHCP_START:
     LOG_DBG("DHCP started");
+    ob_wifi_timeline_mark(OB_WIFI_TIMELINE_DHCP_START);
     break;
 
   case NET_EVENT_IPV4_DHCP_STOP:
@@ -267,6 +1248,7 @@ static void ipv4_mgmt_event_handler(struct net_mgmt_event_callback *cb,
 
       zsock_inet_ntop(AF_INET, in, buffer, sizeof(struct in_addr));
       LOG_DBG("Address add (%s)", buffer);
+      ob_wifi_timeline_mark(OB_WIFI_TIMELINE_ADDR_ADD);
       if(NULL != address_add_callback) {
         (*address_add_callback)();
       }
@@ -305,9 +1287,15 @@ static void ethernet_mgmt_event_handler(struct net_mgmt_event_callback *cb,
   switch (mgmt_event) {
   case NET_EVENT_ETHERNET_CARRIER_ON:
     LOG_INF("Ethernet carrier on");
+#ifdef CONFIG_ONBOARDING_WIFI_LINK_ETHERNET
+    ob_wifi_link_carrier(iface, true);
+#endif // CONFIG_ONBOARDING_WIFI_LINK_ETHERNET
     break;
   case NET_EVENT_ETHERNET_CARRIER_OFF:
     LOG_INF("Ethernet carrier off");
+#ifdef CONFIG_ONBOARDING_WIFI_LINK_ETHERNET
+    ob_wifi_link_carrier(iface, false);
+#endif // CONFIG_ONBOARDING_WIFI_LINK_ETHERNET
     break;
   default:
     LOG_ERR("Unhandled ethernet mgmt event 0x%llx", mgmt_event);
@@ -315,37 +1303,120 @@ static void ethernet_mgmt_event_handler(struct net_mgmt_event_callback *cb,
   }
 }
 
-static void handle_wifi_scan_result(struct net_mgmt_event_callback *cb)
+/**
+ * @brief Copy a scan result into the scan ring
+ * @details runs in the net_mgmt callback, the result is added to the scan
+ * table by scan_drain_handler(). The result is dropped if the ring is full.
+ *
+ * @param cb The network management callback structure
+ */
+static void handle_wifi_scan_result(struct net_mgmt_event_callback *cb)
+{
+  const struct wifi_scan_result *entry =
+    (const struct wifi_scan_result *)cb->info;
+  atomic_val_t head = atomic_get(&scan_ring.head);
+  struct scan_ring_entry *slot;
+
+  if(head - atomic_get(&scan_ring.tail) >= CONFIG_ONBOARDING_WIFI_SCAN_RING) {
+    atomic_inc(&scan_ring.overflows);
+    return;
+  }
+  slot = &scan_ring.entries[head & (CONFIG_ONBOARDING_WIFI_SCAN_RING - 1)];
+  slot->ssid_length = MIN(entry->ssid_length, WIFI_SSID_MAX_LEN);
+  memcpy(slot->ssid, entry->ssid, slot->ssid_length);
+  memcpy(slot->bssid, entry->mac, WIFI_MAC_ADDR_LEN);
+  slot->security = entry->security;
+  slot->rssi = entry->rssi;
+  slot->channel = entry->channel;
+  slot->band = entry->band;
+  atomic_set(&scan_ring.head, head + 1);
+  // Already queued while a batch builds up, queued again if it is draining
+  k_work_submit_to_queue(&connect_wq, &scan_drain_work);
+}
+
+static void handle_wifi_scan_done(struct net_mgmt_event_callback *cb)
+{
+  const struct wifi_status *status = (const struct wifi_status *)cb->info;
+
+  LOG_DBG("Wifi scan done %d", status->status);
+  // Completed by the drain work once the results before it are in the table
+  atomic_set(&scan_ring.done, (0 == status->status) ? 1 : 2);
+  k_work_submit_to_queue(&connect_wq, &scan_drain_work);
+}
+
+#ifdef CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+/**
+ * @brief Count a BSS on its 2.4 GHz channel, called with scan_mutex held
+ * @details every result is counted, several BSSes of a network on
+ * different channels all load their channel
+ *
+ * @param snap the snapshot being filled
+ * @param slot the scan result
+ */
+static void
+scan_count_bss(ob_wifi_scan_snapshot_t * snap, const struct scan_ring_entry * slot)
 {
-  const struct wifi_scan_result *entry =
-    (const struct wifi_scan_result *)cb->info;
-  // There are obviously more sophistocated ways to convert RSSI
-  // into a 0-1-- scale signal strength, but this is good enough for the
-  // onboarding ui.
-  int strength = entry->rssi + 130;
-  if (strength > 100) {
-	  strength = 100;
+  int i = slot->channel - 1;
+
+  if((WIFI_FREQ_BAND_2_4_GHZ != slot->band) || (i < 0) || (i >= OB_WIFI_CHANNELS_2_4_GHZ) ||
+     (snap->bss_count[i] == UINT8_MAX)) {
+    return;
   }
-  ssid_add_item(entry->ssid,
-	        entry->ssid_length,
-	        (entry->security == WIFI_SECURITY_TYPE_NONE ? 0 : 1),
-	        strength);
+  snap->bss_count[i]++;
+  snap->rssi_sum[i] += MAX(slot->rssi + 100, 0);
 }
+#endif // CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
 
-static void handle_wifi_scan_done(struct net_mgmt_event_callback *cb)
+/**
+ * @brief Add the results of the scan ring to the scan table
+ * @details the results are added in one batch under scan_mutex. A pending
+ * scan done event completes the scan afterwards.
+ *
+ * @param work the scan_drain_work structure
+ */
+static void scan_drain_handler(struct k_work *work)
 {
-  LOG_DBG("Wifi scan done");
-  if(NULL != done_callback) {
-    (*done_callback)(ssid_head);
+  static atomic_val_t overflows_seen = 0;
+  atomic_val_t done = atomic_clear(&scan_ring.done);
+  atomic_val_t tail = atomic_get(&scan_ring.tail);
+  atomic_val_t head = atomic_get(&scan_ring.head);
+  atomic_val_t overflows = atomic_get(&scan_ring.overflows);
+  struct scan_ring_entry *slot;
+
+  ARG_UNUSED(work);
+  k_mutex_lock(&scan_mutex, K_FOREVER);
+  for(; tail != head; tail++) {
+    slot = &scan_ring.entries[tail & (CONFIG_ONBOARDING_WIFI_SCAN_RING - 1)];
+    if(scan_in_flight) {
+#ifdef CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+      if(NULL != scan_table.snap) {
+        scan_count_bss(scan_table.snap, slot);
+      }
+#endif // CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+      // There are obviously more sophistocated ways to convert RSSI
+      // into a 0-1-- scale signal strength, but this is good enough for the
+      // onboarding ui.
+      ssid_add_item(slot->ssid, slot->ssid_length, slot->security, slot->rssi,
+                    MIN(slot->rssi + 130, 100), slot->channel, slot->band, slot->bssid);
+    }
+    atomic_set(&scan_ring.tail, tail + 1);
   }
-  else {
-	  LOG_ERR("Error: done_callback is NULL!");
+  if(scan_in_flight && (NULL != scan_table.snap)) {
+    scan_table.snap->dropped += overflows - overflows_seen;
   }
+  overflows_seen = overflows;
+  k_mutex_unlock(&scan_mutex);
 
-  ssid_init_list();
+  if(0 != done) {
+    scan_finish(1 == done);
+  }
 }
 
-
+uint32_t
+ob_wifi_scan_overflows(void)
+{
+  return (uint32_t)atomic_get(&scan_ring.overflows);
+}
 
 /**
  * @brief Callback for wifi network management events
@@ -357,13 +1428,15 @@ static void handle_wifi_scan_done(struct net_mgmt_event_callback *cb)
 static void ob_wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
                                     uint64_t mgmt_event, struct net_if *iface)
 {
-  LOG_DBG("Got event 0x%llx", mgmt_event);
   const struct wifi_status *status =
 		(const struct wifi_status *)cb->info;
-  switch (mgmt_event) {
-  case NET_EVENT_WIFI_SCAN_RESULT:
+  if(NET_EVENT_WIFI_SCAN_RESULT == mgmt_event) {
+    // Scan results come in bursts, they are neither logged nor processed here
     handle_wifi_scan_result(cb);
-    break;
+    return;
+  }
+  LOG_DBG("Got event 0x%llx", mgmt_event);
+  switch (mgmt_event) {
 
   case NET_EVENT_WIFI_SCAN_DONE:
     handle_wifi_scan_done(cb);
@@ -373,23 +1446,43 @@ static void ob_wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
     LOG_INF("Iface status for %s", ((const struct wifi_iface_status *)(cb->info))->ssid);
     break;
 
+  case NET_EVENT_WIFI_TWT:
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+    ob_wifi_ps_twt_event((const struct wifi_twt_params *)cb->info);
+#endif // CONFIG_ONBOARDING_WIFI_PS
+    break;
+
+  case NET_EVENT_WIFI_TWT_SLEEP_STATE:
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+    ob_wifi_ps_twt_sleep(*(const int *)cb->info);
+#endif // CONFIG_ONBOARDING_WIFI_PS
+    break;
+
   case NET_EVENT_WIFI_CONNECT_RESULT:
     LOG_DBG("Wifi Connect result %s", iface->config.name);
 
     if (status->status) {
       LOG_ERR("Connect result request failed (%d)(%d:%d:%d)", status->status, status->conn_status, status->disconn_reason, status->ap_status);
-      wifi_connect_status_succeded = false;
-      k_sem_give(&wifi_connect_sem);
+      connect_result_time = k_uptime_get();
+      ob_wifi_timeline_mark(OB_WIFI_TIMELINE_CONNECT_RESULT);
+      connect_event(CONNECT_EV_FAILED, status->status);
     } else {
       LOG_INF("WIFI Connected");
-#ifndef CONFIG_ESP32_STA_AUTO_DHCP
-      net_dhcpv4_start(iface);
+      connect_result_time = k_uptime_get();
+      ob_wifi_timeline_mark(OB_WIFI_TIMELINE_CONNECT_RESULT);
+      connect_event(CONNECT_EV_ASSOCIATED, 0);
+#ifdef CONFIG_ONBOARDING_WIFI_FAST_CONNECT
+      k_work_submit(&save_bss_work);
+#endif
+      if(0 == ob_wifi_ipv4_apply(iface)) {
+        ipv4_bound();
+      } else {
+#if defined(CONFIG_ONBOARDING_WIFI_LEASE)
+        k_work_submit_to_queue(&connect_wq, &lease_start_work);
+#elif !defined(CONFIG_ESP32_STA_AUTO_DHCP)
+        net_dhcpv4_start(iface);
 #endif
-#ifdef CONFIG_ONBOARDING_WIFI_AP
-      if(ob_wifi_HasAP()) {
-        ob_wifi_ap_disable();
       }
-#endif // CONFIG_ONBOARDING_WIFI_AP
     }
     break;
 
@@ -399,8 +1492,21 @@ static void ob_wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
     ready_led_color(255,0,0);
     ready_led_set(READY_LED_PANIC);
 #endif
-    wifi_connect_status_succeded = false;
-    k_sem_give(&wifi_connect_sem);
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+    if(k_event_test(&wifi_events, OB_WIFI_EVENT_STA_CONNECTED)) {
+      ob_wifi_link_lost();
+    }
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+    k_event_clear(&wifi_events, OB_WIFI_EVENT_STA_CONNECTED);
+#ifdef CONFIG_ONBOARDING_WIFI_LEASE
+    ob_wifi_lease_stop();
+#endif // CONFIG_ONBOARDING_WIFI_LEASE
+    connect_event(CONNECT_EV_DISCONNECTED, status->disconn_reason);
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+    if(connect_wq_started) {
+      bringup_kick();
+    }
+#endif // CONFIG_ONBOARDING_WIFI_LINK
     break;
 
   case NET_EVENT_WIFI_DISCONNECT_COMPLETE:
@@ -434,10 +1540,16 @@ static void ob_wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
 
   case NET_EVENT_WIFI_AP_STA_CONNECTED:
     LOG_INF("STA connected to AP");
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+    ob_wifi_ap_pool_station(((const struct wifi_ap_sta_info *)cb->info)->mac, true);
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
     break;
 
   case NET_EVENT_WIFI_AP_STA_DISCONNECTED:
     LOG_INF("STA disconnected from AP");
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+    ob_wifi_ap_pool_station(((const struct wifi_ap_sta_info *)cb->info)->mac, false);
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
     break;
 
   default:
@@ -450,6 +1562,7 @@ static void ob_wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
                           NET_EVENT_WIFI_SCAN_DONE           | \
                           NET_EVENT_WIFI_IFACE_STATUS        | \
                           NET_EVENT_WIFI_TWT                 | \
+                          NET_EVENT_WIFI_TWT_SLEEP_STATE     | \
                           NET_EVENT_WIFI_RAW_SCAN_RESULT     | \
                           NET_EVENT_WIFI_CONNECT_RESULT      | \
                           NET_EVENT_WIFI_DISCONNECT_RESULT   | \
@@ -461,6 +1574,7 @@ static void ob_wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
 
 /** @brief a bit mask of the IPV4 manangement events to recieve */
 #define IPV4_MGMT_EVENTS ( \
+                           NET_EVENT_IPV4_DHCP_START | \
                            NET_EVENT_IPV4_DHCP_BOUND | \
                            NET_EVENT_IPV4_ADDR_ADD   | \
                            NET_EVENT_IPV4_ADDR_DEL)
@@ -470,27 +1584,16 @@ static void ob_wifi_mgmt_event_handler(struct net_mgmt_event_callback *cb,
                           NET_EVENT_ETHERNET_CARRIER_ON | \
                           NET_EVENT_ETHERNET_CARRIER_OFF)
 
-int
-ob_wifi_init(void)
-{
-#ifdef CONFIG_ONBOARDING_WIFI_AP
-  char mac_addr_buf[18];
-  char * mad = NULL;
-  char ssid_suffix[7];
-#endif // CONFIG_ONBOARDING_WIFI_AP
-
 #ifdef CONFIG_NET_HOSTNAME_DYNAMIC
+/**
+ * @brief Set the hostname saved in NVS
+ */
+static void
+bringup_load_hostname(void)
+{
   int len;
   char hostname[NET_HOSTNAME_MAX_LEN];
-#endif
-
-  if(ob_nvs_data_init() < 0) {
-    return -1;
-  }
-
-  wifi_inited=true;
 
-#ifdef CONFIG_NET_HOSTNAME_DYNAMIC
   /* Only read the hostname if the app has set dynamic hostnames */
   if((len = ob_nvs_data_read(NVS_SETTINGS_ID_HOSTNAME, hostname, sizeof(hostname))) <= 0) {
     LOG_WRN("Unable to read hostname %d setting to %s", len, net_hostname_get());
@@ -502,24 +1605,21 @@ ob_wifi_init(void)
       LOG_DBG("Hostname set to %s", hostname);
     }
   }
-#endif
-
-  net_mgmt_init_event_callback(&wifi_mgmt_cb,
-                               ob_wifi_mgmt_event_handler,
-                               WIFI_MGMT_EVENTS);
-
-  net_mgmt_add_event_callback(&wifi_mgmt_cb);
-  net_mgmt_init_event_callback(&ipv4_mgmt_cb,
-                               ipv4_mgmt_event_handler,
-                               IPV4_MGMT_EVENTS);
-
-  net_mgmt_add_event_callback(&ipv4_mgmt_cb);
+}
+#endif // CONFIG_NET_HOSTNAME_DYNAMIC
 
-  net_mgmt_init_event_callback(&ethernet_mgmt_cb,
-                               ethernet_mgmt_event_handler,
-                               ETHERNET_MGMT_EVENTS);
-  net_mgmt_add_event_callback(&ethernet_mgmt_cb);
 #ifdef CONFIG_ONBOARDING_WIFI_AP
+/**
+ * @brief Name the device AP after the MAC address and start it
+ * @details the AP is brought up on the system work queue
+ */
+static void
+bringup_start_ap(void)
+{
+  char mac_addr_buf[18];
+  char * mad = NULL;
+  char ssid_suffix[7];
+
 #ifndef CONFIG_ONBOARDING_WIFI_AP_ADDRESS
   #error "No AP IP Address configured"
 #endif
@@ -542,47 +1642,459 @@ ob_wifi_init(void)
   LOG_DBG("got mac %s", wifi_ap_ssid);
   strcpy(wifi_ap_psk, CONFIG_ONBOARDING_WIFI_AP_PSK);
 
-
-  k_work_init_delayable(&start_ap_work,bws_start_ap_work);
   // Start the AP
   ob_wifi_ap_enable();
   LOG_DBG("AP enabled");
-#endif //CONFIG_ONBOARDING_AP
-  bool needSTA = false;
-  if((gSSID_len = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_SSID, gSSID, sizeof(gSSID))) <= 0) {
-    LOG_ERR("Unable to read SSID");
-#ifdef CONFIG_ONBOARDING_PRECONFIG_WIFI
-    strncpy(gSSID, CONFIG_ONBOARDING_WIFI_SSID, WIFI_SSID_MAX_LEN);
-    gSSID_len =strlen(gSSID);
-    LOG_ERR("Setting SSID to %s", gSSID);
-#else // CONFIG_PRECONFIG_WIFI
-    needSTA = true;
-#endif // CONFIG_ONBOARDING_PRECONFIG_WIFI
+}
+#endif // CONFIG_ONBOARDING_WIFI_AP
+
+/**
+ * @brief Set the credentials of the most recently connected profile
+ * @details ob_wifi_connect() and the shell use the published credentials
+ * @param profile the profile
+ */
+static void
+bringup_set_credentials(const struct ob_wifi_profile * profile)
+{
+  ob_wifi_config_publish(profile->ssid, profile->psk);
+}
+
+/**
+ * @brief completion callback of the connections started by the bring-up
+ *
+ * @param result the outcome of the connection
+ * @param user_data unused
+ */
+static void
+bringup_connect_done(const struct ob_wifi_connect_result * result, void * user_data)
+{
+  ARG_UNUSED(user_data);
+  if(OB_WIFI_CONNECT_OK == result->reason) {
+    LOG_DBG("Wifi Connect succeeded");
+  } else {
+    LOG_ERR("Wifi Connect failed: %s", ob_wifi_connect_reason_str(result->reason));
   }
+  atomic_set(&bringup.status, result->status);
+  atomic_set(&bringup.result, result->reason + 1);
+  bringup_kick();
+}
 
-  if((gPSK_len = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_PSK, gPSK, sizeof(gPSK))) <= 0) {
-    LOG_ERR("Unable to read PSK");
-#ifdef CONFIG_ONBOARDING_PRECONFIG_WIFI
-    strncpy(gPSK, CONFIG_ONBOARDING_WIFI_PSK, WIFI_PSK_MAX_LEN);
-    gPSK_len = strlen(gPSK);
-#else // CONFIG_PRECONFIG_WIFI
-    needSTA = true;
-#endif // CONFIG_ONBOARDING_RECONFIG_WIFI
-  }
-  if( needSTA ) {
-    LOG_DBG("needs STA");
+/**
+ * @brief scan callback, ranks the profiles against the results
+ *
+ * @param snap the scan results, NULL if the scan failed
+ * @param user_data unused
+ */
+static void
+bringup_scan_done(ob_wifi_scan_snapshot_t * snap, void * user_data)
+{
+  ARG_UNUSED(user_data);
+  bringup.num = ob_wifi_profile_rank(snap, bringup.order, ARRAY_SIZE(bringup.order));
+  atomic_set(&bringup.ranked, 1);
+  bringup_kick();
+}
+
+/**
+ * @brief Load the configuration and start the AP
+ * @param obj the bring-up state machine
+ */
+static void
+bringup_load_entry(void * obj)
+{
+  ARG_UNUSED(obj);
+#ifdef CONFIG_NET_HOSTNAME_DYNAMIC
+  bringup_load_hostname();
+#endif // CONFIG_NET_HOSTNAME_DYNAMIC
 #ifdef CONFIG_ONBOARDING_WIFI_AP
-    LOG_ERR("take wifi_AP_sem %d %d %p", wifi_ap_sem.count, wifi_ap_sem.limit,  sys_dlist_peek_head(&wifi_ap_sem.wait_q.waitq));
-    k_sem_take(&wifi_ap_sem, K_FOREVER);
+  bringup_start_ap();
 #endif // CONFIG_ONBOARDING_WIFI_AP
+}
+
+/**
+ * @brief Connect the station if it has profiles, wait for them otherwise
+ * @param obj the bring-up state machine
+ */
+static enum smf_state_result
+bringup_load_run(void * obj)
+{
+  struct ob_wifi_profile profile;
+  int count = ob_wifi_profile_load();
+  int index;
+
+  ob_wifi_ipv4_load();
+#ifdef CONFIG_ONBOARDING_PRECONFIG_WIFI
+  if(0 == count) {
+    LOG_WRN("No profiles, adding %s", CONFIG_ONBOARDING_WIFI_SSID);
+    if(ob_wifi_profile_add(CONFIG_ONBOARDING_WIFI_SSID, CONFIG_ONBOARDING_WIFI_PSK,
+                           OB_WIFI_PROFILE_PRIORITY_DEFAULT) >= 0) {
+      count = 1;
+    }
+  }
+#endif // CONFIG_ONBOARDING_PRECONFIG_WIFI
+  LOG_DBG("%d wifi profiles", count);
+  if(((index = ob_wifi_profile_most_recent()) >= 0) &&
+     (0 == ob_wifi_profile_get(index, &profile))) {
+    bringup_set_credentials(&profile);
+    memset(&profile, 0, sizeof(profile));
+  }
+  k_event_post(&wifi_events, OB_WIFI_EVENT_CONFIG_LOADED);
+  smf_set_state(SMF_CTX(obj), &bringup_states[(count > 0) ? BRINGUP_CONNECT : BRINGUP_PROVISION]);
+  return SMF_EVENT_HANDLED;
+}
+
+/**
+ * @brief Start with the profile that connected last, without a scan
+ * @param obj the bring-up state machine
+ */
+static void
+bringup_connect_entry(void * obj)
+{
+  ARG_UNUSED(obj);
+  LOG_DBG("Connecting");
+  bringup.num = 0;
+  bringup.next = 0;
+  bringup.rounds = 0;
+  bringup.retry_at = 0;
+  bringup.scanning = false;
+  bringup.scanned = false;
+  bringup.connecting = false;
+  atomic_clear(&bringup.ranked);
+  atomic_clear(&bringup.result);
+  atomic_clear(&bringup.status);
+  if((bringup.order[0] = ob_wifi_profile_most_recent()) >= 0) {
+    bringup.num = 1;
+  }
+}
+
+/**
+ * @brief Handle the end of the connection to a candidate
+ *
+ * @param obj the bring-up state machine
+ * @param reason the reason the connection ended
+ */
+static void
+bringup_connect_result(void * obj, ob_wifi_connect_reason_t reason)
+{
+  bringup.connecting = false;
+  if(OB_WIFI_CONNECT_OK == reason) {
+    ob_wifi_profile_connected(bringup.profile.ssid);
+    bringup_set_credentials(&bringup.profile);
+    smf_set_state(SMF_CTX(obj), &bringup_states[BRINGUP_ONLINE]);
+  } else if(OB_WIFI_CONNECT_ERR_CANCELLED == reason) {
+    /* An onboarding method took the station over, try again once it is done */
+    bringup.retry_at = k_uptime_get() + CONNECT_REQUEST_RETRY_MS;
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+  } else if((OB_WIFI_CONNECT_ERR_ASSOC == reason) &&
+            (WIFI_STATUS_CONN_WRONG_PASSWORD == atomic_get(&bringup.status)) &&
+            ob_wifi_profile_has_pmk(&bringup.profile)) {
+    /* There is no passphrase to fall back to, the network needs new credentials */
+    LOG_WRN("The PMK of %s was rejected, removing the profile", bringup.profile.ssid);
+    ob_wifi_profile_remove(bringup.profile.ssid);
+    if(0 == ob_wifi_profile_count()) {
+      smf_set_state(SMF_CTX(obj), &bringup_states[BRINGUP_PROVISION]);
+    }
+    bringup.next++;
+#endif // CONFIG_ONBOARDING_WIFI_PMK
   } else {
-    LOG_DBG("Connecting");
-    if(ob_wifi_connect()< 0) {
-      LOG_ERR("Wifi Connect failed");
-    } else {
-      LOG_DBG("Wifi Connect succeeded");
-    }    
+    bringup.next++;
+  }
+  memset(&bringup.profile, 0, sizeof(bringup.profile));
+}
+
+/**
+ * @brief Try the candidates one at a time, scanning for a new ranking when they run out
+ * @param obj the bring-up state machine
+ */
+static enum smf_state_result
+bringup_connect_run(void * obj)
+{
+  struct ob_wifi_connect_params params = {
+    .max_attempts = 1
+  };
+  atomic_val_t result;
+  int64_t now = k_uptime_get();
+  int rc;
+
+  if(bringup.connecting) {
+    if(0 != (result = atomic_clear(&bringup.result))) {
+      bringup_connect_result(obj, result - 1);
+      bringup_kick();
+    }
+    return SMF_EVENT_HANDLED;
+  }
+  if(k_event_test(&wifi_events, OB_WIFI_EVENT_STA_CONNECTED)) {
+    smf_set_state(SMF_CTX(obj), &bringup_states[BRINGUP_ONLINE]);
+    return SMF_EVENT_HANDLED;
+  }
+  if(bringup.scanning) {
+    if(!atomic_cas(&bringup.ranked, 1, 0)) {
+      return SMF_EVENT_HANDLED;
+    }
+    bringup.scanning = false;
+    bringup.scanned = true;
+    bringup.next = 0;
+    if(0 == bringup.num) {
+      LOG_WRN("No wifi profiles left");
+      smf_set_state(SMF_CTX(obj), &bringup_states[BRINGUP_PROVISION]);
+      return SMF_EVENT_HANDLED;
+    }
+  }
+  if(now < bringup.retry_at) {
+    k_work_reschedule_for_queue(&connect_wq, &bringup_work, K_MSEC(bringup.retry_at - now));
+    return SMF_EVENT_HANDLED;
+  }
+  if(bringup.next >= bringup.num) {
+    if(bringup.scanned && (bringup.retry_at <= 0)) {
+      /* A ranked round failed, rest before scanning again */
+      bringup.retry_at = now + backoff_delay(++bringup.rounds);
+      LOG_DBG("Rescanning in %lld ms", (long long)(bringup.retry_at - now));
+      bringup_kick();
+      return SMF_EVENT_HANDLED;
+    }
+    bringup.retry_at = 0;
+    bringup.num = 0;
+    bringup.scanning = true;
+    bringup.scan_sub.callback = bringup_scan_done;
+    bringup.scan_sub.user_data = NULL;
+    if(ob_wifi_scan_subscribe(&bringup.scan_sub) < 0) {
+      LOG_ERR("Unable to scan for the wifi profiles");
+      bringup_scan_done(NULL, NULL);
+    }
+    return SMF_EVENT_HANDLED;
+  }
+  bringup.retry_at = 0;
+  if(ob_wifi_profile_get(bringup.order[bringup.next], &bringup.profile) < 0) {
+    /* Removed since it was ranked */
+    bringup.next++;
+    bringup_kick();
+    return SMF_EVENT_HANDLED;
+  }
+  params.ssid = bringup.profile.ssid;
+  params.psk = bringup.profile.psk;
+  LOG_INF("Trying wifi profile %s (%d/%d)", bringup.profile.ssid, bringup.next + 1, bringup.num);
+  atomic_clear(&bringup.result);
+  if(0 == (rc = ob_wifi_connect_async(&params, bringup_connect_done, NULL))) {
+    bringup.connecting = true;
+  } else if(-EBUSY == rc) {
+    /* Another connection is running, try the same candidate once it ends */
+    bringup.retry_at = now + CONNECT_REQUEST_RETRY_MS;
+    bringup_kick();
+  } else {
+    LOG_ERR("Wifi Connect failed %d", rc);
+    bringup.next++;
+    bringup_kick();
+  }
+  return SMF_EVENT_HANDLED;
+}
+
+/**
+ * @brief Stop the connection to a candidate when leaving the state
+ * @param obj the bring-up state machine
+ */
+static void
+bringup_connect_exit(void * obj)
+{
+  ARG_UNUSED(obj);
+  if(bringup.connecting) {
+    bringup.connecting = false;
+    ob_wifi_connect_cancel();
+  }
+  memset(&bringup.profile, 0, sizeof(bringup.profile));
+}
+
+/**
+ * @brief Ask for credentials
+ * @param obj the bring-up state machine
+ */
+static void
+bringup_provision_entry(void * obj)
+{
+  ARG_UNUSED(obj);
+  LOG_DBG("needs STA");
+  k_event_post(&wifi_events, OB_WIFI_EVENT_NEED_CREDENTIALS);
+}
+
+/**
+ * @brief Go online once the station is connected, or connect once a profile is added
+ * @details a connection made by an onboarding method also ends the provisioning
+ * @param obj the bring-up state machine
+ */
+static enum smf_state_result
+bringup_provision_run(void * obj)
+{
+  if(k_event_test(&wifi_events, OB_WIFI_EVENT_STA_CONNECTED)) {
+    smf_set_state(SMF_CTX(obj), &bringup_states[BRINGUP_ONLINE]);
+  } else if(ob_wifi_profile_count() > 0) {
+    smf_set_state(SMF_CTX(obj), &bringup_states[BRINGUP_CONNECT]);
+  }
+  return SMF_EVENT_HANDLED;
+}
+
+/**
+ * @brief The station is connected
+ * @param obj the bring-up state machine
+ */
+static void
+bringup_online_entry(void * obj)
+{
+  ARG_UNUSED(obj);
+  k_event_clear(&wifi_events, OB_WIFI_EVENT_NEED_CREDENTIALS);
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+  bringup.reconnect_at = 0;
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+  LOG_INF("Wifi online %lld ms after init", (long long)(k_uptime_get() - bringup.start));
+}
+
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+/**
+ * @brief Check if a connection is running
+ * @return true if a roam or an onboarding method is connecting the station
+ */
+static bool
+connect_busy(void)
+{
+  bool busy;
+
+  k_mutex_lock(&connect_mutex, K_FOREVER);
+  busy = (CONNECT_IDLE != cnx.state);
+  k_mutex_unlock(&connect_mutex);
+  return busy;
+}
+
+/**
+ * @brief Connect the station again after an unexpected disconnect
+ * @details a station that keeps dropping soon after coming online waits
+ * for a backoff before each reconnection
+ * @param obj the bring-up state machine
+ */
+static enum smf_state_result
+bringup_online_run(void * obj)
+{
+  int64_t now = k_uptime_get();
+  int flaps;
+
+  if(k_event_test(&wifi_events, OB_WIFI_EVENT_STA_CONNECTED)) {
+    bringup.reconnect_at = 0;
+    return SMF_EVENT_HANDLED;
+  }
+  if(!wifi_inited || connect_busy()) {
+    /* Stopped, or a roam or an onboarding method is connecting the station */
+    return SMF_EVENT_HANDLED;
+  }
+  if(0 == bringup.reconnect_at) {
+    flaps = ob_wifi_link_incident();
+    bringup.reconnect_at = now + ((flaps > 0) ? backoff_delay(flaps) : 0);
+    LOG_DBG("Reconnecting in %lld ms", (long long)(bringup.reconnect_at - now));
+  }
+  if(now < bringup.reconnect_at) {
+    k_work_reschedule_for_queue(&connect_wq, &bringup_work, K_MSEC(bringup.reconnect_at - now));
+    return SMF_EVENT_HANDLED;
+  }
+  smf_set_state(SMF_CTX(obj), &bringup_states[BRINGUP_CONNECT]);
+  bringup_kick();
+  return SMF_EVENT_HANDLED;
+}
+#else
+/**
+ * @brief The station stays online, later disconnects are handled by the connect API
+ * @param obj the bring-up state machine
+ */
+static enum smf_state_result
+bringup_online_run(void * obj)
+{
+  ARG_UNUSED(obj);
+  return SMF_EVENT_HANDLED;
+}
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+
+static const struct smf_state bringup_states[] = {
+  [BRINGUP_LOAD] = SMF_CREATE_STATE(bringup_load_entry, bringup_load_run, NULL, NULL, NULL),
+  [BRINGUP_CONNECT] = SMF_CREATE_STATE(bringup_connect_entry, bringup_connect_run, bringup_connect_exit, NULL, NULL),
+  [BRINGUP_PROVISION] = SMF_CREATE_STATE(bringup_provision_entry, bringup_provision_run, NULL, NULL, NULL),
+  [BRINGUP_ONLINE] = SMF_CREATE_STATE(bringup_online_entry, bringup_online_run, NULL, NULL, NULL),
+};
+
+/**
+ * @brief Run the bring-up state machine
+ * @details runs on the connect work queue
+ * @param work The work structure
+ */
+static void
+bringup_work_handler(struct k_work * work)
+{
+  if(!bringup.started) {
+    bringup.started = true;
+    smf_set_initial(SMF_CTX(&bringup), &bringup_states[BRINGUP_LOAD]);
+  }
+  smf_run_state(SMF_CTX(&bringup));
+}
+
+uint32_t
+ob_wifi_wait_events(uint32_t events, k_timeout_t timeout)
+{
+  return k_event_wait(&wifi_events, events, false, timeout);
+}
+
+int
+ob_wifi_init(void)
+{
+  if(ob_nvs_data_init() < 0) {
+    return -1;
+  }
+
+  if(!connect_wq_started) {
+    k_work_queue_init(&connect_wq);
+    k_work_queue_start(&connect_wq, connect_wq_stack,
+                       K_THREAD_STACK_SIZEOF(connect_wq_stack),
+                       K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+    k_thread_name_set(k_work_queue_thread_get(&connect_wq), "ob_wifi_connect");
+    connect_wq_started = true;
   }
+
+#if defined(CONFIG_ONBOARDING_WIFI_SCAN_DEFAULT_QUICK)
+  ob_wifi_scan_preset_params(OB_WIFI_SCAN_PRESET_PORTAL_QUICK, NULL, NULL, &scan_default_params);
+#elif defined(CONFIG_ONBOARDING_WIFI_SCAN_DEFAULT_PASSIVE)
+  ob_wifi_scan_preset_params(OB_WIFI_SCAN_PRESET_PASSIVE, NULL, NULL, &scan_default_params);
+#else
+  ob_wifi_scan_preset_params(OB_WIFI_SCAN_PRESET_FULL, NULL, NULL, &scan_default_params);
+#endif
+
+  ob_wifi_timeline_init();
+  wifi_inited=true;
+
+  net_mgmt_init_event_callback(&wifi_mgmt_cb,
+                               ob_wifi_mgmt_event_handler,
+                               WIFI_MGMT_EVENTS);
+
+  net_mgmt_add_event_callback(&wifi_mgmt_cb);
+  net_mgmt_init_event_callback(&ipv4_mgmt_cb,
+                               ipv4_mgmt_event_handler,
+                               IPV4_MGMT_EVENTS);
+
+  net_mgmt_add_event_callback(&ipv4_mgmt_cb);
+
+  net_mgmt_init_event_callback(&ethernet_mgmt_cb,
+                               ethernet_mgmt_event_handler,
+                               ETHERNET_MGMT_EVENTS);
+  net_mgmt_add_event_callback(&ethernet_mgmt_cb);
+#ifdef CONFIG_ONBOARDING_WIFI_AP
+  k_work_init_delayable(&start_ap_work,bws_start_ap_work);
+  k_work_init_delayable(&stop_ap_work, stop_ap_work_handler);
+#endif // CONFIG_ONBOARDING_WIFI_AP
+
+  // The AP, the hostname and the station are brought up on the connect work queue
+  bringup.start = k_uptime_get();
+  bringup.started = false;
+  bringup_kick();
+#ifdef CONFIG_ONBOARDING_WIFI_ROAM
+  ob_wifi_roam_init();
+#endif // CONFIG_ONBOARDING_WIFI_ROAM
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+  ob_wifi_probe_init();
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+  ob_wifi_ps_init();
+#endif // CONFIG_ONBOARDING_WIFI_PS
   LOG_DBG("Wifi inited");
   return 0;
 }
@@ -593,38 +2105,44 @@ ob_wifi_deinit(void)
   int rc = 0;
   struct net_if *iface;
   LOG_DBG("Wifi deinit");
+  ob_wifi_connect_cancel();
+#ifdef CONFIG_ONBOARDING_WIFI_ROAM
+  ob_wifi_roam_stop();
+#endif // CONFIG_ONBOARDING_WIFI_ROAM
+#ifdef CONFIG_ONBOARDING_WIFI_PROBE
+  ob_wifi_probe_stop();
+#endif // CONFIG_ONBOARDING_WIFI_PROBE
   k_sem_reset(&wifi_deinit_sem);
 #ifdef CONFIG_ONBOARDING_WIFI_AP
   if(ob_wifi_HasAP()) {
     ob_wifi_ap_disable();
   }
 #endif // CONFIG_ONBOARDING_WIFI_AP
+  // Cleared first so the disconnect is not taken for a lost link
+  wifi_inited=false;
   iface = net_if_get_wifi_sta();
   rc = net_mgmt(NET_REQUEST_WIFI_DISCONNECT, iface, NULL, 0);
   if(rc < 0) {
     LOG_ERR("Wifi deinitialization failed %d", rc);
   }
   k_sem_take(&wifi_deinit_sem, K_MSEC(5000));
-  wifi_inited=false;
+  k_work_cancel_delayable(&bringup_work);
+  k_event_clear(&wifi_events, OB_WIFI_EVENT_STA_CONNECTED | OB_WIFI_EVENT_NEED_CREDENTIALS |
+                OB_WIFI_EVENT_CONFIG_LOADED);
   LOG_INF("Wifi deinited");
 }
 
 int
 ob_wifi_scan(void)
 {
-  struct net_if *iface = net_if_get_wifi_sta();
-  LOG_DBG("scan iface %s", iface?iface->config.name:"NULL");
-  // TODO why?
-  if(!wifi_inited) {
-    LOG_ERR("Wifi not initied");
-    return -1;
-  }
-  ssid_init_list();
-  LOG_DBG("Scan started");
-  if (net_mgmt(NET_REQUEST_WIFI_SCAN, iface, NULL, 0)) {
-    LOG_ERR("Wifi scan faild");
+  int rc = 0;
+
+  k_mutex_lock(&scan_mutex, K_FOREVER);
+  if(!scan_in_flight) {
+    rc = scan_start_locked(NULL);
   }
-  return 0;
+  k_mutex_unlock(&scan_mutex);
+  return rc;
 }
 #ifdef CONFIG_ONBOARDING_WIFI_AP
 void
@@ -645,7 +2163,11 @@ ob_wifi_ap_disable(void)
     LOG_ERR("net_if_ipv4_addr_add failed %d", errno);
   }
 
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+  rc = ob_wifi_ap_pool_stop(iface);
+#else
   rc = net_dhcpv4_server_stop(iface);
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
   if(rc < 0) {
     LOG_ERR("Unable to stop dhcp server %d", rc);
   }
@@ -657,7 +2179,11 @@ ob_wifi_ap_disable(void)
     LOG_ERR("AP mode disable failed %s", strerror(errno));
   } else {
     k_sem_give(&wifi_deinit_sem);
-    k_sem_give(&wifi_ap_sem);
+    mHasAp = false;
+    k_event_clear(&wifi_events, OB_WIFI_EVENT_AP_READY);
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+    ob_wifi_ps_hold(OB_WIFI_PS_HOLD_PORTAL, false);
+#endif // CONFIG_ONBOARDING_WIFI_PS
   }
 }
 void ob_wifi_ap_enable()
@@ -665,11 +2191,196 @@ void ob_wifi_ap_enable()
     k_work_schedule(&start_ap_work, AP_WORK_DELAY);
 }
 
+#ifdef CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+/**
+ * @brief Score the candidate channels of the AP against scan results
+ * @details each BSS on a 2.4 GHz channel less than 5 channels away counts
+ * CONFIG_ONBOARDING_WIFI_AP_CHANNEL_BSS_WEIGHT plus its RSSI above -100 dBm,
+ * weighted by how much the channels overlap. The BSSes are counted per
+ * channel before the scan results are deduplicated by SSID.
+ *
+ * @param snap the scan results
+ * @param[out] scores the scores of the candidate channels
+ * @return the number of candidate channels
+ */
+static int
+ap_channel_score(ob_wifi_scan_snapshot_t * snap, struct ob_wifi_ap_channel_score * scores)
+{
+  char channels[] = CONFIG_ONBOARDING_WIFI_AP_CHANNELS;
+  char *next = channels;
+  int count = 0;
+  int distance;
+  long channel;
+
+  while((count < OB_WIFI_AP_CHANNELS_MAX) && ('\0' != *next)) {
+    channel = strtol(next, &next, 10);
+    if((channel >= 1) && (channel <= 14)) {
+      scores[count].channel = channel;
+      scores[count].bss_count = 0;
+      scores[count].score = 0;
+      count++;
+    }
+    while((',' == *next) || (' ' == *next)) {
+      next++;
+    }
+    if(('\0' != *next) && ((*next < '0') || (*next > '9'))) {
+      LOG_ERR("Invalid AP channels %s", CONFIG_ONBOARDING_WIFI_AP_CHANNELS);
+      break;
+    }
+  }
+  for(int c = 0; c < OB_WIFI_CHANNELS_2_4_GHZ; c++) {
+    if(0 == snap->bss_count[c]) {
+      continue;
+    }
+    for(int i = 0; i < count; i++) {
+      distance = abs((int)scores[i].channel - (c + 1));
+      if(distance >= 5) {
+        continue;
+      }
+      scores[i].bss_count = MIN(scores[i].bss_count + snap->bss_count[c], UINT8_MAX);
+      scores[i].score += (((CONFIG_ONBOARDING_WIFI_AP_CHANNEL_BSS_WEIGHT * snap->bss_count[c]) +
+                           snap->rssi_sum[c]) * (5 - distance)) / 5;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Choose the least congested channel for the AP from scan results
+ * @details the selection is kept for ob_wifi_ap_channel_scores()
+ *
+ * @param snap the scan results
+ * @return the channel
+ * @return WIFI_CHANNEL_ANY if there is no candidate channel
+ */
+static int
+ap_channel_update(ob_wifi_scan_snapshot_t * snap)
+{
+  struct ob_wifi_ap_channel_score scores[OB_WIFI_AP_CHANNELS_MAX];
+  k_spinlock_key_t key;
+  int count;
+  int best = -1;
+
+  count = ap_channel_score(snap, scores);
+  for(int i = 0; i < count; i++) {
+    if((best < 0) || (scores[i].score < scores[best].score)) {
+      best = i;
+    }
+  }
+  if(best < 0) {
+    return WIFI_CHANNEL_ANY;
+  }
+  key = k_spin_lock(&ap_channel_lock);
+  memcpy(ap_channel.scores, scores, count * sizeof(scores[0]));
+  ap_channel.count = count;
+  ap_channel.channel = scores[best].channel;
+  ap_channel.timestamp = k_uptime_get();
+  k_spin_unlock(&ap_channel_lock, key);
+  LOG_INF("AP channel %d, %d BSSes around it", scores[best].channel, scores[best].bss_count);
+  return scores[best].channel;
+}
+
+/**
+ * @brief scan callback, selects the AP channel and starts the AP
+ * @details runs on the thread completing the scan, the AP is started from
+ * the AP start work
+ *
+ * @param snap the scan results, NULL if the scan failed
+ * @param user_data unused
+ */
+static void
+ap_channel_scan_done(ob_wifi_scan_snapshot_t * snap, void * user_data)
+{
+  int channel = WIFI_CHANNEL_ANY;
+
+  ARG_UNUSED(user_data);
+  if(NULL != snap) {
+    channel = ap_channel_update(snap);
+  } else {
+    LOG_WRN("No scan results, the driver selects the AP channel");
+  }
+  atomic_set(&ap_channel_selected, channel);
+  atomic_clear(&ap_channel_scanning);
+  k_work_reschedule(&start_ap_work, K_NO_WAIT);
+}
+
+/**
+ * @brief Choose the least congested channel for the AP
+ * @details a selection younger than CONFIG_ONBOARDING_WIFI_AP_CHANNEL_TTL is
+ * reused. Otherwise the scan results, which also fill the cache served to
+ * the captive portal, are requested and ap_channel_scan_done() selects the
+ * channel.
+ *
+ * @return the channel
+ * @return 0 if the channel is selected once the scan completes
+ */
+static int
+ap_channel_select(void)
+{
+  k_spinlock_key_t key;
+  int channel = 0;
+
+  key = k_spin_lock(&ap_channel_lock);
+  if((0 != ap_channel.channel) &&
+     ((k_uptime_get() - ap_channel.timestamp) < CONFIG_ONBOARDING_WIFI_AP_CHANNEL_TTL)) {
+    channel = ap_channel.channel;
+  }
+  k_spin_unlock(&ap_channel_lock, key);
+  if(0 != channel) {
+    LOG_DBG("Reusing AP channel %d", channel);
+    return channel;
+  }
+  if(atomic_set(&ap_channel_scanning, 1)) {
+    /* The AP starts once the scan already requested completes */
+    return 0;
+  }
+  ap_channel_sub.callback = ap_channel_scan_done;
+  ap_channel_sub.user_data = NULL;
+  if(ob_wifi_scan_subscribe(&ap_channel_sub) < 0) {
+    ap_channel_scan_done(NULL, NULL);
+  }
+  return 0;
+}
+
+int
+ob_wifi_ap_channel_scores(struct ob_wifi_ap_channel_score * scores, int max,
+                          int * channel, int64_t * age_ms)
+{
+  k_spinlock_key_t key = k_spin_lock(&ap_channel_lock);
+  int count = -ENOENT;
+
+  if(0 != ap_channel.channel) {
+    count = MIN(max, ap_channel.count);
+    memcpy(scores, ap_channel.scores, count * sizeof(scores[0]));
+    if(NULL != channel) {
+      *channel = ap_channel.channel;
+    }
+    if(NULL != age_ms) {
+      *age_ms = k_uptime_get() - ap_channel.timestamp;
+    }
+  }
+  k_spin_unlock(&ap_channel_lock, key);
+  return count;
+}
+#else
+int
+ob_wifi_ap_channel_scores(struct ob_wifi_ap_channel_score * scores, int max,
+                          int * channel, int64_t * age_ms)
+{
+  ARG_UNUSED(scores);
+  ARG_UNUSED(max);
+  ARG_UNUSED(channel);
+  ARG_UNUSED(age_ms);
+  return -ENOENT;
+}
+#endif // CONFIG_ONBOARDING_WIFI_AP_AUTO_CHANNEL
+
 /**
  * @brief This function enables the devices AP
+ * @param channel the channel of the AP, WIFI_CHANNEL_ANY to let the driver choose
  */
 static void
-_ob_wifi_ap_enable(void)
+_ob_wifi_ap_enable(int channel)
 {
   int rc;
   struct net_if *iface = net_if_get_wifi_sap();
@@ -684,10 +2395,22 @@ _ob_wifi_ap_enable(void)
   }
 #ifdef CONFIG_NET_DHCPV4_SERVER
   struct in_addr addr;
+  struct in_addr netmask;
   if (net_addr_pton(AF_INET, wifi_ap_address, &addr)) {
     NET_ERR("Invalid address: %s", wifi_ap_address);
     return;
   }
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+  struct ob_wifi_ap_pool_config pool;
+  // Checked against the AP address before the netmask is set on it
+  ob_wifi_ap_pool_get(&pool, &addr);
+  netmask = pool.netmask;
+#else
+  if (net_addr_pton(AF_INET, CONFIG_ONBOARDING_WIFI_AP_NETMASK, &netmask)) {
+    NET_ERR("Invalid netmask: %s", CONFIG_ONBOARDING_WIFI_AP_NETMASK);
+    return;
+  }
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
   LOG_INF("Set IP addr to %s", wifi_ap_address);
   if(NULL == net_if_ipv4_addr_add(iface, &addr, NET_ADDR_MANUAL, 0))  {
     LOG_ERR("net_if_ipv4_addr_add failed %d", errno);
@@ -699,9 +2422,6 @@ _ob_wifi_ap_enable(void)
     return;
   }
 
-  /* Set the starting address for the dhcp server pool */
-  addr.s4_addr[3]++;
-
 #endif // CONFIG_NET_DHCPV4_SERVER
 
   struct wifi_connect_req_params ap_cnx_params;
@@ -711,8 +2431,11 @@ _ob_wifi_ap_enable(void)
   /* Defaults */
   params->security = WIFI_SECURITY_TYPE_PSK;
   params->band = WIFI_FREQ_BAND_UNKNOWN;
-  params->channel = WIFI_CHANNEL_ANY;
+  params->channel = channel;
   params->mfp = WIFI_MFP_OPTIONAL;
+  if(WIFI_CHANNEL_ANY != channel) {
+    params->band = WIFI_FREQ_BAND_2_4_GHZ;
+  }
 
   //  params->band =  WIFI_FREQ_BAND_2_4_GHZ; //WIFI_FREQ_BAND_UNKNOWN;
   //  params->channel = 6; // WIFI_CHANNEL_ANY;
@@ -746,9 +2469,15 @@ _ob_wifi_ap_enable(void)
     LOG_INF("AP mode succeeded %d", rc);
   }
 #ifdef CONFIG_NET_DHCPV4_SERVER
+#ifdef CONFIG_ONBOARDING_WIFI_AP_POOL
+  rc = ob_wifi_ap_pool_start(iface, &addr);
+#else
+  /* Set the starting address for the dhcp server pool */
+  addr.s4_addr[3]++;
   char address_buffer[16];
   LOG_DBG("starting dhcpv4 server with %s", net_addr_ntop(AF_INET, &addr, address_buffer, 16));
   rc = net_dhcpv4_server_start(iface, &addr);
+#endif // CONFIG_ONBOARDING_WIFI_AP_POOL
   if(rc < 0) {
     LOG_ERR("Unable to start dhcp server %d", rc);
     return;
@@ -757,79 +2486,538 @@ _ob_wifi_ap_enable(void)
   net_ipv4_autoconf_init();
 #endif //CONFIG_NET_DHCPV4_SERVER
   mHasAp = true;
-  k_sem_give(&wifi_ap_sem);
+  k_event_post(&wifi_events, OB_WIFI_EVENT_AP_READY);
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+  ob_wifi_ps_hold(OB_WIFI_PS_HOLD_PORTAL, true);
+#endif // CONFIG_ONBOARDING_WIFI_PS
 
   LOG_INF("AP mode done");
   return;
 }
 #endif // CONFIG_ONBOARDING_WIFI_AP
 
-int ob_wifi_connect(void)
+#ifdef CONFIG_ONBOARDING_WIFI_FAST_CONNECT
+/**
+ * @brief Load the BSS of the last association if it belongs to an SSID
+ *
+ * @param[out] bss the BSS to fill in
+ * @param ssid the SSID
+ * @param ssid_len the length of the SSID
+ * @return true if a usable record was found
+ */
+static bool
+load_bss_record(struct ob_wifi_bss * bss, const char * ssid, int ssid_len)
 {
-  int nr_tries = 20;
-  int ret = 0;
+  struct ob_wifi_bss_record rec;
+
+  if((ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_BSS, &rec, sizeof(rec)) != sizeof(rec)) ||
+     (rec.ssid_len != ssid_len) || (0 != memcmp(rec.ssid, ssid, ssid_len))) {
+    return false;
+  }
+  memcpy(bss->bssid, rec.bssid, WIFI_MAC_ADDR_LEN);
+  bss->channel = rec.channel;
+  bss->band = rec.band;
+  bss->security = rec.security;
+  return true;
+}
 
+/**
+ * @brief Save the BSS of the current association
+ * @details runs on the system work queue to keep flash writes off the net_mgmt thread
+ * @param work The work structure
+ */
+static void save_bss_work_handler(struct k_work * work)
+{
   struct net_if *iface = net_if_get_wifi_sta();
-  LOG_DBG("conntect iface %p", iface);
-  if(NULL == iface) {
-    LOG_ERR("No interface found");
-    return -1;
+  struct wifi_iface_status status = { 0 };
+  struct ob_wifi_bss_record rec = { 0 };
+  struct ob_wifi_bss_record old;
+
+  if(net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface, &status, sizeof(status))) {
+    LOG_ERR("Unable to read wifi status");
+    return;
+  }
+  if((status.ssid_len <= 0) || (status.ssid_len > WIFI_SSID_MAX_LEN)) {
+    return;
+  }
+  rec.ssid_len = status.ssid_len;
+  memcpy(rec.ssid, status.ssid, status.ssid_len);
+  memcpy(rec.bssid, status.bssid, WIFI_MAC_ADDR_LEN);
+  rec.channel = status.channel;
+  rec.band = status.band;
+  rec.security = status.security;
+  if((ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_BSS, &old, sizeof(old)) == sizeof(old)) &&
+     (0 == memcmp(&old, &rec, sizeof(rec)))) {
+    return;
+  }
+  LOG_DBG("Saving BSS %s channel %d band %d", Mac2String(rec.bssid), rec.channel, rec.band);
+  if(ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_BSS, &rec, sizeof(rec)) < 0) {
+    LOG_ERR("Unable to save BSS");
   }
-  LOG_DBG("wifi connect iface %s", iface?iface->config.name:"NULL");
+}
+#endif // CONFIG_ONBOARDING_WIFI_FAST_CONNECT
 
-  static struct wifi_connect_req_params cnx_params = {
-    .ssid = gSSID,
-    .ssid_length = 0,
-    .psk = gPSK,
-    .psk_length = 0,
-    .channel = 0,
-    .security = WIFI_SECURITY_TYPE_PSK,
-  };
-  LOG_DBG("wifi_inited %d", wifi_inited);
+/**
+ * @brief Record the timing of a connection attempt
+ *
+ * @param targeted true if the attempt used the cached BSS
+ * @param start the uptime when the attempt started
+ * @param success true if the attempt succeeded
+ */
+static void
+record_connect_attempt(bool targeted, int64_t start, bool success)
+{
+  struct ob_wifi_connect_attempt * attempt;
+
+  attempt = &connect_attempts[connect_attempt_count++ % OB_WIFI_CONNECT_ATTEMPT_HISTORY];
+  attempt->targeted = targeted;
+  attempt->success = success;
+  attempt->assoc_ms = (connect_result_time > start) ? (int32_t)(connect_result_time - start) : -1;
+  attempt->total_ms = (int32_t)(k_uptime_get() - start);
+  LOG_INF("%s connect %s: associated in %d ms, total %d ms",
+          targeted ? "Targeted" : "Full scan", success ? "succeeded" : "failed",
+          attempt->assoc_ms, attempt->total_ms);
+}
+
+int
+ob_wifi_get_connect_attempts(struct ob_wifi_connect_attempt * attempts, int max)
+{
+  int count = MIN(max, MIN(connect_attempt_count, OB_WIFI_CONNECT_ATTEMPT_HISTORY));
+  int i;
+
+  /* Most recent first */
+  for(i = 0; i < count; i++) {
+    attempts[i] = connect_attempts[(connect_attempt_count - 1 - i) % OB_WIFI_CONNECT_ATTEMPT_HISTORY];
+  }
+  return count;
+}
+
+const char *
+ob_wifi_connect_reason_str(ob_wifi_connect_reason_t reason)
+{
+  switch(reason) {
+  case OB_WIFI_CONNECT_OK:
+    return "connected";
+  case OB_WIFI_CONNECT_ERR_REQUEST:
+    return "request rejected";
+  case OB_WIFI_CONNECT_ERR_ASSOC:
+    return "association failed";
+  case OB_WIFI_CONNECT_ERR_ASSOC_TIMEOUT:
+    return "association timed out";
+  case OB_WIFI_CONNECT_ERR_DHCP_TIMEOUT:
+    return "DHCP timed out";
+  case OB_WIFI_CONNECT_ERR_DISCONNECTED:
+    return "disconnected";
+  case OB_WIFI_CONNECT_ERR_CANCELLED:
+    return "cancelled";
+  default:
+    return "unknown";
+  }
+}
+
+/**
+ * @brief Queue an event for the connection state machine
+ * @details called from the net_mgmt callbacks
+ *
+ * @param event the CONNECT_EV_* event
+ * @param status the status reported by the driver, 0 if none
+ */
+static void
+connect_event(atomic_val_t event, int status)
+{
+  if(0 != status) {
+    atomic_set(&connect_status, status);
+  }
+  atomic_or(&connect_events, event);
+  k_work_reschedule_for_queue(&connect_wq, &connect_work, K_NO_WAIT);
+}
+
+/**
+ * @brief Run the state machine at the current deadline
+ */
+static void
+connect_schedule_locked(void)
+{
+  int64_t delay = cnx.deadline - k_uptime_get();
+
+  k_work_reschedule_for_queue(&connect_wq, &connect_work, K_MSEC(MAX(delay, 0)));
+}
+
+/**
+ * @brief Set up the request parameters of the next attempt
+ */
+static void
+connect_prepare_locked(void)
+{
+  memset(cnx.params.bssid, 0, WIFI_MAC_ADDR_LEN);
+  if(cnx.targeted) {
+    LOG_DBG("Trying BSS %s channel %d", Mac2String(cnx.target.bssid), cnx.target.channel);
+    memcpy(cnx.params.bssid, cnx.target.bssid, WIFI_MAC_ADDR_LEN);
+    cnx.params.channel = cnx.target.channel;
+    cnx.params.band = cnx.target.band;
+    cnx.params.security = cnx.target.security;
+    return;
+  }
+  cnx.params.channel = 0;
+  cnx.params.band = 0;
+  cnx.params.security = (cnx.params.psk_length > 0) ? WIFI_SECURITY_TYPE_PSK : WIFI_SECURITY_TYPE_NONE;
+}
+
+/**
+ * @brief Compute the delay before retrying after a number of failures
+ *
+ * The backoff doubles from CONFIG_ONBOARDING_WIFI_CONNECT_BACKOFF_MIN up to
+ * CONFIG_ONBOARDING_WIFI_CONNECT_BACKOFF_MAX. Half of it is randomized so
+ * devices that lost the same AP do not retry in step.
+ *
+ * @param failures the number of failures, at least 1
+ * @return the delay in milliseconds
+ */
+static uint32_t
+backoff_delay(int failures)
+{
+  uint32_t backoff = CONFIG_ONBOARDING_WIFI_CONNECT_BACKOFF_MIN;
+  int i;
+
+  for(i = 1; (i < failures) && (backoff < CONFIG_ONBOARDING_WIFI_CONNECT_BACKOFF_MAX); i++) {
+    backoff *= 2;
+  }
+  backoff = MIN(backoff, CONFIG_ONBOARDING_WIFI_CONNECT_BACKOFF_MAX);
+  return (backoff / 2) + (sys_rand32_get() % ((backoff / 2) + 1));
+}
+
+/**
+ * @brief Handle the failure of an attempt
+ *
+ * A failed targeted attempt is followed by a full scan attempt right away.
+ * A failed full scan attempt is retried after an exponential backoff with
+ * jitter until max_attempts is reached.
+ *
+ * @param reason the reason the attempt failed
+ * @return true if the connection gives up
+ */
+static bool
+connect_failed_locked(ob_wifi_connect_reason_t reason)
+{
+  uint32_t delay;
+
+  record_connect_attempt(cnx.targeted, cnx.attempt_start, false);
+  LOG_WRN("Connect attempt failed: %s", ob_wifi_connect_reason_str(reason));
+  cnx.reason = reason;
+  cnx.request_tries = 0;
+  if(cnx.targeted) {
+    cnx.targeted = false;
+    cnx.state = CONNECT_REQUEST;
+    cnx.deadline = k_uptime_get();
+    return false;
+  }
+  cnx.failures++;
+  if((cnx.max_attempts >= 0) && (cnx.failures >= cnx.max_attempts)) {
+    return true;
+  }
+  delay = backoff_delay(cnx.failures);
+  LOG_DBG("Retrying connect in %u ms", delay);
+  cnx.state = CONNECT_BACKOFF;
+  cnx.deadline = k_uptime_get() + delay;
+  return false;
+}
+
+/**
+ * @brief End the connection
+ *
+ * @param[out] result the outcome to report to the completion callback
+ */
+static void
+connect_complete_locked(struct ob_wifi_connect_result * result)
+{
+  struct net_if *iface = net_if_get_wifi_sta();
 
+  cnx.state = CONNECT_IDLE;
+  k_work_cancel_delayable(&connect_work);
+  memset(cnx.psk, 0, sizeof(cnx.psk));
+  result->reason = cnx.reason;
+  result->status = (int)atomic_get(&connect_status);
+  result->attempts = cnx.requests;
+  result->elapsed_ms = (int32_t)(k_uptime_get() - cnx.start);
 #ifdef CONFIG_USE_READY_LED
-  ready_led_color(0,255,0);
-  ready_led_set(READY_LED_LONG);
+  ready_led_off();
 #endif
+  if(OB_WIFI_CONNECT_OK == cnx.reason) {
+    LOG_INF("Wifi Connected in %d ms", result->elapsed_ms);
+#ifdef CONFIG_ONBOARDING_WIFI_LINK_ETHERNET
+    ARG_UNUSED(iface);
+    ob_wifi_link_set_default();
+#else
+    net_if_set_default(iface);
+#endif // CONFIG_ONBOARDING_WIFI_LINK_ETHERNET
+  } else {
+    LOG_INF("Wifi Failed to Connect: %s", ob_wifi_connect_reason_str(cnx.reason));
+  }
+}
 
-  if(!wifi_inited) {
-    LOG_ERR("wifi_init not called\n");
-    return -1;
+/**
+ * @brief Issue the connect request of the next attempt
+ *
+ * @param iface the station interface
+ * @return true if the connection gives up
+ */
+static bool
+connect_request_locked(struct net_if *iface)
+{
+  int rc;
+
+  connect_prepare_locked();
+  connect_result_time = 0;
+  ob_wifi_timeline_mark(OB_WIFI_TIMELINE_CONNECT_REQUEST);
+  rc = net_mgmt(NET_REQUEST_WIFI_CONNECT, iface, &cnx.params,
+                sizeof(struct wifi_connect_req_params));
+  if(0 == rc) {
+    cnx.requests++;
+    cnx.request_tries = 0;
+    cnx.associated = false;
+    cnx.attempt_start = k_uptime_get();
+    cnx.deadline = cnx.attempt_start +
+#ifdef CONFIG_ONBOARDING_WIFI_FAST_CONNECT
+      (cnx.targeted ? CONFIG_ONBOARDING_WIFI_FAST_CONNECT_TIMEOUT : CONFIG_ONBOARDING_WIFI_CONNECT_TIMEOUT);
+#else
+      CONFIG_ONBOARDING_WIFI_CONNECT_TIMEOUT;
+#endif // CONFIG_ONBOARDING_WIFI_FAST_CONNECT
+    cnx.state = CONNECT_WAIT;
+    return false;
+  }
+  if(++cnx.request_tries < CONNECT_REQUEST_RETRIES) {
+    LOG_WRN("Connect request failed %d. Waiting for iface to be up...", rc);
+    cnx.deadline = k_uptime_get() + CONNECT_REQUEST_RETRY_MS;
+    return false;
+  }
+  atomic_set(&connect_status, rc);
+  cnx.attempt_start = k_uptime_get();
+  return connect_failed_locked(OB_WIFI_CONNECT_ERR_REQUEST);
+}
+
+/**
+ * @brief Run the connection state machine
+ * @details runs on the connect work queue, whenever a deadline expires or
+ * a connect event is received
+ *
+ * @param work The work structure
+ */
+static void
+connect_work_handler(struct k_work * work)
+{
+  struct net_if *iface = net_if_get_wifi_sta();
+  struct ob_wifi_connect_result result;
+  ob_wifi_connect_cb_t callback = NULL;
+  void * user_data = NULL;
+  atomic_val_t events;
+  bool done = false;
+
+  k_mutex_lock(&connect_mutex, K_FOREVER);
+  events = atomic_clear(&connect_events);
+
+  if((CONNECT_BACKOFF == cnx.state) && (k_uptime_get() >= cnx.deadline)) {
+    cnx.state = CONNECT_REQUEST;
   }
 
+  switch(cnx.state) {
+  case CONNECT_REQUEST:
+    done = connect_request_locked(iface);
+    break;
 
-  cnx_params.ssid_length = gSSID_len;
-  cnx_params.psk_length = gPSK_len;
+  case CONNECT_WAIT:
+    if(events & CONNECT_EV_ASSOCIATED) {
+      cnx.associated = true;
+    }
+    if(events & CONNECT_EV_BOUND) {
+      record_connect_attempt(cnx.targeted, cnx.attempt_start, true);
+      cnx.reason = OB_WIFI_CONNECT_OK;
+      done = true;
+    } else if(events & CONNECT_EV_FAILED) {
+      done = connect_failed_locked(OB_WIFI_CONNECT_ERR_ASSOC);
+    } else if(cnx.associated && (events & CONNECT_EV_DISCONNECTED)) {
+      /* Disconnects before the association belong to an earlier attempt */
+      done = connect_failed_locked(OB_WIFI_CONNECT_ERR_DISCONNECTED);
+    } else if(k_uptime_get() >= cnx.deadline) {
+      net_mgmt(NET_REQUEST_WIFI_DISCONNECT, iface, NULL, 0);
+      done = connect_failed_locked(cnx.associated ? OB_WIFI_CONNECT_ERR_DHCP_TIMEOUT :
+                                   OB_WIFI_CONNECT_ERR_ASSOC_TIMEOUT);
+    }
+    break;
 
-  LOG_WRN("WIFI try connecting to %s(%s)...", gSSID, gPSK);
-  /* Let's wait few seconds to allow wifi device be on-line */
-  while (nr_tries-- > 0) {
-    ret = net_mgmt(NET_REQUEST_WIFI_CONNECT, iface, &cnx_params,
-		   sizeof(struct wifi_connect_req_params));
-    if (ret == 0) {
-      break;
+  case CONNECT_IDLE:
+  case CONNECT_BACKOFF:
+  default:
+    break;
+  }
+
+  if(done) {
+    connect_complete_locked(&result);
+    callback = cnx.callback;
+    user_data = cnx.user_data;
+    cnx.callback = NULL;
+  } else if(CONNECT_IDLE != cnx.state) {
+    connect_schedule_locked();
+  }
+  k_mutex_unlock(&connect_mutex);
+
+  if(NULL != callback) {
+    callback(&result, user_data);
+  }
+#ifdef CONFIG_ONBOARDING_WIFI_LINK
+  if(done) {
+    /* The bring-up reconnects an online station left disconnected */
+    bringup_kick();
+  }
+#endif // CONFIG_ONBOARDING_WIFI_LINK
+}
+
+int
+ob_wifi_connect_async(const struct ob_wifi_connect_params * params,
+                      ob_wifi_connect_cb_t callback, void * user_data)
+{
+  struct ob_wifi_config config;
+  const char * ssid = config.ssid;
+  const char * psk = config.psk;
+  int ssid_len;
+  int psk_len;
+  int max_attempts = CONFIG_ONBOARDING_WIFI_CONNECT_ATTEMPTS;
+
+  if(!wifi_inited) {
+    LOG_ERR("wifi_init not called\n");
+    return -EAGAIN;
+  }
+  if(NULL == net_if_get_wifi_sta()) {
+    LOG_ERR("No interface found");
+    return -ENODEV;
+  }
+  ob_wifi_config_get(&config);
+  ssid_len = config.ssid_len;
+  psk_len = config.psk_len;
+  if(NULL != params) {
+    if(NULL != params->ssid) {
+      ssid = params->ssid;
+      ssid_len = strlen(ssid);
+      psk = (NULL != params->psk) ? params->psk : "";
+      psk_len = strlen(psk);
+    }
+    if(0 != params->max_attempts) {
+      max_attempts = params->max_attempts;
     }
+  }
+  if((ssid_len <= 0) || (ssid_len > WIFI_SSID_MAX_LEN) ||
+     (psk_len < 0) || (psk_len > WIFI_PSK_MAX_LEN)) {
+    return -EINVAL;
+  }
 
-    LOG_WRN("Connect request failed %d. Waiting for iface to be up...", ret);
-    k_msleep(1000);
+  k_mutex_lock(&connect_mutex, K_FOREVER);
+  if(CONNECT_IDLE != cnx.state) {
+    k_mutex_unlock(&connect_mutex);
+    return -EBUSY;
   }
-  if(ret == 0) {
-    LOG_DBG("Waiting on wifi_connect_sem.....");
-    k_sem_take(&wifi_connect_sem, K_FOREVER);
-    LOG_DBG("wifi_connect_sem released.");
+  memcpy(cnx.ssid, ssid, ssid_len);
+  cnx.ssid[ssid_len] = '\0';
+  memcpy(cnx.psk, psk, psk_len);
+  cnx.psk[psk_len] = '\0';
+  memset(&cnx.params, 0, sizeof(cnx.params));
+  cnx.params.ssid = cnx.ssid;
+  cnx.params.ssid_length = ssid_len;
+  cnx.params.psk = cnx.psk;
+  cnx.params.psk_length = psk_len;
+  if((NULL != params) && (NULL != params->bss)) {
+    cnx.target = *params->bss;
+    cnx.targeted = true;
+  } else {
+#ifdef CONFIG_ONBOARDING_WIFI_FAST_CONNECT
+    cnx.targeted = load_bss_record(&cnx.target, cnx.ssid, ssid_len);
+#else
+    cnx.targeted = false;
+#endif // CONFIG_ONBOARDING_WIFI_FAST_CONNECT
   }
+  cnx.associated = false;
+  cnx.reason = OB_WIFI_CONNECT_OK;
+  cnx.requests = 0;
+  cnx.failures = 0;
+  cnx.max_attempts = max_attempts;
+  cnx.request_tries = 0;
+  cnx.callback = callback;
+  cnx.user_data = user_data;
+  cnx.start = k_uptime_get();
+  cnx.deadline = cnx.start;
+  atomic_clear(&connect_events);
+  atomic_set(&connect_status, 0);
+  cnx.state = CONNECT_REQUEST;
+
 #ifdef CONFIG_USE_READY_LED
-  ready_led_off();
+  ready_led_color(0,255,0);
+  ready_led_set(READY_LED_LONG);
 #endif
-  if (wifi_connect_status_succeded) {
-    LOG_INF("Wifi Connected");
-    net_if_set_default(iface);
+  LOG_WRN("WIFI try connecting to %s...", cnx.ssid);
+  connect_schedule_locked();
+  k_mutex_unlock(&connect_mutex);
+  return 0;
+}
+
+int
+ob_wifi_connect_cancel(void)
+{
+  struct ob_wifi_connect_result result;
+  ob_wifi_connect_cb_t callback;
+  void * user_data;
+
+  k_mutex_lock(&connect_mutex, K_FOREVER);
+  if(CONNECT_IDLE == cnx.state) {
+    k_mutex_unlock(&connect_mutex);
+    return -EALREADY;
   }
-  else {
-    LOG_INF("Wifi Failed to Connect");
-    ret = -1;
+  if(CONNECT_WAIT == cnx.state) {
+    net_mgmt(NET_REQUEST_WIFI_DISCONNECT, net_if_get_wifi_sta(), NULL, 0);
   }
-  return ret;
+  cnx.reason = OB_WIFI_CONNECT_ERR_CANCELLED;
+  connect_complete_locked(&result);
+  callback = cnx.callback;
+  user_data = cnx.user_data;
+  cnx.callback = NULL;
+  k_mutex_unlock(&connect_mutex);
+
+  if(NULL != callback) {
+    callback(&result, user_data);
+  }
+  return 0;
 }
 
+/**
+ * @brief the state of a blocking ob_wifi_connect() call
+ */
+struct connect_waiter {
+  /** @brief released when the connection completes */
+  struct k_sem sem;
+  /** @brief the reason the connection completed */
+  ob_wifi_connect_reason_t reason;
+};
+
+/**
+ * @brief completion callback of ob_wifi_connect()
+ *
+ * @param result the outcome of the connection
+ * @param user_data the waiter
+ */
+static void
+connect_waiter_callback(const struct ob_wifi_connect_result * result, void * user_data)
+{
+  struct connect_waiter * waiter = user_data;
 
+  waiter->reason = result->reason;
+  k_sem_give(&waiter->sem);
+}
+
+int ob_wifi_connect(void)
+{
+  struct connect_waiter waiter;
+
+  k_sem_init(&waiter.sem, 0, 1);
+  if(ob_wifi_connect_async(NULL, connect_waiter_callback, &waiter) < 0) {
+    return -1;
+  }
+  k_sem_take(&waiter.sem, K_FOREVER);
+  return (OB_WIFI_CONNECT_OK == waiter.reason) ? 0 : -1;
+}
@@ -0,0 +1,499 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/dhcpv4_server.h>
+
+#include "ob_wifi_ap_pool.h"
+#include "ob_nvs_data.h"
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief the size of the server lease table */
+#define AP_POOL_COUNT CONFIG_NET_DHCPV4_SERVER_ADDR_COUNT
+/** @brief the hardware type of a client identifier made of a MAC address */
+#define AP_POOL_HTYPE_ETHERNET 1
+
+BUILD_ASSERT(sizeof(((struct dhcpv4_client_id *)NULL)->buf) > WIFI_MAC_ADDR_LEN,
+             "the DHCP client identifier cannot hold a MAC address");
+
+/**
+ * @struct ap_pool_lease
+ * @brief a lease saved while the AP is stopped
+ */
+struct ap_pool_lease {
+  /** @brief the MAC address of the station */
+  uint8_t mac[WIFI_MAC_ADDR_LEN];
+  /** @brief padding */
+  uint8_t reserved[2];
+  /** @brief the leased address */
+  struct in_addr addr;
+  /** @brief the remaining time of the lease in seconds when it was saved */
+  uint32_t lease_s;
+};
+
+/**
+ * @struct ap_pool_station
+ * @brief a station tracked from the AP events
+ */
+struct ap_pool_station {
+  /** @brief the MAC address of the station */
+  uint8_t mac[WIFI_MAC_ADDR_LEN];
+  /** @brief indicates that the entry is used */
+  bool used;
+  /** @brief indicates that the station is associated */
+  bool associated;
+  /** @brief the uptime when the station left */
+  int64_t left_ms;
+};
+
+/** @brief protects the state of the pool */
+static K_MUTEX_DEFINE(pool_mutex);
+/** @brief the configuration of the pool */
+static struct ob_wifi_ap_pool_config pool_config;
+/** @brief indicates that pool_config was loaded */
+static bool pool_config_loaded = false;
+/** @brief the AP interface while the server runs */
+static struct net_if * pool_iface = NULL;
+/** @brief the stations of the AP */
+static struct ap_pool_station stations[AP_POOL_COUNT];
+/** @brief the leases saved when the AP stopped */
+static struct ap_pool_lease leases[AP_POOL_COUNT];
+/** @brief the number of saved leases */
+static int lease_count = 0;
+/** @brief the uptime when the leases were saved */
+static int64_t leases_saved_ms;
+/** @brief indicates that the leases were read from the nvs store */
+static bool leases_loaded = false;
+
+static void pool_evict_work_handler(struct k_work * work);
+/** @brief releases the leases of the stations that left */
+static K_WORK_DELAYABLE_DEFINE(pool_evict_work, pool_evict_work_handler);
+
+/**
+ * @brief get the MAC address a lease was given to
+ *
+ * @param lease the lease
+ * @param[out] mac the MAC address
+ * @return true if the client identifier is a MAC address
+ */
+static bool
+lease_mac(const struct dhcpv4_addr_slot * lease, uint8_t * mac)
+{
+  if((WIFI_MAC_ADDR_LEN + 1 != lease->client_id.len) ||
+     (AP_POOL_HTYPE_ETHERNET != lease->client_id.buf[0])) {
+    return false;
+  }
+  memcpy(mac, &lease->client_id.buf[1], WIFI_MAC_ADDR_LEN);
+  return true;
+}
+
+/**
+ * @brief get the remaining time of a lease
+ *
+ * @param lease the lease
+ * @return the remaining time in seconds
+ */
+static uint32_t
+lease_remaining_s(const struct dhcpv4_addr_slot * lease)
+{
+  k_timeout_t left = sys_timepoint_timeout(lease->expiry);
+
+  if(K_TIMEOUT_EQ(left, K_FOREVER)) {
+    return UINT32_MAX;
+  }
+  return (uint32_t)(k_ticks_to_ms_floor64(left.ticks) / MSEC_PER_SEC);
+}
+
+/**
+ * @brief check a configuration against the address of the AP
+ * @details the whole pool must be in the subnet of the AP, after the AP
+ * address and before the broadcast address
+ *
+ * @param config the configuration
+ * @param ap_addr the address of the AP
+ * @return true if the configuration is valid
+ */
+static bool
+pool_valid(const struct ob_wifi_ap_pool_config * config, const struct in_addr * ap_addr)
+{
+  uint32_t mask = ntohl(config->netmask.s_addr);
+  uint32_t ap = ntohl(ap_addr->s_addr);
+  uint32_t first = ap + config->offset;
+  uint32_t last = first + AP_POOL_COUNT - 1;
+
+  return (0 != mask) && (0 == ((~mask + 1) & ~mask)) && (config->offset > 0) &&
+    (first > ap) && (last >= first) &&
+    ((first & mask) == (ap & mask)) && ((last & mask) == (ap & mask)) &&
+    ((last & ~mask) != ~mask);
+}
+
+/**
+ * @brief load the configuration from the nvs store
+ * @details must be called with pool_mutex held
+ */
+static void
+pool_config_load_locked(void)
+{
+  struct ob_wifi_ap_pool_config config;
+
+  if(pool_config_loaded) {
+    return;
+  }
+  if(ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_AP_POOL, &config, sizeof(config)) == sizeof(config)) {
+    pool_config = config;
+  } else {
+    if(net_addr_pton(AF_INET, CONFIG_ONBOARDING_WIFI_AP_NETMASK, &pool_config.netmask)) {
+      LOG_ERR("Invalid AP netmask %s", CONFIG_ONBOARDING_WIFI_AP_NETMASK);
+      pool_config.netmask.s_addr = htonl(0xffffff00);
+    }
+    pool_config.offset = CONFIG_ONBOARDING_WIFI_AP_POOL_OFFSET;
+  }
+  pool_config_loaded = true;
+}
+
+/**
+ * @brief load the configuration and check it against the address of the AP
+ * @details a saved configuration that does not fit is deleted and the
+ * defaults are used. Must be called with pool_mutex held.
+ *
+ * @param ap_addr the address of the AP
+ */
+static void
+pool_config_check_locked(const struct in_addr * ap_addr)
+{
+  pool_config_load_locked();
+  if(!pool_valid(&pool_config, ap_addr)) {
+    LOG_WRN("The AP pool does not fit in the subnet, using the defaults");
+    pool_config_loaded = false;
+    ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_AP_POOL);
+    pool_config_load_locked();
+  }
+}
+
+void
+ob_wifi_ap_pool_get(struct ob_wifi_ap_pool_config * config, const struct in_addr * ap_addr)
+{
+  k_mutex_lock(&pool_mutex, K_FOREVER);
+  pool_config_check_locked(ap_addr);
+  *config = pool_config;
+  k_mutex_unlock(&pool_mutex);
+}
+
+int
+ob_wifi_ap_pool_set(const struct ob_wifi_ap_pool_config * config,
+                    const struct in_addr * ap_addr)
+{
+  int rc = 0;
+
+  if((NULL != config) && !pool_valid(config, ap_addr)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&pool_mutex, K_FOREVER);
+  if(NULL == config) {
+    ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_AP_POOL);
+    pool_config_loaded = false;
+    pool_config_load_locked();
+  } else if(ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_AP_POOL, (void *)config, sizeof(*config)) < 0) {
+    LOG_ERR("Unable to save the AP pool configuration");
+    rc = -EIO;
+  } else {
+    pool_config = *config;
+    pool_config_loaded = true;
+  }
+  k_mutex_unlock(&pool_mutex);
+  return rc;
+}
+
+/**
+ * @brief give a saved lease back to its station
+ * @details net_dhcpv4_server_foreach_lease() call back. The server has no
+ * API to import a lease, the free slot holding the address is filled in
+ * place while the server lock is held.
+ *
+ * @param iface the AP interface
+ * @param lease the lease
+ * @param user_data the time elapsed since the leases were saved in seconds
+ */
+static void
+pool_restore_cb(struct net_if * iface, struct dhcpv4_addr_slot * lease, void * user_data)
+{
+  uint32_t elapsed_s = *(uint32_t *)user_data;
+
+  ARG_UNUSED(iface);
+  if(DHCPV4_SERVER_ADDR_FREE != lease->state) {
+    return;
+  }
+  for(int i = 0; i < lease_count; i++) {
+    if((leases[i].addr.s_addr != lease->addr.s_addr) || (leases[i].lease_s <= elapsed_s)) {
+      continue;
+    }
+    lease->client_id.buf[0] = AP_POOL_HTYPE_ETHERNET;
+    memcpy(&lease->client_id.buf[1], leases[i].mac, WIFI_MAC_ADDR_LEN);
+    lease->client_id.len = WIFI_MAC_ADDR_LEN + 1;
+    lease->lease_time = leases[i].lease_s - elapsed_s;
+    lease->expiry = sys_timepoint_calc(K_SECONDS(lease->lease_time));
+    lease->state = DHCPV4_SERVER_ADDR_ALLOCATED;
+    break;
+  }
+}
+
+/**
+ * @brief save an allocated lease
+ * @details net_dhcpv4_server_foreach_lease() call back
+ *
+ * @param iface the AP interface
+ * @param lease the lease
+ * @param user_data unused
+ */
+static void
+pool_save_cb(struct net_if * iface, struct dhcpv4_addr_slot * lease, void * user_data)
+{
+  ARG_UNUSED(iface);
+  ARG_UNUSED(user_data);
+  if((DHCPV4_SERVER_ADDR_ALLOCATED != lease->state) || (lease_count >= AP_POOL_COUNT) ||
+     !lease_mac(lease, leases[lease_count].mac)) {
+    return;
+  }
+  leases[lease_count].addr = lease->addr;
+  leases[lease_count].lease_s = lease_remaining_s(lease);
+  if(leases[lease_count].lease_s > 0) {
+    lease_count++;
+  }
+}
+
+/**
+ * @brief release the lease of a station
+ * @details net_dhcpv4_server_foreach_lease() call back
+ *
+ * @param iface the AP interface
+ * @param lease the lease
+ * @param user_data the MAC address of the station
+ */
+static void
+pool_evict_cb(struct net_if * iface, struct dhcpv4_addr_slot * lease, void * user_data)
+{
+  uint8_t mac[WIFI_MAC_ADDR_LEN];
+  char buffer[NET_IPV4_ADDR_LEN];
+
+  ARG_UNUSED(iface);
+  if(((DHCPV4_SERVER_ADDR_ALLOCATED != lease->state) &&
+      (DHCPV4_SERVER_ADDR_RESERVED != lease->state)) ||
+     !lease_mac(lease, mac) || memcmp(mac, user_data, WIFI_MAC_ADDR_LEN)) {
+    return;
+  }
+  lease->state = DHCPV4_SERVER_ADDR_FREE;
+  LOG_INF("Released %s", net_addr_ntop(AF_INET, &lease->addr, buffer, sizeof(buffer)));
+}
+
+/**
+ * @brief release the leases of the stations that left the AP
+ *
+ * @param work the pool_evict_work structure
+ */
+static void
+pool_evict_work_handler(struct k_work * work)
+{
+  int64_t now = k_uptime_get();
+  int64_t next = INT64_MAX;
+
+  ARG_UNUSED(work);
+  k_mutex_lock(&pool_mutex, K_FOREVER);
+  for(int i = 0; (NULL != pool_iface) && (i < ARRAY_SIZE(stations)); i++) {
+    if(!stations[i].used || stations[i].associated) {
+      continue;
+    }
+    if(now - stations[i].left_ms < CONFIG_ONBOARDING_WIFI_AP_EVICT_DELAY) {
+      next = MIN(next, stations[i].left_ms + CONFIG_ONBOARDING_WIFI_AP_EVICT_DELAY);
+      continue;
+    }
+    net_dhcpv4_server_foreach_lease(pool_iface, pool_evict_cb, stations[i].mac);
+    stations[i].used = false;
+  }
+  if(INT64_MAX != next) {
+    k_work_schedule(&pool_evict_work, K_MSEC(next - now));
+  }
+  k_mutex_unlock(&pool_mutex);
+}
+
+void
+ob_wifi_ap_pool_station(const uint8_t * mac, bool associated)
+{
+  struct ap_pool_station * station = NULL;
+  struct ap_pool_station * spare = NULL;
+
+  k_mutex_lock(&pool_mutex, K_FOREVER);
+  for(int i = 0; i < ARRAY_SIZE(stations); i++) {
+    if(stations[i].used && !memcmp(stations[i].mac, mac, WIFI_MAC_ADDR_LEN)) {
+      station = &stations[i];
+      break;
+    }
+    /* An unused entry, else the station that left first */
+    if(!stations[i].used) {
+      if((NULL == spare) || spare->used) {
+        spare = &stations[i];
+      }
+    } else if(!stations[i].associated &&
+              ((NULL == spare) || (spare->used && (stations[i].left_ms < spare->left_ms)))) {
+      spare = &stations[i];
+    }
+  }
+  if((NULL == station) && (NULL != (station = spare))) {
+    /* A station that left and loses its entry keeps its lease until it expires */
+    memcpy(station->mac, mac, WIFI_MAC_ADDR_LEN);
+    station->used = true;
+  }
+  if(NULL == station) {
+    LOG_WRN("Too many stations to track");
+  } else if(associated) {
+    station->associated = true;
+  } else {
+    station->associated = false;
+    station->left_ms = k_uptime_get();
+    k_work_schedule(&pool_evict_work, K_MSEC(CONFIG_ONBOARDING_WIFI_AP_EVICT_DELAY));
+  }
+  k_mutex_unlock(&pool_mutex);
+}
+
+/**
+ * @struct pool_list
+ * @brief the context of pool_list_cb()
+ */
+struct pool_list {
+  /** @brief the stations */
+  struct ob_wifi_ap_station * stations;
+  /** @brief the size of stations */
+  int max;
+  /** @brief the number of stations */
+  int count;
+};
+
+/**
+ * @brief add a lease to a list of stations
+ * @details net_dhcpv4_server_foreach_lease() call back
+ *
+ * @param iface the AP interface
+ * @param lease the lease
+ * @param user_data the struct pool_list
+ */
+static void
+pool_list_cb(struct net_if * iface, struct dhcpv4_addr_slot * lease, void * user_data)
+{
+  struct pool_list * list = user_data;
+  uint8_t mac[WIFI_MAC_ADDR_LEN];
+  int i;
+
+  ARG_UNUSED(iface);
+  if((DHCPV4_SERVER_ADDR_ALLOCATED != lease->state) || !lease_mac(lease, mac)) {
+    return;
+  }
+  for(i = 0; i < list->count; i++) {
+    if(!memcmp(list->stations[i].mac, mac, WIFI_MAC_ADDR_LEN)) {
+      break;
+    }
+  }
+  if(i == list->count) {
+    if(list->count >= list->max) {
+      return;
+    }
+    memset(&list->stations[i], 0, sizeof(list->stations[i]));
+    memcpy(list->stations[i].mac, mac, WIFI_MAC_ADDR_LEN);
+    list->count++;
+  }
+  list->stations[i].addr = lease->addr;
+  list->stations[i].lease_s = lease_remaining_s(lease);
+}
+
+int
+ob_wifi_ap_pool_stations(struct ob_wifi_ap_station * stations_out, int max)
+{
+  struct pool_list list = { .stations = stations_out, .max = max, .count = 0 };
+
+  k_mutex_lock(&pool_mutex, K_FOREVER);
+  for(int i = 0; (i < ARRAY_SIZE(stations)) && (list.count < max); i++) {
+    if(!stations[i].used) {
+      continue;
+    }
+    memset(&stations_out[list.count], 0, sizeof(stations_out[list.count]));
+    memcpy(stations_out[list.count].mac, stations[i].mac, WIFI_MAC_ADDR_LEN);
+    stations_out[list.count].associated = stations[i].associated;
+    list.count++;
+  }
+  if(NULL != pool_iface) {
+    net_dhcpv4_server_foreach_lease(pool_iface, pool_list_cb, &list);
+  }
+  k_mutex_unlock(&pool_mutex);
+  return list.count;
+}
+
+int
+ob_wifi_ap_pool_start(struct net_if * iface, const struct in_addr * ap_addr)
+{
+  struct in_addr base;
+  char buffer[NET_IPV4_ADDR_LEN];
+  uint32_t elapsed_s;
+  int len;
+  int rc;
+
+  k_mutex_lock(&pool_mutex, K_FOREVER);
+  pool_config_check_locked(ap_addr);
+  if(!leases_loaded) {
+    /* Without a wall clock the time spent powered off is not counted, a
+     * station coming back with an expired lease simply gets the same address */
+    len = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_AP_LEASES, leases, sizeof(leases));
+    lease_count = (len > 0) ? (len / sizeof(leases[0])) : 0;
+    leases_saved_ms = k_uptime_get();
+    leases_loaded = true;
+  }
+  base.s_addr = htonl(ntohl(ap_addr->s_addr) + pool_config.offset);
+  LOG_INF("DHCP pool %d addresses from %s", AP_POOL_COUNT,
+          net_addr_ntop(AF_INET, &base, buffer, sizeof(buffer)));
+  if((rc = net_dhcpv4_server_start(iface, &base)) == 0) {
+    pool_iface = iface;
+    elapsed_s = (uint32_t)((k_uptime_get() - leases_saved_ms) / MSEC_PER_SEC);
+    net_dhcpv4_server_foreach_lease(iface, pool_restore_cb, &elapsed_s);
+  }
+  k_mutex_unlock(&pool_mutex);
+  return rc;
+}
+
+int
+ob_wifi_ap_pool_stop(struct net_if * iface)
+{
+  struct ap_pool_lease saved[AP_POOL_COUNT];
+  bool changed;
+  int len;
+
+  k_mutex_lock(&pool_mutex, K_FOREVER);
+  lease_count = 0;
+  net_dhcpv4_server_foreach_lease(iface, pool_save_cb, NULL);
+  leases_saved_ms = k_uptime_get();
+  leases_loaded = true;
+  len = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_AP_LEASES, saved, sizeof(saved));
+  /* The remaining times always differ, only rewrite when the stations or addresses changed */
+  changed = (len != lease_count * (int)sizeof(leases[0]));
+  for(int i = 0; !changed && (i < lease_count); i++) {
+    changed = memcmp(saved[i].mac, leases[i].mac, WIFI_MAC_ADDR_LEN) ||
+      (saved[i].addr.s_addr != leases[i].addr.s_addr);
+  }
+  if(changed && (0 == lease_count)) {
+    ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_AP_LEASES);
+  } else if(changed && (ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_AP_LEASES, leases,
+                                          lease_count * sizeof(leases[0])) < 0)) {
+    LOG_ERR("Unable to save the AP leases");
+  }
+  LOG_INF("Saved %d AP leases", lease_count);
+  pool_iface = NULL;
+  memset(stations, 0, sizeof(stations));
+  k_work_cancel_delayable(&pool_evict_work);
+  k_mutex_unlock(&pool_mutex);
+  return net_dhcpv4_server_stop(iface);
+}
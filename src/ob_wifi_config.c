@@ -0,0 +1,93 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+
+#include "ob_wifi_config.h"
+
+/**
+ * @struct config_slot
+ * @brief storage for a snapshot
+ */
+struct config_slot {
+  /** @brief odd while the snapshot is being written */
+  atomic_t seq;
+  /** @brief the snapshot */
+  struct ob_wifi_config config;
+};
+
+/**
+ * @brief the current snapshot and the spare one the next publish writes
+ * @details a reader still copying the spare one when it is reused sees its
+ * sequence change and retries on the new current snapshot
+ */
+static struct config_slot config_slots[2];
+/** @brief the current snapshot */
+static atomic_ptr_t config_current = ATOMIC_PTR_INIT(&config_slots[0]);
+/** @brief the version of the current snapshot */
+static atomic_t config_version = ATOMIC_INIT(0);
+/** @brief serializes the writers */
+static K_MUTEX_DEFINE(config_mutex);
+
+uint32_t
+ob_wifi_config_get(struct ob_wifi_config * config)
+{
+  struct config_slot * slot;
+  atomic_val_t seq;
+
+  do {
+    slot = atomic_ptr_get(&config_current);
+    seq = atomic_get(&slot->seq);
+    if(seq & 1) {
+      continue;
+    }
+    memcpy(config, &slot->config, sizeof(*config));
+    barrier_dmem_fence_full();
+  } while((seq & 1) || (seq != atomic_get(&slot->seq)));
+  return config->version;
+}
+
+uint32_t
+ob_wifi_config_version(void)
+{
+  return (uint32_t)atomic_get(&config_version);
+}
+
+int
+ob_wifi_config_publish(const char * ssid, const char * psk)
+{
+  struct config_slot * slot;
+  size_t ssid_len = strlen(ssid);
+  size_t psk_len = (NULL != psk) ? strlen(psk) : 0;
+  uint32_t version;
+
+  if((0 == ssid_len) || (ssid_len > WIFI_SSID_MAX_LEN) || (psk_len > WIFI_PSK_MAX_LEN)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&config_mutex, K_FOREVER);
+  slot = (atomic_ptr_get(&config_current) == &config_slots[0]) ? &config_slots[1] : &config_slots[0];
+  version = (uint32_t)atomic_get(&config_version) + 1;
+  atomic_inc(&slot->seq);
+  barrier_dmem_fence_full();
+  memset(&slot->config, 0, sizeof(slot->config));
+  slot->config.version = version;
+  memcpy(slot->config.ssid, ssid, ssid_len);
+  slot->config.ssid_len = ssid_len;
+  if(psk_len > 0) {
+    memcpy(slot->config.psk, psk, psk_len);
+  }
+  slot->config.psk_len = psk_len;
+  barrier_dmem_fence_full();
+  atomic_inc(&slot->seq);
+  atomic_ptr_set(&config_current, slot);
+  atomic_set(&config_version, version);
+  k_mutex_unlock(&config_mutex);
+  return (int)version;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_ip.h>
+#ifdef CONFIG_DNS_RESOLVER
+#include <zephyr/net/dns_resolve.h>
+#endif // CONFIG_DNS_RESOLVER
+
+#include "ob_wifi_ipv4.h"
+#include "ob_nvs_data.h"
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief protects ipv4_config */
+static K_MUTEX_DEFINE(ipv4_mutex);
+/** @brief the static configuration */
+static struct ob_wifi_ipv4_config ipv4_config;
+/** @brief indicates that a static configuration is set */
+static bool ipv4_static = false;
+
+/**
+ * @brief check a configuration
+ *
+ * @param config the configuration
+ * @return true if the address is set and the netmask is contiguous
+ */
+static bool
+ipv4_valid(const struct ob_wifi_ipv4_config * config)
+{
+  uint32_t mask = ntohl(config->netmask.s_addr);
+
+  return (INADDR_ANY != config->address.s_addr) && (0 != mask) &&
+    (0 == ((~mask + 1) & ~mask));
+}
+
+void
+ob_wifi_ipv4_load(void)
+{
+  struct ob_wifi_ipv4_config config;
+
+  k_mutex_lock(&ipv4_mutex, K_FOREVER);
+  ipv4_static = (ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_IPV4, &config, sizeof(config)) == sizeof(config)) &&
+    ipv4_valid(&config);
+  if(ipv4_static) {
+    ipv4_config = config;
+  }
+  k_mutex_unlock(&ipv4_mutex);
+}
+
+int
+ob_wifi_ipv4_get(struct ob_wifi_ipv4_config * config)
+{
+  int rc = -ENOENT;
+
+  k_mutex_lock(&ipv4_mutex, K_FOREVER);
+  if(ipv4_static) {
+    *config = ipv4_config;
+    rc = 0;
+  }
+  k_mutex_unlock(&ipv4_mutex);
+  return rc;
+}
+
+int
+ob_wifi_ipv4_set(const struct ob_wifi_ipv4_config * config)
+{
+  int rc = 0;
+
+  if((NULL != config) && !ipv4_valid(config)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&ipv4_mutex, K_FOREVER);
+  if(NULL == config) {
+    ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_IPV4);
+    ipv4_static = false;
+    LOG_INF("IPv4 set to DHCP");
+  } else if(ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_IPV4, (void *)config, sizeof(*config)) < 0) {
+    LOG_ERR("Unable to save the IPv4 configuration");
+    rc = -EIO;
+  } else {
+    ipv4_config = *config;
+    ipv4_static = true;
+    LOG_INF("IPv4 set to static");
+  }
+  k_mutex_unlock(&ipv4_mutex);
+  return rc;
+}
+
+int
+ob_wifi_ipv4_parse(const char * address, const char * netmask, const char * gateway,
+                   const char * dns, struct ob_wifi_ipv4_config * config)
+{
+  memset(config, 0, sizeof(*config));
+  if((NULL == address) || (NULL == netmask) ||
+     net_addr_pton(AF_INET, address, &config->address) ||
+     net_addr_pton(AF_INET, netmask, &config->netmask)) {
+    return -EINVAL;
+  }
+  if((NULL != gateway) && ('\0' != gateway[0]) &&
+     net_addr_pton(AF_INET, gateway, &config->gateway)) {
+    return -EINVAL;
+  }
+  if((NULL != dns) && ('\0' != dns[0]) && net_addr_pton(AF_INET, dns, &config->dns)) {
+    return -EINVAL;
+  }
+  return ipv4_valid(config) ? 0 : -EINVAL;
+}
+
+int
+ob_wifi_ipv4_apply(struct net_if * iface)
+{
+  struct ob_wifi_ipv4_config config;
+  char buffer[NET_IPV4_ADDR_LEN];
+
+  if(ob_wifi_ipv4_get(&config) < 0) {
+    return -ENOENT;
+  }
+  if(NULL == net_if_ipv4_addr_add(iface, &config.address, NET_ADDR_MANUAL, 0)) {
+    LOG_ERR("Unable to add the static address");
+    return -ENOMEM;
+  }
+  net_if_ipv4_set_netmask_by_addr(iface, &config.address, &config.netmask);
+  if(INADDR_ANY != config.gateway.s_addr) {
+    net_if_ipv4_set_gw(iface, &config.gateway);
+  }
+#ifdef CONFIG_DNS_RESOLVER
+  if(INADDR_ANY != config.dns.s_addr) {
+    const char *servers[] = { buffer, NULL };
+
+    net_addr_ntop(AF_INET, &config.dns, buffer, sizeof(buffer));
+    if(dns_resolve_reconfigure(dns_resolve_get_default(), servers, NULL, DNS_SOURCE_MANUAL) < 0) {
+      LOG_WRN("Unable to set the DNS server %s", buffer);
+    }
+  }
+#endif // CONFIG_DNS_RESOLVER
+  net_addr_ntop(AF_INET, &config.address, buffer, sizeof(buffer));
+  LOG_INF("Static address %s", buffer);
+  return 0;
+}
@@ -0,0 +1,620 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/wifi.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/byteorder.h>
+#ifdef CONFIG_DNS_RESOLVER
+#include <zephyr/net/dns_resolve.h>
+#endif // CONFIG_DNS_RESOLVER
+
+#include "ob_wifi_lease.h"
+#include "ob_nvs_data.h"
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief the UDP port of DHCP servers */
+#define DHCP_SERVER_PORT 67
+/** @brief the UDP port of DHCP clients */
+#define DHCP_CLIENT_PORT 68
+/** @brief the op of a request */
+#define DHCP_OP_REQUEST 1
+/** @brief the op of a reply */
+#define DHCP_OP_REPLY 2
+/** @brief the hardware type of Ethernet and 802.11 */
+#define DHCP_HTYPE_ETHERNET 1
+/** @brief asks the server to broadcast the reply, the client has no address yet */
+#define DHCP_FLAG_BROADCAST 0x8000
+
+/** @brief option codes used by the request and the reply */
+#define DHCP_OPT_PAD 0
+#define DHCP_OPT_SUBNET_MASK 1
+#define DHCP_OPT_ROUTER 3
+#define DHCP_OPT_DNS 6
+#define DHCP_OPT_REQUESTED_IP 50
+#define DHCP_OPT_LEASE_TIME 51
+#define DHCP_OPT_MSG_TYPE 53
+#define DHCP_OPT_SERVER_ID 54
+#define DHCP_OPT_PARAM_LIST 55
+#define DHCP_OPT_END 255
+
+/** @brief message types */
+#define DHCP_MSG_REQUEST 3
+#define DHCP_MSG_ACK 5
+#define DHCP_MSG_NAK 6
+
+/** @brief the number of times the request is sent */
+#define LEASE_REBOOT_TRIES 2
+
+/**
+ * @struct dhcp_msg
+ * @brief the fixed part of a DHCP message followed by the options
+ */
+struct dhcp_msg {
+  uint8_t op;
+  uint8_t htype;
+  uint8_t hlen;
+  uint8_t hops;
+  uint32_t xid;
+  uint16_t secs;
+  uint16_t flags;
+  struct in_addr ciaddr;
+  struct in_addr yiaddr;
+  struct in_addr siaddr;
+  struct in_addr giaddr;
+  uint8_t chaddr[16];
+  uint8_t sname[64];
+  uint8_t file[128];
+  uint8_t cookie[4];
+  /** @brief the options, 312 bytes is the minimum a client must accept */
+  uint8_t options[312];
+} __packed;
+
+/**
+ * @struct ob_wifi_lease_record
+ * @brief the lease of a network
+ * @details persisted at NVS_SETTINGS_ID_WIFI_LEASE
+ */
+struct ob_wifi_lease_record {
+  /** @brief the SSID the lease belongs to, NUL terminated */
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  /** @brief the leased address */
+  struct in_addr addr;
+  /** @brief the network mask */
+  struct in_addr netmask;
+  /** @brief the default gateway */
+  struct in_addr gateway;
+  /** @brief the DHCP server that granted the lease */
+  struct in_addr server;
+  /** @brief the first DNS server */
+  struct in_addr dns;
+  /** @brief the lease time in seconds */
+  uint32_t lease_time;
+};
+
+/** @brief the DHCP magic cookie */
+static const uint8_t dhcp_cookie[4] = { 99, 130, 83, 99 };
+/** @brief set once the saved lease has been requested */
+static bool lease_tried = false;
+
+/**
+ * @brief the states of the lease held without the DHCP client
+ */
+enum lease_state {
+  /** @brief no lease is held */
+  LEASE_IDLE,
+  /** @brief the saved address is requested */
+  LEASE_REBOOTING,
+  /** @brief the address is configured, waiting for the renewal time */
+  LEASE_BOUND,
+  /** @brief the lease is renewed with the server */
+  LEASE_RENEWING
+};
+
+/**
+ * @struct lease_context
+ * @brief the lease held without the DHCP client
+ */
+static struct lease_context {
+  /** @brief the state of the lease */
+  enum lease_state state;
+  /** @brief the station interface */
+  struct net_if *iface;
+  /** @brief called when the saved lease is acknowledged or lost */
+  ob_wifi_lease_cb_t cb;
+  /** @brief the lease */
+  struct ob_wifi_lease_record rec;
+  /** @brief the socket of the exchange in progress, -1 if none */
+  int sock;
+  /** @brief the transaction id of the exchange */
+  uint32_t xid;
+  /** @brief the number of requests sent in the exchange */
+  int tries;
+  /** @brief the uptime the request is sent again at */
+  int64_t resend;
+  /** @brief the uptime the exchange times out at */
+  int64_t deadline;
+  /** @brief the uptime the lease expires at */
+  int64_t expiry;
+} lease = { .sock = -1 };
+
+/** @brief protects lease */
+static K_MUTEX_DEFINE(lease_mutex);
+/** @brief the DHCP message sent and received */
+static struct dhcp_msg lease_msg;
+
+static void lease_work_handler(struct k_work * work);
+/** @brief polls the exchange and renews the lease, runs on the system work queue */
+static K_WORK_DELAYABLE_DEFINE(lease_work, lease_work_handler);
+
+/** @brief the interval the socket is polled at during an exchange in milliseconds */
+#define LEASE_POLL_INTERVAL 10
+/** @brief the shortest time a failed renewal is retried in, RFC 2131 4.4.5 */
+#define LEASE_RENEW_RETRY_MIN (60 * MSEC_PER_SEC)
+/** @brief a lease time meaning the lease never expires */
+#define LEASE_TIME_INFINITE 0xffffffff
+
+/**
+ * @brief build a request for the address of the lease
+ * @details RFC 2131 4.3.2: an INIT-REBOOT request has a zero ciaddr and holds
+ * the address in the requested IP option, a RENEWING request has the
+ * address in ciaddr. Neither sends a server identifier.
+ *
+ * @param msg the message to fill in
+ * @param xid the transaction id
+ * @param mac the hardware address of the interface
+ * @param addr the address to request
+ * @param renew true for a RENEWING request
+ * @return the length of the message
+ */
+static int
+lease_build_request(struct dhcp_msg * msg, uint32_t xid,
+                    const struct net_linkaddr * mac, const struct in_addr * addr, bool renew)
+{
+  static const uint8_t params[] = { DHCP_OPT_SUBNET_MASK, DHCP_OPT_ROUTER, DHCP_OPT_DNS,
+                                    DHCP_OPT_LEASE_TIME };
+  uint8_t *opt = msg->options;
+
+  memset(msg, 0, sizeof(*msg));
+  msg->op = DHCP_OP_REQUEST;
+  msg->htype = DHCP_HTYPE_ETHERNET;
+  msg->hlen = MIN(mac->len, sizeof(msg->chaddr));
+  msg->xid = xid;
+  memcpy(msg->chaddr, mac->addr, msg->hlen);
+  memcpy(msg->cookie, dhcp_cookie, sizeof(dhcp_cookie));
+
+  *opt++ = DHCP_OPT_MSG_TYPE;
+  *opt++ = 1;
+  *opt++ = DHCP_MSG_REQUEST;
+  if(renew) {
+    msg->ciaddr = *addr;
+  } else {
+    msg->flags = htons(DHCP_FLAG_BROADCAST);
+    *opt++ = DHCP_OPT_REQUESTED_IP;
+    *opt++ = sizeof(struct in_addr);
+    memcpy(opt, addr, sizeof(struct in_addr));
+    opt += sizeof(struct in_addr);
+  }
+  *opt++ = DHCP_OPT_PARAM_LIST;
+  *opt++ = sizeof(params);
+  memcpy(opt, params, sizeof(params));
+  opt += sizeof(params);
+  *opt++ = DHCP_OPT_END;
+  return (int)(opt - (uint8_t *)msg);
+}
+
+/**
+ * @brief parse the reply to the request
+ *
+ * @param msg the reply
+ * @param len the length of the reply
+ * @param xid the transaction id of the request
+ * @param mac the hardware address of the interface
+ * @param[in,out] rec the lease, only updated from an ACK of its address
+ * @return DHCP_MSG_ACK or DHCP_MSG_NAK
+ * @return 0 if the message is not a reply to the request
+ */
+static int
+lease_parse_reply(const struct dhcp_msg * msg, int len, uint32_t xid,
+                  const struct net_linkaddr * mac, struct ob_wifi_lease_record * rec)
+{
+  const uint8_t *opt = msg->options;
+  const uint8_t *end = (const uint8_t *)msg + len;
+  struct ob_wifi_lease_record reply = *rec;
+  int type = 0;
+
+  if((len < (int)offsetof(struct dhcp_msg, options)) || (DHCP_OP_REPLY != msg->op) ||
+     (xid != msg->xid) || (0 != memcmp(msg->chaddr, mac->addr, MIN(mac->len, sizeof(msg->chaddr)))) ||
+     (0 != memcmp(msg->cookie, dhcp_cookie, sizeof(dhcp_cookie)))) {
+    return 0;
+  }
+  while((opt < end) && (DHCP_OPT_END != *opt)) {
+    if(DHCP_OPT_PAD == *opt) {
+      opt++;
+      continue;
+    }
+    if(((opt + 2) > end) || ((opt + 2 + opt[1]) > end)) {
+      break;
+    }
+    switch(opt[0]) {
+    case DHCP_OPT_MSG_TYPE:
+      type = (opt[1] >= 1) ? opt[2] : 0;
+      break;
+    case DHCP_OPT_SUBNET_MASK:
+      if(opt[1] >= sizeof(struct in_addr)) {
+        memcpy(&reply.netmask, &opt[2], sizeof(struct in_addr));
+      }
+      break;
+    case DHCP_OPT_ROUTER:
+      if(opt[1] >= sizeof(struct in_addr)) {
+        memcpy(&reply.gateway, &opt[2], sizeof(struct in_addr));
+      }
+      break;
+    case DHCP_OPT_DNS:
+      if(opt[1] >= sizeof(struct in_addr)) {
+        memcpy(&reply.dns, &opt[2], sizeof(struct in_addr));
+      }
+      break;
+    case DHCP_OPT_SERVER_ID:
+      if(opt[1] >= sizeof(struct in_addr)) {
+        memcpy(&reply.server, &opt[2], sizeof(struct in_addr));
+      }
+      break;
+    case DHCP_OPT_LEASE_TIME:
+      if(opt[1] >= sizeof(uint32_t)) {
+        reply.lease_time = sys_get_be32(&opt[2]);
+      }
+      break;
+    default:
+      break;
+    }
+    opt += 2 + opt[1];
+  }
+  if(DHCP_MSG_ACK == type) {
+    // The held lease is left alone by a NAK or an ACK of another address
+    if(msg->yiaddr.s_addr != rec->addr.s_addr) {
+      return 0;
+    }
+    *rec = reply;
+  }
+  return ((DHCP_MSG_ACK == type) || (DHCP_MSG_NAK == type)) ? type : 0;
+}
+
+/**
+ * @brief close the socket of the exchange, called with lease_mutex held
+ */
+static void
+lease_close(void)
+{
+  if(lease.sock >= 0) {
+    zsock_close(lease.sock);
+    lease.sock = -1;
+  }
+}
+
+/**
+ * @brief send the request of the exchange, called with lease_mutex held
+ * @details the request of an INIT-REBOOT is broadcast, the request of a
+ * renewal is sent to the server of the lease.
+ *
+ * @return 0 on success
+ * @return a negative errno on error
+ */
+static int
+lease_send(void)
+{
+  bool renew = (LEASE_RENEWING == lease.state);
+  struct sockaddr_in server = { .sin_family = AF_INET, .sin_port = htons(DHCP_SERVER_PORT),
+                                .sin_addr.s_addr = INADDR_BROADCAST };
+  int len;
+
+  if(renew && (INADDR_ANY != lease.rec.server.s_addr)) {
+    server.sin_addr = lease.rec.server;
+  }
+  len = lease_build_request(&lease_msg, lease.xid, net_if_get_link_addr(lease.iface),
+                            &lease.rec.addr, renew);
+  if(zsock_sendto(lease.sock, &lease_msg, len, 0, (struct sockaddr *)&server, sizeof(server)) < 0) {
+    return -errno;
+  }
+  lease.tries++;
+  lease.resend = k_uptime_get() + (CONFIG_ONBOARDING_WIFI_LEASE_REBOOT_TIMEOUT / LEASE_REBOOT_TRIES);
+  return 0;
+}
+
+/**
+ * @brief open the socket and send the first request, called with lease_mutex held
+ *
+ * @return 0 on success
+ * @return a negative errno on error
+ */
+static int
+lease_exchange_start(void)
+{
+  struct sockaddr_in local = { .sin_family = AF_INET, .sin_port = htons(DHCP_CLIENT_PORT) };
+  struct ifreq ifr = { 0 };
+  int rc;
+
+  if((lease.sock = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+    return -errno;
+  }
+  net_if_get_name(lease.iface, ifr.ifr_name, sizeof(ifr.ifr_name));
+  if((zsock_setsockopt(lease.sock, SOL_SOCKET, SO_BINDTODEVICE, &ifr, sizeof(ifr)) < 0) ||
+     (zsock_bind(lease.sock, (struct sockaddr *)&local, sizeof(local)) < 0)) {
+    rc = -errno;
+    lease_close();
+    return rc;
+  }
+  lease.xid = sys_rand32_get();
+  lease.tries = 0;
+  lease.deadline = k_uptime_get() + CONFIG_ONBOARDING_WIFI_LEASE_REBOOT_TIMEOUT;
+  if((rc = lease_send()) < 0) {
+    lease_close();
+    return rc;
+  }
+  k_work_reschedule(&lease_work, K_MSEC(LEASE_POLL_INTERVAL));
+  return 0;
+}
+
+/**
+ * @brief read the replies received without waiting, called with lease_mutex held
+ *
+ * @return DHCP_MSG_ACK or DHCP_MSG_NAK
+ * @return 0 if no reply was received
+ */
+static int
+lease_receive(void)
+{
+  struct net_linkaddr *mac = net_if_get_link_addr(lease.iface);
+  int len;
+
+  while((len = zsock_recv(lease.sock, &lease_msg, sizeof(lease_msg), ZSOCK_MSG_DONTWAIT)) > 0) {
+    if((len = lease_parse_reply(&lease_msg, len, lease.xid, mac, &lease.rec)) > 0) {
+      return len;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief save the lease when it changed
+ *
+ * @param rec the lease
+ */
+static void
+lease_save(const struct ob_wifi_lease_record * rec)
+{
+  struct ob_wifi_lease_record old;
+
+  if((ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_LEASE, &old, sizeof(old)) == sizeof(old)) &&
+     (0 == memcmp(&old, rec, sizeof(*rec)))) {
+    return;
+  }
+  if(ob_nvs_data_write(NVS_SETTINGS_ID_WIFI_LEASE, rec, sizeof(*rec)) < 0) {
+    LOG_ERR("Unable to save the DHCP lease");
+  }
+}
+
+/**
+ * @brief start the lease from an ACK, called with lease_mutex held
+ * @details the renewal is scheduled at half the lease time (T1)
+ */
+static void
+lease_acknowledged(void)
+{
+  int64_t now = k_uptime_get();
+
+  if(LEASE_TIME_INFINITE == lease.rec.lease_time) {
+    lease.expiry = INT64_MAX;
+    k_work_cancel_delayable(&lease_work);
+  } else {
+    lease.expiry = now + ((int64_t)lease.rec.lease_time * MSEC_PER_SEC);
+    k_work_reschedule(&lease_work,
+                      K_MSEC(MAX((int64_t)lease.rec.lease_time * MSEC_PER_SEC / 2, MSEC_PER_SEC)));
+  }
+  lease.state = LEASE_BOUND;
+  lease_save(&lease.rec);
+}
+
+/**
+ * @brief give the address of the lease up, called with lease_mutex held
+ */
+static void
+lease_release(void)
+{
+  char buffer[NET_IPV4_ADDR_LEN];
+
+  if(LEASE_BOUND <= lease.state) {
+    net_addr_ntop(AF_INET, &lease.rec.addr, buffer, sizeof(buffer));
+    LOG_INF("Lease %s lost", buffer);
+    net_if_ipv4_addr_rm(lease.iface, &lease.rec.addr);
+  }
+  lease.state = LEASE_IDLE;
+}
+
+/**
+ * @brief handle the end of an exchange, called with lease_mutex held
+ *
+ * @param rc DHCP_MSG_ACK, DHCP_MSG_NAK or a negative errno
+ * @return 0 if the saved lease was acknowledged
+ * @return 1 if the lease is still held
+ * @return a negative errno if the lease was refused or lost
+ */
+static int
+lease_exchange_done(int rc)
+{
+  char buffer[NET_IPV4_ADDR_LEN];
+  int64_t remaining;
+
+  lease_close();
+  net_addr_ntop(AF_INET, &lease.rec.addr, buffer, sizeof(buffer));
+  if(LEASE_REBOOTING == lease.state) {
+    if(DHCP_MSG_NAK == rc) {
+      LOG_INF("Saved lease refused, discovering");
+      lease.state = LEASE_IDLE;
+      return -ECONNREFUSED;
+    }
+    if(DHCP_MSG_ACK != rc) {
+      LOG_WRN("No answer to the lease request (%d)", rc);
+      lease.state = LEASE_IDLE;
+      return rc;
+    }
+    if(NULL == net_if_ipv4_addr_add(lease.iface, &lease.rec.addr, NET_ADDR_DHCP, 0)) {
+      LOG_ERR("Unable to add %s", buffer);
+      lease.state = LEASE_IDLE;
+      return -ENOMEM;
+    }
+    net_if_ipv4_set_netmask_by_addr(lease.iface, &lease.rec.addr, &lease.rec.netmask);
+    if(INADDR_ANY != lease.rec.gateway.s_addr) {
+      net_if_ipv4_set_gw(lease.iface, &lease.rec.gateway);
+    }
+    LOG_INF("Saved lease %s acknowledged", buffer);
+    lease_acknowledged();
+    return 0;
+  }
+
+  if(DHCP_MSG_ACK == rc) {
+    LOG_DBG("Lease %s renewed for %u s", buffer, lease.rec.lease_time);
+    lease_acknowledged();
+    return 1;
+  }
+  if(DHCP_MSG_NAK == rc) {
+    lease_release();
+    return -ECONNREFUSED;
+  }
+  remaining = lease.expiry - k_uptime_get();
+  if(remaining < (2 * LEASE_RENEW_RETRY_MIN)) {
+    lease_release();
+    return -ETIMEDOUT;
+  }
+  LOG_WRN("No answer to the lease renewal (%d)", rc);
+  lease.state = LEASE_BOUND;
+  k_work_reschedule(&lease_work, K_MSEC(remaining / 2));
+  return 1;
+}
+
+/**
+ * @brief poll the exchange in progress or start the renewal of the lease
+ * @param work The work structure
+ */
+static void
+lease_work_handler(struct k_work * work)
+{
+  struct net_if *iface;
+  ob_wifi_lease_cb_t cb;
+  int result = 1;
+  int rc;
+
+  ARG_UNUSED(work);
+  k_mutex_lock(&lease_mutex, K_FOREVER);
+  switch(lease.state) {
+  case LEASE_BOUND:
+    lease.state = LEASE_RENEWING;
+    if((rc = lease_exchange_start()) < 0) {
+      result = lease_exchange_done(rc);
+    }
+    break;
+
+  case LEASE_REBOOTING:
+  case LEASE_RENEWING:
+    if(0 == (rc = lease_receive())) {
+      if(k_uptime_get() >= lease.deadline) {
+        rc = -ETIMEDOUT;
+      } else if((k_uptime_get() >= lease.resend) && (lease.tries < LEASE_REBOOT_TRIES)) {
+        rc = lease_send();
+      }
+    }
+    if(0 == rc) {
+      k_work_reschedule(&lease_work, K_MSEC(LEASE_POLL_INTERVAL));
+    } else {
+      result = lease_exchange_done(rc);
+    }
+    break;
+
+  default:
+    break;
+  }
+  cb = lease.cb;
+  iface = lease.iface;
+  k_mutex_unlock(&lease_mutex);
+  if((result <= 0) && (NULL != cb)) {
+    cb(iface, result);
+  }
+}
+
+int
+ob_wifi_lease_reboot(struct net_if * iface, const char * ssid, ob_wifi_lease_cb_t cb)
+{
+  char buffer[NET_IPV4_ADDR_LEN];
+  int rc;
+
+  k_mutex_lock(&lease_mutex, K_FOREVER);
+  if(lease_tried) {
+    k_mutex_unlock(&lease_mutex);
+    return -EALREADY;
+  }
+  lease_tried = true;
+  if((ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_LEASE, &lease.rec, sizeof(lease.rec)) != sizeof(lease.rec)) ||
+     (0 != strncmp(lease.rec.ssid, ssid, sizeof(lease.rec.ssid))) ||
+     (INADDR_ANY == lease.rec.addr.s_addr)) {
+    k_mutex_unlock(&lease_mutex);
+    return -ENOENT;
+  }
+  net_addr_ntop(AF_INET, &lease.rec.addr, buffer, sizeof(buffer));
+  LOG_DBG("Requesting %s", buffer);
+  lease.iface = iface;
+  lease.cb = cb;
+  lease.state = LEASE_REBOOTING;
+  if((rc = lease_exchange_start()) < 0) {
+    LOG_WRN("Unable to request the saved lease (%d)", rc);
+    lease.state = LEASE_IDLE;
+  }
+  k_mutex_unlock(&lease_mutex);
+  return rc;
+}
+
+void
+ob_wifi_lease_stop(void)
+{
+  k_mutex_lock(&lease_mutex, K_FOREVER);
+  k_work_cancel_delayable(&lease_work);
+  lease_close();
+  lease_release();
+  k_mutex_unlock(&lease_mutex);
+}
+
+void
+ob_wifi_lease_bound(struct net_if * iface, const char * ssid)
+{
+  struct ob_wifi_lease_record rec = { 0 };
+
+  strncpy(rec.ssid, ssid, sizeof(rec.ssid) - 1);
+  rec.addr = iface->config.dhcpv4.requested_ip;
+  rec.server = iface->config.dhcpv4.server_id;
+  rec.lease_time = iface->config.dhcpv4.lease_time;
+  if(NULL != iface->config.ip.ipv4) {
+    rec.gateway = iface->config.ip.ipv4->gw;
+  }
+  rec.netmask = net_if_ipv4_get_netmask_by_addr(iface, &rec.addr);
+#ifdef CONFIG_DNS_RESOLVER
+  {
+    struct dns_resolve_context *ctx = dns_resolve_get_default();
+
+    if((NULL != ctx) && (AF_INET == ctx->servers[0].dns_server.sa_family)) {
+      rec.dns = net_sin(&ctx->servers[0].dns_server)->sin_addr;
+    }
+  }
+#endif // CONFIG_DNS_RESOLVER
+
+  if(INADDR_ANY != rec.addr.s_addr) {
+    lease_save(&rec);
+  }
+}
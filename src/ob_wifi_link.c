@@ -0,0 +1,143 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
+
+#include "ob_wifi.h"
+#include "ob_wifi_link.h"
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/**
+ * @brief the link supervisor, protected by link_lock
+ */
+static struct {
+  /** @brief the uptime when the station lost its connection, 0 while connected */
+  int64_t lost_at;
+  /** @brief the uptime when the station last got an address, 0 if never */
+  int64_t up_since;
+  /** @brief an incident is open */
+  bool down;
+  /** @brief the Ethernet interface, NULL until its carrier came up */
+  struct net_if * ethernet;
+  /** @brief the counters */
+  struct ob_wifi_link_stats stats;
+} link;
+
+/** @brief protects link */
+static struct k_spinlock link_lock;
+
+void
+ob_wifi_link_lost(void)
+{
+  int64_t now = k_uptime_get();
+  k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+  if(0 == link.lost_at) {
+    link.lost_at = now;
+    if((link.up_since > 0) && ((now - link.up_since) < CONFIG_ONBOARDING_WIFI_LINK_STABLE)) {
+      link.stats.flaps++;
+    } else {
+      link.stats.flaps = 0;
+    }
+  }
+  k_spin_unlock(&link_lock, key);
+}
+
+int
+ob_wifi_link_incident(void)
+{
+  k_spinlock_key_t key = k_spin_lock(&link_lock);
+  int flaps;
+
+  if(0 == link.lost_at) {
+    link.lost_at = k_uptime_get();
+  }
+  link.down = true;
+  flaps = link.stats.flaps;
+  k_spin_unlock(&link_lock, key);
+  LOG_WRN("Wifi link lost, reconnecting");
+  return flaps;
+}
+
+void
+ob_wifi_link_restored(void)
+{
+  int64_t now = k_uptime_get();
+  int32_t downtime = 0;
+  bool down;
+  k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+  down = link.down;
+  if(down) {
+    downtime = (int32_t)(now - link.lost_at);
+    link.stats.incidents++;
+    link.stats.last_ms = downtime;
+    link.stats.max_ms = MAX(link.stats.max_ms, downtime);
+    link.stats.total_ms += downtime;
+    link.down = false;
+  }
+  link.lost_at = 0;
+  link.up_since = now;
+  k_spin_unlock(&link_lock, key);
+  if(down) {
+    LOG_INF("Wifi link restored after %d ms", downtime);
+  }
+}
+
+void
+ob_wifi_link_forget(void)
+{
+  k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+  link.up_since = 0;
+  link.stats.flaps = 0;
+  k_spin_unlock(&link_lock, key);
+}
+
+void
+ob_wifi_link_carrier(struct net_if * iface, bool on)
+{
+  k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+  link.ethernet = iface;
+  if(on && !link.stats.ethernet) {
+    link.stats.failovers++;
+  }
+  link.stats.ethernet = on;
+  k_spin_unlock(&link_lock, key);
+  ob_wifi_link_set_default();
+}
+
+void
+ob_wifi_link_set_default(void)
+{
+  struct net_if * iface = net_if_get_wifi_sta();
+  k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+  if(link.stats.ethernet && (NULL != link.ethernet)) {
+    iface = link.ethernet;
+  }
+  k_spin_unlock(&link_lock, key);
+  if((NULL != iface) && (net_if_get_default() != iface)) {
+    LOG_INF("Default interface %d", net_if_get_by_iface(iface));
+    net_if_set_default(iface);
+  }
+}
+
+void
+ob_wifi_link_get_stats(struct ob_wifi_link_stats * stats)
+{
+  k_spinlock_key_t key = k_spin_lock(&link_lock);
+
+  *stats = link.stats;
+  if(link.down) {
+    stats->down_ms = (int32_t)(k_uptime_get() - link.lost_at);
+  }
+  k_spin_unlock(&link_lock, key);
+}
@@ -0,0 +1,411 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/icmp.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/wifi_mgmt.h>
+#ifdef CONFIG_NET_STATISTICS_WIFI
+#include <zephyr/net/net_stats.h>
+#endif // CONFIG_NET_STATISTICS_WIFI
+
+#include "ob_wifi.h"
+#include "ob_wifi_probe.h"
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+#include "ob_wifi_ps.h"
+#endif // CONFIG_ONBOARDING_WIFI_PS
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+BUILD_ASSERT(CONFIG_ONBOARDING_WIFI_PROBE_TIMEOUT < CONFIG_ONBOARDING_WIFI_PROBE_INTERVAL,
+             "The probe timeout must be shorter than its interval");
+
+/** @brief the identifier of the echo requests of the probe */
+#define PROBE_IDENTIFIER 0x4f42
+/** @brief the fixed point scale of the smoothed RSSI */
+#define PROBE_EWMA_SCALE 16
+/** @brief the gain of the jitter estimator, as in RFC 3550 */
+#define PROBE_JITTER_GAIN 16
+
+/**
+ * @brief the probe
+ * @details the target, the pending requests and the statistics are
+ * protected by probe_lock, the rest is only used from the system work queue
+ */
+static struct {
+  /** @brief the ICMP context receiving the echo replies */
+  struct net_icmp_ctx ctx;
+  /** @brief ctx is initialized */
+  bool ctx_ready;
+  /** @brief the requests of the round are sent, waiting for the timeout */
+  bool waiting;
+  /** @brief the sequence number of the last request */
+  uint16_t sequence;
+  /** @brief the smoothed RSSI in 1/PROBE_EWMA_SCALE dBm */
+  int rssi_ewma;
+  /** @brief rssi_ewma is valid */
+  bool rssi_tracking;
+  /** @brief the probe target */
+  struct in_addr target;
+  /** @brief a reply is expected from the destination */
+  bool pending[OB_WIFI_PROBE_PATHS];
+  /** @brief the sequence number of the request to the destination */
+  uint16_t pending_sequence[OB_WIFI_PROBE_PATHS];
+  /** @brief the cycle count when the request to the destination was sent */
+  uint32_t pending_cycles[OB_WIFI_PROBE_PATHS];
+  /** @brief the statistics */
+  struct ob_wifi_probe_stats stats;
+} probe;
+
+/** @brief protects the destinations and the statistics of probe */
+static struct k_spinlock probe_lock;
+
+static void probe_work_handler(struct k_work * work);
+/** @brief runs the probe */
+static K_WORK_DELAYABLE_DEFINE(probe_work, probe_work_handler);
+
+/**
+ * @brief smooth a loss sample into a destination, called with probe_lock held
+ *
+ * @param path the destination
+ * @param lost true if the reply did not come back in time
+ */
+static void
+probe_loss(struct ob_wifi_probe_path * path, bool lost)
+{
+  int sample = lost ? 1000 : 0;
+
+  path->loss_permille += ((sample - (int)path->loss_permille) *
+                          CONFIG_ONBOARDING_WIFI_PROBE_EWMA_WEIGHT) / 100;
+}
+
+/**
+ * @brief add a round trip time to a destination, called with probe_lock held
+ *
+ * @param path the destination
+ * @param rtt the round trip time in microseconds
+ */
+static void
+probe_sample(struct ob_wifi_probe_path * path, uint32_t rtt)
+{
+  int32_t delta;
+
+  if(0 == path->received) {
+    path->srtt_us = rtt;
+    path->min_us = rtt;
+    path->max_us = rtt;
+    path->jitter_us = 0;
+  } else {
+    delta = (int32_t)rtt - (int32_t)path->rtt_us;
+    if(delta < 0) {
+      delta = -delta;
+    }
+    path->jitter_us = (int32_t)path->jitter_us + ((delta - (int32_t)path->jitter_us) / PROBE_JITTER_GAIN);
+    path->srtt_us = (int32_t)path->srtt_us + ((((int32_t)rtt - (int32_t)path->srtt_us) *
+                                               CONFIG_ONBOARDING_WIFI_PROBE_EWMA_WEIGHT) / 100);
+    path->min_us = MIN(path->min_us, rtt);
+    path->max_us = MAX(path->max_us, rtt);
+  }
+  path->rtt_us = rtt;
+  path->received++;
+  probe_loss(path, false);
+}
+
+/**
+ * @brief ICMP handler of the echo replies
+ * @details called from the network RX thread for every echo reply, the
+ * replies to other requests are ignored
+ */
+static int
+probe_reply(struct net_icmp_ctx * ctx, struct net_pkt * pkt, struct net_icmp_ip_hdr * ip_hdr,
+            struct net_icmp_hdr * icmp_hdr, void * user_data)
+{
+  uint32_t cycles = k_cycle_get_32();
+  uint32_t rtt = 0;
+  uint16_t identifier;
+  uint16_t sequence;
+  k_spinlock_key_t key;
+  int i;
+
+  ARG_UNUSED(ctx);
+  ARG_UNUSED(ip_hdr);
+  ARG_UNUSED(icmp_hdr);
+  ARG_UNUSED(user_data);
+  net_pkt_cursor_init(pkt);
+  if(net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt) + net_pkt_ipv4_opts_len(pkt) +
+                  sizeof(struct net_icmp_hdr)) ||
+     net_pkt_read_be16(pkt, &identifier) || net_pkt_read_be16(pkt, &sequence) ||
+     (PROBE_IDENTIFIER != identifier)) {
+    return 0;
+  }
+  key = k_spin_lock(&probe_lock);
+  for(i = 0; i < OB_WIFI_PROBE_PATHS; i++) {
+    if(probe.pending[i] && (probe.pending_sequence[i] == sequence)) {
+      probe.pending[i] = false;
+      rtt = k_cyc_to_us_floor32(cycles - probe.pending_cycles[i]);
+      probe_sample(&probe.stats.paths[i], rtt);
+      break;
+    }
+  }
+  k_spin_unlock(&probe_lock, key);
+#ifdef CONFIG_ONBOARDING_WIFI_PS
+  if((i == OB_WIFI_PROBE_GATEWAY) && (rtt > 0)) {
+    /* The gateway is one hop away, its round trip time mostly depends on the power save */
+    ob_wifi_ps_rtt(rtt);
+  }
+#endif // CONFIG_ONBOARDING_WIFI_PS
+  return 0;
+}
+
+/**
+ * @brief read the RSSI, the TX rate and the counters of the station
+ *
+ * @param iface the station interface
+ * @return true if the station is connected
+ */
+static bool
+probe_radio(struct net_if * iface)
+{
+  struct wifi_iface_status status = { 0 };
+#ifdef CONFIG_NET_STATISTICS_WIFI
+  struct net_stats_wifi wifi_stats = { 0 };
+  bool counters;
+#endif // CONFIG_NET_STATISTICS_WIFI
+  k_spinlock_key_t key;
+
+  if((0 == ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_NO_WAIT)) ||
+     net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface, &status, sizeof(status)) ||
+     (WIFI_STATE_COMPLETED != status.state)) {
+    probe.rssi_tracking = false;
+    key = k_spin_lock(&probe_lock);
+    probe.stats.rssi = 0;
+    k_spin_unlock(&probe_lock, key);
+    return false;
+  }
+  if(!probe.rssi_tracking) {
+    probe.rssi_ewma = status.rssi * PROBE_EWMA_SCALE;
+    probe.rssi_tracking = true;
+  } else {
+    probe.rssi_ewma += (((status.rssi * PROBE_EWMA_SCALE) - probe.rssi_ewma) *
+                        CONFIG_ONBOARDING_WIFI_PROBE_EWMA_WEIGHT) / 100;
+  }
+#ifdef CONFIG_NET_STATISTICS_WIFI
+  counters = (0 == net_mgmt(NET_REQUEST_STATS_GET_WIFI, iface, &wifi_stats, sizeof(wifi_stats)));
+#endif // CONFIG_NET_STATISTICS_WIFI
+  key = k_spin_lock(&probe_lock);
+  probe.stats.rssi = status.rssi;
+  probe.stats.rssi_avg = probe.rssi_ewma / PROBE_EWMA_SCALE;
+  probe.stats.tx_rate = status.current_phy_tx_rate;
+#ifdef CONFIG_NET_STATISTICS_WIFI
+  if(counters) {
+    probe.stats.tx_packets = wifi_stats.pkts.tx;
+    probe.stats.tx_errors = wifi_stats.errors.tx;
+    probe.stats.rx_errors = wifi_stats.errors.rx;
+  }
+#endif // CONFIG_NET_STATISTICS_WIFI
+  k_spin_unlock(&probe_lock, key);
+  return true;
+}
+
+/**
+ * @brief send an echo request to a destination
+ *
+ * @param iface the station interface
+ * @param id the destination
+ * @param addr the address of the destination
+ */
+static void
+probe_send(struct net_if * iface, enum ob_wifi_probe_path_id id, const struct in_addr * addr)
+{
+  struct sockaddr_in dst = {
+    .sin_family = AF_INET,
+    .sin_addr = *addr
+  };
+  struct net_icmp_ping_params params = {
+    .identifier = PROBE_IDENTIFIER,
+    .sequence = ++probe.sequence
+  };
+  k_spinlock_key_t key;
+  int rc;
+
+  key = k_spin_lock(&probe_lock);
+  probe.stats.paths[id].addr = *addr;
+  probe.pending_sequence[id] = params.sequence;
+  probe.pending_cycles[id] = k_cycle_get_32();
+  probe.pending[id] = true;
+  k_spin_unlock(&probe_lock, key);
+
+  rc = net_icmp_send_echo_request(&probe.ctx, iface, (struct sockaddr *)&dst, &params, NULL);
+
+  key = k_spin_lock(&probe_lock);
+  if(rc < 0) {
+    probe.pending[id] = false;
+  } else {
+    probe.stats.paths[id].sent++;
+  }
+  k_spin_unlock(&probe_lock, key);
+  if(rc < 0) {
+    LOG_DBG("Probe request failed %d", rc);
+  }
+}
+
+/**
+ * @brief start a round
+ *
+ * @return true if a request was sent
+ */
+static bool
+probe_round(void)
+{
+  struct net_if * iface = net_if_get_wifi_sta();
+  struct in_addr gateway = { 0 };
+  struct in_addr target;
+  k_spinlock_key_t key;
+
+  if((NULL == iface) || !probe_radio(iface)) {
+    return false;
+  }
+  if(NULL != iface->config.ip.ipv4) {
+    gateway = iface->config.ip.ipv4->gw;
+  }
+  key = k_spin_lock(&probe_lock);
+  target = probe.target;
+  probe.stats.rounds++;
+  probe.stats.timestamp = k_uptime_get();
+  k_spin_unlock(&probe_lock, key);
+  if(INADDR_ANY != gateway.s_addr) {
+    probe_send(iface, OB_WIFI_PROBE_GATEWAY, &gateway);
+  }
+  if(INADDR_ANY != target.s_addr) {
+    probe_send(iface, OB_WIFI_PROBE_TARGET, &target);
+  }
+  return (INADDR_ANY != gateway.s_addr) || (INADDR_ANY != target.s_addr);
+}
+
+/**
+ * @brief count the replies that did not come back in time as lost
+ */
+static void
+probe_timeout(void)
+{
+  k_spinlock_key_t key = k_spin_lock(&probe_lock);
+  int i;
+
+  for(i = 0; i < OB_WIFI_PROBE_PATHS; i++) {
+    if(probe.pending[i]) {
+      probe.pending[i] = false;
+      probe_loss(&probe.stats.paths[i], true);
+    }
+  }
+  k_spin_unlock(&probe_lock, key);
+}
+
+/**
+ * @brief Run the probe
+ * @param work The work structure
+ */
+static void
+probe_work_handler(struct k_work * work)
+{
+  ARG_UNUSED(work);
+  if(probe.waiting) {
+    probe.waiting = false;
+    probe_timeout();
+    k_work_reschedule(&probe_work, K_MSEC(CONFIG_ONBOARDING_WIFI_PROBE_INTERVAL -
+                                          CONFIG_ONBOARDING_WIFI_PROBE_TIMEOUT));
+  } else if(probe_round()) {
+    probe.waiting = true;
+    k_work_reschedule(&probe_work, K_MSEC(CONFIG_ONBOARDING_WIFI_PROBE_TIMEOUT));
+  } else {
+    k_work_reschedule(&probe_work, K_MSEC(CONFIG_ONBOARDING_WIFI_PROBE_INTERVAL));
+  }
+}
+
+void
+ob_wifi_probe_init(void)
+{
+  struct in_addr target = { 0 };
+  int rc;
+
+  if(!probe.ctx_ready) {
+    if((rc = net_icmp_init_ctx(&probe.ctx, NET_ICMPV4_ECHO_REPLY, 0, probe_reply)) < 0) {
+      LOG_ERR("Unable to start the link probe %d", rc);
+      return;
+    }
+    probe.ctx_ready = true;
+  }
+  if(('\0' != CONFIG_ONBOARDING_WIFI_PROBE_TARGET[0]) &&
+     net_addr_pton(AF_INET, CONFIG_ONBOARDING_WIFI_PROBE_TARGET, &target)) {
+    LOG_ERR("Invalid probe target %s", CONFIG_ONBOARDING_WIFI_PROBE_TARGET);
+  } else if(INADDR_ANY != target.s_addr) {
+    ob_wifi_probe_set_target(&target);
+  }
+  probe.waiting = false;
+  probe.rssi_tracking = false;
+  k_work_reschedule(&probe_work, K_MSEC(CONFIG_ONBOARDING_WIFI_PROBE_INTERVAL));
+}
+
+void
+ob_wifi_probe_stop(void)
+{
+  struct k_work_sync sync;
+
+  k_work_cancel_delayable_sync(&probe_work, &sync);
+  probe.waiting = false;
+  probe_timeout();
+  if(probe.ctx_ready) {
+    net_icmp_cleanup_ctx(&probe.ctx);
+    probe.ctx_ready = false;
+  }
+}
+
+void
+ob_wifi_probe_set_target(const struct in_addr * addr)
+{
+  k_spinlock_key_t key = k_spin_lock(&probe_lock);
+
+  if(NULL == addr) {
+    probe.target.s_addr = INADDR_ANY;
+  } else {
+    probe.target = *addr;
+  }
+  if(probe.target.s_addr != probe.stats.paths[OB_WIFI_PROBE_TARGET].addr.s_addr) {
+    /* The statistics of the previous target do not apply */
+    probe.pending[OB_WIFI_PROBE_TARGET] = false;
+    memset(&probe.stats.paths[OB_WIFI_PROBE_TARGET], 0, sizeof(probe.stats.paths[0]));
+    probe.stats.paths[OB_WIFI_PROBE_TARGET].addr = probe.target;
+  }
+  k_spin_unlock(&probe_lock, key);
+}
+
+void
+ob_wifi_probe_reset(void)
+{
+  k_spinlock_key_t key = k_spin_lock(&probe_lock);
+  int i;
+
+  for(i = 0; i < OB_WIFI_PROBE_PATHS; i++) {
+    struct in_addr addr = probe.stats.paths[i].addr;
+
+    probe.pending[i] = false;
+    memset(&probe.stats.paths[i], 0, sizeof(probe.stats.paths[i]));
+    probe.stats.paths[i].addr = addr;
+  }
+  probe.stats.rounds = 0;
+  k_spin_unlock(&probe_lock, key);
+}
+
+void
+ob_wifi_probe_get_stats(struct ob_wifi_probe_stats * stats)
+{
+  k_spinlock_key_t key = k_spin_lock(&probe_lock);
+
+  *stats = probe.stats;
+  k_spin_unlock(&probe_lock, key);
+}
@@ -0,0 +1,689 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "ob_wifi.h"
+#include "ob_wifi_profile.h"
+#include "ob_nvs_data.h"
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+#include <mbedtls/md.h>
+#include <zephyr/sys/byteorder.h>
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief the size of a profile data record identifier */
+#define PROFILE_KEY_SIZE (sizeof(NVS_SETTINGS_ID_WIFI_PROFILE) + 4)
+
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+/** @brief the length of a WPA2 PMK */
+#define WIFI_PMK_LEN 32
+/** @brief the number of PBKDF2 iterations used to derive the PMK */
+#define WIFI_PMK_ITERATIONS 4096
+/** @brief the length of a SHA1 HMAC, the PBKDF2 block size */
+#define WIFI_PMK_BLOCK_LEN 20
+/** @brief the number of PBKDF2 iterations between two yields of the derivation */
+#define WIFI_PMK_YIELD_ITERATIONS 256
+
+/**
+ * @brief a PMK and the SSID it was derived for
+ * @details the legacy record at NVS_SETTINGS_ID_WIFI_PMK
+ */
+struct ob_wifi_pmk_record {
+  /** @brief the SSID the PMK was derived for */
+  char ssid[WIFI_SSID_MAX_LEN];
+  /** @brief the length of the SSID */
+  uint8_t ssid_len;
+  /** @brief the PMK */
+  uint8_t pmk[WIFI_PMK_LEN];
+};
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+
+/** @brief the profiles, an empty SSID marks an unused entry */
+static struct ob_wifi_profile profiles[CONFIG_ONBOARDING_WIFI_PROFILES];
+/** @brief the sequence number of the most recent successful connection */
+static uint32_t profile_sequence = 0;
+/** @brief protects profiles and profile_sequence */
+static K_MUTEX_DEFINE(profile_mutex);
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+BUILD_ASSERT(CONFIG_ONBOARDING_WIFI_PROFILES <= 32, "the PMK masks are 32 bit");
+/**
+ * @brief the profiles whose passphrase is only kept in RAM until the PMK
+ * replaces it, protected by profile_mutex
+ */
+static uint32_t pmk_pending = 0;
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+
+/**
+ * @brief build the data record identifier of a profile
+ *
+ * @param key the buffer for the identifier, PROFILE_KEY_SIZE bytes
+ * @param index the index of the profile
+ */
+static void
+profile_key(char * key, int index)
+{
+  snprintf(key, PROFILE_KEY_SIZE, NVS_SETTINGS_ID_WIFI_PROFILE "/%d", index);
+}
+
+/**
+ * @brief save a profile, or delete its record if the entry is unused
+ * @details with CONFIG_ONBOARDING_WIFI_PMK a profile waiting for its PMK is
+ * not saved, the derivation saves it with the PMK
+ *
+ * @param index the index of the profile
+ * @return 0 on success
+ * @return a negative errno on error
+ */
+static int
+profile_save_locked(int index)
+{
+  char key[PROFILE_KEY_SIZE];
+  int rc;
+
+  profile_key(key, index);
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+  if('\0' == profiles[index].ssid[0]) {
+    pmk_pending &= ~BIT(index);
+  } else if(pmk_pending & BIT(index)) {
+    return 0;
+  }
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+  if('\0' == profiles[index].ssid[0]) {
+    return ob_nvs_data_delete(key);
+  }
+  rc = ob_nvs_data_write(key, &profiles[index], sizeof(profiles[index]));
+  return (rc < 0) ? rc : 0;
+}
+
+/**
+ * @brief find the profile of an SSID
+ *
+ * @param ssid the SSID, NUL terminated
+ * @return the index of the profile, -1 if not found
+ */
+static int
+profile_find_locked(const char * ssid)
+{
+  int i;
+
+  for(i = 0; i < ARRAY_SIZE(profiles); i++) {
+    if(('\0' != profiles[i].ssid[0]) && (0 == strcmp(profiles[i].ssid, ssid))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief compare the rank of two profiles outside of a scan
+ *
+ * @return true if profile a ranks before profile b
+ */
+static bool
+profile_before(const struct ob_wifi_profile * a, const struct ob_wifi_profile * b)
+{
+  if(a->priority != b->priority) {
+    return a->priority > b->priority;
+  }
+  return a->last_success > b->last_success;
+}
+
+/**
+ * @brief pick the entry a new profile goes to
+ *
+ * @return the first unused entry, or the entry with the lowest rank
+ */
+static int
+profile_slot_locked(void)
+{
+  int slot = 0;
+  int i;
+
+  for(i = 0; i < ARRAY_SIZE(profiles); i++) {
+    if('\0' == profiles[i].ssid[0]) {
+      return i;
+    }
+    if(profile_before(&profiles[slot], &profiles[i])) {
+      slot = i;
+    }
+  }
+  LOG_INF("Profile table full, replacing %s", profiles[slot].ssid);
+  return slot;
+}
+
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+/**
+ * @brief derive the WPA2 PMK of a passphrase as 64 hex digits
+ * @details PBKDF2-HMAC-SHA1 (IEEE 802.11 J.4). The thread yields every
+ * WIFI_PMK_YIELD_ITERATIONS iterations so the derivation does not hold
+ * the CPU from the threads of the same priority.
+ *
+ * @param ssid the SSID
+ * @param psk the passphrase
+ * @param[out] hex the PMK, WIFI_PSK_MAX_LEN + 1 bytes
+ * @return 0 on success
+ * @return -EIO on error
+ */
+static int
+derive_pmk(const char * ssid, const char * psk, char * hex)
+{
+  mbedtls_md_context_t ctx;
+  uint8_t pmk[WIFI_PMK_LEN];
+  uint8_t u[WIFI_PMK_BLOCK_LEN];
+  uint8_t t[WIFI_PMK_BLOCK_LEN];
+  uint8_t counter[4];
+  int64_t start = k_uptime_get();
+  size_t offset = 0;
+  uint32_t block;
+  int rc;
+  int i;
+  int j;
+
+  mbedtls_md_init(&ctx);
+  rc = mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1);
+  if(0 == rc) {
+    rc = mbedtls_md_hmac_starts(&ctx, (const unsigned char *)psk, strlen(psk));
+  }
+  for(block = 1; (0 == rc) && (offset < WIFI_PMK_LEN); block++) {
+    sys_put_be32(block, counter);
+    if((0 != (rc = mbedtls_md_hmac_update(&ctx, (const unsigned char *)ssid, strlen(ssid)))) ||
+       (0 != (rc = mbedtls_md_hmac_update(&ctx, counter, sizeof(counter)))) ||
+       (0 != (rc = mbedtls_md_hmac_finish(&ctx, u)))) {
+      break;
+    }
+    memcpy(t, u, sizeof(t));
+    for(i = 1; i < WIFI_PMK_ITERATIONS; i++) {
+      if((0 != (rc = mbedtls_md_hmac_reset(&ctx))) ||
+         (0 != (rc = mbedtls_md_hmac_update(&ctx, u, sizeof(u)))) ||
+         (0 != (rc = mbedtls_md_hmac_finish(&ctx, u)))) {
+        break;
+      }
+      for(j = 0; j < (int)sizeof(t); j++) {
+        t[j] ^= u[j];
+      }
+      if(0 == (i % WIFI_PMK_YIELD_ITERATIONS)) {
+        k_yield();
+      }
+    }
+    if(0 == rc) {
+      memcpy(&pmk[offset], t, MIN(sizeof(t), WIFI_PMK_LEN - offset));
+      offset += MIN(sizeof(t), WIFI_PMK_LEN - offset);
+      rc = mbedtls_md_hmac_reset(&ctx);
+    }
+  }
+  mbedtls_md_free(&ctx);
+  memset(u, 0, sizeof(u));
+  memset(t, 0, sizeof(t));
+  if(rc != 0) {
+    LOG_ERR("PMK derivation failed %d", rc);
+    memset(pmk, 0, sizeof(pmk));
+    return -EIO;
+  }
+  bin2hex(pmk, WIFI_PMK_LEN, hex, WIFI_PSK_MAX_LEN + 1);
+  memset(pmk, 0, sizeof(pmk));
+  LOG_DBG("PMK derived in %lld ms", (long long)(k_uptime_get() - start));
+  return 0;
+}
+
+/**
+ * @brief check if the PMK should replace the PSK of a profile
+ * @details only a WPA2-PSK network can be joined with the PMK, the
+ * passphrase of any other network, or of a network not seen yet, is kept.
+ * An empty PSK is an open network and 64 digits are already a PMK. A
+ * passphrase shorter than WIFI_PSK_MIN_LEN is invalid and kept as it is,
+ * the connection reports the error.
+ *
+ * @param profile the profile
+ * @return true if the PMK should be derived
+ */
+static bool
+pmk_needed(const struct ob_wifi_profile * profile)
+{
+  size_t len = strlen(profile->psk);
+
+  return (WIFI_SECURITY_TYPE_PSK == profile->security) &&
+    (len >= WIFI_PSK_MIN_LEN) && (len < WIFI_PSK_MAX_LEN);
+}
+
+static K_THREAD_STACK_DEFINE(pmk_wq_stack, CONFIG_ONBOARDING_WIFI_PMK_STACK_SIZE);
+/** @brief the work queue deriving the PMKs, off the connect work queue */
+static struct k_work_q pmk_wq;
+/** @brief set once pmk_wq is started, protected by profile_mutex */
+static bool pmk_wq_started = false;
+
+static void pmk_work_handler(struct k_work * work);
+/** @brief replaces the passphrases of the profiles by their PMK */
+static K_WORK_DEFINE(pmk_work, pmk_work_handler);
+
+/**
+ * @brief derive the PMK of each WPA2-PSK profile that holds a passphrase
+ * @details the passphrase is copied out and the PMK derived without
+ * profile_mutex, the PMK replaces the passphrase only if the profile was
+ * not changed in the meantime. A profile whose derivation fails keeps its
+ * passphrase, in RAM only if it was never saved.
+ *
+ * @param work The work structure
+ */
+static void
+pmk_work_handler(struct k_work * work)
+{
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  char psk[WIFI_PSK_MAX_LEN + 1];
+  char pmk[WIFI_PSK_MAX_LEN + 1];
+  uint32_t failed = 0;
+  int index;
+  int i;
+
+  ARG_UNUSED(work);
+  for(;;) {
+    index = -1;
+    k_mutex_lock(&profile_mutex, K_FOREVER);
+    for(i = 0; i < ARRAY_SIZE(profiles); i++) {
+      if(('\0' != profiles[i].ssid[0]) && !(failed & BIT(i)) && pmk_needed(&profiles[i])) {
+        strcpy(ssid, profiles[i].ssid);
+        strcpy(psk, profiles[i].psk);
+        index = i;
+        break;
+      }
+    }
+    k_mutex_unlock(&profile_mutex);
+    if(index < 0) {
+      break;
+    }
+
+    if(derive_pmk(ssid, psk, pmk) < 0) {
+      LOG_WRN("PMK of %s not derived, keeping the passphrase in RAM", ssid);
+      failed |= BIT(index);
+      continue;
+    }
+    k_mutex_lock(&profile_mutex, K_FOREVER);
+    if((0 == strcmp(profiles[index].ssid, ssid)) && (0 == strcmp(profiles[index].psk, psk))) {
+      strcpy(profiles[index].psk, pmk);
+      pmk_pending &= ~BIT(index);
+      if(profile_save_locked(index) < 0) {
+        LOG_ERR("Unable to save the PMK of %s", ssid);
+        failed |= BIT(index);
+      }
+    }
+    k_mutex_unlock(&profile_mutex);
+  }
+  memset(psk, 0, sizeof(psk));
+  memset(pmk, 0, sizeof(pmk));
+}
+
+/**
+ * @brief queue the derivation of the PMKs, called with profile_mutex held
+ */
+static void
+pmk_schedule_locked(void)
+{
+  if(!pmk_wq_started) {
+    k_work_queue_init(&pmk_wq);
+    k_work_queue_start(&pmk_wq, pmk_wq_stack, K_THREAD_STACK_SIZEOF(pmk_wq_stack),
+                       K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+    k_thread_name_set(k_work_queue_thread_get(&pmk_wq), "ob_wifi_pmk");
+    pmk_wq_started = true;
+  }
+  k_work_submit_to_queue(&pmk_wq, &pmk_work);
+}
+
+bool
+ob_wifi_profile_has_pmk(const struct ob_wifi_profile * profile)
+{
+  return strlen(profile->psk) == WIFI_PSK_MAX_LEN;
+}
+
+void
+ob_wifi_profile_flush(void)
+{
+  struct k_work_sync sync;
+
+  k_work_flush(&pmk_work, &sync);
+}
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+
+/**
+ * @brief record the security a profile was seen with, called with profile_mutex held
+ * @details with CONFIG_ONBOARDING_WIFI_PMK a profile found to be WPA2-PSK
+ * gets its PMK derived, and a passphrase waiting for its PMK is saved as it
+ * is if the network is found not to be WPA2-PSK.
+ *
+ * @param index the index of the profile
+ * @param security the security (enum wifi_security_type) of the network
+ */
+static void
+profile_set_security_locked(int index, uint8_t security)
+{
+  if(profiles[index].security == security) {
+    return;
+  }
+  profiles[index].security = security;
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+  if(pmk_needed(&profiles[index])) {
+    pmk_schedule_locked();
+  } else if(pmk_pending & BIT(index)) {
+    pmk_pending &= ~BIT(index);
+    if(profile_save_locked(index) < 0) {
+      LOG_ERR("Unable to save profile %s", profiles[index].ssid);
+    }
+  }
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+}
+
+/**
+ * @brief move the credentials of the legacy records into the table
+ */
+static void
+profile_migrate_legacy(void)
+{
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  char psk[WIFI_PSK_MAX_LEN + 1];
+  bool found = false;
+  int len;
+
+  if((len = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_SSID, ssid, WIFI_SSID_MAX_LEN)) <= 0) {
+    return;
+  }
+  ssid[len] = '\0';
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+  struct ob_wifi_pmk_record rec;
+
+  if((ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_PMK, &rec, sizeof(rec)) == sizeof(rec)) &&
+     (rec.ssid_len == len) && (0 == memcmp(rec.ssid, ssid, len))) {
+    bin2hex(rec.pmk, WIFI_PMK_LEN, psk, sizeof(psk));
+    found = true;
+  }
+  memset(&rec, 0, sizeof(rec));
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+  if(!found) {
+    /* Wait for the PSK if only the SSID has been set from the shell */
+    if((len = ob_nvs_data_read(NVS_SETTINGS_ID_WIFI_PSK, psk, WIFI_PSK_MAX_LEN)) <= 0) {
+      return;
+    }
+    psk[len] = '\0';
+  }
+  if(ob_wifi_profile_add(ssid, psk, OB_WIFI_PROFILE_PRIORITY_DEFAULT) >= 0) {
+    LOG_INF("Moved the credentials of %s to a profile", ssid);
+    /* These are the credentials the device used last */
+    ob_wifi_profile_connected(ssid);
+    ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_SSID);
+    ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_PSK);
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+    ob_nvs_data_delete(NVS_SETTINGS_ID_WIFI_PMK);
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+  }
+  memset(psk, 0, sizeof(psk));
+}
+
+int
+ob_wifi_profile_load(void)
+{
+  char key[PROFILE_KEY_SIZE];
+  int i;
+
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  memset(profiles, 0, sizeof(profiles));
+  profile_sequence = 0;
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+  pmk_pending = 0;
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+  for(i = 0; i < ARRAY_SIZE(profiles); i++) {
+    profile_key(key, i);
+    if(ob_nvs_data_read(key, &profiles[i], sizeof(profiles[i])) != sizeof(profiles[i])) {
+      memset(&profiles[i], 0, sizeof(profiles[i]));
+      continue;
+    }
+    profiles[i].ssid[WIFI_SSID_MAX_LEN] = '\0';
+    profiles[i].psk[WIFI_PSK_MAX_LEN] = '\0';
+    profile_sequence = MAX(profile_sequence, profiles[i].last_success);
+  }
+  k_mutex_unlock(&profile_mutex);
+
+  profile_migrate_legacy();
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+  // Passphrases saved before the network was known to be WPA2-PSK
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  for(i = 0; i < ARRAY_SIZE(profiles); i++) {
+    if(('\0' != profiles[i].ssid[0]) && pmk_needed(&profiles[i])) {
+      pmk_schedule_locked();
+      break;
+    }
+  }
+  k_mutex_unlock(&profile_mutex);
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+  return ob_wifi_profile_count();
+}
+
+int
+ob_wifi_profile_add(const char * ssid, const char * psk, int priority)
+{
+  enum wifi_security_type security;
+  int psk_len = strlen(psk);
+  int index;
+  int rc;
+
+  if((strlen(ssid) == 0) || (strlen(ssid) > WIFI_SSID_MAX_LEN) ||
+     (psk_len > WIFI_PSK_MAX_LEN) || (priority < 0) || (priority > UINT8_MAX)) {
+    return -EINVAL;
+  }
+  // Looked up before profile_mutex is taken, the scan callbacks rank the profiles
+  security = ob_wifi_scan_security(ssid);
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  if((index = profile_find_locked(ssid)) < 0) {
+    index = profile_slot_locked();
+    memset(&profiles[index], 0, sizeof(profiles[index]));
+    strcpy(profiles[index].ssid, ssid);
+    profiles[index].security = security;
+  } else if(WIFI_SECURITY_TYPE_UNKNOWN != security) {
+    profiles[index].security = security;
+  }
+  strcpy(profiles[index].psk, psk);
+  profiles[index].priority = priority;
+#ifdef CONFIG_ONBOARDING_WIFI_PMK
+  if(pmk_needed(&profiles[index])) {
+    // The passphrase stays in RAM, the profile is saved once the PMK replaces it
+    pmk_pending |= BIT(index);
+    pmk_schedule_locked();
+  } else {
+    pmk_pending &= ~BIT(index);
+  }
+#endif // CONFIG_ONBOARDING_WIFI_PMK
+  if((rc = profile_save_locked(index)) < 0) {
+    LOG_ERR("Unable to save profile %s %d", ssid, rc);
+    index = rc;
+  }
+  k_mutex_unlock(&profile_mutex);
+  return index;
+}
+
+int
+ob_wifi_profile_remove(const char * ssid)
+{
+  int index;
+
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  if((index = profile_find_locked(ssid)) >= 0) {
+    memset(&profiles[index], 0, sizeof(profiles[index]));
+    profile_save_locked(index);
+  }
+  k_mutex_unlock(&profile_mutex);
+  return (index < 0) ? -ENOENT : 0;
+}
+
+int
+ob_wifi_profile_get(int index, struct ob_wifi_profile * profile)
+{
+  int rc = 0;
+
+  if((index < 0) || (index >= ARRAY_SIZE(profiles))) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  if('\0' == profiles[index].ssid[0]) {
+    rc = -ENOENT;
+  } else {
+    *profile = profiles[index];
+  }
+  k_mutex_unlock(&profile_mutex);
+  return rc;
+}
+
+int
+ob_wifi_profile_count(void)
+{
+  int count = 0;
+  int i;
+
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  for(i = 0; i < ARRAY_SIZE(profiles); i++) {
+    if('\0' != profiles[i].ssid[0]) {
+      count++;
+    }
+  }
+  k_mutex_unlock(&profile_mutex);
+  return count;
+}
+
+/**
+ * @brief find the profile that connected last, called with profile_mutex held
+ *
+ * @return the index of the profile
+ * @return -ENOENT if no profile connected yet
+ */
+static int
+profile_most_recent_locked(void)
+{
+  int index = -ENOENT;
+  uint32_t best = 0;
+  int i;
+
+  for(i = 0; i < ARRAY_SIZE(profiles); i++) {
+    if(('\0' != profiles[i].ssid[0]) && (profiles[i].last_success > best)) {
+      best = profiles[i].last_success;
+      index = i;
+    }
+  }
+  return index;
+}
+
+int
+ob_wifi_profile_most_recent(void)
+{
+  int index;
+
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  index = profile_most_recent_locked();
+  k_mutex_unlock(&profile_mutex);
+  return index;
+}
+
+/**
+ * @brief a profile being ranked
+ */
+struct profile_candidate {
+  /** @brief the index of the profile */
+  int index;
+  /** @brief the profile was seen by the scan */
+  bool visible;
+  /** @brief the strongest RSSI the profile was seen with */
+  int rssi;
+};
+
+/**
+ * @brief compare the rank of two candidates
+ *
+ * @return true if candidate a ranks before candidate b
+ */
+static bool
+candidate_before(const struct profile_candidate * a, const struct profile_candidate * b)
+{
+  const struct ob_wifi_profile * pa = &profiles[a->index];
+  const struct ob_wifi_profile * pb = &profiles[b->index];
+
+  if(a->visible != b->visible) {
+    return a->visible;
+  }
+  if(pa->priority != pb->priority) {
+    return pa->priority > pb->priority;
+  }
+  if(a->visible && (a->rssi != b->rssi)) {
+    return a->rssi > b->rssi;
+  }
+  return pa->last_success > pb->last_success;
+}
+
+int
+ob_wifi_profile_rank(ob_wifi_scan_snapshot_t * snap, int * order, int max)
+{
+  struct profile_candidate candidates[CONFIG_ONBOARDING_WIFI_PROFILES];
+  struct profile_candidate c;
+  uint8_t security = WIFI_SECURITY_TYPE_UNKNOWN;
+  ssid_item_t * it;
+  int count = 0;
+  int i;
+  int j;
+
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  for(i = 0; i < ARRAY_SIZE(profiles); i++) {
+    if('\0' == profiles[i].ssid[0]) {
+      continue;
+    }
+    c.index = i;
+    c.visible = false;
+    c.rssi = INT8_MIN;
+    for(it = (NULL != snap) ? snap->head : NULL; NULL != it; it = it->next) {
+      if(0 == strcmp(it->ssid, profiles[i].ssid)) {
+        /* The items are linked strongest first */
+        if(!c.visible) {
+          security = it->security_type;
+        }
+        c.visible = true;
+        c.rssi = MAX(c.rssi, it->rssi);
+      }
+    }
+    if(c.visible) {
+      profiles[i].last_rssi = CLAMP(c.rssi, INT8_MIN, INT8_MAX);
+      profile_set_security_locked(i, security);
+    }
+    /* Insertion sort, the table is small */
+    for(j = count; (j > 0) && candidate_before(&c, &candidates[j - 1]); j--) {
+      candidates[j] = candidates[j - 1];
+    }
+    candidates[j] = c;
+    count++;
+  }
+  k_mutex_unlock(&profile_mutex);
+
+  count = MIN(count, max);
+  for(i = 0; i < count; i++) {
+    order[i] = candidates[i].index;
+  }
+  return count;
+}
+
+void
+ob_wifi_profile_connected(const char * ssid)
+{
+  int index;
+
+  k_mutex_lock(&profile_mutex, K_FOREVER);
+  // Reconnecting to the network that connected last changes nothing, and
+  // rewriting the profile on every reconnection of a flapping link would
+  // wear the flash
+  if(((index = profile_find_locked(ssid)) >= 0) && (index != profile_most_recent_locked())) {
+    profiles[index].last_success = ++profile_sequence;
+    if(profile_save_locked(index) < 0) {
+      LOG_ERR("Unable to save profile %s", ssid);
+    }
+  }
+  k_mutex_unlock(&profile_mutex);
+}
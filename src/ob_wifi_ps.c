@@ -0,0 +1,438 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/wifi_mgmt.h>
+#ifdef CONFIG_NET_STATISTICS_WIFI
+#include <zephyr/net/net_stats.h>
+#endif // CONFIG_NET_STATISTICS_WIFI
+
+#include "ob_wifi.h"
+#include "ob_wifi_ps.h"
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief the names of the profiles */
+static const char * const ps_profile_names[OB_WIFI_PS_PROFILES] = {
+  [OB_WIFI_PS_LATENCY] = "latency",
+  [OB_WIFI_PS_BALANCED] = "balanced",
+  [OB_WIFI_PS_DEEP] = "deep",
+};
+
+/**
+ * @brief the power save state
+ * @details the fields are protected by ps_lock, the profile is applied
+ * from the system work queue
+ */
+static struct {
+  /** @brief the OB_WIFI_PS_HOLD_* bits set */
+  uint32_t holds;
+  /** @brief the forced profile, OB_WIFI_PS_AUTO if none */
+  enum ob_wifi_ps_profile forced;
+  /** @brief nothing reported activity for CONFIG_ONBOARDING_WIFI_PS_IDLE_DELAY */
+  bool idle;
+  /** @brief the profile must be applied again, the station reconnected */
+  bool reapply;
+  /** @brief the applied profile, OB_WIFI_PS_AUTO until one is */
+  enum ob_wifi_ps_profile current;
+  /** @brief the uptime when the current profile was applied */
+  int64_t since;
+  /** @brief the beacon counter of the station when the current profile was applied */
+  uint32_t beacons;
+  /** @brief a TWT agreement was requested or is in place */
+  bool twt;
+  /** @brief the counters */
+  struct ob_wifi_ps_stats stats[OB_WIFI_PS_PROFILES];
+} ps = {
+  .forced = OB_WIFI_PS_AUTO,
+  .current = OB_WIFI_PS_AUTO
+};
+
+/** @brief protects ps */
+static struct k_spinlock ps_lock;
+
+static void ps_work_handler(struct k_work * work);
+/** @brief applies the profile */
+static K_WORK_DEFINE(ps_work, ps_work_handler);
+static void ps_idle_handler(struct k_work * work);
+/** @brief selects the deep save profile once nothing reported activity */
+static K_WORK_DELAYABLE_DEFINE(ps_idle_work, ps_idle_handler);
+
+const char *
+ob_wifi_ps_profile_str(enum ob_wifi_ps_profile profile)
+{
+  if((profile < 0) || (profile >= OB_WIFI_PS_PROFILES)) {
+    return "auto";
+  }
+  return ps_profile_names[profile];
+}
+
+/**
+ * @brief select the profile of the operating phase, called with ps_lock held
+ *
+ * @return the profile
+ */
+static enum ob_wifi_ps_profile
+ps_select_locked(void)
+{
+  if(OB_WIFI_PS_AUTO != ps.forced) {
+    return ps.forced;
+  }
+  if(0 != ps.holds) {
+    return OB_WIFI_PS_LATENCY;
+  }
+  return ps.idle ? OB_WIFI_PS_DEEP : OB_WIFI_PS_BALANCED;
+}
+
+/**
+ * @brief read the beacon counter of the station
+ *
+ * @param iface the station interface
+ * @return the number of beacons received, 0 without CONFIG_NET_STATISTICS_WIFI
+ */
+static uint32_t
+ps_beacons(struct net_if * iface)
+{
+#ifdef CONFIG_NET_STATISTICS_WIFI
+  struct net_stats_wifi stats = { 0 };
+
+  if(0 == net_mgmt(NET_REQUEST_STATS_GET_WIFI, iface, &stats, sizeof(stats))) {
+    return stats.sta_mgmt.beacons_rx;
+  }
+#else
+  ARG_UNUSED(iface);
+#endif // CONFIG_NET_STATISTICS_WIFI
+  return 0;
+}
+
+/**
+ * @brief add the time and the beacons since the last update to the current
+ * profile, called with ps_lock held
+ *
+ * @param now the uptime
+ * @param beacons the beacon counter of the station
+ */
+static void
+ps_account_locked(int64_t now, uint32_t beacons)
+{
+  if(OB_WIFI_PS_AUTO == ps.current) {
+    return;
+  }
+  ps.stats[ps.current].time_ms += now - ps.since;
+  if(beacons >= ps.beacons) {
+    /* The counter restarts when the driver resets the station */
+    ps.stats[ps.current].beacons += beacons - ps.beacons;
+  }
+  ps.since = now;
+  ps.beacons = beacons;
+}
+
+/**
+ * @brief set a power save parameter
+ *
+ * @param iface the station interface
+ * @param params the parameters
+ * @param type the parameter to set
+ */
+static void
+ps_request(struct net_if * iface, struct wifi_ps_params * params, enum wifi_ps_param_type type)
+{
+  params->type = type;
+  if(net_mgmt(NET_REQUEST_WIFI_PS, iface, params, sizeof(*params))) {
+    LOG_WRN("Power save parameter %d not set, reason %d", type, params->fail_reason);
+  }
+}
+
+#ifdef CONFIG_ONBOARDING_WIFI_PS_TWT
+/**
+ * @brief request or tear down the TWT agreement
+ *
+ * @param iface the station interface
+ * @param setup true to request the agreement, false to tear it down
+ */
+static void
+ps_twt(struct net_if * iface, bool setup)
+{
+  struct wifi_twt_params params = {
+    .negotiation_type = WIFI_TWT_INDIVIDUAL,
+    .setup_cmd = WIFI_TWT_SETUP_CMD_REQUEST,
+    .dialog_token = 1,
+    .flow_id = 1
+  };
+  k_spinlock_key_t key;
+  int rc;
+
+  if(setup) {
+    params.operation = WIFI_TWT_SETUP;
+    params.setup.twt_interval = (uint64_t)CONFIG_ONBOARDING_WIFI_PS_TWT_INTERVAL * USEC_PER_MSEC;
+    params.setup.twt_wake_interval = CONFIG_ONBOARDING_WIFI_PS_TWT_WAKE;
+    params.setup.trigger = true;
+    params.setup.implicit = true;
+    params.setup.announce = true;
+  } else {
+    params.operation = WIFI_TWT_TEARDOWN;
+    params.teardown.teardown_all = true;
+  }
+  rc = net_mgmt(NET_REQUEST_WIFI_TWT, iface, &params, sizeof(params));
+  if(rc) {
+    LOG_WRN("TWT %s failed %d, reason %d", setup ? "setup" : "teardown", rc, params.fail_reason);
+  }
+  key = k_spin_lock(&ps_lock);
+  ps.twt = setup && (0 == rc);
+  k_spin_unlock(&ps_lock, key);
+}
+#endif // CONFIG_ONBOARDING_WIFI_PS_TWT
+
+/**
+ * @brief apply a profile to the station
+ *
+ * @param iface the station interface
+ * @param profile the profile
+ */
+static void
+ps_apply(struct net_if * iface, enum ob_wifi_ps_profile profile)
+{
+  struct wifi_ps_params params = { 0 };
+#ifdef CONFIG_ONBOARDING_WIFI_PS_TWT
+  struct wifi_iface_status status = { 0 };
+  k_spinlock_key_t key;
+  bool twt;
+
+  key = k_spin_lock(&ps_lock);
+  twt = ps.twt;
+  k_spin_unlock(&ps_lock, key);
+  if(twt && (OB_WIFI_PS_DEEP != profile)) {
+    ps_twt(iface, false);
+  }
+#endif // CONFIG_ONBOARDING_WIFI_PS_TWT
+
+  switch(profile) {
+  case OB_WIFI_PS_LATENCY:
+    params.enabled = WIFI_PS_DISABLED;
+    ps_request(iface, &params, WIFI_PS_PARAM_STATE);
+    break;
+
+  case OB_WIFI_PS_BALANCED:
+    params.wakeup_mode = WIFI_PS_WAKEUP_MODE_DTIM;
+    ps_request(iface, &params, WIFI_PS_PARAM_WAKEUP_MODE);
+    params.timeout_ms = CONFIG_ONBOARDING_WIFI_PS_TIMEOUT;
+    ps_request(iface, &params, WIFI_PS_PARAM_TIMEOUT);
+    params.enabled = WIFI_PS_ENABLED;
+    ps_request(iface, &params, WIFI_PS_PARAM_STATE);
+    break;
+
+  case OB_WIFI_PS_DEEP:
+  default:
+    params.listen_interval = CONFIG_ONBOARDING_WIFI_PS_LISTEN_INTERVAL;
+    ps_request(iface, &params, WIFI_PS_PARAM_LISTEN_INTERVAL);
+    params.wakeup_mode = WIFI_PS_WAKEUP_MODE_LISTEN_INTERVAL;
+    ps_request(iface, &params, WIFI_PS_PARAM_WAKEUP_MODE);
+    params.timeout_ms = CONFIG_ONBOARDING_WIFI_PS_TIMEOUT;
+    ps_request(iface, &params, WIFI_PS_PARAM_TIMEOUT);
+    params.enabled = WIFI_PS_ENABLED;
+    ps_request(iface, &params, WIFI_PS_PARAM_STATE);
+#ifdef CONFIG_ONBOARDING_WIFI_PS_TWT
+    if(!twt && (0 == net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface, &status, sizeof(status))) &&
+       status.twt_capable) {
+      ps_twt(iface, true);
+    }
+#endif // CONFIG_ONBOARDING_WIFI_PS_TWT
+    break;
+  }
+}
+
+/**
+ * @brief Apply the profile of the operating phase if it changed
+ * @param work The work structure
+ */
+static void
+ps_work_handler(struct k_work * work)
+{
+  struct net_if * iface = net_if_get_wifi_sta();
+  enum ob_wifi_ps_profile profile;
+  k_spinlock_key_t key;
+  uint32_t beacons;
+  bool reapply;
+
+  ARG_UNUSED(work);
+  if((NULL == iface) || (0 == ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_NO_WAIT))) {
+    /* Applied once the station is connected */
+    return;
+  }
+  key = k_spin_lock(&ps_lock);
+  profile = ps_select_locked();
+  reapply = ps.reapply;
+  ps.reapply = false;
+  k_spin_unlock(&ps_lock, key);
+  if(!reapply && (profile == ps.current)) {
+    return;
+  }
+
+  ps_apply(iface, profile);
+  beacons = ps_beacons(iface);
+  key = k_spin_lock(&ps_lock);
+  ps_account_locked(k_uptime_get(), beacons);
+  if(profile != ps.current) {
+    ps.stats[profile].activations++;
+  }
+  ps.current = profile;
+  ps.since = k_uptime_get();
+  ps.beacons = beacons;
+  k_spin_unlock(&ps_lock, key);
+  LOG_INF("Power save profile %s", ob_wifi_ps_profile_str(profile));
+}
+
+/**
+ * @brief Select the deep save profile
+ * @param work The work structure
+ */
+static void
+ps_idle_handler(struct k_work * work)
+{
+  k_spinlock_key_t key = k_spin_lock(&ps_lock);
+
+  ARG_UNUSED(work);
+  ps.idle = true;
+  k_spin_unlock(&ps_lock, key);
+  k_work_submit(&ps_work);
+}
+
+void
+ob_wifi_ps_init(void)
+{
+  ob_wifi_ps_activity();
+  k_work_submit(&ps_work);
+}
+
+void
+ob_wifi_ps_hold(uint32_t hold, bool held)
+{
+  k_spinlock_key_t key = k_spin_lock(&ps_lock);
+
+  if(held) {
+    ps.holds |= hold;
+  } else {
+    ps.holds &= ~hold;
+  }
+  k_spin_unlock(&ps_lock, key);
+  ob_wifi_ps_activity();
+  k_work_submit(&ps_work);
+}
+
+void
+ob_wifi_ps_activity(void)
+{
+  k_spinlock_key_t key = k_spin_lock(&ps_lock);
+  bool idle = ps.idle;
+
+  ps.idle = false;
+  k_spin_unlock(&ps_lock, key);
+  if(CONFIG_ONBOARDING_WIFI_PS_IDLE_DELAY > 0) {
+    k_work_reschedule(&ps_idle_work, K_MSEC(CONFIG_ONBOARDING_WIFI_PS_IDLE_DELAY));
+  }
+  if(idle) {
+    k_work_submit(&ps_work);
+  }
+}
+
+int
+ob_wifi_ps_force(enum ob_wifi_ps_profile profile)
+{
+  k_spinlock_key_t key;
+
+  if((OB_WIFI_PS_AUTO != profile) && ((profile < 0) || (profile >= OB_WIFI_PS_PROFILES))) {
+    return -EINVAL;
+  }
+  key = k_spin_lock(&ps_lock);
+  ps.forced = profile;
+  k_spin_unlock(&ps_lock, key);
+  k_work_submit(&ps_work);
+  return 0;
+}
+
+void
+ob_wifi_ps_connected(void)
+{
+  k_spinlock_key_t key = k_spin_lock(&ps_lock);
+
+  /* The driver may have lost the parameters and the agreement with the association */
+  ps.reapply = true;
+  ps.twt = false;
+  k_spin_unlock(&ps_lock, key);
+  k_work_submit(&ps_work);
+}
+
+void
+ob_wifi_ps_twt_event(const struct wifi_twt_params * params)
+{
+  k_spinlock_key_t key;
+  bool accepted = (WIFI_TWT_SETUP == params->operation) &&
+    (WIFI_TWT_RESP_RECEIVED == params->resp_status) &&
+    (WIFI_TWT_SETUP_CMD_ACCEPT == params->setup_cmd);
+
+  if(WIFI_TWT_SETUP == params->operation) {
+    if(accepted) {
+      LOG_INF("TWT agreement %d in place", params->flow_id);
+    } else {
+      LOG_WRN("TWT agreement %d not accepted", params->flow_id);
+    }
+  } else {
+    LOG_INF("TWT agreement %d torn down", params->flow_id);
+  }
+  key = k_spin_lock(&ps_lock);
+  ps.twt = accepted;
+  k_spin_unlock(&ps_lock, key);
+}
+
+void
+ob_wifi_ps_twt_sleep(int state)
+{
+  k_spinlock_key_t key = k_spin_lock(&ps_lock);
+
+  if((WIFI_TWT_STATE_AWAKE == state) && (OB_WIFI_PS_AUTO != ps.current)) {
+    ps.stats[ps.current].wakes++;
+  }
+  k_spin_unlock(&ps_lock, key);
+}
+
+void
+ob_wifi_ps_rtt(uint32_t rtt_us)
+{
+  k_spinlock_key_t key = k_spin_lock(&ps_lock);
+
+  if(OB_WIFI_PS_AUTO != ps.current) {
+    ps.stats[ps.current].rtt_samples++;
+    ps.stats[ps.current].rtt_total_us += rtt_us;
+    ps.stats[ps.current].rtt_max_us = MAX(ps.stats[ps.current].rtt_max_us, rtt_us);
+  }
+  k_spin_unlock(&ps_lock, key);
+}
+
+enum ob_wifi_ps_profile
+ob_wifi_ps_get(enum ob_wifi_ps_profile * forced, struct ob_wifi_ps_stats * stats)
+{
+  struct net_if * iface = net_if_get_wifi_sta();
+  uint32_t beacons = (NULL != iface) ? ps_beacons(iface) : 0;
+  enum ob_wifi_ps_profile current;
+  k_spinlock_key_t key = k_spin_lock(&ps_lock);
+
+  if(NULL != iface) {
+    ps_account_locked(k_uptime_get(), beacons);
+  }
+  current = ps.current;
+  if(NULL != forced) {
+    *forced = ps.forced;
+  }
+  if(NULL != stats) {
+    memcpy(stats, ps.stats, sizeof(ps.stats));
+  }
+  k_spin_unlock(&ps_lock, key);
+  return current;
+}
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/wifi_mgmt.h>
+
+#include "ob_wifi.h"
+#include "ob_wifi_config.h"
+#include "ob_wifi_roam.h"
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief the fixed point scale of the smoothed RSSI */
+#define ROAM_EWMA_SCALE 16
+
+/**
+ * @brief states of the roaming monitor
+ */
+enum roam_state {
+  /** @brief reading the RSSI of the current AP */
+  ROAM_MONITOR,
+  /** @brief waiting for the background scan */
+  ROAM_SCANNING,
+  /** @brief waiting for the connection to the new AP */
+  ROAM_CONNECTING
+};
+
+/**
+ * @brief the roaming monitor
+ * @details only used from the system work queue, except where noted
+ */
+static struct {
+  /** @brief the state of the monitor */
+  enum roam_state state;
+  /** @brief the smoothed RSSI is valid */
+  bool tracking;
+  /** @brief the smoothed RSSI in 1/ROAM_EWMA_SCALE dBm */
+  int ewma;
+  /** @brief the BSSID the smoothed RSSI belongs to */
+  uint8_t bssid[WIFI_MAC_ADDR_LEN];
+  /** @brief the uptime of the last background scan */
+  int64_t last_scan;
+  /** @brief the uptime when the station was disconnected to roam */
+  int64_t roam_start;
+  /** @brief the parameters of the background scan */
+  struct wifi_scan_params params;
+  /** @brief the SSID the background scan looks for */
+  char ssid[WIFI_SSID_MAX_LEN + 1];
+  /** @brief the request for the background scan */
+  struct ob_wifi_scan_subscriber sub;
+  /** @brief set by the scan callback once candidate is filled in */
+  atomic_t scanned;
+  /** @brief the strongest AP of the SSID found by the scan, written by the scan callback */
+  struct ob_wifi_bss candidate;
+  /** @brief the RSSI of the candidate, INT_MIN if none was found */
+  int candidate_rssi;
+  /** @brief the counters, protected by roam_lock */
+  struct ob_wifi_roam_stats stats;
+} roam;
+
+/** @brief protects roam.stats */
+static struct k_spinlock roam_lock;
+
+static void roam_work_handler(struct k_work * work);
+/** @brief runs the roaming monitor */
+static K_WORK_DELAYABLE_DEFINE(roam_work, roam_work_handler);
+
+/**
+ * @brief scan callback, keeps the strongest AP of the SSID
+ *
+ * @param snap the scan results, NULL if the scan failed
+ * @param user_data unused
+ */
+static void
+roam_scan_done(ob_wifi_scan_snapshot_t * snap, void * user_data)
+{
+  ssid_item_t * it;
+
+  ARG_UNUSED(user_data);
+  roam.candidate_rssi = INT_MIN;
+  for(it = (NULL != snap) ? snap->head : NULL; NULL != it; it = it->next) {
+    if(0 == strcmp(it->ssid, roam.ssid)) {
+      memcpy(roam.candidate.bssid, it->bssid, WIFI_MAC_ADDR_LEN);
+      roam.candidate.channel = it->channel;
+      roam.candidate.band = it->band;
+      roam.candidate_rssi = it->rssi;
+      break;
+    }
+  }
+  atomic_set(&roam.scanned, 1);
+  k_work_reschedule(&roam_work, K_NO_WAIT);
+}
+
+/**
+ * @brief completion callback of the connection to the new AP
+ *
+ * @param result the outcome of the connection
+ * @param user_data unused
+ */
+static void
+roam_connect_done(const struct ob_wifi_connect_result * result, void * user_data)
+{
+  int32_t latency = (int32_t)(k_uptime_get() - roam.roam_start);
+  k_spinlock_key_t key;
+
+  ARG_UNUSED(user_data);
+  key = k_spin_lock(&roam_lock);
+  if(OB_WIFI_CONNECT_OK == result->reason) {
+    roam.stats.roams++;
+    roam.stats.last_ms = latency;
+    roam.stats.max_ms = MAX(roam.stats.max_ms, latency);
+    roam.stats.total_ms += latency;
+  } else {
+    roam.stats.failures++;
+  }
+  k_spin_unlock(&roam_lock, key);
+  if(OB_WIFI_CONNECT_OK == result->reason) {
+    LOG_INF("Roamed in %d ms", latency);
+  } else {
+    LOG_WRN("Roam failed: %s", ob_wifi_connect_reason_str(result->reason));
+  }
+  roam.state = ROAM_MONITOR;
+  roam.tracking = false;
+  k_work_reschedule(&roam_work, K_MSEC(CONFIG_ONBOARDING_WIFI_ROAM_INTERVAL));
+}
+
+/**
+ * @brief Fill in the parameters of the background scan
+ *
+ * The scan looks for the SSID on the roaming channels, or on every channel
+ * of the current band if CONFIG_ONBOARDING_WIFI_ROAM_CHANNELS is empty.
+ *
+ * @param status the status of the station
+ */
+static void
+roam_scan_params(const struct wifi_iface_status * status)
+{
+  struct ob_wifi_bss current = { .band = status->band, .channel = status->channel };
+
+  memcpy(roam.ssid, status->ssid, status->ssid_len);
+  roam.ssid[status->ssid_len] = '\0';
+  ob_wifi_scan_preset_params(OB_WIFI_SCAN_PRESET_ROAM_BACKGROUND, roam.ssid,
+                             &current, &roam.params);
+}
+
+/**
+ * @brief Read the RSSI, scan when it is low and roam to a stronger AP
+ */
+static void
+roam_monitor(void)
+{
+  struct net_if *iface = net_if_get_wifi_sta();
+  struct wifi_iface_status status = { 0 };
+  int64_t now = k_uptime_get();
+  k_spinlock_key_t key;
+  int rc;
+
+  if((0 == ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_NO_WAIT)) ||
+     net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface, &status, sizeof(status)) ||
+     (WIFI_STATE_COMPLETED != status.state) ||
+     (status.ssid_len <= 0) || (status.ssid_len > WIFI_SSID_MAX_LEN)) {
+    roam.tracking = false;
+    key = k_spin_lock(&roam_lock);
+    roam.stats.rssi = 0;
+    k_spin_unlock(&roam_lock, key);
+    return;
+  }
+  if(!roam.tracking || (0 != memcmp(roam.bssid, status.bssid, WIFI_MAC_ADDR_LEN))) {
+    memcpy(roam.bssid, status.bssid, WIFI_MAC_ADDR_LEN);
+    roam.ewma = status.rssi * ROAM_EWMA_SCALE;
+    roam.tracking = true;
+  } else {
+    roam.ewma += (((status.rssi * ROAM_EWMA_SCALE) - roam.ewma) *
+                  CONFIG_ONBOARDING_WIFI_ROAM_EWMA_WEIGHT) / 100;
+  }
+  key = k_spin_lock(&roam_lock);
+  roam.stats.rssi = roam.ewma / ROAM_EWMA_SCALE;
+  k_spin_unlock(&roam_lock, key);
+
+  if(((roam.ewma / ROAM_EWMA_SCALE) >= CONFIG_ONBOARDING_WIFI_ROAM_THRESHOLD) ||
+     ((roam.last_scan != 0) &&
+      ((now - roam.last_scan) < CONFIG_ONBOARDING_WIFI_ROAM_SCAN_INTERVAL))) {
+    return;
+  }
+  LOG_DBG("RSSI %d dBm, scanning for a stronger AP", roam.ewma / ROAM_EWMA_SCALE);
+  roam_scan_params(&status);
+  roam.candidate.security = status.security;
+  roam.last_scan = now;
+  roam.sub.callback = roam_scan_done;
+  roam.sub.user_data = NULL;
+  atomic_clear(&roam.scanned);
+  if((rc = ob_wifi_scan_ex(&roam.sub, &roam.params)) == 0) {
+    key = k_spin_lock(&roam_lock);
+    roam.stats.scans++;
+    k_spin_unlock(&roam_lock, key);
+    roam.state = ROAM_SCANNING;
+  } else if(-EBUSY == rc) {
+    /* Try again once the other scan is done */
+    roam.last_scan = 0;
+  } else {
+    LOG_ERR("Roaming scan failed %d", rc);
+    /* The callback is called from the scan timeout */
+    roam.state = ROAM_SCANNING;
+  }
+}
+
+/**
+ * @brief Roam to the candidate if it is stronger than the current AP
+ *
+ * @return true if the station is roaming
+ */
+static bool
+roam_to_candidate(void)
+{
+  struct ob_wifi_connect_params params = {
+    .max_attempts = OB_WIFI_CONNECT_ATTEMPTS_FOREVER,
+    .bss = &roam.candidate
+  };
+  struct net_if *iface = net_if_get_wifi_sta();
+  struct ob_wifi_config config;
+  int current = roam.ewma / ROAM_EWMA_SCALE;
+  int rc;
+
+  if((INT_MIN == roam.candidate_rssi) ||
+     (0 == memcmp(roam.candidate.bssid, roam.bssid, WIFI_MAC_ADDR_LEN)) ||
+     (roam.candidate_rssi < (current + CONFIG_ONBOARDING_WIFI_ROAM_HYSTERESIS))) {
+    LOG_DBG("No stronger AP than %d dBm", current);
+    return false;
+  }
+  if((ob_wifi_config_get(&config) == 0) || (0 != strcmp(config.ssid, roam.ssid))) {
+    LOG_WRN("No credentials for %s", roam.ssid);
+    return false;
+  }
+  LOG_INF("Roaming from %d dBm to %s at %d dBm channel %d", current,
+          Mac2String(roam.candidate.bssid), roam.candidate_rssi, roam.candidate.channel);
+  roam.roam_start = k_uptime_get();
+  net_mgmt(NET_REQUEST_WIFI_DISCONNECT, iface, NULL, 0);
+  /* The first attempt targets the candidate, the next ones scan the whole band */
+  if((rc = ob_wifi_connect_async(&params, roam_connect_done, NULL)) < 0) {
+    LOG_ERR("Roam connect failed %d", rc);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Run the roaming monitor
+ * @param work The work structure
+ */
+static void
+roam_work_handler(struct k_work * work)
+{
+  ARG_UNUSED(work);
+  switch(roam.state) {
+  case ROAM_MONITOR:
+    roam_monitor();
+    break;
+
+  case ROAM_SCANNING:
+    if(!atomic_cas(&roam.scanned, 1, 0)) {
+      return;
+    }
+    roam.state = ROAM_MONITOR;
+    if(roam_to_candidate()) {
+      roam.state = ROAM_CONNECTING;
+      return;
+    }
+    break;
+
+  case ROAM_CONNECTING:
+  default:
+    return;
+  }
+  if(ROAM_MONITOR == roam.state) {
+    k_work_reschedule(&roam_work, K_MSEC(CONFIG_ONBOARDING_WIFI_ROAM_INTERVAL));
+  }
+}
+
+void
+ob_wifi_roam_init(void)
+{
+  roam.state = ROAM_MONITOR;
+  roam.tracking = false;
+  roam.last_scan = 0;
+  k_work_reschedule(&roam_work, K_MSEC(CONFIG_ONBOARDING_WIFI_ROAM_INTERVAL));
+}
+
+void
+ob_wifi_roam_stop(void)
+{
+  k_work_cancel_delayable(&roam_work);
+  roam.state = ROAM_MONITOR;
+  roam.tracking = false;
+}
+
+void
+ob_wifi_roam_get_stats(struct ob_wifi_roam_stats * stats)
+{
+  k_spinlock_key_t key = k_spin_lock(&roam_lock);
+
+  *stats = roam.stats;
+  k_spin_unlock(&roam_lock, key);
+}
@@ -0,0 +1,824 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/ethernet.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/wifi_mgmt.h>
+
+#include "ob_wifi_sim.h"
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief the first byte of the simulated MAC addresses, locally administered */
+#define SIM_MAC_PREFIX 0x02
+
+/**
+ * @brief the simulated driver
+ * @details protected by sim_mutex, the events are raised from the system
+ * work queue without holding it
+ */
+static struct {
+  /** @brief the wifi interface */
+  struct net_if * iface;
+  /** @brief the APs, in scan order */
+  struct ob_wifi_sim_ap aps[CONFIG_ONBOARDING_WIFI_SIM_MAX_APS];
+  /** @brief the number of APs */
+  int count;
+  /** @brief the index given to the next AP, keeps the BSSIDs unique */
+  uint8_t next_index;
+  /** @brief the time a scan takes in milliseconds */
+  uint32_t scan_ms;
+  /** @brief the time a connection or an AP enable takes in milliseconds */
+  uint32_t connect_ms;
+  /** @brief the number of operations left to fail */
+  int fail_count[OB_WIFI_SIM_OPS];
+  /** @brief the status of the failed operations */
+  int fail_status[OB_WIFI_SIM_OPS];
+  /** @brief the callback of the running scan, NULL if none */
+  scan_result_cb_t scan_cb;
+  /** @brief the SSIDs the running scan is limited to */
+  char scan_ssids[WIFI_MGMT_SCAN_SSID_FILT_MAX][WIFI_SSID_MAX_LEN + 1];
+  /** @brief the maximum number of results of the running scan, 0 if unlimited */
+  uint16_t scan_max;
+  /** @brief the parameters of the running connection */
+  struct {
+    char ssid[WIFI_SSID_MAX_LEN + 1];
+    char psk[WIFI_PSK_MAX_LEN + 1];
+    uint8_t bssid[WIFI_MAC_ADDR_LEN];
+    uint8_t channel;
+  } request;
+  /** @brief a connection is running */
+  bool connecting;
+  /** @brief the station is connected */
+  bool connected;
+  /** @brief the AP the station is connected to */
+  struct ob_wifi_sim_ap current;
+  /** @brief the device AP is being enabled */
+  bool ap_starting;
+  /** @brief the device AP is up */
+  bool ap_up;
+  /** @brief the SSID of the device AP */
+  char ap_ssid[WIFI_SSID_MAX_LEN + 1];
+  /** @brief the channel of the device AP */
+  uint8_t ap_channel;
+  /** @brief the frames dropped since the link was down or there was no bridge */
+  uint32_t dropped;
+} sim;
+
+/** @brief protects sim */
+static K_MUTEX_DEFINE(sim_mutex);
+
+static void sim_scan_handler(struct k_work * work);
+/** @brief completes the scans */
+static K_WORK_DELAYABLE_DEFINE(sim_scan_work, sim_scan_handler);
+static void sim_connect_handler(struct k_work * work);
+/** @brief completes the connections */
+static K_WORK_DELAYABLE_DEFINE(sim_connect_work, sim_connect_handler);
+static void sim_ap_handler(struct k_work * work);
+/** @brief completes the AP enables */
+static K_WORK_DELAYABLE_DEFINE(sim_ap_work, sim_ap_handler);
+
+/** @brief the MAC address of the interface */
+static uint8_t sim_mac[WIFI_MAC_ADDR_LEN] = { SIM_MAC_PREFIX, 0x00, 0x5e, 0x10, 0x00, 0x01 };
+
+/**
+ * @brief take the next injected failure of an operation, called with sim_mutex held
+ *
+ * @param op the operation
+ * @return the status of the failure, 0 if the operation succeeds
+ */
+static int
+sim_fail_locked(enum ob_wifi_sim_op op)
+{
+  if(sim.fail_count[op] <= 0) {
+    return 0;
+  }
+  sim.fail_count[op]--;
+  return sim.fail_status[op];
+}
+
+/**
+ * @brief let the frames through while the station or the AP is up, called with sim_mutex held
+ */
+static void
+sim_update_link_locked(void)
+{
+  if(NULL == sim.iface) {
+    return;
+  }
+  if(sim.connected || sim.ap_up) {
+    net_if_dormant_off(sim.iface);
+  } else {
+    net_if_dormant_on(sim.iface);
+  }
+}
+
+/**
+ * @brief fill in a scan result
+ *
+ * @param ap the AP
+ * @param[out] entry the scan result
+ */
+static void
+sim_scan_entry(const struct ob_wifi_sim_ap * ap, struct wifi_scan_result * entry)
+{
+  memset(entry, 0, sizeof(*entry));
+  entry->ssid_length = strlen(ap->ssid);
+  memcpy(entry->ssid, ap->ssid, entry->ssid_length);
+  entry->channel = ap->channel;
+  entry->band = (ap->channel > 14) ? WIFI_FREQ_BAND_5_GHZ : WIFI_FREQ_BAND_2_4_GHZ;
+  entry->security = ('\0' != ap->psk[0]) ? WIFI_SECURITY_TYPE_PSK : WIFI_SECURITY_TYPE_NONE;
+  entry->mfp = WIFI_MFP_DISABLE;
+  entry->rssi = ap->rssi;
+  memcpy(entry->mac, ap->bssid, WIFI_MAC_ADDR_LEN);
+  entry->mac_length = WIFI_MAC_ADDR_LEN;
+}
+
+/**
+ * @brief check if an SSID is wanted by the running scan, called with sim_mutex held
+ *
+ * @param ssid the SSID
+ * @return true if the scan is not limited or is limited to the SSID
+ */
+static bool
+sim_scan_wanted_locked(const char * ssid)
+{
+  bool limited = false;
+  int i;
+
+  for(i = 0; i < WIFI_MGMT_SCAN_SSID_FILT_MAX; i++) {
+    if('\0' == sim.scan_ssids[i][0]) {
+      continue;
+    }
+    limited = true;
+    if(0 == strcmp(sim.scan_ssids[i], ssid)) {
+      return true;
+    }
+  }
+  return !limited;
+}
+
+/**
+ * @brief Report the results of the scan, in the order of the APs
+ * @param work The work structure
+ */
+static void
+sim_scan_handler(struct k_work * work)
+{
+  static struct ob_wifi_sim_ap aps[CONFIG_ONBOARDING_WIFI_SIM_MAX_APS];
+  struct wifi_scan_result entry;
+  scan_result_cb_t cb;
+  struct net_if * iface;
+  int status;
+  int count = 0;
+  int i;
+
+  ARG_UNUSED(work);
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  cb = sim.scan_cb;
+  iface = sim.iface;
+  sim.scan_cb = NULL;
+  if(0 == (status = sim_fail_locked(OB_WIFI_SIM_OP_SCAN))) {
+    for(i = 0; i < sim.count; i++) {
+      if(((0 == sim.scan_max) || (count < sim.scan_max)) &&
+         sim_scan_wanted_locked(sim.aps[i].ssid)) {
+        aps[count++] = sim.aps[i];
+      }
+    }
+  }
+  k_mutex_unlock(&sim_mutex);
+  if(NULL == cb) {
+    return;
+  }
+  for(i = 0; i < count; i++) {
+    sim_scan_entry(&aps[i], &entry);
+    cb(iface, 0, &entry);
+  }
+  cb(iface, status, NULL);
+}
+
+/**
+ * @brief Find the AP of the running connection and report the result
+ * @details the strongest AP matching the SSID, the BSSID and the channel
+ * requested is joined
+ * @param work The work structure
+ */
+static void
+sim_connect_handler(struct k_work * work)
+{
+  static const uint8_t any_bssid[WIFI_MAC_ADDR_LEN] = { 0 };
+  struct ob_wifi_sim_ap * ap;
+  struct ob_wifi_sim_ap * best = NULL;
+  struct net_if * iface;
+  int status;
+  int i;
+
+  ARG_UNUSED(work);
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(!sim.connecting) {
+    k_mutex_unlock(&sim_mutex);
+    return;
+  }
+  sim.connecting = false;
+  iface = sim.iface;
+  if(0 == (status = sim_fail_locked(OB_WIFI_SIM_OP_CONNECT))) {
+    for(i = 0; i < sim.count; i++) {
+      ap = &sim.aps[i];
+      if((0 != strcmp(ap->ssid, sim.request.ssid)) ||
+         ((0 != memcmp(sim.request.bssid, any_bssid, WIFI_MAC_ADDR_LEN)) &&
+          (0 != memcmp(sim.request.bssid, ap->bssid, WIFI_MAC_ADDR_LEN))) ||
+         ((WIFI_CHANNEL_ANY != sim.request.channel) && (sim.request.channel != ap->channel))) {
+        continue;
+      }
+      if((NULL == best) || (ap->rssi > best->rssi)) {
+        best = ap;
+      }
+    }
+    if(NULL == best) {
+      status = WIFI_STATUS_CONN_AP_NOT_FOUND;
+    } else if(0 != strcmp(best->psk, sim.request.psk)) {
+      status = WIFI_STATUS_CONN_WRONG_PASSWORD;
+    } else {
+      sim.current = *best;
+      sim.connected = true;
+    }
+  }
+  memset(sim.request.psk, 0, sizeof(sim.request.psk));
+  sim_update_link_locked();
+  LOG_DBG("Sim connect %s status %d", sim.request.ssid, status);
+  k_mutex_unlock(&sim_mutex);
+  wifi_mgmt_raise_connect_result_event(iface, status);
+}
+
+/**
+ * @brief Report the result of the AP enable
+ * @param work The work structure
+ */
+static void
+sim_ap_handler(struct k_work * work)
+{
+  struct net_if * iface;
+  int status;
+
+  ARG_UNUSED(work);
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(!sim.ap_starting) {
+    k_mutex_unlock(&sim_mutex);
+    return;
+  }
+  sim.ap_starting = false;
+  iface = sim.iface;
+  if(0 == (status = sim_fail_locked(OB_WIFI_SIM_OP_AP))) {
+    sim.ap_up = true;
+    status = WIFI_STATUS_AP_SUCCESS;
+  }
+  sim_update_link_locked();
+  k_mutex_unlock(&sim_mutex);
+  wifi_mgmt_raise_ap_enable_result_event(iface, status);
+}
+
+/**
+ * @brief wifi_mgmt_ops scan
+ */
+static int
+sim_scan(const struct device * dev, struct wifi_scan_params * params, scan_result_cb_t cb)
+{
+  int i;
+
+  ARG_UNUSED(dev);
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(NULL != sim.scan_cb) {
+    k_mutex_unlock(&sim_mutex);
+    return -EBUSY;
+  }
+  sim.scan_cb = cb;
+  memset(sim.scan_ssids, 0, sizeof(sim.scan_ssids));
+  sim.scan_max = 0;
+  if(NULL != params) {
+    for(i = 0; i < WIFI_MGMT_SCAN_SSID_FILT_MAX; i++) {
+      if(NULL != params->ssids[i]) {
+        strncpy(sim.scan_ssids[i], params->ssids[i], WIFI_SSID_MAX_LEN);
+      }
+    }
+    sim.scan_max = params->max_bss_cnt;
+  }
+  k_work_reschedule(&sim_scan_work, K_MSEC(sim.scan_ms));
+  k_mutex_unlock(&sim_mutex);
+  return 0;
+}
+
+/**
+ * @brief wifi_mgmt_ops connect
+ */
+static int
+sim_connect(const struct device * dev, struct wifi_connect_req_params * params)
+{
+  ARG_UNUSED(dev);
+  if((NULL == params->ssid) || (0 == params->ssid_length) ||
+     (params->ssid_length > WIFI_SSID_MAX_LEN) || (params->psk_length > WIFI_PSK_MAX_LEN)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(sim.connecting || sim.connected) {
+    k_mutex_unlock(&sim_mutex);
+    return -EALREADY;
+  }
+  memset(&sim.request, 0, sizeof(sim.request));
+  memcpy(sim.request.ssid, params->ssid, params->ssid_length);
+  if(NULL != params->psk) {
+    memcpy(sim.request.psk, params->psk, params->psk_length);
+  }
+  memcpy(sim.request.bssid, params->bssid, WIFI_MAC_ADDR_LEN);
+  sim.request.channel = params->channel;
+  sim.connecting = true;
+  k_work_reschedule(&sim_connect_work, K_MSEC(sim.connect_ms));
+  k_mutex_unlock(&sim_mutex);
+  return 0;
+}
+
+/**
+ * @brief disconnect the station
+ *
+ * @param reason the WIFI_REASON_DISCONN_* reason reported
+ * @return 0 on success
+ * @return -EALREADY if the station is neither connected nor connecting
+ */
+static int
+sim_disconnect_reason(int reason)
+{
+  struct net_if * iface;
+
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(!sim.connecting && !sim.connected) {
+    k_mutex_unlock(&sim_mutex);
+    return -EALREADY;
+  }
+  sim.connecting = false;
+  sim.connected = false;
+  memset(&sim.current, 0, sizeof(sim.current));
+  sim_update_link_locked();
+  iface = sim.iface;
+  k_mutex_unlock(&sim_mutex);
+  k_work_cancel_delayable(&sim_connect_work);
+  wifi_mgmt_raise_disconnect_result_event(iface, reason);
+  return 0;
+}
+
+/**
+ * @brief wifi_mgmt_ops disconnect
+ */
+static int
+sim_disconnect(const struct device * dev)
+{
+  ARG_UNUSED(dev);
+  return sim_disconnect_reason(WIFI_REASON_DISCONN_USER_REQUEST);
+}
+
+/**
+ * @brief wifi_mgmt_ops ap_enable
+ */
+static int
+sim_ap_enable(const struct device * dev, struct wifi_connect_req_params * params)
+{
+  ARG_UNUSED(dev);
+  if((NULL == params->ssid) || (0 == params->ssid_length) ||
+     (params->ssid_length > WIFI_SSID_MAX_LEN)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(sim.ap_starting || sim.ap_up) {
+    k_mutex_unlock(&sim_mutex);
+    return -EALREADY;
+  }
+  memset(sim.ap_ssid, 0, sizeof(sim.ap_ssid));
+  memcpy(sim.ap_ssid, params->ssid, params->ssid_length);
+  sim.ap_channel = (WIFI_CHANNEL_ANY == params->channel) ? 1 : params->channel;
+  sim.ap_starting = true;
+  k_work_reschedule(&sim_ap_work, K_MSEC(sim.connect_ms));
+  k_mutex_unlock(&sim_mutex);
+  return 0;
+}
+
+/**
+ * @brief wifi_mgmt_ops ap_disable
+ */
+static int
+sim_ap_disable(const struct device * dev)
+{
+  struct net_if * iface;
+
+  ARG_UNUSED(dev);
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(!sim.ap_starting && !sim.ap_up) {
+    k_mutex_unlock(&sim_mutex);
+    return -EALREADY;
+  }
+  sim.ap_starting = false;
+  sim.ap_up = false;
+  sim_update_link_locked();
+  iface = sim.iface;
+  k_mutex_unlock(&sim_mutex);
+  k_work_cancel_delayable(&sim_ap_work);
+  wifi_mgmt_raise_ap_disable_result_event(iface, WIFI_STATUS_AP_SUCCESS);
+  return 0;
+}
+
+/**
+ * @brief wifi_mgmt_ops iface_status
+ * @details the RSSI follows the changes made to the AP after the connection
+ */
+static int
+sim_iface_status(const struct device * dev, struct wifi_iface_status * status)
+{
+  int i;
+
+  ARG_UNUSED(dev);
+  memset(status, 0, sizeof(*status));
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(sim.connected) {
+    status->state = WIFI_STATE_COMPLETED;
+    status->iface_mode = WIFI_MODE_INFRA;
+    status->ssid_len = strlen(sim.current.ssid);
+    memcpy(status->ssid, sim.current.ssid, status->ssid_len);
+    memcpy(status->bssid, sim.current.bssid, WIFI_MAC_ADDR_LEN);
+    status->channel = sim.current.channel;
+    status->band = (sim.current.channel > 14) ? WIFI_FREQ_BAND_5_GHZ : WIFI_FREQ_BAND_2_4_GHZ;
+    status->security = ('\0' != sim.current.psk[0]) ? WIFI_SECURITY_TYPE_PSK : WIFI_SECURITY_TYPE_NONE;
+    status->rssi = sim.current.rssi;
+    for(i = 0; i < sim.count; i++) {
+      if(0 == memcmp(sim.aps[i].bssid, sim.current.bssid, WIFI_MAC_ADDR_LEN)) {
+        status->rssi = sim.aps[i].rssi;
+      }
+    }
+  } else if(sim.ap_up) {
+    status->state = WIFI_STATE_COMPLETED;
+    status->iface_mode = WIFI_MODE_AP;
+    status->ssid_len = strlen(sim.ap_ssid);
+    memcpy(status->ssid, sim.ap_ssid, status->ssid_len);
+    memcpy(status->bssid, sim_mac, WIFI_MAC_ADDR_LEN);
+    status->channel = sim.ap_channel;
+    status->band = (sim.ap_channel > 14) ? WIFI_FREQ_BAND_5_GHZ : WIFI_FREQ_BAND_2_4_GHZ;
+  } else {
+    status->state = sim.connecting ? WIFI_STATE_ASSOCIATING : WIFI_STATE_DISCONNECTED;
+    status->iface_mode = WIFI_MODE_INFRA;
+  }
+  status->link_mode = WIFI_4;
+  status->mfp = WIFI_MFP_DISABLE;
+  status->beacon_interval = 100;
+  status->dtim_period = 1;
+  status->current_phy_tx_rate = sim.connected ? 72200 : 0;
+  k_mutex_unlock(&sim_mutex);
+  return 0;
+}
+
+#ifdef CONFIG_ONBOARDING_WIFI_SIM_BRIDGE
+/*
+ * The host side of the native_sim TAP Ethernet driver, see
+ * drivers/ethernet/eth_native_tap_priv.h
+ */
+int eth_iface_create(const char * dev_name, const char * if_name, bool tun_only);
+int eth_wait_data(int fd);
+ssize_t eth_read_data(int fd, void * buf, size_t buf_len);
+ssize_t eth_write_data(int fd, void * buf, size_t buf_len);
+
+/** @brief the file descriptor of the TAP interface of the host */
+static int sim_tap_fd = -1;
+/** @brief the frame being sent */
+static uint8_t sim_tx_frame[NET_ETH_MTU + sizeof(struct net_eth_hdr)];
+/** @brief the frame being received */
+static uint8_t sim_rx_frame[NET_ETH_MTU + sizeof(struct net_eth_hdr)];
+
+K_KERNEL_STACK_DEFINE(sim_rx_stack, CONFIG_ONBOARDING_WIFI_SIM_BRIDGE_STACK_SIZE);
+/** @brief the thread reading the TAP interface */
+static struct k_thread sim_rx_thread;
+
+/**
+ * @brief read the frames of the TAP interface
+ * @details the frames are dropped while the station and the AP are down
+ */
+static void
+sim_rx_loop(void * p1, void * p2, void * p3)
+{
+  struct net_pkt * pkt;
+  ssize_t len;
+  bool up;
+
+  ARG_UNUSED(p1);
+  ARG_UNUSED(p2);
+  ARG_UNUSED(p3);
+  while(true) {
+    if(eth_wait_data(sim_tap_fd) < 0) {
+      k_sleep(K_MSEC(CONFIG_ONBOARDING_WIFI_SIM_BRIDGE_POLL));
+      continue;
+    }
+    if((len = eth_read_data(sim_tap_fd, sim_rx_frame, sizeof(sim_rx_frame))) <= 0) {
+      continue;
+    }
+    k_mutex_lock(&sim_mutex, K_FOREVER);
+    up = sim.connected || sim.ap_up;
+    if(!up) {
+      sim.dropped++;
+    }
+    k_mutex_unlock(&sim_mutex);
+    if(!up) {
+      continue;
+    }
+    pkt = net_pkt_rx_alloc_with_buffer(sim.iface, len, AF_UNSPEC, 0, K_NO_WAIT);
+    if(NULL == pkt) {
+      continue;
+    }
+    if(net_pkt_write(pkt, sim_rx_frame, len) || (net_recv_data(sim.iface, pkt) < 0)) {
+      net_pkt_unref(pkt);
+    }
+  }
+}
+#endif // CONFIG_ONBOARDING_WIFI_SIM_BRIDGE
+
+/**
+ * @brief ethernet_api send
+ * @details the frames go to the TAP interface of the host while the
+ * station or the AP is up, they are dropped otherwise
+ */
+static int
+sim_send(const struct device * dev, struct net_pkt * pkt)
+{
+  bool up;
+
+  ARG_UNUSED(dev);
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  up = sim.connected || sim.ap_up;
+#ifndef CONFIG_ONBOARDING_WIFI_SIM_BRIDGE
+  up = false;
+#endif // CONFIG_ONBOARDING_WIFI_SIM_BRIDGE
+  if(!up) {
+    sim.dropped++;
+  }
+  k_mutex_unlock(&sim_mutex);
+  if(!up) {
+    return 0;
+  }
+#ifdef CONFIG_ONBOARDING_WIFI_SIM_BRIDGE
+  {
+    size_t len = net_pkt_get_len(pkt);
+
+    if((len > sizeof(sim_tx_frame)) || net_pkt_read(pkt, sim_tx_frame, len)) {
+      return -EIO;
+    }
+    if(eth_write_data(sim_tap_fd, sim_tx_frame, len) < 0) {
+      return -EIO;
+    }
+  }
+#endif // CONFIG_ONBOARDING_WIFI_SIM_BRIDGE
+  return 0;
+}
+
+/**
+ * @brief net_if_api init
+ */
+static void
+sim_iface_init(struct net_if * iface)
+{
+  struct ethernet_context * eth_ctx = net_if_l2_data(iface);
+
+  sim.iface = iface;
+  ethernet_init(iface);
+  eth_ctx->eth_if_type = L2_ETH_IF_TYPE_WIFI;
+  net_if_set_link_addr(iface, sim_mac, sizeof(sim_mac), NET_LINK_ETHERNET);
+  net_if_dormant_on(iface);
+#ifdef CONFIG_ONBOARDING_WIFI_SIM_BRIDGE
+  sim_tap_fd = eth_iface_create(CONFIG_ETH_NATIVE_TAP_DRV_NAME, CONFIG_ONBOARDING_WIFI_SIM_BRIDGE_TAP,
+                                false);
+  if(sim_tap_fd < 0) {
+    LOG_ERR("Unable to create the TAP interface %s", CONFIG_ONBOARDING_WIFI_SIM_BRIDGE_TAP);
+    return;
+  }
+  k_thread_create(&sim_rx_thread, sim_rx_stack, K_KERNEL_STACK_SIZEOF(sim_rx_stack), sim_rx_loop,
+                  NULL, NULL, NULL, K_PRIO_COOP(14), 0, K_NO_WAIT);
+  k_thread_name_set(&sim_rx_thread, "ob_wifi_sim_rx");
+#endif // CONFIG_ONBOARDING_WIFI_SIM_BRIDGE
+}
+
+/** @brief the wifi management operations */
+static const struct wifi_mgmt_ops sim_mgmt_ops = {
+  .scan = sim_scan,
+  .connect = sim_connect,
+  .disconnect = sim_disconnect,
+  .ap_enable = sim_ap_enable,
+  .ap_disable = sim_ap_disable,
+  .iface_status = sim_iface_status,
+};
+
+/** @brief the API of the device */
+static const struct net_wifi_mgmt_offload sim_api = {
+  .wifi_iface.iface_api.init = sim_iface_init,
+  .wifi_iface.send = sim_send,
+  .wifi_mgmt_api = &sim_mgmt_ops,
+};
+
+/**
+ * @brief load the APs of CONFIG_ONBOARDING_WIFI_SIM_APS
+ * @details the entries are separated by ';', each entry is
+ * "ssid,psk,rssi,channel" with an empty psk for an open network
+ */
+static void
+sim_load_script(void)
+{
+  static char script[] = CONFIG_ONBOARDING_WIFI_SIM_APS;
+  char * entry_save = NULL;
+  char * field_save;
+  char * entry;
+  char * ssid;
+  char * psk;
+  char * rssi;
+  char * channel;
+
+  for(entry = strtok_r(script, ";", &entry_save); NULL != entry;
+      entry = strtok_r(NULL, ";", &entry_save)) {
+    /* strsep keeps the empty psk of the open networks */
+    field_save = entry;
+    ssid = strsep(&field_save, ",");
+    psk = strsep(&field_save, ",");
+    rssi = strsep(&field_save, ",");
+    channel = strsep(&field_save, ",");
+    if((NULL == channel) ||
+       (ob_wifi_sim_ap_add(ssid, psk, atoi(rssi), atoi(channel)) < 0)) {
+      LOG_ERR("Invalid simulated AP %s", entry);
+    }
+  }
+}
+
+/**
+ * @brief device init
+ */
+static int
+sim_dev_init(const struct device * dev)
+{
+  ARG_UNUSED(dev);
+  sim.scan_ms = CONFIG_ONBOARDING_WIFI_SIM_SCAN_DELAY;
+  sim.connect_ms = CONFIG_ONBOARDING_WIFI_SIM_CONNECT_DELAY;
+  sim_load_script();
+  return 0;
+}
+
+ETH_NET_DEVICE_INIT(ob_wifi_sim, "ob_wifi_sim", sim_dev_init, NULL, NULL, NULL,
+                    CONFIG_ETH_INIT_PRIORITY, &sim_api, NET_ETH_MTU);
+
+int
+ob_wifi_sim_ap_add(const char * ssid, const char * psk, int rssi, int channel)
+{
+  struct ob_wifi_sim_ap * ap;
+  int index;
+
+  if((NULL == ssid) || (0 == strlen(ssid)) || (strlen(ssid) > WIFI_SSID_MAX_LEN) ||
+     ((NULL != psk) && (strlen(psk) > WIFI_PSK_MAX_LEN)) ||
+     (channel <= 0) || (channel > 233) || (rssi > 0) || (rssi < -127)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  if(sim.count >= CONFIG_ONBOARDING_WIFI_SIM_MAX_APS) {
+    k_mutex_unlock(&sim_mutex);
+    return -ENOMEM;
+  }
+  index = sim.count++;
+  ap = &sim.aps[index];
+  memset(ap, 0, sizeof(*ap));
+  strcpy(ap->ssid, ssid);
+  if(NULL != psk) {
+    strcpy(ap->psk, psk);
+  }
+  ap->rssi = rssi;
+  ap->channel = channel;
+  ap->bssid[0] = SIM_MAC_PREFIX;
+  ap->bssid[2] = 0x5e;
+  ap->bssid[5] = ++sim.next_index;
+  k_mutex_unlock(&sim_mutex);
+  return index;
+}
+
+int
+ob_wifi_sim_ap_rssi(const char * ssid, int rssi)
+{
+  int rc = -ENOENT;
+  int i;
+
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  for(i = 0; i < sim.count; i++) {
+    if(0 == strcmp(sim.aps[i].ssid, ssid)) {
+      sim.aps[i].rssi = rssi;
+      rc = 0;
+    }
+  }
+  k_mutex_unlock(&sim_mutex);
+  return rc;
+}
+
+int
+ob_wifi_sim_ap_psk(const char * ssid, const char * psk)
+{
+  int rc = -ENOENT;
+  int i;
+
+  if((NULL != psk) && (strlen(psk) > WIFI_PSK_MAX_LEN)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  for(i = 0; i < sim.count; i++) {
+    if(0 == strcmp(sim.aps[i].ssid, ssid)) {
+      strcpy(sim.aps[i].psk, (NULL != psk) ? psk : "");
+      rc = 0;
+    }
+  }
+  k_mutex_unlock(&sim_mutex);
+  return rc;
+}
+
+void
+ob_wifi_sim_ap_clear(void)
+{
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  sim.count = 0;
+  k_mutex_unlock(&sim_mutex);
+}
+
+int
+ob_wifi_sim_aps(struct ob_wifi_sim_ap * aps, int max)
+{
+  int count;
+
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  count = MIN(max, sim.count);
+  memcpy(aps, sim.aps, count * sizeof(*aps));
+  k_mutex_unlock(&sim_mutex);
+  return count;
+}
+
+void
+ob_wifi_sim_set_delays(uint32_t scan_ms, uint32_t connect_ms)
+{
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  sim.scan_ms = scan_ms;
+  sim.connect_ms = connect_ms;
+  k_mutex_unlock(&sim_mutex);
+}
+
+int
+ob_wifi_sim_fail(enum ob_wifi_sim_op op, int count, int status)
+{
+  if(((int)op < 0) || (op >= OB_WIFI_SIM_OPS)) {
+    return -EINVAL;
+  }
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  sim.fail_count[op] = count;
+  sim.fail_status[op] = status;
+  k_mutex_unlock(&sim_mutex);
+  return 0;
+}
+
+int
+ob_wifi_sim_drop(void)
+{
+  bool connected;
+
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  connected = sim.connected;
+  k_mutex_unlock(&sim_mutex);
+  if(!connected) {
+    return -ENOTCONN;
+  }
+  return sim_disconnect_reason(WIFI_REASON_DISCONN_AP_LEAVING);
+}
+
+int
+ob_wifi_sim_station(const uint8_t * mac, bool joined)
+{
+  struct wifi_ap_sta_info info = {
+    .link_mode = WIFI_4,
+    .mac_length = WIFI_MAC_ADDR_LEN
+  };
+  struct net_if * iface;
+  bool up;
+
+  k_mutex_lock(&sim_mutex, K_FOREVER);
+  up = sim.ap_up;
+  iface = sim.iface;
+  k_mutex_unlock(&sim_mutex);
+  if(!up) {
+    return -ENETDOWN;
+  }
+  memcpy(info.mac, mac, WIFI_MAC_ADDR_LEN);
+  if(joined) {
+    wifi_mgmt_raise_ap_sta_connected_event(iface, &info);
+  } else {
+    wifi_mgmt_raise_ap_sta_disconnected_event(iface, &info);
+  }
+  return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_mgmt.h>
+#include <zephyr/net/net_event.h>
+
+#include "ob_wifi.h"
+#include "ob_wifi_timeline.h"
+
+LOG_MODULE_DECLARE(ONBOARDING_LOG_MODULE_NAME, CONFIG_ONBOARDING_LOG_LEVEL);
+
+/** @brief the names of the steps, indexed by enum ob_wifi_timeline_mark */
+static const char * const mark_names[OB_WIFI_TIMELINE_MARK_COUNT] = {
+  [OB_WIFI_TIMELINE_SCAN_START] = "scan_start",
+  [OB_WIFI_TIMELINE_SCAN_DONE] = "scan_done",
+  [OB_WIFI_TIMELINE_CONNECT_REQUEST] = "connect_request",
+  [OB_WIFI_TIMELINE_CONNECT_RESULT] = "connect_result",
+  [OB_WIFI_TIMELINE_DHCP_START] = "dhcp_start",
+  [OB_WIFI_TIMELINE_DHCP_BOUND] = "dhcp_bound",
+  [OB_WIFI_TIMELINE_ADDR_ADD] = "addr_add",
+  [OB_WIFI_TIMELINE_L4_CONNECTED] = "l4_connected",
+};
+
+/**
+ * @brief the steps a phase is measured between
+ */
+static const struct {
+  /** @brief the name of the phase */
+  const char *name;
+  /** @brief the first step, OB_WIFI_TIMELINE_MARK_COUNT for the start of the timeline */
+  uint8_t from;
+  /** @brief the last step */
+  uint8_t to;
+} phases[OB_WIFI_TIMELINE_PHASE_COUNT] = {
+  [OB_WIFI_TIMELINE_PHASE_SCAN] = { "scan", OB_WIFI_TIMELINE_SCAN_START, OB_WIFI_TIMELINE_SCAN_DONE },
+  [OB_WIFI_TIMELINE_PHASE_ASSOCIATE] = { "associate", OB_WIFI_TIMELINE_CONNECT_REQUEST,
+                                         OB_WIFI_TIMELINE_CONNECT_RESULT },
+  [OB_WIFI_TIMELINE_PHASE_DHCP] = { "dhcp", OB_WIFI_TIMELINE_DHCP_START, OB_WIFI_TIMELINE_DHCP_BOUND },
+  [OB_WIFI_TIMELINE_PHASE_ADDRESS] = { "address", OB_WIFI_TIMELINE_CONNECT_RESULT,
+                                       OB_WIFI_TIMELINE_ADDR_ADD },
+  [OB_WIFI_TIMELINE_PHASE_L4] = { "l4", OB_WIFI_TIMELINE_ADDR_ADD, OB_WIFI_TIMELINE_L4_CONNECTED },
+  [OB_WIFI_TIMELINE_PHASE_TOTAL] = { "total", OB_WIFI_TIMELINE_MARK_COUNT,
+                                     OB_WIFI_TIMELINE_L4_CONNECTED },
+};
+
+/** @brief protects the open timeline and the ring */
+static struct k_spinlock timeline_lock;
+/** @brief the timeline being recorded */
+static struct ob_wifi_timeline open;
+/** @brief indicates that a timeline is being recorded */
+static bool open_valid = false;
+/** @brief the completed timelines */
+static struct ob_wifi_timeline ring[CONFIG_ONBOARDING_WIFI_TIMELINE_DEPTH];
+/** @brief the index of the next entry of the ring to write */
+static int ring_head = 0;
+/** @brief the number of completed timelines in the ring */
+static int ring_count = 0;
+
+/** @brief the L4 connection manager events */
+static struct net_mgmt_event_callback l4_cb;
+
+uint64_t
+ob_wifi_timeline_now_us(void)
+{
+#ifdef CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+  return k_cyc_to_us_floor64(k_cycle_get_64());
+#else
+  return k_ticks_to_us_floor64(k_uptime_ticks());
+#endif // CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+}
+
+/**
+ * @brief start a new open timeline
+ * @details must be called with timeline_lock held
+ *
+ * @param now_us the reading of the time source
+ */
+static void
+timeline_open_locked(uint64_t now_us)
+{
+  memset(open.at_us, 0xff, sizeof(open.at_us));
+  open.start_us = now_us;
+  open_valid = true;
+}
+
+void
+ob_wifi_timeline_mark(enum ob_wifi_timeline_mark mark)
+{
+  uint64_t now_us = ob_wifi_timeline_now_us();
+  bool online = (0 != ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_NO_WAIT));
+  uint32_t total_us = OB_WIFI_TIMELINE_NONE;
+  k_spinlock_key_t key;
+
+  if(((int)mark < 0) || (mark >= OB_WIFI_TIMELINE_MARK_COUNT)) {
+    return;
+  }
+  key = k_spin_lock(&timeline_lock);
+  switch(mark) {
+  case OB_WIFI_TIMELINE_SCAN_START:
+    /* Background scans of a station that is online are not part of a bring up.
+     * A scan before the connection is requested restarts the timeline. */
+    if(online) {
+      break;
+    }
+    if(!open_valid || (OB_WIFI_TIMELINE_NONE == open.at_us[OB_WIFI_TIMELINE_CONNECT_REQUEST])) {
+      timeline_open_locked(now_us);
+    }
+    break;
+
+  case OB_WIFI_TIMELINE_CONNECT_REQUEST:
+    if(!open_valid) {
+      timeline_open_locked(now_us);
+    }
+    break;
+
+  default:
+    break;
+  }
+  if(open_valid) {
+    open.at_us[mark] = (uint32_t)MIN(now_us - open.start_us, (uint64_t)(UINT32_MAX - 1));
+    if(OB_WIFI_TIMELINE_L4_CONNECTED == mark) {
+      ring[ring_head] = open;
+      ring_head = (ring_head + 1) % CONFIG_ONBOARDING_WIFI_TIMELINE_DEPTH;
+      ring_count = MIN(ring_count + 1, CONFIG_ONBOARDING_WIFI_TIMELINE_DEPTH);
+      open_valid = false;
+      total_us = open.at_us[mark];
+    }
+  }
+  k_spin_unlock(&timeline_lock, key);
+  if(OB_WIFI_TIMELINE_NONE != total_us) {
+    LOG_INF("Online in %u ms", total_us / 1000);
+  }
+}
+
+/**
+ * @brief call back for the L4 connection manager events
+ *
+ * @param cb pointer to the network management event callback
+ * @param mgmt_event the management event
+ * @param iface the interface that generated the event
+ */
+static void
+timeline_l4_event_handler(struct net_mgmt_event_callback *cb,
+                          uint64_t mgmt_event, struct net_if *iface)
+{
+  ARG_UNUSED(cb);
+  ARG_UNUSED(iface);
+  if(NET_EVENT_L4_CONNECTED == mgmt_event) {
+    ob_wifi_timeline_mark(OB_WIFI_TIMELINE_L4_CONNECTED);
+  }
+}
+
+void
+ob_wifi_timeline_init(void)
+{
+  static bool registered = false;
+
+  if(!registered) {
+    net_mgmt_init_event_callback(&l4_cb, timeline_l4_event_handler, NET_EVENT_L4_CONNECTED);
+    net_mgmt_add_event_callback(&l4_cb);
+    registered = true;
+  }
+}
+
+int
+ob_wifi_timeline_get(int index, struct ob_wifi_timeline * timeline)
+{
+  k_spinlock_key_t key = k_spin_lock(&timeline_lock);
+  int rc = -ENOENT;
+
+  if((index >= 0) && (index < ring_count)) {
+    *timeline = ring[(ring_head + CONFIG_ONBOARDING_WIFI_TIMELINE_DEPTH - 1 - index) %
+                     CONFIG_ONBOARDING_WIFI_TIMELINE_DEPTH];
+    rc = 0;
+  }
+  k_spin_unlock(&timeline_lock, key);
+  return rc;
+}
+
+uint32_t
+ob_wifi_timeline_phase_us(const struct ob_wifi_timeline * timeline,
+                          enum ob_wifi_timeline_phase phase)
+{
+  uint32_t from;
+  uint32_t to;
+
+  if(((int)phase < 0) || (phase >= OB_WIFI_TIMELINE_PHASE_COUNT)) {
+    return OB_WIFI_TIMELINE_NONE;
+  }
+  from = (OB_WIFI_TIMELINE_MARK_COUNT == phases[phase].from) ? 0 :
+    timeline->at_us[phases[phase].from];
+  to = timeline->at_us[phases[phase].to];
+  /* Steps are kept at their last occurrence, a retry may leave them out of order */
+  if((OB_WIFI_TIMELINE_NONE == from) || (OB_WIFI_TIMELINE_NONE == to) || (to < from)) {
+    return OB_WIFI_TIMELINE_NONE;
+  }
+  return to - from;
+}
+
+int
+ob_wifi_timeline_stats(enum ob_wifi_timeline_phase phase, struct ob_wifi_timeline_stat * stat)
+{
+  struct ob_wifi_timeline timeline;
+  uint64_t total = 0;
+  uint32_t us;
+
+  if(((int)phase < 0) || (phase >= OB_WIFI_TIMELINE_PHASE_COUNT)) {
+    return -EINVAL;
+  }
+  memset(stat, 0, sizeof(*stat));
+  stat->min_us = UINT32_MAX;
+  for(int i = 0; 0 == ob_wifi_timeline_get(i, &timeline); i++) {
+    if(OB_WIFI_TIMELINE_NONE == (us = ob_wifi_timeline_phase_us(&timeline, phase))) {
+      continue;
+    }
+    stat->count++;
+    stat->min_us = MIN(stat->min_us, us);
+    stat->max_us = MAX(stat->max_us, us);
+    total += us;
+  }
+  if(0 == stat->count) {
+    stat->min_us = 0;
+  } else {
+    stat->avg_us = (uint32_t)(total / stat->count);
+  }
+  return 0;
+}
+
+void
+ob_wifi_timeline_clear(void)
+{
+  k_spinlock_key_t key = k_spin_lock(&timeline_lock);
+
+  ring_head = 0;
+  ring_count = 0;
+  k_spin_unlock(&timeline_lock, key);
+}
+
+const char *
+ob_wifi_timeline_mark_name(enum ob_wifi_timeline_mark mark)
+{
+  if(((int)mark < 0) || (mark >= OB_WIFI_TIMELINE_MARK_COUNT)) {
+    return "unknown";
+  }
+  return mark_names[mark];
+}
+
+const char *
+ob_wifi_timeline_phase_name(enum ob_wifi_timeline_phase phase)
+{
+  if(((int)phase < 0) || (phase >= OB_WIFI_TIMELINE_PHASE_COUNT)) {
+    return "unknown";
+  }
+  return phases[phase].name;
+}
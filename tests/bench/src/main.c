@@ -0,0 +1,37 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#include "ob_wifi.h"
+#include "ob_wifi_ipv4.h"
+
+/** @brief the address of the station, the frames of the simulated interface are dropped so there is no DHCP */
+#define BENCH_APP_ADDRESS "192.0.2.10"
+/** @brief the network mask of the station */
+#define BENCH_APP_NETMASK "255.255.255.0"
+
+/**
+ * @brief initialize the wifi, the benchmark starts once the configuration is loaded
+ */
+int
+main(void)
+{
+  struct ob_wifi_ipv4_config ipv4;
+  int rc;
+
+  if(0 != (rc = ob_wifi_init())) {
+    printk("{\"error\":\"wifi init %d\"}\n", rc);
+    return rc;
+  }
+  if((0 != (rc = ob_wifi_ipv4_parse(BENCH_APP_ADDRESS, BENCH_APP_NETMASK, NULL, NULL, &ipv4))) ||
+     (0 != (rc = ob_wifi_ipv4_set(&ipv4)))) {
+    printk("{\"error\":\"static IPv4 %d\"}\n", rc);
+    return rc;
+  }
+  return 0;
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "harness.h"
+
+/**
+ * @file
+ * @brief Throughput benchmark of the HTTP request and POST parsers.
+ *
+ * Every request file given on the command line is parsed -n times (1000 by
+ * default) in two ways:
+ * - server: the request line and headers one byte at a time and the body
+ *   in 64 byte chunks, as the web server receives them
+ * - bulk: the request line, the headers and the body in one chunk each
+ *
+ * One JSON object is printed per file and way with the number of bytes,
+ * the cycles (nanoseconds where the cycle counter is not read) per byte and
+ * the calls to malloc, calloc and realloc per request, followed by a total
+ * over the corpus. The allocations are counted when the benchmark is linked
+ * with --wrap for these functions, as CMakeLists.txt does with GNU ld.
+ */
+
+/** @brief the default number of iterations */
+#define BENCH_ITERATIONS 1000
+
+/** @brief the chunk size of the body in the server way, POST_RECV_BUFFER_SIZE of the web server */
+#define BENCH_POST_CHUNK 64
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+/** @brief the unit of the timings */
+#define BENCH_UNIT "cycles"
+
+/**
+ * @brief read the time stamp counter
+ */
+static inline uint64_t bench_now(void)
+{
+  return __rdtsc();
+}
+#else
+/** @brief the unit of the timings */
+#define BENCH_UNIT "ns"
+
+/**
+ * @brief read the monotonic clock
+ */
+static inline uint64_t bench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000u) + ts.tv_nsec;
+}
+#endif
+
+/** @brief the number of allocations since the last reset */
+static unsigned long bench_allocs;
+
+#ifdef BENCH_WRAP_ALLOC
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+  bench_allocs++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+  bench_allocs++;
+  return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  bench_allocs++;
+  return __real_realloc(ptr, size);
+}
+#endif // BENCH_WRAP_ALLOC
+
+/**
+ * @brief format the allocations per request
+ *
+ * @param buf the buffer receiving the JSON value
+ * @param size the size of buf
+ * @param allocs the number of allocations
+ * @param requests the number of requests
+ * @return buf, holding null when the allocations are not counted
+ */
+static const char *bench_allocs_str(char *buf, size_t size, unsigned long allocs, double requests)
+{
+#ifdef BENCH_WRAP_ALLOC
+  snprintf(buf, size, "%.2f", (double)allocs / requests);
+#else
+  (void)allocs;
+  (void)requests;
+  snprintf(buf, size, "null");
+#endif // BENCH_WRAP_ALLOC
+  return buf;
+}
+
+/**
+ * @brief one byte at a time, the way the web server reads the request
+ */
+static size_t bench_byte_chunk(void *user_data, size_t remaining)
+{
+  (void)user_data;
+  (void)remaining;
+  return 1;
+}
+
+/**
+ * @brief the chunks of the body in the web server
+ */
+static size_t bench_post_chunk(void *user_data, size_t remaining)
+{
+  (void)user_data;
+  return (remaining < BENCH_POST_CHUNK) ? remaining : BENCH_POST_CHUNK;
+}
+
+/**
+ * @brief everything that is left in one chunk
+ */
+static size_t bench_bulk_chunk(void *user_data, size_t remaining)
+{
+  (void)user_data;
+  return remaining;
+}
+
+/**
+ * @struct bench_way
+ * @brief how a request is split
+ */
+struct bench_way {
+  /** @brief the name of the way */
+  const char *name;
+  /** @brief the chunks of the request line and headers */
+  harness_chunk_t request_chunk;
+  /** @brief the chunks of the body */
+  harness_chunk_t post_chunk;
+  /** @brief the bytes parsed over the corpus */
+  uint64_t bytes;
+  /** @brief the time spent over the corpus */
+  uint64_t time;
+  /** @brief the allocations over the corpus */
+  unsigned long allocs;
+};
+
+/**
+ * @brief read a file
+ *
+ * @param path the path of the file
+ * @param[out] len the size of the file
+ * @return the content of the file, to be freed, NULL on error
+ */
+static char *bench_read(const char *path, size_t *len)
+{
+  char *data = NULL;
+  FILE *fp;
+  long size;
+
+  if(NULL == (fp = fopen(path, "rb"))) {
+    perror(path);
+    return NULL;
+  }
+  if((0 == fseek(fp, 0, SEEK_END)) && ((size = ftell(fp)) > 0) &&
+     (0 == fseek(fp, 0, SEEK_SET)) && (NULL != (data = malloc(size)))) {
+    if((size_t)size == fread(data, 1, size, fp)) {
+      *len = size;
+    } else {
+      free(data);
+      data = NULL;
+    }
+  }
+  fclose(fp);
+  if(NULL == data) {
+    fprintf(stderr, "%s: read failed\n", path);
+  }
+  return data;
+}
+
+int main(int argc, char **argv)
+{
+  struct bench_way ways[] = {
+    { .name = "server", .request_chunk = bench_byte_chunk, .post_chunk = bench_post_chunk },
+    { .name = "bulk", .request_chunk = bench_bulk_chunk, .post_chunk = bench_bulk_chunk },
+  };
+  struct harness_result result;
+  unsigned long iterations = BENCH_ITERATIONS;
+  unsigned long allocs;
+  unsigned long n;
+  uint64_t start;
+  uint64_t time;
+  size_t len;
+  size_t w;
+  char allocs_str[32];
+  char *data;
+  int first = 1;
+  int files = 0;
+  int i;
+
+  if((argc > 2) && (0 == strcmp(argv[1], "-n"))) {
+    iterations = strtoul(argv[2], NULL, 0);
+    first = 3;
+  }
+  if((0 == iterations) || (first >= argc)) {
+    fprintf(stderr, "usage: %s [-n iterations] request...\n", argv[0]);
+    return 1;
+  }
+
+  for(i = first; i < argc; i++) {
+    if(NULL == (data = bench_read(argv[i], &len))) {
+      return 1;
+    }
+    for(w = 0; w < sizeof(ways) / sizeof(ways[0]); w++) {
+      harness_run(data, len, ways[w].request_chunk, ways[w].post_chunk, NULL, &result);
+      if((OB_HTTP_PARSE_DONE != result.request) || (0 != result.post)) {
+        fprintf(stderr, "%s: parse failed %d %d\n", argv[i], result.request, result.post);
+        free(data);
+        return 1;
+      }
+      bench_allocs = 0;
+      start = bench_now();
+      for(n = 0; n < iterations; n++) {
+        harness_run(data, len, ways[w].request_chunk, ways[w].post_chunk, NULL, &result);
+      }
+      time = bench_now() - start;
+      allocs = bench_allocs;
+      ways[w].bytes += (uint64_t)len * iterations;
+      ways[w].time += time;
+      ways[w].allocs += allocs;
+      printf("{\"file\":\"%s\",\"way\":\"%s\",\"bytes\":%zu,\"%s_per_byte\":%.2f,\"allocs\":%s}\n",
+             argv[i], ways[w].name, len, BENCH_UNIT,
+             (double)time / ((double)len * iterations),
+             bench_allocs_str(allocs_str, sizeof(allocs_str), allocs, iterations));
+    }
+    free(data);
+    files++;
+  }
+  for(w = 0; w < sizeof(ways) / sizeof(ways[0]); w++) {
+    printf("{\"total\":\"%s\",\"files\":%d,\"iterations\":%lu,\"%s_per_byte\":%.2f,\"allocs\":%s}\n",
+           ways[w].name, files, iterations, BENCH_UNIT,
+           (double)ways[w].time / (double)ways[w].bytes,
+           bench_allocs_str(allocs_str, sizeof(allocs_str), ways[w].allocs,
+                            (double)iterations * files));
+  }
+  return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "harness.h"
+
+/**
+ * @file
+ * @brief libFuzzer target of the HTTP request and POST parsers.
+ *
+ * The input is the request. The split points come from a generator seeded
+ * with a hash of the input, so the request files of the corpus can be used
+ * as they are and a mutation moves the split points as well. Each chunk is
+ * 1 to 64 bytes long, so the parsers see every state resumed at an
+ * arbitrary byte.
+ */
+
+/** @brief the largest chunk */
+#define FUZZ_MAX_CHUNK 64
+
+/**
+ * @brief choose the next split point from a xorshift generator
+ */
+static size_t fuzz_chunk(void *user_data, size_t remaining)
+{
+  uint32_t *state = user_data;
+  size_t chunk;
+
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  chunk = 1 + (*state % FUZZ_MAX_CHUNK);
+  return (chunk < remaining) ? chunk : remaining;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct harness_result result;
+  uint32_t state = 2166136261u;
+  size_t i;
+
+  /* FNV-1a */
+  for(i = 0; i < size; i++) {
+    state = (state ^ data[i]) * 16777619u;
+  }
+  if(0 == state) {
+    state = 1;
+  }
+  harness_run((const char *)data, size, fuzz_chunk, fuzz_chunk, &state, &result);
+  return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @file
+ * @brief Runs the fuzz target over files when libFuzzer is not available.
+ *
+ * Each file is given to LLVMFuzzerTestOneInput() once, as libFuzzer does
+ * when it is started with files instead of a corpus directory.
+ */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int main(int argc, char **argv)
+{
+  uint8_t *data;
+  FILE *fp;
+  long size;
+  int i;
+
+  for(i = 1; i < argc; i++) {
+    if(NULL == (fp = fopen(argv[i], "rb"))) {
+      perror(argv[i]);
+      return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if((size < 0) || (NULL == (data = malloc(size ? size : 1))) ||
+       ((size_t)size != fread(data, 1, size, fp))) {
+      fprintf(stderr, "%s: read failed\n", argv[i]);
+      fclose(fp);
+      return 1;
+    }
+    fclose(fp);
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    printf("Executed %s\n", argv[i]);
+  }
+  return 0;
+}
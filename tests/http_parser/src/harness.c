@@ -0,0 +1,82 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+
+/** @brief the number of attributes known to the harness */
+#define HARNESS_ATTRIBUTES 6
+
+/**
+ * @brief the attributes of the setup and IPv4 pages of the captive portal
+ */
+static post_attributes_t harness_attrib[HARNESS_ATTRIBUTES] = {
+  { .name = "ssid", .length = 4 },
+  { .name = "password", .length = 8 },
+  { .name = "address", .length = 7 },
+  { .name = "netmask", .length = 7 },
+  { .name = "gateway", .length = 7 },
+  { .name = "dns", .length = 3 },
+};
+
+void harness_run(const char *buf, size_t len, harness_chunk_t request_chunk,
+                 harness_chunk_t post_chunk, void *user_data,
+                 struct harness_result *result)
+{
+  struct ob_http_request_parser request;
+  struct ob_post_parser post;
+  size_t offset = 0;
+  size_t chunk;
+  size_t used;
+  size_t body;
+  int i;
+
+  memset(result, 0, sizeof(*result));
+  ob_http_request_parser_init(&request);
+  result->request = OB_HTTP_PARSE_MORE;
+  while((offset < len) && (OB_HTTP_PARSE_MORE == result->request)) {
+    chunk = request_chunk(user_data, len - offset);
+    result->request = ob_http_request_parser_feed(&request, buf + offset, chunk, &used);
+    if(used > chunk) {
+      abort();
+    }
+    offset += used;
+  }
+  if(NULL == memchr(request.path, '\0', sizeof(request.path))) {
+    abort();
+  }
+  if((OB_HTTP_PARSE_DONE == result->request) &&
+     ((request.content_length < 0) || (request.content_length > OB_HTTP_MAX_CONTENT_LENGTH))) {
+    abort();
+  }
+  result->method = request.method;
+  result->content_length = request.content_length;
+  if((OB_HTTP_PARSE_DONE != result->request) || (OB_HTTP_METHOD_POST != request.method)) {
+    return;
+  }
+
+  body = len - offset;
+  if(body > (size_t)request.content_length) {
+    body = request.content_length;
+  }
+  ob_post_parser_init(&post, harness_attrib, HARNESS_ATTRIBUTES);
+  while((body > 0) && (0 == result->post)) {
+    chunk = post_chunk(user_data, body);
+    result->post = ob_post_parser_feed(&post, buf + offset, chunk);
+    offset += chunk;
+    body -= chunk;
+  }
+  if(0 == result->post) {
+    result->post = ob_post_parser_finish(&post);
+  }
+  for(i = 0; i < HARNESS_ATTRIBUTES; i++) {
+    if(NULL == memchr(harness_attrib[i].valuebuffer, '\0', VALUE_BUFFER_SIZE)) {
+      abort();
+    }
+  }
+}
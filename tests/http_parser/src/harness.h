@@ -0,0 +1,60 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+#pragma once
+
+#include <stddef.h>
+
+#include "ob_http_parser.h"
+
+/**
+ * @file
+ * @brief Drives the HTTP parsers over a request held in memory.
+ *
+ * The request line and headers go through ob_http_request_parser_feed() and
+ * the body of a POST, bounded by its Content-Length, through
+ * ob_post_parser_feed() and ob_post_parser_finish() with the attributes of
+ * the captive portal pages. The data is split into chunks chosen by the
+ * caller, as recv() would return it. The invariants of the parsers are
+ * checked after each request and a violation aborts.
+ */
+
+/**
+ * @brief choose the size of the next chunk
+ *
+ * @param user_data the user data given to harness_run()
+ * @param remaining the number of bytes left, at least 1
+ * @return the size of the chunk, between 1 and remaining
+ */
+typedef size_t (*harness_chunk_t)(void *user_data, size_t remaining);
+
+/**
+ * @struct harness_result
+ * @brief the outcome of a request
+ */
+struct harness_result {
+  /** @brief the result of the request parser */
+  ob_http_parse_result_t request;
+  /** @brief the method of the request */
+  ob_http_method_t method;
+  /** @brief the Content-Length of the request */
+  int content_length;
+  /** @brief the result of the POST parser, 0 if the request has no body */
+  int post;
+};
+
+/**
+ * @brief parse a request
+ *
+ * @param buf the request
+ * @param len the number of bytes in buf
+ * @param request_chunk the chunk sizes of the request line and headers
+ * @param post_chunk the chunk sizes of the body
+ * @param user_data passed to the chunk functions
+ * @param[out] result the outcome of the request
+ */
+void harness_run(const char *buf, size_t len, harness_chunk_t request_chunk,
+                 harness_chunk_t post_chunk, void *user_data,
+                 struct harness_result *result);
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2025 Beechwoods Software, Inc brad@beechwoods.com
+ * All Rights Reserved
+ * SPDX-License-Identifier: Apache 2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/wifi.h>
+#include <zephyr/ztest.h>
+
+#include "ob_captive_portal.h"
+#include "ob_wifi.h"
+#include "ob_wifi_ipv4.h"
+#include "ob_wifi_profile.h"
+#include "ob_wifi_sim.h"
+
+/** @brief the time a step of the bring-up may take in milliseconds */
+#define WIFI_SIM_TIMEOUT_MS 30000
+/** @brief the time a step of the bring-up may take */
+#define WIFI_SIM_TIMEOUT K_MSEC(WIFI_SIM_TIMEOUT_MS)
+/** @brief the time between two checks of the station in milliseconds */
+#define WIFI_SIM_POLL_MS 10
+/** @brief the address of the station, the frames of the simulated interface are dropped so there is no DHCP */
+#define WIFI_SIM_ADDRESS "192.0.2.10"
+/** @brief the network mask of the station */
+#define WIFI_SIM_NETMASK "255.255.255.0"
+/** @brief a passphrase the simulated AP refuses */
+#define WIFI_SIM_WRONG_PSK "not-the-passphrase"
+
+/** @brief the first AP of CONFIG_ONBOARDING_WIFI_SIM_APS */
+static struct ob_wifi_sim_ap sim_ap;
+/** @brief the outcome of the last ob_wifi_connect_async() of a test */
+static struct ob_wifi_connect_result connect_result;
+/** @brief given once connect_result is set */
+static K_SEM_DEFINE(connect_sem, 0, 1);
+
+/**
+ * @brief record the outcome of a connection
+ */
+static void
+wifi_sim_connect_done(const struct ob_wifi_connect_result * result, void * user_data)
+{
+  ARG_UNUSED(user_data);
+  connect_result = *result;
+  k_sem_give(&connect_sem);
+}
+
+/**
+ * @brief check if a profile is saved for an SSID
+ *
+ * @param ssid the SSID
+ * @return true if the profile is saved
+ */
+static bool
+wifi_sim_has_profile(const char * ssid)
+{
+  struct ob_wifi_profile profile;
+  bool found = false;
+  int i;
+
+  for(i = 0; (i < CONFIG_ONBOARDING_WIFI_PROFILES) && !found; i++) {
+    found = (0 == ob_wifi_profile_get(i, &profile)) && (0 == strcmp(profile.ssid, ssid));
+  }
+  memset(&profile, 0, sizeof(profile));
+  return found;
+}
+
+/**
+ * @brief wait for a profile to be saved for an SSID
+ *
+ * @param ssid the SSID
+ * @return true if the profile was saved in time
+ */
+static bool
+wifi_sim_wait_profile(const char * ssid)
+{
+  int64_t deadline = k_uptime_get() + WIFI_SIM_TIMEOUT_MS;
+
+  while(!wifi_sim_has_profile(ssid)) {
+    if(k_uptime_get() > deadline) {
+      return false;
+    }
+    k_sleep(K_MSEC(WIFI_SIM_POLL_MS));
+  }
+  return true;
+}
+
+/**
+ * @brief remove every profile so the bring-up asks for credentials
+ */
+static void
+wifi_sim_remove_profiles(void)
+{
+  struct ob_wifi_profile profile;
+  int i;
+
+  for(i = 0; i < CONFIG_ONBOARDING_WIFI_PROFILES; i++) {
+    if(0 == ob_wifi_profile_get(i, &profile)) {
+      ob_wifi_profile_remove(profile.ssid);
+    }
+  }
+  memset(&profile, 0, sizeof(profile));
+}
+
+/**
+ * @brief make the simulated AP drop the station and wait for the disconnect
+ */
+static void
+wifi_sim_offline(void)
+{
+  int64_t deadline = k_uptime_get() + WIFI_SIM_TIMEOUT_MS;
+
+  zassert_ok(ob_wifi_sim_drop(), "the station is not connected");
+  while(0 != ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_NO_WAIT)) {
+    zassert_true(k_uptime_get() <= deadline, "the disconnect was not handled");
+    k_sleep(K_MSEC(WIFI_SIM_POLL_MS));
+  }
+}
+
+/**
+ * @brief drop the station with no profile left and wait for the bring-up to ask for credentials
+ */
+static void
+wifi_sim_need_credentials(void)
+{
+  wifi_sim_remove_profiles();
+  wifi_sim_offline();
+  zassert_not_equal(ob_wifi_wait_events(OB_WIFI_EVENT_NEED_CREDENTIALS, WIFI_SIM_TIMEOUT), 0,
+                    "the bring-up did not ask for credentials");
+  zassert_equal(ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_NO_WAIT), 0);
+}
+
+/**
+ * @brief start the wifi once with a static address on the simulated interface
+ */
+static void *
+wifi_sim_setup(void)
+{
+  struct ob_wifi_ipv4_config ipv4;
+
+  zassert_ok(ob_wifi_init());
+  zassert_ok(ob_wifi_ipv4_parse(WIFI_SIM_ADDRESS, WIFI_SIM_NETMASK, NULL, NULL, &ipv4));
+  zassert_ok(ob_wifi_ipv4_set(&ipv4));
+  zassert_not_equal(ob_wifi_wait_events(OB_WIFI_EVENT_CONFIG_LOADED, WIFI_SIM_TIMEOUT), 0);
+  zassert_equal(ob_wifi_sim_aps(&sim_ap, 1), 1, "CONFIG_ONBOARDING_WIFI_SIM_APS is empty");
+  zassert_not_equal(sim_ap.psk[0], '\0', "the first simulated AP must have a passphrase");
+  return NULL;
+}
+
+/**
+ * @brief start every test online with the credentials of the first simulated AP
+ */
+static void
+wifi_sim_before(void * fixture)
+{
+  ARG_UNUSED(fixture);
+  k_sem_reset(&connect_sem);
+  ob_wifi_sim_ap_psk(sim_ap.ssid, sim_ap.psk);
+  zassert_ok(ob_wifi_save_credentials(sim_ap.ssid, sim_ap.psk));
+  zassert_not_equal(ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, WIFI_SIM_TIMEOUT), 0,
+                    "the station did not connect with the saved credentials");
+}
+
+ZTEST(wifi_sim, test_stored_credentials)
+{
+  wifi_sim_offline();
+  zassert_not_equal(ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, WIFI_SIM_TIMEOUT), 0,
+                    "the station did not reconnect with the saved profile");
+  zassert_equal(ob_wifi_wait_events(OB_WIFI_EVENT_NEED_CREDENTIALS, K_NO_WAIT), 0,
+                "credentials were asked for with a saved profile");
+  zassert_true(wifi_sim_has_profile(sim_ap.ssid));
+}
+
+ZTEST(wifi_sim, test_portal_join)
+{
+  wifi_sim_need_credentials();
+  zassert_ok(ob_cp_join(sim_ap.ssid, sim_ap.psk));
+  zassert_not_equal(ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, WIFI_SIM_TIMEOUT), 0,
+                    "the station did not connect with the credentials of the portal");
+  zassert_true(wifi_sim_wait_profile(sim_ap.ssid), "the credentials of the portal were not saved");
+}
+
+ZTEST(wifi_sim, test_wrong_psk)
+{
+  struct ob_wifi_connect_params params = {
+    .ssid = sim_ap.ssid,
+    .psk = WIFI_SIM_WRONG_PSK,
+    .max_attempts = 1
+  };
+
+  wifi_sim_need_credentials();
+  zassert_ok(ob_wifi_connect_async(&params, wifi_sim_connect_done, NULL));
+  zassert_ok(k_sem_take(&connect_sem, WIFI_SIM_TIMEOUT), "the connection did not complete");
+  zassert_equal(connect_result.reason, OB_WIFI_CONNECT_ERR_ASSOC, "reason %s",
+                ob_wifi_connect_reason_str(connect_result.reason));
+  zassert_equal(connect_result.status, WIFI_STATUS_CONN_WRONG_PASSWORD);
+  zassert_equal(ob_wifi_wait_events(OB_WIFI_EVENT_STA_CONNECTED, K_NO_WAIT), 0);
+  zassert_not_equal(ob_wifi_wait_events(OB_WIFI_EVENT_NEED_CREDENTIALS, K_NO_WAIT), 0);
+  zassert_false(wifi_sim_has_profile(sim_ap.ssid));
+}
+
+ZTEST_SUITE(wifi_sim, NULL, wifi_sim_setup, wifi_sim_before, NULL, NULL);